@@ -0,0 +1,80 @@
+/**
+ * AccelEstimator - tilt estimate for window navigation and tilt bend
+ *
+ * Runs at a fixed step (the accelerometer read interval) whatever the
+ * jitter of individual samples: each sample advances the state by the
+ * number of whole steps since the previous one.
+ *
+ * Per axis, a scalar Kalman filter tracks the gravity component. The
+ * measurement is the raw reading normalized to 1 g, so shaking along the
+ * gravity direction cancels, and its noise variance grows with the
+ * deviation of |a| from 1 g, so jolts are mostly ignored.
+ *
+ * The calibrated center is the reference for every tilt. While the hand is
+ * near level and not navigating, the center slowly follows the estimate,
+ * so sensor bias and small posture changes do not build up.
+ *
+ * Navigation integrates X tilt beyond a dead zone into a position in
+ * semitones. The window offset only moves once the position passes a
+ * semitone boundary by a hysteresis margin, so it cannot chatter.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class AccelEstimator {
+public:
+  /**
+   * stepMicros: fixed update step (the read interval)
+   * maxOffset: window offset limit, in semitones either side
+   */
+  void Init(uint32_t stepMicros, int maxOffset);
+
+  /**
+   * Seed state and center from one reading (m/s^2)
+   */
+  void Reset(float x, float y, float z);
+
+  /**
+   * Feed one sample; sensitivity > 0 navigates at that many semitones per
+   * second per m/s^2 of tilt, 0 holds the position and allows bias tracking
+   */
+  void Update(const float accel[3], uint32_t timestampMicros, float sensitivity);
+
+  /**
+   * Make the current tilt the center and return the window to 0
+   */
+  void Recenter();
+
+  /**
+   * Restore a stored center (m/s^2) and window offset
+   */
+  void SetCenter(float x, float y);
+  void SetWindowOffset(int windowOffset);
+
+  float TiltX() const { return stateX - centerX; }  // Filtered tilt from center (m/s^2)
+  float TiltY() const { return stateY - centerY; }
+  float CenterX() const { return centerX; }
+  float CenterY() const { return centerY; }
+  float Position() const { return position; }        // Unquantized window position
+  int WindowOffset() const { return offset; }
+
+private:
+  void filterAxis(float &state, float &variance, float measurement, float noise, uint32_t steps);
+
+  float stepSeconds = 0.004f;
+  uint32_t stepMicros = 4000;
+  int maxOffset = 24;
+
+  bool seeded = false;
+  uint32_t lastMicros = 0;
+  float stateX = 0.0f;
+  float stateY = 0.0f;
+  float varianceX = 1.0f;
+  float varianceY = 1.0f;
+  float centerX = 0.0f;
+  float centerY = 0.0f;
+  float position = 0.0f;
+  int offset = 0;
+};
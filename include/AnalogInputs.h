@@ -0,0 +1,74 @@
+/**
+ * AnalogInputs - pots and pedals sampled by DMA, filtered at control rate
+ *
+ * ADC1 converts every configured pin in one continuous scan with hardware
+ * oversampling (libDaisy's AdcHandle: 32 conversions averaged in the ADC,
+ * a 16-bit result per pin), and DMA writes each result into a buffer. No
+ * conversion is ever started or waited for on the CPU: Read() copies the
+ * latest results out of that buffer.
+ *
+ * Filter() then runs each input through a one-pole IIR (its own cutoff,
+ * at the fixed rate of the caller) and a dead band: the value only moves
+ * once the filtered reading leaves a band around it, so a knob left alone
+ * reads perfectly still instead of flickering in the last bits. Values
+ * are kept as 16-bit levels, so a trace can record and replay them exactly.
+ *
+ * Another input is one more channel in the same DMA scan and a few
+ * multiplies per Filter(); the control task does not run any more often.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "DaisyDuino.h"
+
+const int ANALOG_MAX_INPUTS = 8;
+const float ANALOG_FULL_SCALE = 65535.0f;
+
+struct AnalogInputConfig {
+  dsy_gpio_pin pin;
+  float cutoffHz;       // IIR cutoff
+  float deadBand;       // Fraction of full scale the filtered value must move by
+};
+
+/**
+ * Perceptual taper: knob position 0-1 to a gain spanning rangeDb, 1 = 0 dB;
+ * positions below offBelow are silent
+ */
+float analogDbTaper(float position, float rangeDb, float offBelow);
+
+class AnalogInputs {
+public:
+  /**
+   * Configure the pins and start the DMA scan; updateHz is how often
+   * Filter() will be called
+   */
+  bool Init(const AnalogInputConfig *configs, int count, float updateHz);
+
+  /**
+   * Latest oversampled readings (16-bit), one per input
+   */
+  void Read(uint16_t *raw) const;
+
+  /**
+   * Filter one reading per input; true if any value moved
+   */
+  bool Filter(const uint16_t *raw);
+
+  /**
+   * Filtered, dead-banded level (0-65535) and the same as 0-1
+   */
+  uint16_t Level(int input) const { return level[input]; }
+  float Value(int input) const { return (float)level[input] / ANALOG_FULL_SCALE; }
+  int Count() const { return numInputs; }
+
+private:
+  daisy::AdcHandle adc;
+  int numInputs = 0;
+  bool primed = false;                  // First Filter() starts at the reading
+  float coefficient[ANALOG_MAX_INPUTS];
+  float deadBand[ANALOG_MAX_INPUTS];
+  float filtered[ANALOG_MAX_INPUTS];
+  uint16_t level[ANALOG_MAX_INPUTS];
+};
@@ -0,0 +1,148 @@
+/**
+ * Arpeggiator - arpeggio and strum patterns on the audio sample clock
+ *
+ * Held note ids go into a pool sorted by pitch. The rate patterns (up,
+ * down, up-down, random) step through the pool at a fixed number of
+ * samples per step, each step sounding one note for ARP_GATE of the step;
+ * the strum pattern starts each newly held note ARP_STRUM_SPREAD of a step
+ * after the previous one and holds it until it is released.
+ *
+ * Process() runs on the audio side once per callback and returns the note
+ * on/off events due in that callback with their sample offsets. Steps are
+ * counted in samples, not read from a clock, so their spacing is exact
+ * whatever the control loop is doing; pool changes (Hold/Release) take
+ * effect at the sample offset they are given, so the first note of an
+ * arpeggio starts exactly when a directly played note would have.
+ *
+ * Audio side only: SynthEngine feeds it from its event queue.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum ArpPattern : uint8_t {
+  ARP_OFF = 0,       // Notes play directly, nothing is pooled
+  ARP_UP = 1,        // Lowest to highest, repeat
+  ARP_DOWN = 2,      // Highest to lowest, repeat
+  ARP_UP_DOWN = 3,   // Up then down, ends not repeated
+  ARP_RANDOM = 4,    // Random held note each step (never the same twice running)
+  ARP_STRUM = 5,     // Chord tones start one after another and hold
+  NUM_ARP_PATTERNS = 6
+};
+
+const int ARP_MAX_NOTES = 64;            // Note ids the pool can hold
+const int ARP_MAX_PENDING = 64;          // Pool changes per callback (the event queue size)
+const size_t ARP_MAX_EVENTS = 128;       // Note events one Process() call can return
+const float ARP_GATE = 0.5f;             // Share of a step each arpeggio note sounds
+const float ARP_STRUM_SPREAD = 0.25f;    // Strum spacing as a share of a step
+const float ARP_RATE_MIN = 0.5f;         // Steps per second
+const float ARP_RATE_MAX = 50.0f;
+
+struct ArpEvent {
+  int32_t offset;     // Sample offset into the callback
+  uint8_t note;       // Note id
+  bool on;            // Note on, else note off
+  float pitch;        // MIDI pitch (note on)
+};
+
+class Arpeggiator {
+public:
+  void Init(float sampleRate);
+
+  /**
+   * Change pattern: sounding notes stop, the held pool starts over in the
+   * new pattern (strum re-strums it)
+   */
+  void SetPattern(ArpPattern pattern);
+  ArpPattern Pattern() const { return pattern; }
+
+  /**
+   * Steps per second, clamped to ARP_RATE_MIN..ARP_RATE_MAX; takes effect
+   * from the next step
+   */
+  void SetRate(float stepsPerSecond);
+
+  /**
+   * Add a note id to the pool, offset samples into the next Process()
+   */
+  void Hold(int note, float pitch, int32_t offset);
+
+  /**
+   * Remove a note id from the pool (stopping it if it sounds)
+   */
+  void Release(int note, int32_t offset);
+
+  /**
+   * New pitch for a pooled note (used from its next step)
+   */
+  void SetPitch(int note, float pitch);
+
+  /**
+   * Advance n samples; writes the note events due in them, in time order,
+   * and returns how many (at most max; any beyond are dropped and counted)
+   */
+  size_t Process(size_t n, ArpEvent *events, size_t max);
+
+  uint32_t DroppedEvents() const { return dropped; }
+
+private:
+  struct PoolEntry {
+    uint8_t note;
+    float pitch;
+  };
+
+  struct PoolChange {
+    int32_t offset;
+    uint8_t note;
+    bool hold;
+    float pitch;
+  };
+
+  void emit(int32_t offset, int note, bool on, float pitch);
+  int poolIndex(int note) const;
+  void insertPool(int note, float pitch);
+  void removePool(int note);
+  int nextPosition();
+  void advance(int32_t samples);
+  void stopAll(int32_t offset);
+  void restart();
+  void applyChange(const PoolChange &change, int32_t offset);
+  void step(int32_t offset);
+  void strum(int note, float pitch, int32_t offset);
+
+  float sampleRate = 48000.0f;
+  ArpPattern pattern = ARP_OFF;
+  int32_t stepSamples = 12000;
+  int32_t gateSamples = 6000;
+  int32_t strumSamples = 3000;
+
+  PoolEntry pool[ARP_MAX_NOTES];       // Ascending pitch
+  int poolCount = 0;
+  PoolChange pending[ARP_MAX_PENDING];
+  int pendingCount = 0;
+  uint64_t sounding = 0;               // Note ids this arpeggiator has started and not stopped
+  bool restartPending = false;
+
+  // Rate patterns
+  bool running = false;
+  int32_t stepCountdown = 0;           // Samples to the next step
+  int32_t gateCountdown = -1;          // Samples to the current note's end, -1 if none
+  int current = -1;                    // Note id of the current step
+  int position = -1;                   // Pool index of the current step
+  int direction = 1;                   // Up-down travel
+  uint32_t randomState = 1;
+
+  // Strum
+  PoolEntry strumQueue[ARP_MAX_NOTES]; // Waiting to start, oldest first
+  int strumCount = 0;
+  int32_t strumCountdown = 0;          // Samples to the next queued start
+  int32_t sinceStrum = 0;              // Samples since the last start (saturating)
+
+  // Output of the current Process() call
+  ArpEvent *out = nullptr;
+  size_t outCount = 0;
+  size_t outMax = 0;
+  uint32_t dropped = 0;
+};
@@ -0,0 +1,66 @@
+/**
+ * ButtonScanner - timer-driven button sampling with integrator debounce
+ *
+ * Scan() runs from a hardware timer interrupt at a fixed rate. Each scan
+ * reads every button pin into a bit mask and runs it through a 3-bit
+ * vertical counter, one counter per bit evaluated for all buttons at once:
+ * a button's debounced state only flips after BUTTON_DEBOUNCE_SAMPLES
+ * consecutive samples disagree with it, and any agreeing sample restarts
+ * the count, so contact bounce never produces an edge.
+ *
+ * A scan that flips any state pushes one ButtonEdge (scan time, full
+ * debounced mask) into a lock-free queue for loop(). Edge times are
+ * exact to the scan period whatever loop() was doing, so note events can
+ * be scheduled from them rather than from when loop() got around to it.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "SpscQueue.h"
+
+const int BUTTON_SCAN_BITS = 16;              // Buttons one scanner can watch
+const int BUTTON_DEBOUNCE_SAMPLES = 8;        // Fixed by the 3-bit counter
+const uint32_t BUTTON_EDGE_QUEUE_SIZE = 32;
+
+struct ButtonEdge {
+  uint32_t timeMicros;   // Scan that completed the debounce
+  uint16_t buttons;      // Debounced mask after the change (bit set = pressed)
+};
+
+class ButtonScanner {
+public:
+  /**
+   * pins[bit] is the pin of that mask bit, -1 if unused; buttons are
+   * active low (INPUT_PULLUP). The caller sets the pin modes.
+   */
+  void Init(const int *pins, int numBits);
+
+  /**
+   * Sample every pin and debounce (timer interrupt only)
+   */
+  void Scan(uint32_t nowMicros);
+
+  /**
+   * Next debounced edge, oldest first (loop() only)
+   */
+  bool Pop(ButtonEdge &edge) { return edges.Pop(edge); }
+
+  uint16_t State() const { return state.load(std::memory_order_relaxed); }
+  uint32_t Scans() const { return scans.load(std::memory_order_relaxed); }
+  uint32_t DroppedEdges() const { return edges.Dropped(); }
+
+private:
+  uint16_t readPins() const;
+
+  int pinForBit[BUTTON_SCAN_BITS];
+  int numBits = 0;
+  uint16_t count0 = 0xFFFF;   // Vertical counter bits, all at rest (7)
+  uint16_t count1 = 0xFFFF;
+  uint16_t count2 = 0xFFFF;
+  std::atomic<uint16_t> state{0};
+  std::atomic<uint32_t> scans{0};
+  SpscQueue<ButtonEdge, BUTTON_EDGE_QUEUE_SIZE> edges;
+};
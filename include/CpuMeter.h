@@ -0,0 +1,90 @@
+/**
+ * CpuMeter - audio callback load instrumentation
+ *
+ * Wrap the callback body in CPU_METER_BEGIN() / CPU_METER_END(size) to
+ * record how many ticks each block took against its deadline (block length
+ * in samples / sample rate). On the Cortex-M7 a tick is one CPU cycle from
+ * the DWT cycle counter; on a host build it is one nanosecond from
+ * std::chrono::steady_clock, so offline renders report the same metrics.
+ *
+ * The meter keeps the average, the peak, overruns and a histogram of load
+ * in 10% buckets. Record() runs in the audio interrupt; Snapshot() can be
+ * called from loop() at any time and retries if a block lands mid-copy.
+ *
+ * Build with -D CPU_METER_ENABLED=0 to compile the instrumentation out.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CPU_METER_ENABLED
+#define CPU_METER_ENABLED 1
+#endif
+
+const int CPU_HIST_BUCKETS = 11;  // 0-10%, 10-20%, ... 90-100%, overrun
+
+struct CpuStats {
+  uint32_t blocks;          // Blocks measured since the last reset
+  uint64_t totalTicks;      // Sum of ticks spent in the callback
+  uint64_t totalBudget;     // Sum of block deadlines in ticks
+  uint32_t peakTicks;       // Slowest block
+  uint32_t peakBudget;      // Deadline of the slowest block
+  uint32_t overruns;        // Blocks that took longer than their deadline
+  uint32_t histogram[CPU_HIST_BUCKETS];
+};
+
+class CpuMeter {
+public:
+  /**
+   * Start the cycle counter and compute ticks per sample
+   */
+  void Init(float sampleRate);
+
+  /**
+   * Record one callback (audio interrupt only)
+   */
+  void Record(uint32_t ticks, size_t samples);
+
+  /**
+   * Copy a consistent set of stats (control loop)
+   */
+  void Snapshot(CpuStats &out) const;
+
+  /**
+   * Clear the stats at the start of the next block
+   */
+  void RequestReset() { resetRequested.store(true, std::memory_order_relaxed); }
+
+  /**
+   * Ticks per microsecond (CPU MHz on target, 1000 on host)
+   */
+  float TicksPerMicro() const { return ticksPerMicro; }
+
+  static float AverageLoad(const CpuStats &s);  // 0.0 to 1.0+
+  static float PeakLoad(const CpuStats &s);     // 0.0 to 1.0+
+
+private:
+  CpuStats stats = {};
+  std::atomic<uint32_t> sequence{0};  // Odd while Record() is updating stats
+  std::atomic<bool> resetRequested{false};
+  float ticksPerSample = 0.0f;
+  float ticksPerMicro = 1.0f;
+};
+
+/**
+ * Current tick count (free-running, wraps)
+ */
+uint32_t cpuMeterNow();
+
+extern CpuMeter cpuMeter;
+
+#if CPU_METER_ENABLED
+#define CPU_METER_BEGIN() uint32_t cpuMeterStart_ = cpuMeterNow()
+#define CPU_METER_END(samples) cpuMeter.Record(cpuMeterNow() - cpuMeterStart_, (samples))
+#else
+#define CPU_METER_BEGIN() do { } while (0)
+#define CPU_METER_END(samples) do { (void)(samples); } while (0)
+#endif
@@ -0,0 +1,57 @@
+/**
+ * DistanceFilter - hand distance from VL53L0X ranges for timbre control
+ *
+ * Two stages per range:
+ *   - Outlier rejection: a range with an error status or beyond the
+ *     sensor's useful reach is dropped and the last value held; only a run
+ *     of them means the hand has gone. A valid range that jumps far from
+ *     the estimate is held back one sample and only taken if the next one
+ *     confirms it, so a single spurious return never reaches the sound.
+ *   - One Euro filter (Casiez et al.): a low-pass whose cutoff rises with
+ *     the filtered speed of the hand, so a still hand is smoothed hard
+ *     (no jitter) and a moving one is followed with little lag.
+ *
+ * Timestamps come from the samples, so irregular ranging (polling
+ * fallback, a late loop) only changes the filter step, not its response.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class DistanceFilter {
+public:
+  /**
+   * minCutoffHz: cutoff with the hand still
+   * beta: cutoff added per mm/s of hand speed
+   * derivativeCutoffHz: smoothing of the speed estimate
+   */
+  void Init(float minCutoffHz, float beta, float derivativeCutoffHz);
+
+  /**
+   * Feed one range (mm; valid = the sensor reported a good range status);
+   * true if the filtered distance or the hand's presence changed
+   */
+  bool Update(float mm, bool valid, uint32_t timestampMicros);
+
+  bool Present() const { return present; }    // A hand is in range
+  float Distance() const { return value; }     // Filtered distance (mm), held while absent
+  float Speed() const { return speed; }        // Filtered hand speed (mm/s, + = away)
+  uint32_t Rejected() const { return rejected; }
+
+private:
+  void reset(float mm, uint32_t timestampMicros);
+
+  float minCutoff = 1.0f;
+  float beta = 0.0f;
+  float derivativeCutoff = 1.0f;
+
+  bool present = false;
+  int invalidRun = 0;                          // Consecutive rejected ranges
+  bool spikePending = false;                   // A jump waiting for confirmation
+  float spike = 0.0f;
+  float value = 0.0f;
+  float speed = 0.0f;
+  uint32_t lastMicros = 0;
+  uint32_t rejected = 0;
+};
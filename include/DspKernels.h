@@ -0,0 +1,98 @@
+/**
+ * DspKernels - block math used by the voice renderer and mixer
+ *
+ * The Cortex-M7 FPU has no float SIMD, so CMSIS-DSP's f32 kernels are
+ * 4-way unrolled scalar loops that keep the dual-issue pipeline and the
+ * load/store unit busy. The *Unrolled variants follow that shape; the
+ * *Scalar variants are the plain reference loops. Both are portable C and
+ * compute every element with the same operations in the same order, so
+ * they produce bit-identical output: test/test_dsp_kernels asserts it and
+ * `program --bench kernels` times each pair on the native build.
+ *
+ * The unsuffixed names pick the unrolled kernels on ARMv7E-M targets and
+ * the scalar ones elsewhere (define DSP_FORCE_SCALAR to override). Only
+ * the unrolled kernels are placed in ITCM (MemoryPlacement.h).
+ *
+ * softClip() is the output saturator: tanh(1.5x) / 1.5 from Lambert's 7/6
+ * continued-fraction approximant, clamped where it reaches 1.0. It costs a
+ * handful of multiplies and one divide instead of a libm tanhf() call, and
+ * stays within SOFT_CLIP_MAX_ERROR of the tanhf() version for every input
+ * (test/test_dsp_kernels checks it; `program --bench softclip` times both).
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+// Largest block rendered in one pass; longer callbacks are split
+const size_t MAX_BLOCK_SIZE = 64;
+
+const float SOFT_CLIP_DRIVE = 1.5f;        // Input gain into the tanh curve
+const float SOFT_CLIP_KNEE = 4.97179f;     // Approximant reaches 1.0 here
+const float SOFT_CLIP_MAX_ERROR = 1.0e-4f; // Bound against tanhf(1.5x) / 1.5
+
+/**
+ * Gentle saturation: tanh(1.5x) / 1.5, rational approximation
+ */
+inline float softClip(float sample) {
+  float x = sample * SOFT_CLIP_DRIVE;
+  if (x > SOFT_CLIP_KNEE) {
+    x = SOFT_CLIP_KNEE;
+  } else if (x < -SOFT_CLIP_KNEE) {
+    x = -SOFT_CLIP_KNEE;
+  }
+  float x2 = x * x;
+  float num = x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2)));
+  float den = 135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f));
+  return num / den * (1.0f / SOFT_CLIP_DRIVE);
+}
+
+// dst[i] = 0
+void dspClearScalar(float *dst, size_t n);
+void dspClearUnrolled(float *dst, size_t n);
+
+// dst[i] *= start + (end - start) * i / n  (click-free gain change)
+void dspScaleRampScalar(float *dst, float start, float end, size_t n);
+void dspScaleRampUnrolled(float *dst, float start, float end, size_t n);
+
+// acc[i] += src[i] * gain
+void dspScaleAccumulateScalar(float *acc, const float *src, float gain, size_t n);
+void dspScaleAccumulateUnrolled(float *acc, const float *src, float gain, size_t n);
+
+// s = a[i] * b[i]; left[i] += s * gL(i); right[i] += s * gR(i), both gains
+// ramped like dspScaleRamp (pan a voice into a stereo mix)
+void dspMultiplyPanAccumulateScalar(float *left, float *right, const float *a, const float *b,
+                                    float leftStart, float leftEnd, float rightStart, float rightEnd, size_t n);
+void dspMultiplyPanAccumulateUnrolled(float *left, float *right, const float *a, const float *b,
+                                      float leftStart, float leftEnd, float rightStart, float rightEnd, size_t n);
+
+// dst[i] = softClip(dst[i])
+void dspSoftClipScalar(float *dst, size_t n);
+void dspSoftClipUnrolled(float *dst, size_t n);
+
+#if defined(__ARM_ARCH_7EM__) && !defined(DSP_FORCE_SCALAR)
+#define DSP_KERNEL(name) name##Unrolled
+#else
+#define DSP_KERNEL(name) name##Scalar
+#endif
+
+inline void dspClear(float *dst, size_t n) {
+  DSP_KERNEL(dspClear)(dst, n);
+}
+
+inline void dspScaleRamp(float *dst, float start, float end, size_t n) {
+  DSP_KERNEL(dspScaleRamp)(dst, start, end, n);
+}
+
+inline void dspScaleAccumulate(float *acc, const float *src, float gain, size_t n) {
+  DSP_KERNEL(dspScaleAccumulate)(acc, src, gain, n);
+}
+
+inline void dspMultiplyPanAccumulate(float *left, float *right, const float *a, const float *b,
+                                     float leftStart, float leftEnd, float rightStart, float rightEnd, size_t n) {
+  DSP_KERNEL(dspMultiplyPanAccumulate)(left, right, a, b, leftStart, leftEnd, rightStart, rightEnd, n);
+}
+
+inline void dspSoftClip(float *dst, size_t n) {
+  DSP_KERNEL(dspSoftClip)(dst, n);
+}
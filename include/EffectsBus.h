@@ -0,0 +1,163 @@
+/**
+ * EffectsBus - post-mix stereo delay and feedback-delay-network reverb
+ *
+ * The bus adds its wet signal to the stereo voice mix in place, ahead of
+ * the soft clipper; both effects are fed the mid (mono) sum. The delay is a ping-pong pair (the send enters the
+ * left line, each line feeds the other through a damping low-pass). The
+ * reverb is a four-line feedback delay network: a Hadamard matrix mixes
+ * the line outputs back into every line, each line's gain sets the decay
+ * time for its length, and a one-pole low-pass per line makes highs die
+ * away first.
+ *
+ * Every delay line lives in SDRAM and is processed a block at a time: the
+ * block's delayed samples are copied out in one contiguous burst (two at
+ * the wrap), the block is computed in internal RAM and the new samples are
+ * copied back in one burst. No line is shorter than MAX_BLOCK_SIZE, so a
+ * block never needs a sample it has not yet written.
+ *
+ * Each effect stops processing once its send is zero and its tail has
+ * decayed past audibility, so an unused bus costs nothing and the output is
+ * then exactly the dry mix. While running, the bus times itself with the
+ * CPU meter clock against a fixed share of the block deadline: after
+ * EFFECTS_SHED_BLOCKS blocks over budget the reverb fades out and stops,
+ * and it comes back (with cleared lines) once the delay plus the reverb's
+ * last measured cost fits the budget again for EFFECTS_RESTORE_BLOCKS.
+ *
+ * Audio side only, apart from the load getters and RequestReset().
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "DspKernels.h"
+
+const float EFFECTS_CPU_BUDGET = 0.15f;       // Share of each block deadline
+const int EFFECTS_SHED_BLOCKS = 4;            // Blocks over budget before the reverb stops
+const int EFFECTS_RESTORE_BLOCKS = 500;       // Blocks with room before it restarts
+const float EFFECTS_RESTORE_MARGIN = 0.75f;   // Share of the budget the restart must fit in
+
+const size_t DELAY_LINE_SAMPLES = 48000;      // 1 s at 48 kHz, per side
+const size_t REVERB_LINE_SAMPLES = 4096;      // Longest reverb line
+const int REVERB_LINES = 4;
+
+/**
+ * One delay line in caller-provided storage, read and written a block at
+ * a time; the delay is at least MAX_BLOCK_SIZE and at most the line size
+ */
+class DelayLine {
+public:
+  void Init(float *storage, size_t size);
+  void SetDelay(size_t samples);
+  size_t Delay() const { return delay; }
+  void Clear();
+
+  /**
+   * Copy the n samples written Delay() samples before the next Write()
+   */
+  void Read(float *dst, size_t n) const;
+
+  /**
+   * Append n samples
+   */
+  void Write(const float *src, size_t n);
+
+private:
+  float *buffer = nullptr;
+  size_t size = 0;
+  size_t writePos = 0;
+  size_t delay = MAX_BLOCK_SIZE;
+};
+
+class EffectsBus {
+public:
+  /**
+   * Clear every line (SDRAM is not zeroed at boot) and set the fixed
+   * delay times for the sample rate
+   */
+  void Init(float sampleRate);
+
+  /**
+   * Enable budget enforcement: budget is the share of each block deadline
+   * the bus may use, ticksPerSample the CPU meter clock per sample
+   */
+  void SetCpuBudget(float budget, float ticksPerSample);
+
+  // Parameter targets, smoothed per block (audio side)
+  void SetDelayMix(float send);
+  void SetReverbMix(float send);
+  void SetReverbDecay(float seconds);
+
+  /**
+   * Add the wet signal to left/right for n <= MAX_BLOCK_SIZE samples;
+   * leaves them untouched while both effects are idle
+   */
+  void Process(float *left, float *right, size_t n);
+
+  /**
+   * Whether the last Process() call ran either effect
+   */
+  bool Active() const { return active; }
+
+  // Load as a share of the block deadline (any thread)
+  float Load() const { return load.load(std::memory_order_relaxed); }
+  float PeakLoad() const { return peakLoad.load(std::memory_order_relaxed); }
+  float Budget() const { return budget; }
+  uint32_t OverBudget() const { return overBudget.load(std::memory_order_relaxed); }
+  bool ReverbShed() const { return reverbShed.load(std::memory_order_relaxed); }
+
+  /**
+   * Clear the peak and over-budget count at the next block
+   */
+  void RequestReset() { resetRequested.store(true, std::memory_order_relaxed); }
+
+private:
+  void processDelay(float *left, float *right, size_t n);
+  void processReverb(float *left, float *right, size_t n);
+  void updateReverbGains();
+  void clearReverb();
+  void recordLoad(uint32_t delayTicks, uint32_t reverbTicks, size_t n);
+
+  float sampleRate = 48000.0f;
+  DelayLine delayLines[2];
+  DelayLine reverbLines[REVERB_LINES];
+
+  // Block scratch in internal RAM: the send, and per line delayed samples
+  // in, new samples out
+  float sendBlock[MAX_BLOCK_SIZE];
+  float delayBlock[2][MAX_BLOCK_SIZE];
+  float reverbBlock[REVERB_LINES][MAX_BLOCK_SIZE];
+
+  // Parameters: targets from SetParam events, values at the end of the last block
+  float delayMix = 0.0f;
+  float delayMixSmoothed = 0.0f;
+  float reverbMix = 0.0f;
+  float reverbMixSmoothed = 0.0f;
+  float reverbDecay = 2.0f;
+  float reverbDecaySmoothed = 2.0f;
+  float reverbGain[REVERB_LINES];     // Per-pass gain for the decay time
+  float delayDamp[2] = {};            // Feedback low-pass states
+  float reverbDamp[REVERB_LINES] = {};
+
+  // Idle tracking: samples until each tail is inaudible
+  int32_t delayTail = 0;
+  int32_t delayTailLength = 0;
+  int32_t reverbTail = 0;
+  bool active = false;
+
+  // Budget (ticksPerSample 0 = not enforced)
+  float budget = EFFECTS_CPU_BUDGET;
+  float ticksPerSample = 0.0f;
+  float reverbCost = 0.0f;            // Reverb load of its last block
+  bool reverbOn = true;
+  bool reverbStopping = false;        // Fading out over this block, then off
+  int overStreak = 0;
+  int roomStreak = 0;
+  std::atomic<float> load{0.0f};
+  std::atomic<float> peakLoad{0.0f};
+  std::atomic<uint32_t> overBudget{0};
+  std::atomic<bool> reverbShed{false};
+  std::atomic<bool> resetRequested{false};
+};
@@ -0,0 +1,140 @@
+/**
+ * EventLog - deferred, binary event logging
+ *
+ * Producers push fixed-size records (event id, timestamp, up to
+ * LOG_MAX_ARGS raw arguments) into a ring without formatting anything.
+ * Drain() runs at the end of loop(): it formats queued records against the
+ * event table (LogEvents.h) and hands the text to a writer, but only while
+ * the writer reports room for a full line, so a slow or disconnected USB
+ * serial port can never stall note handling.
+ *
+ * Each event belongs to a category with its own verbosity; records above
+ * the category's level are rejected before they reach the ring. A full
+ * ring drops records and counts them, and Drain() reports the count.
+ *
+ * Format strings support %d, %u, %x, %s (static strings only: the pointer
+ * is stored, not the text), %f / %.Nf and %%.
+ *
+ * Build with -D LOG_ENABLED=0 to strip every LOG_EVENT() call.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SpscQueue.h"
+
+#ifndef LOG_ENABLED
+#define LOG_ENABLED 1
+#endif
+
+enum LogLevel : uint8_t {
+  LOG_LEVEL_OFF = 0,
+  LOG_LEVEL_INFO = 1,    // User-facing state changes
+  LOG_LEVEL_DEBUG = 2    // Per-sample / per-gesture detail
+};
+
+const int LOG_MAX_ARGS = 8;
+const int LOG_MAX_CATEGORIES = 8;
+const uint32_t LOG_QUEUE_SIZE = 64;
+const size_t LOG_LINE_SIZE = 128;   // Longest formatted line, incl. timestamp
+
+union LogArg {
+  int32_t i;
+  uint32_t u;
+  float f;
+  const char *s;
+
+  LogArg() : i(0) {}
+  LogArg(bool v) : i(v ? 1 : 0) {}
+  LogArg(int v) : i(v) {}
+  LogArg(long v) : i((int32_t)v) {}
+  LogArg(unsigned int v) : u(v) {}
+  LogArg(unsigned long v) : u((uint32_t)v) {}
+  LogArg(float v) : f(v) {}
+  LogArg(double v) : f((float)v) {}
+  LogArg(const char *v) : s(v) {}
+};
+
+struct LogRecord {
+  uint32_t timestampMicros;
+  uint16_t id;
+  uint8_t argc;
+  LogArg args[LOG_MAX_ARGS];
+};
+
+struct LogEventInfo {
+  uint8_t category;
+  LogLevel level;
+  const char *format;
+};
+
+/**
+ * Sink for formatted text: write, and how many bytes fit without blocking
+ */
+struct LogWriter {
+  void (*write)(const char *text, size_t length);
+  size_t (*writable)();
+};
+
+class EventLog {
+public:
+  void Init(const LogEventInfo *events, size_t numEvents, LogWriter writer, uint32_t (*clock)());
+
+  void SetLevel(uint8_t category, LogLevel level);
+  LogLevel Level(uint8_t category) const;
+
+  /**
+   * Set every category at once
+   */
+  void SetAllLevels(LogLevel level);
+
+  bool Enabled(uint16_t id) const {
+    return id < numEvents && events[id].level != LOG_LEVEL_OFF && events[id].level <= levels[events[id].category];
+  }
+
+  template<typename... Args>
+  void Log(uint16_t id, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+    if (!Enabled(id)) {
+      return;
+    }
+    LogRecord record;
+    record.timestampMicros = clock ? clock() : 0;
+    record.id = id;
+    record.argc = (uint8_t)sizeof...(Args);
+    int n = 0;
+    int expand[] = {0, (record.args[n++] = LogArg(args), 0)...};
+    (void)expand;
+    records.Push(record);
+  }
+
+  /**
+   * Format and write up to maxRecords queued records; returns how many
+   */
+  size_t Drain(size_t maxRecords);
+
+  uint32_t Dropped() const { return records.Dropped(); }
+  uint32_t Pending() const { return records.Size(); }
+
+private:
+  size_t format(const LogRecord &record, char *line, size_t size) const;
+
+  const LogEventInfo *events = nullptr;
+  size_t numEvents = 0;
+  LogWriter writer = {nullptr, nullptr};
+  uint32_t (*clock)() = nullptr;
+  LogLevel levels[LOG_MAX_CATEGORIES] = {};
+  SpscQueue<LogRecord, LOG_QUEUE_SIZE> records;
+  uint32_t reportedDrops = 0;
+};
+
+extern EventLog eventLog;
+
+#if LOG_ENABLED
+#define LOG_EVENT(...) eventLog.Log(__VA_ARGS__)
+#else
+// Never executed, but keeps arguments "used" so stripped builds stay warning-free
+#define LOG_EVENT(...) do { if (0) eventLog.Log(__VA_ARGS__); } while (0)
+#endif
@@ -0,0 +1,99 @@
+/**
+ * I2cScheduler - queued, non-blocking I2C transactions
+ *
+ * Sensor code submits small register transactions (write register address,
+ * read N bytes) and gets a completion callback with timestamps. At most one
+ * transaction is started per Service() call, so the time the control loop
+ * spends on the bus per iteration is bounded by one short transfer.
+ *
+ * The bus itself sits behind I2cBus, which has an asynchronous
+ * Start()/Poll() contract: Start() returns once the transfer is on its
+ * way, and Poll() returns I2C_BUSY until it has finished. WireBus.h does
+ * this on the HAL's I2C interrupts; tests plug in a mock bus that injects
+ * latency.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "SpscQueue.h"
+
+enum I2cStatus : uint8_t {
+  I2C_PENDING = 0,  // Queued, not started
+  I2C_BUSY = 1,     // On the bus
+  I2C_DONE = 2,     // Completed, rx valid
+  I2C_ERROR = 3     // NACK, bus error or timeout
+};
+
+const int I2C_MAX_TX = 4;   // Register address + a few data bytes
+const int I2C_MAX_RX = 12;  // Largest sensor burst read
+
+struct I2cTransaction {
+  uint8_t address;          // 7-bit device address
+  uint8_t tag;              // Owner-defined id, passed back on completion
+  uint8_t txLen;
+  uint8_t rxLen;
+  uint8_t tx[I2C_MAX_TX];
+  uint8_t rx[I2C_MAX_RX];
+  I2cStatus status;
+  uint32_t submittedMicros;
+  uint32_t completedMicros;
+};
+
+class I2cBus {
+public:
+  virtual ~I2cBus() {}
+
+  /**
+   * Begin a write-then-read transfer; false if it could not be started
+   */
+  virtual bool Start(I2cTransaction &t) = 0;
+
+  /**
+   * I2C_BUSY while the transfer runs, then I2C_DONE or I2C_ERROR
+   */
+  virtual I2cStatus Poll(I2cTransaction &t) = 0;
+};
+
+typedef void (*I2cCompletion)(void *context, const I2cTransaction &t);
+
+class I2cScheduler {
+public:
+  void Init(I2cBus *bus, I2cCompletion onComplete, void *context);
+
+  /**
+   * Queue a transaction; false (and counted) if the queue is full
+   */
+  bool Submit(const I2cTransaction &t, uint32_t nowMicros);
+
+  /**
+   * Advance the bus: finish the active transfer or start the next one
+   */
+  void Service(uint32_t nowMicros);
+
+  bool Idle() const { return !busy && pending.Empty(); }
+  uint32_t Errors() const { return errors; }
+  uint32_t Dropped() const { return pending.Dropped(); }
+
+private:
+  void complete(I2cStatus status, uint32_t nowMicros);
+
+  I2cBus *bus = nullptr;
+  I2cCompletion onComplete = nullptr;
+  void *context = nullptr;
+  SpscQueue<I2cTransaction, 8> pending;
+  I2cTransaction active;
+  bool busy = false;
+  uint32_t errors = 0;
+};
+
+/**
+ * Build a "write register, then read rxLen bytes" transaction
+ */
+I2cTransaction i2cReadRegisters(uint8_t address, uint8_t reg, uint8_t rxLen, uint8_t tag);
+
+/**
+ * Build a "write value to register" transaction
+ */
+I2cTransaction i2cWriteRegister(uint8_t address, uint8_t reg, uint8_t value, uint8_t tag);
@@ -0,0 +1,146 @@
+/**
+ * InputTrace - record every control input and replay it deterministically
+ *
+ * The control tasks read every input as they take it: the debounced button
+ * edges, the filtered analog inputs, the decoded sensor samples and the
+ * serial commands that change what plays (arpeggiator pattern keys, live
+ * tuning writes). While recording, each one becomes a 16-byte
+ * record (time since the recording started, type, payload) in a RAM
+ * buffer, which is also streamed out as text lines starting with '@' while
+ * the serial port has room, so a capture can be grabbed from a serial log.
+ *
+ * While replaying, the tasks keep scanning the hardware (so their timing
+ * stays the same) but the handlers see the recorded inputs instead, each
+ * at the task run whose time reaches the record's; live play commands are
+ * ignored like the live buttons. On the host build the
+ * simulated clock makes a replay render bit-exactly the same audio as the
+ * run that was recorded.
+ *
+ * Sensor values are stored as the raw integers they were decoded from
+ * (ToF mm, MSA301 counts) and analog inputs as their filtered 16-bit
+ * levels, so the replayed floats are identical. Button
+ * edges and sensor samples keep their own timestamps (as an offset from
+ * the loop iteration), so notes scheduled from them land on the same
+ * samples.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "AnalogInputs.h"
+#include "ButtonScanner.h"
+#include "EventLog.h"
+#include "SensorPipeline.h"
+#include "SpscQueue.h"
+
+enum InputRecordType : uint8_t {
+  INPUT_BUTTONS = 0,   // value[0] = debounced mask after an edge (bit i = left i, bit 8 + i = right i)
+  INPUT_ANALOG = 1,    // value[0] = filtered level (0-65535 as uint16), status = analog input
+  INPUT_TOF = 2,       // value[0] = mm, status = range status
+  INPUT_ACCEL = 3,     // value[0..2] = MSA301 counts
+  INPUT_COMMAND = 4,   // status = serial command key
+  INPUT_TUNABLE = 5    // status = tunable id, value[0..1] = the written float's bits (low, high half)
+};
+
+/**
+ * A replayed serial command or tunable write
+ */
+struct InputCommand {
+  InputRecordType type;    // INPUT_COMMAND or INPUT_TUNABLE
+  uint8_t id;              // Command key, or tunable id
+  float value;             // Value written to the tunable
+};
+
+struct InputRecord {
+  uint32_t timeMicros;     // Loop iteration that consumed it, since the recording started
+  int32_t sampleOffset;    // Edges and samples: their own time minus timeMicros
+  InputRecordType type;
+  uint8_t status;
+  int16_t value[3];
+};
+
+static_assert(sizeof(InputRecord) == 16, "InputRecord must stay compact");
+
+const size_t INPUT_TRACE_CAPACITY = 4096;   // Records (64 KB, about 15 s of full sensor traffic)
+const size_t INPUT_TRACE_LINE_SIZE = 64;    // Longest text line, incl. CR LF
+const uint32_t INPUT_COMMAND_QUEUE_SIZE = 16;
+
+class InputTrace {
+public:
+  /**
+   * Clear the buffer and record from now on, starting from the buttons held
+   */
+  void StartRecording(uint32_t nowMicros, uint16_t buttons);
+  void StopRecording();
+
+  /**
+   * Replay the buffer from its start, timed from now
+   */
+  void StartReplay(uint32_t nowMicros);
+  void StopReplay();
+
+  bool Recording() const { return recording; }
+  bool Replaying() const { return replaying; }
+
+  // Recording (call with the live inputs as loop() consumes them)
+  void RecordAnalog(uint32_t nowMicros, const uint16_t *levels, int count);
+  void RecordButtons(uint32_t nowMicros, const ButtonEdge &edge);
+  void RecordSample(uint32_t nowMicros, const SensorSample &sample);
+  void RecordCommand(uint32_t nowMicros, uint8_t key);
+  void RecordTunable(uint32_t nowMicros, uint8_t id, float value);
+
+  /**
+   * Replay: take every record due by now, queueing edges and samples for
+   * the Pop calls and keeping the latest analog levels
+   */
+  void ReplayDue(uint32_t nowMicros);
+
+  /**
+   * ReplayDue(), then replace the analog levels with the replayed ones
+   */
+  void ReplayAnalog(uint32_t nowMicros, uint16_t *levels, int count);
+  bool PopButtons(ButtonEdge &edge) { return replayEdges.Pop(edge); }
+  bool PopSample(SensorSample &sample) { return replaySamples.Pop(sample); }
+  bool PopCommand(InputCommand &command) { return replayCommands.Pop(command); }
+
+  /**
+   * Stream unsent records as text while the writer has room; returns lines written
+   */
+  size_t Flush(LogWriter writer, size_t maxRecords);
+
+  /**
+   * Add a record from a saved capture (not streamed again); false when full
+   */
+  bool Load(const InputRecord &record);
+
+  size_t Count() const { return count; }
+  const InputRecord &At(size_t i) const { return records[i]; }
+  uint32_t Overflows() const { return overflows; }
+
+  static size_t FormatRecord(const InputRecord &record, char *line, size_t size);
+  static bool ParseRecord(const char *line, InputRecord &record);
+
+private:
+  bool push(const InputRecord &record);
+  void append(uint32_t nowMicros, InputRecordType type, uint8_t status, int32_t offset, int16_t v0, int16_t v1,
+              int16_t v2);
+
+  InputRecord records[INPUT_TRACE_CAPACITY];
+  size_t count = 0;
+  size_t flushed = 0;
+  size_t cursor = 0;
+  uint32_t startMicros = 0;
+  uint32_t overflows = 0;
+  bool recording = false;
+  bool replaying = false;
+
+  int32_t lastAnalog[ANALOG_MAX_INPUTS];     // -1 = not recorded yet
+  int32_t replayAnalog[ANALOG_MAX_INPUTS];   // -1 = no record replayed yet
+  SpscQueue<ButtonEdge, BUTTON_EDGE_QUEUE_SIZE> replayEdges;
+  SpscQueue<SensorSample, SENSOR_SAMPLE_QUEUE_SIZE> replaySamples;
+  SpscQueue<InputCommand, INPUT_COMMAND_QUEUE_SIZE> replayCommands;
+};
+
+extern InputTrace inputTrace;
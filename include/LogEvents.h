@@ -0,0 +1,64 @@
+/**
+ * LogEvents - event ids, categories and formats for the firmware's log
+ *
+ * Add an event by appending an id here and a row to logEventTable in
+ * LogEvents.cpp (same order).
+ */
+
+#pragma once
+
+#include "EventLog.h"
+
+enum LogCategory : uint8_t {
+  LOG_CAT_NOTES = 0,     // Note on/off, latching
+  LOG_CAT_CONTROL = 1,   // Scale, key, mode, pitch and volume changes
+  LOG_CAT_SENSORS = 2,   // ToF and accelerometer gestures
+  LOG_CAT_SYSTEM = 3,    // Calibration, input traces and housekeeping
+  LOG_CAT_STATS = 4,     // Load, sensor and task reports ('c', 's', 'k')
+  LOG_NUM_CATEGORIES = 5
+};
+
+enum LogEventId : uint16_t {
+  LOG_NOTE_ON,              // button, pitch
+  LOG_NOTE_LATCHED,         // button, pitch
+  LOG_NOTE_RETRIGGERED,     // button
+  LOG_NOTE_OFF,             // button
+  LOG_NOTES_CLEARED,
+  LOG_PITCH_OFFSET,         // message
+  LOG_SCALE,                // name
+  LOG_KEY,                  // key
+  LOG_KEY_SET_MODE,
+  LOG_PLAY_MODE,            // name
+  LOG_LATCH_MODE,           // "ON"/"OFF"
+  LOG_VOLUME,               // pot percent, gain dB
+  LOG_DISTANCE_MORPH,       // mm, morph
+  LOG_DISTANCE_EFFECTS,     // mm, effect amount
+  LOG_WINDOW,               // prefix, 5 notes, offset
+  LOG_CALIBRATION_HOLD,
+  LOG_CALIBRATED,           // center x
+  LOG_CALIBRATION_CANCELLED,
+  LOG_TRACE_RECORDING,
+  LOG_TRACE_STOPPED,        // records, overflows
+  LOG_TRACE_REPLAY,         // records
+  LOG_ARP_PATTERN,          // name
+  LOG_DISTANCE_ARP,         // mm, steps per second
+  LOG_PRESET_MODE,
+  LOG_PRESET_SAVED,         // slot
+  LOG_PRESET_RECALLED,      // slot
+  LOG_PRESET_EMPTY,         // slot
+  LOG_STATE_SAVED,          // flash writes, erases
+  LOG_PRESET_FLASH_ERROR,
+  LOG_BOOT,                 // ms, stored records, "cached"/"scanned"
+  LOG_MEMORY,               // ITCM bytes, DTCM bytes, SDRAM KB
+  LOG_CPU_LOAD,             // avg %, peak %, peak us, overruns, blocks
+  LOG_CPU_CYCLES,           // avg cycles, peak cycles
+  LOG_EFFECTS_LOAD,         // load %, peak %, budget %, over budget, "reverb shed"
+  LOG_CPU_HISTOGRAM_LOW,    // blocks in 0-10% .. 50-60%
+  LOG_CPU_HISTOGRAM_HIGH,   // blocks in 60-70% .. 90-100%, overruns
+  LOG_SENSOR_STATS,         // ToF mode, bus errors, dropped samples
+  LOG_BUTTON_STATS,         // scans, dropped edges, late notes, dropped events
+  LOG_TASK_STATS,           // name, period, runs, avg us, max us, late us, overruns
+  LOG_NUM_EVENTS
+};
+
+extern const LogEventInfo logEventTable[LOG_NUM_EVENTS];
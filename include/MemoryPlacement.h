@@ -0,0 +1,67 @@
+/**
+ * MemoryPlacement - which STM32H750 memory the hot and the bulky parts use
+ *
+ *   ITCM_CODE   64 KB ITCM at 0x00000000: zero-wait instruction fetch, no
+ *               flash wait states or I-cache misses. The audio callback and
+ *               everything it runs per block (voice render, oscillators,
+ *               envelopes, effects, DSP kernels, the CPU meter).
+ *   DTCM_DATA   128 KB DTCM at 0x20000000: zero-wait data, never cached, so
+ *   DTCM_BSS    voice state and the mix buffers are not evicted by the
+ *               control loop. DMA cannot reach DTCM: keep DMA buffers out.
+ *               DTCM_DATA keeps its initializers (loaded from flash);
+ *               DTCM_BSS is zeroed at boot and costs no flash, for objects
+ *               that are zero or built by their constructor (the synth).
+ *   SDRAM_DATA  64 MB external SDRAM at 0xC0000000: big and slower, for
+ *               wavetables and delay lines. Not zeroed at boot: owners
+ *               fill what they use after DAISY.init() brings SDRAM up.
+ *
+ * The sections are laid out by tools/linker/daisy_seed.ld. ITCM code and
+ * DTCM data are loaded from flash like .data; memoryPlacementInit() copies
+ * them in and clears DTCM_BSS before any constructor runs (see
+ * MemoryPlacement.cpp).
+ *
+ * Host builds compile the macros to nothing. Build the firmware with
+ * -D MEMORY_PLACEMENT=0 to leave everything where the default sections
+ * put it, e.g. to compare the CPU report ('c') with and without.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#ifndef MEMORY_PLACEMENT
+#if defined(ARDUINO)
+#define MEMORY_PLACEMENT 1
+#else
+#define MEMORY_PLACEMENT 0
+#endif
+#endif
+
+#if MEMORY_PLACEMENT
+#define ITCM_CODE __attribute__((section(".itcm_text")))
+#define DTCM_DATA __attribute__((section(".dtcm_data")))
+#define DTCM_BSS __attribute__((section(".dtcm_bss")))
+#else
+#define ITCM_CODE
+#define DTCM_DATA
+#define DTCM_BSS
+#endif
+
+// SDRAM holds data that does not fit anywhere else, so it does not follow
+// MEMORY_PLACEMENT
+#if defined(ARDUINO)
+#define SDRAM_DATA __attribute__((section(".sdram_bss")))
+#else
+#define SDRAM_DATA
+#endif
+
+struct MemoryUsage {
+  size_t itcmCode;    // Bytes of ITCM_CODE
+  size_t dtcmData;    // Bytes of DTCM_DATA and DTCM_BSS
+  size_t sdramData;   // Bytes of SDRAM_DATA
+};
+
+/**
+ * What the linker placed in each region (all zero on a host build)
+ */
+MemoryUsage memoryUsage();
@@ -0,0 +1,146 @@
+/**
+ * MidiOut - MPE note and controller output as USB-MIDI event packets
+ *
+ * Notes follow the MPE lower zone: channel 1 is the manager channel (zone
+ * wide bend, timbre and window controllers), channels 2-16 are member
+ * channels and every sounding note owns one, so its own pitch bend carries
+ * the fractional part of EDO pitches and momentary sharp/flat. A member
+ * channel's bend is always sent just before its note-on.
+ *
+ * Note messages go through a lock-free SPSC queue and always go out first.
+ * Continuous controllers are not queued: each has a slot holding its
+ * latest value, so every change within a frame coalesces into one message,
+ * changes below a threshold are dropped and each slot sends at most once
+ * per MIDI_CONTROL_INTERVAL_US. Service() runs once per 1 ms USB frame and
+ * hands at most one full-speed bulk packet (16 event packets) to the
+ * writer, so a dense gesture can never saturate the endpoint or hold a
+ * note-on back by more than a frame.
+ *
+ * Every call comes from loop() today. Note messages still cross a lock-free
+ * SPSC queue, so only the controller slots would need the same treatment
+ * to move the frame transmit into the USB start-of-frame interrupt.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SpscQueue.h"
+
+/**
+ * USB-MIDI event packet: code index number, then the MIDI message
+ */
+struct MidiPacket {
+  uint8_t header;   // Cable << 4 | code index number (the status nibble for channel messages)
+  uint8_t status;
+  uint8_t data1;
+  uint8_t data2;
+};
+
+/**
+ * Packet sink; writable() reports packets accepted without blocking (null = any)
+ */
+struct MidiWriter {
+  void (*write)(const MidiPacket *packets, size_t count);
+  size_t (*writable)();
+};
+
+const uint32_t MIDI_FRAME_MICROS = 1000;        // USB full-speed frame
+const size_t MIDI_PACKETS_PER_FRAME = 16;       // One 64-byte bulk packet
+const uint32_t MIDI_TX_QUEUE_SIZE = 64;         // Note messages awaiting a frame
+const uint32_t MIDI_CONTROL_INTERVAL_US = 5000; // Per controller slot (200 messages/s at most)
+const int MIDI_MAX_NOTE_IDS = 64;               // Same id space as SynthEngine notes
+
+const uint8_t MPE_MANAGER_CHANNEL = 0;          // MIDI channel 1
+const int MPE_MEMBER_CHANNELS = 15;             // MIDI channels 2-16
+const float MPE_NOTE_BEND_RANGE = 48.0f;        // Member channel default (semitones)
+const uint8_t MIDI_NOTE_VELOCITY = 100;         // Buttons are not velocity sensitive
+
+const uint8_t MIDI_CC_WINDOW = 16;              // General purpose 1: window offset, 64 = centered
+const uint8_t MIDI_CC_TIMBRE = 74;              // MPE timbre: waveform blend
+
+class MidiOut {
+public:
+  /**
+   * Reset all notes and controllers; queues the MPE configuration with
+   * the manager channel's bend range in semitones
+   */
+  void Init(float managerBendRange);
+
+  /**
+   * Change the sink; a null write discards everything Service() takes
+   */
+  void SetWriter(MidiWriter sink) { writer = sink; }
+
+  /**
+   * Queue the MPE zone and bend range messages (again, e.g. for a new sink)
+   */
+  void SendConfiguration();
+
+  // Notes, addressed like SynthEngine notes (fractional MIDI pitch)
+  void NoteOn(int noteId, float pitch);
+  void NoteOff(int noteId);
+  void SetNotePitch(int noteId, float pitch);
+
+  // Manager channel controllers
+  void SetBend(float semitones);
+  void SetTimbre(float amount);     // 0 to 1
+  void SetWindow(int offset);       // Semitones from the scale's start
+
+  /**
+   * Send one frame when a frame period has passed; returns packets written
+   */
+  size_t Service(uint32_t nowMicros);
+
+  int ActiveNotes() const { return activeNotes; }
+  uint32_t PacketsSent() const { return packetsSent; }
+  uint32_t Coalesced() const { return coalesced; }
+  uint32_t Dropped() const { return queue.Dropped(); }
+
+private:
+  // Continuous controller slots: one bend per member channel, then the manager's
+  enum {
+    SLOT_MANAGER_BEND = MPE_MEMBER_CHANNELS,
+    SLOT_TIMBRE,
+    SLOT_WINDOW,
+    NUM_SLOTS
+  };
+
+  struct ControlSlot {
+    uint8_t status;
+    uint8_t number;          // Controller number (CC slots only)
+    uint16_t value;          // Latest value
+    uint16_t sent;           // Last value sent
+    uint16_t threshold;      // Smaller changes are dropped (except back to rest)
+    uint16_t rest;
+    uint32_t lastMicros;
+    bool pending;
+  };
+
+  void push(uint8_t status, uint8_t data1, uint8_t data2);
+  void setSlot(int slot, uint16_t value);
+  MidiPacket slotPacket(int slot) const;
+  int allocateChannel();
+
+  MidiWriter writer = {nullptr, nullptr};
+  SpscQueue<MidiPacket, MIDI_TX_QUEUE_SIZE> queue;
+  ControlSlot slots[NUM_SLOTS];
+  float managerRange = 2.0f;
+
+  // Member channel i is MIDI channel i + 2
+  int8_t channelNote[MPE_MEMBER_CHANNELS];      // Owning note id, -1 when free
+  uint32_t channelAge[MPE_MEMBER_CHANNELS];     // Allocation order, oldest reused first
+  int8_t noteChannel[MIDI_MAX_NOTE_IDS];        // Member channel of each note id, -1 when silent
+  uint8_t noteKey[MIDI_MAX_NOTE_IDS];
+  uint32_t allocations = 0;
+  int activeNotes = 0;
+
+  uint32_t frameMicros = 0;
+  bool started = false;
+  int nextSlot = 0;
+  uint32_t packetsSent = 0;
+  uint32_t coalesced = 0;
+};
+
+extern MidiOut midiOut;
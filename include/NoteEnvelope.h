@@ -0,0 +1,109 @@
+/**
+ * NoteEnvelope - sample-accurate ADSR envelope
+ *
+ * Each stage is a fixed number of samples computed from the stage time and
+ * the sample rate. Process() only adds a precomputed increment (linear) or
+ * applies a precomputed one-pole coefficient (exponential), so the level
+ * changes every sample instead of once per millis() tick.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum EnvelopeStage {
+  ENV_IDLE = 0,
+  ENV_ATTACK = 1,
+  ENV_DECAY = 2,
+  ENV_SUSTAIN = 3,
+  ENV_RELEASE = 4
+};
+
+enum EnvelopeCurve {
+  ENV_CURVE_LINEAR = 0,       // Constant slope, exact stage length
+  ENV_CURVE_EXPONENTIAL = 1   // Analog-style RC curve, exact stage length from full scale
+};
+
+class NoteEnvelope {
+public:
+  /**
+   * Set the sample rate and default stage times (seconds)
+   */
+  void Init(float sampleRate);
+
+  /**
+   * Configure stage times (seconds) and sustain level (0.0 to 1.0)
+   * Takes effect on the next Trigger()/Release()
+   */
+  void SetTimes(float attack, float decay, float sustain, float release);
+  void SetCurve(EnvelopeCurve curve);
+
+  /**
+   * Start the attack stage from the current level (no click on retrigger)
+   */
+  void Trigger();
+
+  /**
+   * Start the release stage from the current level
+   */
+  void Release();
+
+  /**
+   * Silence immediately (no release tail)
+   */
+  void Reset();
+
+  /**
+   * Advance one sample and return the new level (0.0 to 1.0)
+   */
+  inline float Process() {
+    if (stage == ENV_IDLE || stage == ENV_SUSTAIN) {
+      return level;
+    }
+    if (curve == ENV_CURVE_LINEAR) {
+      level += increment;
+    } else {
+      level = base + level * coef;
+    }
+    if (--samplesLeft <= 0) {
+      advanceStage();
+    }
+    return level;
+  }
+
+  /**
+   * Advance n samples, writing each level to out
+   * Produces exactly the values n calls to Process() would
+   */
+  void ProcessBlock(float *out, size_t n);
+
+  float Level() const { return level; }
+  EnvelopeStage Stage() const { return stage; }
+  bool IsActive() const { return stage != ENV_IDLE; }
+  bool IsReleasing() const { return stage == ENV_RELEASE; }
+
+  /**
+   * Stage length in samples for a time in seconds (at least one sample)
+   */
+  int32_t SamplesFor(float seconds) const;
+
+private:
+  void advanceStage();
+  void startSegment(EnvelopeStage next, float target, int32_t length);
+
+  float sampleRate = 48000.0f;
+  float attackTime = 0.0f;
+  float decayTime = 0.0f;
+  float sustainLevel = 1.0f;
+  float releaseTime = 0.0f;
+  EnvelopeCurve curve = ENV_CURVE_LINEAR;
+
+  EnvelopeStage stage = ENV_IDLE;
+  float level = 0.0f;          // Current envelope amplitude (0.0 to 1.0)
+  float target = 0.0f;         // Level at the end of the current stage
+  float increment = 0.0f;      // Per-sample step (linear curve)
+  float coef = 0.0f;           // Per-sample multiplier (exponential curve)
+  float base = 0.0f;           // Per-sample offset (exponential curve)
+  int32_t samplesLeft = 0;     // Samples until the current stage ends
+};
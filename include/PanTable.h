@@ -0,0 +1,48 @@
+/**
+ * PanTable - constant-power pan gains without sinf/cosf
+ *
+ * A pan position runs from -1 (hard left) through 0 (center) to +1 (hard
+ * right). The gains follow the sine/cosine law, so left^2 + right^2 is the
+ * same at every position and a voice keeps its loudness as it moves. They
+ * are scaled so the center is unity on both sides: a centered voice sounds
+ * exactly as it did on the mono output, a hard-panned one is 3 dB louder
+ * on its side.
+ *
+ * The table holds PAN_TABLE_STEPS + 1 gains per side, generated at compile
+ * time, and panToGains() interpolates linearly between entries (worst-case
+ * error about 1e-4, far below audibility).
+ */
+
+#pragma once
+
+const int PAN_TABLE_STEPS = 64;
+
+struct PanGainTable {
+  float left[PAN_TABLE_STEPS + 1];   // sqrt(2) * cos(theta), theta = (pan + 1) * pi / 4
+  float right[PAN_TABLE_STEPS + 1];  // sqrt(2) * sin(theta)
+};
+
+extern const PanGainTable panGainTable;
+
+/**
+ * Left and right gains for a pan position; clamped to -1..1
+ */
+inline void panToGains(float pan, float &left, float &right) {
+  float position = (pan + 1.0f) * (0.5f * (float)PAN_TABLE_STEPS);
+  if (position <= 0.0f) {
+    left = panGainTable.left[0];
+    right = panGainTable.right[0];
+    return;
+  }
+  if (position >= (float)PAN_TABLE_STEPS) {
+    left = panGainTable.left[PAN_TABLE_STEPS];
+    right = panGainTable.right[PAN_TABLE_STEPS];
+    return;
+  }
+  int index = (int)position;
+  float frac = position - (float)index;
+  const float *l = panGainTable.left;
+  const float *r = panGainTable.right;
+  left = l[index] + frac * (l[index + 1] - l[index]);
+  right = r[index] + frac * (r[index + 1] - r[index]);
+}
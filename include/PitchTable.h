@@ -0,0 +1,54 @@
+/**
+ * PitchTable - MIDI pitch to frequency without powf
+ *
+ * noteFrequencies[] holds 12-TET (A4 = 440 Hz) frequencies for every whole
+ * MIDI note the controller can reach: OCTAVE_MIN with the window slid fully
+ * down and a flat applied, up to OCTAVE_MAX with the highest key, interval,
+ * window offset and a sharp. Both tables are generated at compile time.
+ *
+ * Fractional pitches (microtonal scales, bends) multiply the note entry by
+ * a 1-cent-resolution ratio table, linearly interpolated between cents.
+ */
+
+#pragma once
+
+#include <math.h>
+
+const int PITCH_NOTE_MIN = -24;
+const int PITCH_NOTE_MAX = 144;
+const int PITCH_TABLE_SIZE = PITCH_NOTE_MAX - PITCH_NOTE_MIN + 1;
+const int PITCH_CENT_STEPS = 100;  // Fine table resolution per semitone
+
+struct NoteFrequencyTable {
+  float hz[PITCH_TABLE_SIZE];
+};
+
+struct CentRatioTable {
+  float ratio[PITCH_CENT_STEPS + 1];  // 2^(c/1200), c = 0..100
+};
+
+extern const NoteFrequencyTable noteFrequencies;
+extern const CentRatioTable centRatios;
+
+/**
+ * Frequency (Hz) of a whole MIDI note; clamped to the table range
+ */
+inline float noteToFreq(int note) {
+  if (note < PITCH_NOTE_MIN) note = PITCH_NOTE_MIN;
+  if (note > PITCH_NOTE_MAX) note = PITCH_NOTE_MAX;
+  return noteFrequencies.hz[note - PITCH_NOTE_MIN];
+}
+
+/**
+ * Frequency (Hz) of a fractional MIDI pitch (60.5 = C4 + 50 cents)
+ */
+inline float pitchToFreq(float pitch) {
+  float whole = floorf(pitch);
+  float cents = (pitch - whole) * (float)PITCH_CENT_STEPS;
+  int cent = (int)cents;
+  if (cent >= PITCH_CENT_STEPS) cent = PITCH_CENT_STEPS - 1;  // Rounding at the top edge
+  float frac = cents - (float)cent;
+  const float *r = centRatios.ratio;
+  float ratio = r[cent] + frac * (r[cent + 1] - r[cent]);
+  return noteToFreq((int)whole) * ratio;
+}
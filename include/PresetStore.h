@@ -0,0 +1,164 @@
+/**
+ * PresetStore - versioned state snapshots in a wear-leveled flash log
+ *
+ * Everything persistent is a small record: the last performance state
+ * (restored at boot), five preset slots, the sensor calibration and the
+ * sensor configuration found on the bus (so a known setup boots without
+ * an I2C scan). Records are appended to a log spread over
+ * PRESET_FLASH_SECTORS erase sectors; the newest valid record of each kind
+ * wins. When the current sector is full the log moves to the next one,
+ * erasing it first and carrying forward any kind whose newest record lived
+ * there, so every sector is erased equally often and no save erases more
+ * than one sector.
+ *
+ * Record layout (PRESET_RECORD_SIZE bytes, little endian):
+ *   0  magic 'P'
+ *   1  format version (PRESET_FORMAT_VERSION when written)
+ *   2  kind (PresetRecordKind)
+ *   3  payload length
+ *   4  sequence number (u32, one higher per record written)
+ *   8  payload (PRESET_PAYLOAD_MAX bytes, 0xFF padded)
+ *  30  CRC-16/CCITT of bytes 0-29
+ *
+ * A record torn by a power cut fails its CRC and is skipped, leaving the
+ * previous record of its kind in force. Payloads only ever grow at the
+ * end: a decoder takes the fields a record has and defaults the rest, and
+ * records from a newer major format are ignored.
+ *
+ * The flash sits behind FlashMemory (erase to 0xFF, program clears bits),
+ * with a QSPI backend on the Daisy (QspiFlash.h). Control loop only:
+ * program and erase block until the flash is done.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+const uint8_t PRESET_FORMAT_VERSION = 1;
+const size_t PRESET_RECORD_SIZE = 32;
+const size_t PRESET_PAYLOAD_MAX = 22;
+const int PRESET_FLASH_SECTORS = 16;         // Log length: 16 x 4 KB = 2048 records
+const int PRESET_SLOTS = 5;                  // One per left-hand button
+
+enum PresetRecordKind : uint8_t {
+  RECORD_LAST_STATE = 0,      // MusicalState, restored at boot
+  RECORD_CALIBRATION = 1,     // SensorCalibration
+  RECORD_SENSOR_CONFIG = 2,   // SensorConfig
+  RECORD_PRESET_FIRST = 3,    // MusicalState per slot, RECORD_PRESET_FIRST + slot
+  NUM_RECORD_KINDS = RECORD_PRESET_FIRST + PRESET_SLOTS
+};
+
+/**
+ * What a preset recalls
+ */
+struct MusicalState {
+  uint8_t key;          // Root, semitones above C
+  uint8_t scale;        // Scales.h index
+  uint8_t octave;
+  bool latch;
+  uint8_t arpPattern;   // ArpPattern
+  int8_t windowOffset;  // Sliding window, scale steps
+};
+
+/**
+ * Per-instrument sensor calibration
+ */
+struct SensorCalibration {
+  float accelCenterX;   // Level tilt (m/s^2)
+  float accelCenterY;
+  uint16_t distanceMin; // ToF mapping range (mm)
+  uint16_t distanceMax;
+};
+
+/**
+ * Sensors found on the bus at their addresses
+ */
+struct SensorConfig {
+  bool tof;
+  bool accel;
+  uint8_t tofAddress;
+  uint8_t accelAddress;
+};
+
+// Payload encodings: encode returns the length written (at most
+// PRESET_PAYLOAD_MAX); decode fills fields missing from an older, shorter
+// payload from the defaults already in the struct
+size_t encodeMusicalState(const MusicalState &state, uint8_t *payload);
+void decodeMusicalState(const uint8_t *payload, size_t length, MusicalState &state);
+size_t encodeCalibration(const SensorCalibration &calibration, uint8_t *payload);
+void decodeCalibration(const uint8_t *payload, size_t length, SensorCalibration &calibration);
+size_t encodeSensorConfig(const SensorConfig &config, uint8_t *payload);
+void decodeSensorConfig(const uint8_t *payload, size_t length, SensorConfig &config);
+
+uint16_t presetCrc16(const uint8_t *data, size_t length);
+
+/**
+ * Sector-erasable NOR flash
+ */
+class FlashMemory {
+public:
+  virtual ~FlashMemory() {}
+
+  virtual uint32_t SectorSize() const = 0;
+
+  /**
+   * Copy n bytes at address (offset into the flash)
+   */
+  virtual bool Read(uint32_t address, uint8_t *dst, size_t n) = 0;
+
+  /**
+   * Set the sector containing address to 0xFF
+   */
+  virtual bool EraseSector(uint32_t address) = 0;
+
+  /**
+   * Program n bytes at address (can only clear bits; n fits in one page)
+   */
+  virtual bool Program(uint32_t address, const uint8_t *src, size_t n) = 0;
+};
+
+class PresetStore {
+public:
+  /**
+   * Scan the log at base (PRESET_FLASH_SECTORS sectors) and index the
+   * newest record of every kind; false if the flash cannot be read
+   */
+  bool Init(FlashMemory *flash, uint32_t base);
+
+  bool Ready() const { return flash != nullptr; }
+
+  /**
+   * Newest payload of a kind; false if none was ever saved
+   */
+  bool Load(PresetRecordKind kind, uint8_t *payload, size_t &length);
+
+  /**
+   * Append a record; false if the flash failed
+   */
+  bool Save(PresetRecordKind kind, const uint8_t *payload, size_t length);
+
+  bool Has(PresetRecordKind kind) const { return latest[kind] != NO_RECORD; }
+
+  // Housekeeping counters since Init()
+  uint32_t Writes() const { return writes; }
+  uint32_t Erases() const { return erases; }
+  uint32_t RecordsFound() const { return found; }
+
+private:
+  static const uint32_t NO_RECORD = 0xFFFFFFFF;
+
+  bool append(PresetRecordKind kind, const uint8_t *payload, size_t length);
+  bool nextSector();
+
+  FlashMemory *flash = nullptr;
+  uint32_t base = 0;
+  uint32_t sectorSize = 4096;
+  uint32_t latest[NUM_RECORD_KINDS];    // Address of each kind's newest record
+  uint32_t sectorStart = 0;             // Sector the log is appending to
+  uint32_t writeAddress = 0;            // Next free record
+  uint32_t sequence = 0;                // Of the next record
+  uint32_t writes = 0;
+  uint32_t erases = 0;
+  uint32_t found = 0;
+};
@@ -0,0 +1,35 @@
+/**
+ * QspiFlash - FlashMemory backend on the Daisy Seed's QSPI NOR flash
+ *
+ * The IS25LP064A (8 MB, 4 KB erase sectors, 256-byte pages) stays in
+ * memory-mapped mode: reads are plain copies from the mapped window (after
+ * invalidating the D-cache lines, which still hold the old contents after
+ * an erase or program), erase and program go through libDaisy's
+ * QSPIHandle and block until the flash reports done. Nothing runs from
+ * QSPI, so the audio interrupt keeps running while the control loop waits.
+ */
+
+#pragma once
+
+#include "DaisyDuino.h"
+#include "PresetStore.h"
+
+const uint32_t QSPI_FLASH_SIZE = 8 * 1024 * 1024;
+const uint32_t QSPI_SECTOR_SIZE = 4096;
+
+class QspiFlash : public FlashMemory {
+public:
+  /**
+   * Bring up the QSPI peripheral on the Seed's pins, memory-mapped
+   */
+  bool Init();
+
+  uint32_t SectorSize() const override { return QSPI_SECTOR_SIZE; }
+  bool Read(uint32_t address, uint8_t *dst, size_t n) override;
+  bool EraseSector(uint32_t address) override;
+  bool Program(uint32_t address, const uint8_t *src, size_t n) override;
+
+private:
+  daisy::QSPIHandle qspi;
+  bool ready = false;
+};
@@ -0,0 +1,67 @@
+/**
+ * Scales - scale registry and note calculation (hardware-neutral)
+ *
+ * Every scale is a table entry: a name, the number of equal steps per
+ * octave (12 for standard tuning, 19/24/31... for EDO tunings) and the
+ * degree each left-hand button plays, in those steps. Adding a scale or
+ * tuning only needs a new ScaleType and a row in scaleRegistry.
+ *
+ * Chords work the same way: each play mode is a row in chordRegistry
+ * listing the intervals (semitones above the button's note) that one
+ * button press sounds.
+ */
+
+#pragma once
+
+const int SCALE_LENGTH = 5;  // Notes per scale (one per left-hand button)
+
+enum ScaleType {
+  SCALE_MAJOR_PENTATONIC = 0,
+  SCALE_BLUES = 1,
+  SCALE_CHROMATIC = 2,
+  SCALE_EDO19_PENTATONIC = 3,
+  SCALE_QUARTER_TONE = 4,
+  NUM_SCALES
+};
+
+struct ScaleDef {
+  const char *name;
+  int stepsPerOctave;         // Equal divisions of the octave
+  int steps[SCALE_LENGTH];    // Degrees, in steps from the root
+};
+
+extern const ScaleDef scaleRegistry[NUM_SCALES];
+
+/**
+ * Registry entry for a scale; falls back to the first entry when out of range
+ */
+const ScaleDef &scaleDef(int scale);
+
+/**
+ * Calculate the pitch of each of the 5 buttons from octave, key, scale and
+ * window offset (window offset slides through the scale). Pitches are MIDI
+ * note numbers, fractional for microtonal scales.
+ */
+void computeScaleNotes(int octave, int key, int scale, int windowOffset, float pitches[SCALE_LENGTH]);
+
+const int MAX_CHORD_TONES = 3;  // Voices one button can start
+
+enum ChordType {
+  CHORD_SINGLE = 0,   // Indices match PlayMode
+  CHORD_MAJOR = 1,
+  CHORD_MINOR = 2,
+  NUM_CHORDS
+};
+
+struct ChordDef {
+  const char *name;
+  int numTones;
+  float intervals[MAX_CHORD_TONES];  // Semitones above the button's note
+};
+
+extern const ChordDef chordRegistry[NUM_CHORDS];
+
+/**
+ * Registry entry for a chord; falls back to a single note when out of range
+ */
+const ChordDef &chordDef(int chord);
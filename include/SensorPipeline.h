@@ -0,0 +1,104 @@
+/**
+ * SensorPipeline - timestamped VL53L0X and MSA301 samples without blocking
+ *
+ * Replaces polling the Adafruit drivers from loop(). After the drivers have
+ * configured the parts at boot, readings are raw register transactions
+ * queued on an I2cScheduler:
+ *   - VL53L0X: its GPIO1 data-ready interrupt (active low) marks a fresh
+ *     range; the ISR only records the time, and Service() then queues the
+ *     result read and the interrupt clear. If no interrupt arrives (pin not
+ *     wired, edge missed) it falls back to polling the status register
+ *     until interrupts resume.
+ *   - MSA301: the X/Y/Z data registers are read on a fixed interval.
+ * Decoded samples carry the time the measurement became available and are
+ * consumed from a ring by the control loop.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "I2cScheduler.h"
+#include "SpscQueue.h"
+
+enum SensorKind : uint8_t {
+  SENSOR_TOF = 0,
+  SENSOR_ACCEL = 1
+};
+
+struct SensorSample {
+  SensorKind kind;
+  uint8_t status;            // ToF: 0 = valid range, else device range status
+  uint32_t timestampMicros;  // When the measurement became available
+  float value[3];            // ToF: distance in mm in [0]; accel: x, y, z in m/s^2
+};
+
+const uint32_t SENSOR_SAMPLE_QUEUE_SIZE = 16;
+
+/**
+ * MSA301 14-bit counts to m/s^2 and back (exact round trip)
+ */
+float accelFromCounts(int16_t counts);
+int16_t accelToCounts(float value);
+
+class SensorPipeline {
+public:
+  void Init(I2cBus *bus);
+
+  /**
+   * Start reading a VL53L0X that is already ranging continuously
+   * periodMicros: inter-measurement period, bounds the polling fallback
+   * useInterrupt: GPIO1 is wired to an interrupt calling OnTofDataReady()
+   */
+  void EnableTof(uint8_t address, uint32_t periodMicros, bool useInterrupt, uint32_t nowMicros);
+
+  /**
+   * Read MSA301 acceleration every intervalMicros
+   */
+  void EnableAccel(uint8_t address, uint32_t intervalMicros);
+
+  /**
+   * VL53L0X data-ready interrupt handler (ISR-safe)
+   */
+  void OnTofDataReady(uint32_t nowMicros);
+
+  /**
+   * Queue due reads and advance the bus; call every loop() iteration
+   */
+  void Service(uint32_t nowMicros);
+
+  bool Pop(SensorSample &sample) { return samples.Pop(sample); }
+
+  bool TofPolling() const { return tofPolling; }
+  uint32_t DroppedSamples() const { return samples.Dropped(); }
+  uint32_t BusErrors() const { return bus.Errors(); }
+
+private:
+  static void onComplete(void *context, const I2cTransaction &t);
+  void handleCompletion(const I2cTransaction &t);
+  void submit(const I2cTransaction &t, uint32_t nowMicros);
+
+  I2cScheduler bus;
+  SpscQueue<SensorSample, SENSOR_SAMPLE_QUEUE_SIZE> samples;
+
+  // VL53L0X
+  bool tofEnabled = false;
+  bool tofUseInterrupt = false;
+  bool tofPolling = false;
+  bool tofInFlight = false;
+  uint8_t tofAddress = 0;
+  uint32_t tofPeriod = 0;
+  uint32_t tofLastSample = 0;
+  uint32_t tofLastPoll = 0;
+  uint32_t tofReadyMicros = 0;
+  std::atomic<bool> tofIrq{false};
+  std::atomic<uint32_t> tofIrqMicros{0};
+
+  // MSA301
+  bool accelEnabled = false;
+  bool accelInFlight = false;
+  uint8_t accelAddress = 0;
+  uint32_t accelInterval = 0;
+  uint32_t accelLastRequest = 0;
+};
@@ -0,0 +1,63 @@
+/**
+ * SpscQueue - lock-free single-producer/single-consumer ring buffer
+ *
+ * One side (e.g. loop()) only calls Push(), the other (e.g. the audio
+ * interrupt) only calls Pop(). Indices are free-running 32-bit counters,
+ * so full/empty need no spare slot. Acquire/release ordering guarantees
+ * the consumer never sees an index before the item it covers. Push() never
+ * blocks: when the ring is full the item is dropped and counted.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+template <typename T, uint32_t CAPACITY>
+class SpscQueue {
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+  /**
+   * Producer side: returns false (and counts a drop) if the ring is full
+   */
+  bool Push(const T &item) {
+    uint32_t head = writeIndex.load(std::memory_order_relaxed);
+    uint32_t tail = readIndex.load(std::memory_order_acquire);
+    if (head - tail >= CAPACITY) {
+      dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    items[head & (CAPACITY - 1)] = item;
+    writeIndex.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Consumer side: returns false if the ring is empty
+   */
+  bool Pop(T &item) {
+    uint32_t tail = readIndex.load(std::memory_order_relaxed);
+    uint32_t head = writeIndex.load(std::memory_order_acquire);
+    if (tail == head) {
+      return false;
+    }
+    item = items[tail & (CAPACITY - 1)];
+    readIndex.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint32_t Size() const {
+    return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+  }
+
+  bool Empty() const { return Size() == 0; }
+  uint32_t Capacity() const { return CAPACITY; }
+  uint32_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  T items[CAPACITY];
+  std::atomic<uint32_t> writeIndex{0};  // Written by the producer only
+  std::atomic<uint32_t> readIndex{0};   // Written by the consumer only
+  std::atomic<uint32_t> dropped{0};     // Written by the producer only
+};
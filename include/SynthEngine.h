@@ -0,0 +1,291 @@
+/**
+ * SynthEngine - hardware-neutral synthesis core
+ *
+ * Owns the voice pool (wavetable oscillator + envelope per voice), the
+ * control-to-audio event queue and the output stage. Nothing here touches
+ * Arduino or DaisyDuino APIs, so the same engine runs inside
+ * AudioCallback() on the Daisy Seed and inside the offline renderer on a
+ * host build.
+ *
+ * Notes are addressed by note id (0 to MAX_NOTE_IDS - 1, chosen by the
+ * caller, e.g. button and chord tone). The audio side maps ids to voices:
+ * a note-on takes a free voice, or steals the voice that was released
+ * longest ago, or failing that the oldest held voice. Stolen voices fade
+ * out over STEAL_FADE_SAMPLES in a separate fade slot so the new note
+ * starts at once without a click. A note-on for an id that is already
+ * sounding releases the old voice (its tail keeps playing) and starts a
+ * fresh one. Voices sit on intrusive age-ordered lists, so allocation,
+ * release and stealing are O(1) whatever the pool size.
+ *
+ * Every voice is panned into a stereo mix with constant-power gains from
+ * PanTable. A note id carries a pan position (set once or changed at any
+ * time) that its voices take when they start; a global offset moves the
+ * whole image. Positions glide per block and each voice's gains are ramped
+ * across the block, so panning costs two table lookups per voice per
+ * block and no per-sample trig. The stereo mix feeds the EffectsBus (delay
+ * and reverb) and then the soft clipper.
+ *
+ * Voices are addressed by MIDI pitch in fractional semitones. Pitch
+ * changes glide: each voice's pitch approaches its target with a one-pole
+ * slew in the semitone (log-frequency) domain, evaluated at block rate and
+ * converted through the pitch table; the oscillator then ramps its phase
+ * increment per sample between block endpoints. A global bend (semitones)
+ * is smoothed the same way and added to every voice.
+ *
+ * Note on/off events can be timed: Process() is told when its block
+ * starts on the control clock and applies each timed note at its sample
+ * offset (a voice starts or releases mid-block), holding timed events for
+ * later blocks back in order. Untimed events (parameters, pitch, pan) never
+ * wait behind them: they apply at the start of the block they arrive in.
+ * Timed events that arrive after their block count as late and apply at
+ * the start of the next one.
+ *
+ * Notes can instead be held into the Arpeggiator, which starts and stops
+ * them itself on the sample clock (steps are counted in samples inside
+ * Process(), never timed by loop()). Its note on/offs drive voices exactly
+ * like NoteOn()/NoteOff() and are passed back to the control side through
+ * a second SpscQueue (PopArpNote()) so loop() can mirror them, e.g. to MIDI.
+ *
+ * Threading: the note/parameter methods are called from loop() only, and
+ * Process() from the audio callback only. They communicate through an
+ * SpscQueue, never through shared fields; the one exception is the voice
+ * status Process() publishes for telemetry, a relaxed atomic per voice.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Arpeggiator.h"
+#include "DspKernels.h"
+#include "EffectsBus.h"
+#include "NoteEnvelope.h"
+#include "SynthEvents.h"
+#include "WavetableOsc.h"
+
+#ifndef SYNTH_VOICES
+#define SYNTH_VOICES 16
+#endif
+
+const int NUM_VOICES = SYNTH_VOICES;         // Voice pool size
+const int MAX_NOTE_IDS = 64;                 // Note ids the caller may use
+const int NUM_FADE_SLOTS = 4;                // Stolen voices fading out at once
+const int STEAL_FADE_SAMPLES = 64;           // Anti-click fade of a stolen voice (~1.3 ms)
+const uint32_t MAX_SCHEDULE_AHEAD_MICROS = 100000;  // Later note times are taken as clock errors
+const uint32_t ARP_NOTE_QUEUE_SIZE = 128;    // Arpeggiator notes waiting for loop()
+const int MAX_HELD_EVENTS = 16;              // Timed events waiting for a later block
+
+static_assert(NUM_VOICES >= 1 && NUM_VOICES <= 32, "SYNTH_VOICES must be 1-32");
+
+/**
+ * One voice as of the end of the last callback
+ */
+struct VoiceStatus {
+  int note;              // Note id holding the voice, -1 if none
+  EnvelopeStage stage;
+  float level;           // Envelope level (0.0 to 1.0), 16-bit resolution
+};
+
+class SynthEngine {
+public:
+  /**
+   * Build the wavetables and reset every voice
+   */
+  void Init(float sampleRate);
+
+  void SetEnvelope(float attack, float decay, float sustain, float release, EnvelopeCurve curve);
+
+  /**
+   * Hold the effects to a share of each block deadline, timed in CPU meter
+   * ticks (call from setup() before audio starts)
+   */
+  void SetEffectsBudget(float budget, float ticksPerMicro);
+
+  // Control side (loop())
+
+  /**
+   * Start a note at a MIDI pitch (no glide) on a pool voice
+   * If the id is already sounding, its voice releases and a fresh voice
+   * starts the cycle and attack from the beginning
+   */
+  void NoteOn(int note, float pitch);
+
+  /**
+   * Start a note at a time on the clock passed to Process()
+   */
+  void NoteOn(int note, float pitch, uint32_t timeMicros);
+
+  /**
+   * Release a note (start release phase)
+   */
+  void NoteOff(int note);
+  void NoteOff(int note, uint32_t timeMicros);
+
+  /**
+   * Glide a sounding note to a new MIDI pitch without retriggering it
+   */
+  void SetNotePitch(int note, float pitch);
+
+  /**
+   * Pan position of a note id (-1 left, 0 center, +1 right): voices it
+   * starts from now on begin there, a sounding voice glides there
+   */
+  void SetNotePan(int note, float pan);
+
+  /**
+   * Queue a continuous parameter change (smoothed per block by the audio side)
+   */
+  void SetParam(SynthParam param, float value);
+
+  /**
+   * Hand a note to the arpeggiator at a time on the Process() clock: it
+   * joins the pool the pattern (PARAM_ARP_PATTERN) plays from
+   */
+  void ArpHold(int note, float pitch, uint32_t timeMicros);
+
+  /**
+   * Take a note out of the arpeggiator's pool (it stops if sounding)
+   */
+  void ArpRelease(int note, uint32_t timeMicros);
+
+  /**
+   * Next note on/off the arpeggiator played; false when there is none
+   */
+  bool PopArpNote(ArpEvent &evt) { return arpNotes.Pop(evt); }
+
+  uint32_t DroppedEvents() const { return events.Dropped(); }
+  uint32_t DroppedArpNotes() const { return arpNotes.Dropped() + arp.DroppedEvents(); }
+
+  // Audio side (AudioCallback())
+
+  /**
+   * Apply queued events, then render size samples into out[0]/out[1];
+   * blockMicros is the time of out[.][0] on the clock note times use
+   */
+  void Process(float **out, size_t size, uint32_t blockMicros);
+
+  uint32_t StolenVoices() const { return stolen; }
+  uint32_t LateEvents() const { return lateEvents; }
+  float Morph() const { return morphCurrent; }  // Morph position at the end of the last block
+
+  /**
+   * Voice status for telemetry (safe from loop())
+   */
+  VoiceStatus Voice(int voice) const;
+
+  /**
+   * Effects load and budget (loop() uses only the getters and RequestReset())
+   */
+  EffectsBus &Effects() { return effects; }
+
+private:
+  enum VoiceList : uint8_t {
+    LIST_FREE = 0,
+    LIST_HELD = 1,       // Oldest first
+    LIST_RELEASING = 2,  // Released longest ago first
+    NUM_LISTS = 3
+  };
+
+  struct FadeSlot {
+    WavetableOsc osc;
+    float panLeft;      // Pan gains of the stolen voice
+    float panRight;
+    float gain;
+    float step;
+    int remaining;
+  };
+
+  void post(SynthEventType type, int note, uint8_t param, float value);
+  void postAt(SynthEventType type, int note, float value, uint32_t timeMicros);
+  void drainEvents(size_t size, uint32_t blockMicros);
+  bool eventOffset(const SynthEvent &evt, size_t size, uint32_t blockMicros, int32_t &offset);
+  void holdEvent(const SynthEvent &evt);
+  void applyEvent(const SynthEvent &evt, int32_t offset);
+  void runArpeggiator(size_t size);
+  void renderBlock(float *left, float *right, size_t n);
+  void updatePitch(int voice, float glide);
+  void updatePan(int voice, float &left, float &right);
+  void setEnvelopeTimes();
+  void publishVoices();
+
+  // Voice pool
+  void listRemove(int voice);
+  void listPush(VoiceList list, int voice);
+  int allocateVoice();
+  void releaseVoice(int voice, int32_t delay);
+  void stealVoice(int voice);
+  void startNote(int note, float pitch, int32_t delay);
+
+  SynthEventQueue events;
+  SynthEvent heldEvents[MAX_HELD_EVENTS];  // Timed events waiting for a later block, oldest first
+  int heldFirst = 0;
+  int heldCount = 0;
+  uint32_t lateEvents = 0;
+  WavetableBank wavetables;
+  EffectsBus effects;
+  Arpeggiator arp;
+  ArpEvent arpEvents[ARP_MAX_EVENTS];   // Notes the arpeggiator played this callback
+  SpscQueue<ArpEvent, ARP_NOTE_QUEUE_SIZE> arpNotes;
+  WavetableOsc osc[NUM_VOICES];
+  NoteEnvelope envelopes[NUM_VOICES];
+
+  // Allocation state (audio side only)
+  int8_t noteVoice[MAX_NOTE_IDS];       // Held voice per note id, -1 if none
+  int8_t voiceNote[NUM_VOICES];         // Note id holding each voice, -1 if none
+  int8_t voicePrev[NUM_VOICES];
+  int8_t voiceNext[NUM_VOICES];
+  uint8_t voiceList[NUM_VOICES];
+  int8_t listHead[NUM_LISTS];
+  int8_t listTail[NUM_LISTS];
+  int32_t voiceStartDelay[NUM_VOICES];    // Samples before a timed note starts
+  int32_t voiceReleaseDelay[NUM_VOICES];  // Samples before a timed release, -1 if none
+  uint32_t stolen = 0;
+  FadeSlot fades[NUM_FADE_SLOTS];
+
+  // Block render buffers (one block of up to MAX_BLOCK_SIZE samples; the
+  // stereo mix accumulates straight into the output)
+  float voiceBuffer[MAX_BLOCK_SIZE];   // Oscillator output for one voice
+  float envBuffer[MAX_BLOCK_SIZE];     // Envelope levels for one voice
+
+  // Audio-side parameters: written only inside Process()
+  float volume = 0.3f;           // Volume target from the last PARAM_VOLUME event
+  float volumeCurrent = 0.3f;    // Volume at the end of the previous block
+  float volumeStep = 0.0f;       // Volume change per sample while ramping to the target
+  float volumeRamp = 0.005f;     // Ramp time (seconds) for a PARAM_VOLUME change
+  float attackTime = 0.01f;      // Envelope settings every voice uses
+  float decayTime = 0.0f;
+  float sustainLevel = 1.0f;
+  float releaseTime = 0.1f;
+  float polyGain = 1.0f;         // Polyphony compensation at the end of the previous block
+  float polyGainTable[NUM_VOICES + 1];  // 1 / sqrt(active voices), filled by Init()
+  float morph = 0.0f;            // Morph target from the last PARAM_MORPH event
+  float morphCurrent = 0.0f;     // Morph at the end of the current block
+  float morphStep = 0.0f;        // Morph change per sample while ramping to the target
+  float morphRamp = 0.02f;       // Ramp time (seconds) for a PARAM_MORPH change
+  float bend = 0.0f;             // Bend target (semitones)
+  float bendSmoothed = 0.0f;     // Bend at the end of the current block
+  float glideTime = 0.0f;        // Glide time constant (seconds)
+  float glideBlockCoef = 0.0f;   // Remaining fraction of a glide after one block
+  size_t glideBlockSize = 0;     // Block size glideBlockCoef was computed for
+  float sampleRate = 48000.0f;
+
+  // Per-voice pitch state (MIDI pitch, fractional)
+  float pitchTarget[NUM_VOICES] = {};
+  float pitchCurrent[NUM_VOICES] = {};
+  float pitchRendered[NUM_VOICES] = {};  // Pitch + bend last sent to the oscillator
+
+  // Pan state: position per note id, per voice target, position and the
+  // gains reached at the end of the last block
+  float notePan[MAX_NOTE_IDS] = {};
+  float panTarget[NUM_VOICES] = {};
+  float panCurrent[NUM_VOICES] = {};
+  float panGainLeft[NUM_VOICES] = {};
+  float panGainRight[NUM_VOICES] = {};
+  float panOffset = 0.0f;
+
+  // Published by publishVoices(): note id (8 bits, 0xFF = none), stage (8)
+  // and envelope level (16) packed into one word per voice
+  std::atomic<uint32_t> voiceStatus[NUM_VOICES] = {};
+};
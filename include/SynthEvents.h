@@ -0,0 +1,59 @@
+/**
+ * SynthEvents - messages from the control loop to the audio callback
+ *
+ * loop() never writes audio state directly. It posts SynthEvents into an
+ * SpscQueue; AudioCallback() drains the queue at the start of every block
+ * and applies the events there, so the audio side always sees complete
+ * updates and continuous parameters can be smoothed per block.
+ *
+ * Note events may carry a time (the control loop's micros() clock): the
+ * audio side holds them until the block containing that time and starts or
+ * releases the voice at the matching sample.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "SpscQueue.h"
+
+enum SynthEventType : uint8_t {
+  EVT_NOTE_ON = 0,     // note id, value = MIDI pitch (fractional semitones)
+  EVT_NOTE_OFF = 1,    // note id
+  EVT_SET_PITCH = 2,   // note id, value = MIDI pitch; glides, no retrigger
+  EVT_SET_PARAM = 3,   // param, value
+  EVT_SET_PAN = 4,     // note id, value = pan (-1 left to +1 right); glides
+  EVT_ARP_HOLD = 5,    // note id, value = MIDI pitch; into the arpeggiator's pool
+  EVT_ARP_RELEASE = 6  // note id; out of the pool
+};
+
+enum SynthParam : uint8_t {
+  PARAM_VOLUME = 0,    // 0.0 to VOLUME_SCALE
+  PARAM_MORPH = 1,     // Wavetable morph position
+  PARAM_BEND = 2,      // Pitch bend added to every voice, in semitones
+  PARAM_GLIDE = 3,     // Glide time constant for EVT_SET_PITCH, in seconds
+  PARAM_DELAY_MIX = 4,     // Delay send, 0.0 to 1.0
+  PARAM_REVERB_MIX = 5,    // Reverb send, 0.0 to 1.0
+  PARAM_REVERB_DECAY = 6,  // Reverb RT60, in seconds
+  PARAM_PAN_OFFSET = 7,    // Added to every voice's pan (-2 to +2; result clamped)
+  PARAM_ARP_PATTERN = 8,   // ArpPattern (Arpeggiator.h)
+  PARAM_ARP_RATE = 9,      // Arpeggiator steps per second
+  PARAM_MORPH_RAMP = 10,   // Time a PARAM_MORPH change is ramped over, in seconds
+  PARAM_VOLUME_RAMP = 11,  // Time a PARAM_VOLUME change is ramped over, in seconds
+  PARAM_ATTACK = 12,       // Envelope stage times in seconds (sustain 0.0 to 1.0);
+  PARAM_DECAY = 13,        // they apply from each voice's next stage on
+  PARAM_SUSTAIN = 14,
+  PARAM_RELEASE = 15
+};
+
+struct SynthEvent {
+  SynthEventType type;
+  uint8_t note;         // Note id; the audio side picks the voice
+  uint8_t param;
+  bool timed;           // Note on/off/hold/release at timeMicros rather than the next block
+  float value;
+  uint32_t timeMicros;
+};
+
+const uint32_t SYNTH_EVENT_QUEUE_SIZE = 64;
+typedef SpscQueue<SynthEvent, SYNTH_EVENT_QUEUE_SIZE> SynthEventQueue;
@@ -0,0 +1,76 @@
+/**
+ * TaskScheduler - cooperative fixed-rate tasks for the control loop
+ *
+ * Each task has a period and a priority (0 = most urgent). A task's
+ * deadlines sit on a fixed grid (start + k * period), so a late run does
+ * not push the next one back and the rate never drifts. RunDue() runs due
+ * tasks one at a time, always picking the most urgent, and checks again
+ * after each run: a button edge that arrives while the log is being
+ * drained is picked up as soon as that one run returns.
+ *
+ * Tasks are not preempted. A task that starts a whole period or more
+ * after its deadline has missed runs: it runs once, the missed deadlines
+ * are counted as overruns and it resumes on its grid. Run times and how
+ * late each run started are kept per task for the 'k' report.
+ *
+ * The clock is a function pointer (micros() on the device, a simulated
+ * clock on the host), so the scheduler has no platform dependencies.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+const int SCHEDULER_MAX_TASKS = 8;
+
+typedef void (*TaskFunction)(uint32_t nowMicros);
+
+struct TaskStats {
+  uint32_t runs;
+  uint64_t totalMicros;     // Sum of run times
+  uint32_t maxMicros;       // Longest run
+  uint32_t maxLateMicros;   // Latest start after a deadline
+  uint32_t overruns;        // Deadlines skipped because the task started a period late
+};
+
+class TaskScheduler {
+public:
+  /**
+   * clock: free-running microseconds (wraps)
+   */
+  void Init(uint32_t (*clock)());
+
+  /**
+   * Add a task; its first deadline is one period from now. Returns its
+   * id, or -1 when the table is full.
+   */
+  int Add(const char *name, uint32_t periodMicros, uint8_t priority, TaskFunction run);
+
+  /**
+   * Run every task that is due, most urgent first; returns microseconds
+   * until the next deadline (0 if one is already due)
+   */
+  uint32_t RunDue();
+
+  int Count() const { return numTasks; }
+  const char *Name(int id) const { return tasks[id].name; }
+  uint32_t Period(int id) const { return tasks[id].period; }
+  const TaskStats &Stats(int id) const { return tasks[id].stats; }
+  void ResetStats();
+
+private:
+  struct Task {
+    const char *name;
+    uint32_t period;
+    uint8_t priority;
+    TaskFunction run;
+    uint32_t deadline;
+    TaskStats stats;
+  };
+
+  int mostUrgent(uint32_t now) const;
+
+  uint32_t (*now)() = nullptr;
+  Task tasks[SCHEDULER_MAX_TASKS];
+  int numTasks = 0;
+};
@@ -0,0 +1,176 @@
+/**
+ * TelemetryLink - framed binary messages over the USB serial port
+ *
+ * Every message is a payload of at most TELEMETRY_MAX_PAYLOAD bytes: a
+ * message type, then its fields (integers little-endian, floats IEEE 754
+ * single, little-endian). The sender appends the payload's CRC-16 (the
+ * CCITT CRC the preset records use, presetCrc16(), also little-endian),
+ * COBS-encodes the result so it contains no zero bytes and ends the frame
+ * with a 0x00. A receiver therefore always finds the next frame boundary:
+ * line noise, a partial frame or log text left in the port costs one
+ * rejected frame, never a lost stream.
+ *
+ * Receive() takes one byte at a time from a fixed buffer and Send() builds
+ * the frame on the stack, so the link never allocates. Send() only writes
+ * whole frames: when the port cannot take one, it is dropped and counted.
+ *
+ * The message set (fields in order, after the type byte):
+ *
+ *   Host to device
+ *     TM_PING          -                       -> TM_PONG
+ *     TM_GET_PARAM     u8 id                   -> TM_PARAM
+ *     TM_SET_PARAM     u8 id, f32 value        -> TM_PARAM (value in use)
+ *     TM_GET_INFO      u8 id                   -> TM_PARAM_INFO
+ *     TM_SET_RATE      u16 frames per second   -> TM_RATE (0 = stop)
+ *     TM_EXIT          -                       (back to log text)
+ *   Device to host
+ *     TM_PONG          u8 version, u8 parameter count
+ *     TM_PARAM         u8 id, f32 value
+ *     TM_PARAM_INFO    u8 id, f32 value, f32 min, f32 max, name (rest)
+ *     TM_RATE          u16 frames per second
+ *     TM_TELEMETRY     u32 micros, u16 CPU load avg and peak (0.1%),
+ *                      u8 active voices, f32 distance (mm, -1 = no hand),
+ *                      f32 morph, f32 tilt (m/s^2), f32 bend (semitones),
+ *                      f32 volume, u8 voice count, then per voice u8 note
+ *                      id (0xFF = free), u8 EnvelopeStage, u16 level
+ *     TM_ERROR         u8 TelemetryError, u8 message type
+ *
+ * tools/telemetry.py is the host client; test/test_telemetry_link checks
+ * the framing, also through a pseudo-terminal, and `program --bench
+ * telemetry` times the round trips.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+const uint8_t TELEMETRY_VERSION = 1;
+const size_t TELEMETRY_MAX_PAYLOAD = 160;
+// Payload + CRC, one COBS code byte per 254 bytes and the delimiter
+const size_t TELEMETRY_MAX_FRAME = TELEMETRY_MAX_PAYLOAD + 2 + (TELEMETRY_MAX_PAYLOAD + 2) / 254 + 2;
+
+enum TelemetryMessage : uint8_t {
+  TM_PING = 0x01,
+  TM_GET_PARAM = 0x02,
+  TM_SET_PARAM = 0x03,
+  TM_GET_INFO = 0x04,
+  TM_SET_RATE = 0x05,
+  TM_EXIT = 0x06,
+  TM_PONG = 0x81,
+  TM_PARAM = 0x82,
+  TM_PARAM_INFO = 0x83,
+  TM_RATE = 0x84,
+  TM_TELEMETRY = 0x85,
+  TM_ERROR = 0xFF
+};
+
+enum TelemetryError : uint8_t {
+  TE_UNKNOWN_MESSAGE = 1,
+  TE_BAD_LENGTH = 2,       // Fields missing
+  TE_UNKNOWN_PARAM = 3,
+  TE_REJECTED = 4          // Valid id, but the value does not fit the other settings
+};
+
+/**
+ * COBS-encode length bytes (no delimiter added); dst needs
+ * length + length / 254 + 1 bytes. Returns the encoded length.
+ */
+size_t cobsEncode(const uint8_t *src, size_t length, uint8_t *dst);
+
+/**
+ * Decode one COBS frame (without its delimiter) into dst (at most
+ * capacity bytes); false if it is malformed or too long
+ */
+bool cobsDecode(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity, size_t &decoded);
+
+/**
+ * Payload under construction; Put*() past TELEMETRY_MAX_PAYLOAD are
+ * dropped and flag the packet as overflowed
+ */
+class TelemetryPacket {
+public:
+  explicit TelemetryPacket(uint8_t type) { PutU8(type); }
+
+  void PutU8(uint8_t value);
+  void PutU16(uint16_t value);
+  void PutU32(uint32_t value);
+  void PutFloat(float value);
+  void PutString(const char *text);  // No terminator: a string is the last field
+
+  const uint8_t *Data() const { return data; }
+  size_t Length() const { return length; }
+  bool Overflowed() const { return overflowed; }
+
+private:
+  uint8_t data[TELEMETRY_MAX_PAYLOAD];
+  size_t length = 0;
+  bool overflowed = false;
+};
+
+/**
+ * Fields of a received payload, in order; a Get*() past the end returns
+ * false and leaves the value alone
+ */
+class TelemetryReader {
+public:
+  TelemetryReader(const uint8_t *payload, size_t length) : data(payload), remaining(length) {}
+
+  bool GetU8(uint8_t &value);
+  bool GetU16(uint16_t &value);
+  bool GetU32(uint32_t &value);
+  bool GetFloat(float &value);
+  size_t Remaining() const { return remaining; }
+
+private:
+  const uint8_t *data;
+  size_t remaining;
+};
+
+/**
+ * Byte sink; writable() reports how many bytes it takes without blocking
+ * (null = any)
+ */
+struct TelemetryWriter {
+  void (*write)(const uint8_t *data, size_t length);
+  size_t (*writable)();
+};
+
+class TelemetryLink {
+public:
+  void Init(TelemetryWriter sink);
+
+  /**
+   * Feed one received byte; true when it completed a valid frame, whose
+   * payload (type first) stays in Payload() until the next call
+   */
+  bool Receive(uint8_t byte);
+
+  const uint8_t *Payload() const { return payload; }
+  size_t PayloadLength() const { return payloadLength; }
+
+  /**
+   * Frame and send one payload; false if the port had no room for the
+   * whole frame (counted in DroppedFrames())
+   */
+  bool Send(const uint8_t *data, size_t length);
+  bool Send(const TelemetryPacket &packet) { return !packet.Overflowed() && Send(packet.Data(), packet.Length()); }
+
+  /**
+   * A lone delimiter: ends whatever the receiver had before (log text)
+   */
+  void SendDelimiter();
+
+  uint32_t BadFrames() const { return badFrames; }
+  uint32_t DroppedFrames() const { return droppedFrames; }
+
+private:
+  TelemetryWriter writer = {nullptr, nullptr};
+  uint8_t rx[TELEMETRY_MAX_FRAME];
+  size_t rxLength = 0;
+  bool rxOverflow = false;              // Frame too long: skip to the next delimiter
+  uint8_t payload[TELEMETRY_MAX_PAYLOAD + 2];
+  size_t payloadLength = 0;
+  uint32_t badFrames = 0;
+  uint32_t droppedFrames = 0;
+};
@@ -0,0 +1,89 @@
+/**
+ * WavetableOsc - band-limited morphing wavetable oscillator
+ *
+ * A WavetableBank holds several single-cycle waveforms ("frames"), each
+ * stored at one mip level per octave with only the harmonics that stay
+ * below Nyquist for that octave. Tables are generated once at startup into
+ * SDRAM. A WavetableOsc reads one bank with a single phase accumulator and
+ * morphs continuously between adjacent frames, so one oscillator replaces
+ * a pair of crossfaded oscillators and the two waveforms can never drift
+ * out of phase.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum WavetableFrame {
+  WT_SINE = 0,
+  WT_TRIANGLE = 1,
+  WT_SAW = 2,
+  WT_SQUARE = 3
+};
+
+const int WT_NUM_FRAMES = 4;
+const int WT_TABLE_BITS = 11;
+const int WT_TABLE_SIZE = 1 << WT_TABLE_BITS;   // Samples per cycle
+const int WT_MAX_HARMONICS = WT_TABLE_SIZE / 4;  // Harmonics in the lowest mip level
+const int WT_NUM_LEVELS = 10;                    // One mip level per octave (512 -> 1 harmonics)
+
+class WavetableBank {
+public:
+  /**
+   * Fill every frame and mip level (additive synthesis, RMS-normalized)
+   * Runs once in setup(); takes a few tens of milliseconds on the Daisy
+   */
+  void Generate();
+
+  /**
+   * Table for a frame at a mip level (WT_TABLE_SIZE + 1 samples, last = first)
+   */
+  const float *Table(int frame, int level) const;
+};
+
+class WavetableOsc {
+public:
+  void Init(const WavetableBank *bank, float sampleRate);
+
+  /**
+   * Set frequency in Hz immediately; also selects the alias-free mip level
+   */
+  void SetFreq(float freq);
+
+  /**
+   * Reach freq (Hz) at the end of the next block: the phase increment is
+   * ramped per sample across the block, so gliding pitch never steps.
+   * The mip level covers the higher of the two frequencies.
+   */
+  void SetFreqTarget(float freq);
+
+  /**
+   * Set morph position immediately (0.0 = WT_SINE ... WT_NUM_FRAMES - 1 =
+   * WT_SQUARE)
+   */
+  void SetMorph(float morph);
+
+  /**
+   * Reach morph at the end of the next block, ramped linearly per sample
+   * across it (the engine spreads control-rate changes over blocks)
+   */
+  void SetMorphTarget(float morph);
+
+  /**
+   * Restart the cycle at phase (0.0 to 1.0)
+   */
+  void Reset(float phase = 0.0f);
+
+  void ProcessBlock(float *out, size_t n);
+
+private:
+  const WavetableBank *bank = nullptr;
+  float sampleRate = 48000.0f;
+  uint32_t phase = 0;       // 32-bit fixed-point phase (one cycle = 2^32)
+  uint32_t phaseInc = 0;
+  uint32_t phaseIncTarget = 0;
+  int level = 0;            // Mip level for the current frequency
+  float morph = 0.0f;       // Morph position at the start of the next block
+  float morphTarget = 0.0f;
+};
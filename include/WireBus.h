@@ -0,0 +1,35 @@
+/**
+ * WireBus - interrupt-driven I2cBus backend on the Wire peripheral
+ *
+ * Transfers run on the STM32 HAL handle behind Wire (STM32duino's
+ * TwoWire::getHandle()): Start() queues a register read (HAL_I2C_Mem_Read_IT)
+ * or a write (HAL_I2C_Master_Transmit_IT) and returns at once, the core's
+ * I2C event/error interrupts move the bytes, and Poll() reports I2C_BUSY
+ * until the HAL's interrupt handler has finished the transfer. The HAL puts
+ * the handle back to READY just before it calls its completion callback,
+ * so Poll() reads that state rather than defining the callbacks, which
+ * the core's twi.c already owns.
+ *
+ * Wire's own blocking calls share the peripheral: use them only while
+ * the scheduler is idle (at boot, before the sensor pipeline starts).
+ */
+
+#pragma once
+
+#include <Wire.h>
+
+#include "I2cScheduler.h"
+
+const uint32_t I2C_TRANSFER_TIMEOUT_US = 5000;  // A transfer this late is aborted (stuck bus, lost interrupt)
+
+class WireBus : public I2cBus {
+public:
+  explicit WireBus(TwoWire &wire) : wire(wire) {}
+
+  bool Start(I2cTransaction &t) override;
+  I2cStatus Poll(I2cTransaction &t) override;
+
+private:
+  TwoWire &wire;
+  uint32_t startMicros = 0;
+};
@@ -0,0 +1,131 @@
+#include "AccelEstimator.h"
+
+#include <math.h>
+
+const float GRAVITY = 9.80665f;
+
+// Kalman tuning: about 15 ms to settle at a 4 ms step
+const float TILT_PROCESS_NOISE = 0.8f;       // (m/s^2)^2 per second of random walk
+const float TILT_MEASUREMENT_NOISE = 0.04f;  // (m/s^2)^2 when |a| = 1 g
+const float JOLT_TOLERANCE = 0.5f;           // |a| deviation (m/s^2) that doubles the noise
+const uint32_t MAX_CATCHUP_STEPS = 8;        // Longer gaps do not extrapolate further
+
+// Bias tracking: follow slow drift near level while not navigating
+const float BIAS_TIME_CONSTANT = 2.0f;       // Seconds
+const float BIAS_WINDOW = 0.8f;              // Only track within this tilt (m/s^2)
+
+// Navigation
+const float NAV_DEAD_ZONE = 0.4f;            // Tilt ignored within this (m/s^2, about 2.3 degrees)
+const float NAV_HYSTERESIS = 0.2f;           // Past a semitone boundary before the window moves
+
+void AccelEstimator::Init(uint32_t step, int limit) {
+  stepMicros = step > 0 ? step : 1;
+  stepSeconds = stepMicros / 1000000.0f;
+  maxOffset = limit;
+  seeded = false;
+  position = 0.0f;
+  offset = 0;
+}
+
+void AccelEstimator::Reset(float x, float y, float z) {
+  float magnitude = sqrtf(x * x + y * y + z * z);
+  float norm = magnitude > 0.0f ? GRAVITY / magnitude : 1.0f;
+  stateX = x * norm;
+  stateY = y * norm;
+  varianceX = TILT_MEASUREMENT_NOISE;
+  varianceY = TILT_MEASUREMENT_NOISE;
+  centerX = stateX;
+  centerY = stateY;
+  position = 0.0f;
+  offset = 0;
+  seeded = true;
+  lastMicros = 0;
+}
+
+void AccelEstimator::Recenter() {
+  centerX = stateX;
+  centerY = stateY;
+  position = 0.0f;
+  offset = 0;
+}
+
+void AccelEstimator::SetCenter(float x, float y) {
+  centerX = x;
+  centerY = y;
+}
+
+void AccelEstimator::SetWindowOffset(int windowOffset) {
+  offset = windowOffset < -maxOffset ? -maxOffset : (windowOffset > maxOffset ? maxOffset : windowOffset);
+  position = (float)offset;
+}
+
+/**
+ * Predict over steps, then correct with one measurement
+ */
+void AccelEstimator::filterAxis(float &state, float &variance, float measurement, float noise, uint32_t steps) {
+  variance += TILT_PROCESS_NOISE * stepSeconds * (float)steps;
+  float gain = variance / (variance + noise);
+  state += gain * (measurement - state);
+  variance *= 1.0f - gain;
+}
+
+void AccelEstimator::Update(const float accel[3], uint32_t timestampMicros, float sensitivity) {
+  if (!seeded) {
+    Reset(accel[0], accel[1], accel[2]);
+  }
+
+  // Whole fixed steps since the previous sample (at least one)
+  uint32_t steps = 1;
+  if (lastMicros != 0) {
+    steps = (timestampMicros - lastMicros + stepMicros / 2) / stepMicros;
+    if (steps < 1) {
+      steps = 1;
+    } else if (steps > MAX_CATCHUP_STEPS) {
+      steps = MAX_CATCHUP_STEPS;
+    }
+  }
+  lastMicros = timestampMicros;
+  float dt = stepSeconds * (float)steps;
+
+  // Normalize to 1 g and trust the reading less the further |a| is from it
+  float magnitude = sqrtf(accel[0] * accel[0] + accel[1] * accel[1] + accel[2] * accel[2]);
+  if (magnitude <= 0.0f) {
+    return;
+  }
+  float jolt = (magnitude - GRAVITY) / JOLT_TOLERANCE;
+  float noise = TILT_MEASUREMENT_NOISE * (1.0f + jolt * jolt);
+  float norm = GRAVITY / magnitude;
+  filterAxis(stateX, varianceX, accel[0] * norm, noise, steps);
+  filterAxis(stateY, varianceY, accel[1] * norm, noise, steps);
+
+  if (sensitivity <= 0.0f) {
+    // Not navigating: let the center follow slow drift near level
+    if (fabsf(TiltX()) < BIAS_WINDOW && fabsf(TiltY()) < BIAS_WINDOW) {
+      float rate = dt / BIAS_TIME_CONSTANT;
+      centerX += (stateX - centerX) * rate;
+      centerY += (stateY - centerY) * rate;
+    }
+    return;
+  }
+
+  // Tilt beyond the dead zone sets the rate of travel
+  float tilt = TiltX();
+  float excess = fabsf(tilt) - NAV_DEAD_ZONE;
+  if (excess > 0.0f) {
+    position += (tilt > 0.0f ? excess : -excess) * sensitivity * dt;
+    float limit = (float)maxOffset + 0.5f;
+    if (position > limit) {
+      position = limit;
+    } else if (position < -limit) {
+      position = -limit;
+    }
+  }
+
+  // Move a semitone only once the boundary is passed by the hysteresis margin
+  while (offset < maxOffset && position > (float)offset + 0.5f + NAV_HYSTERESIS) {
+    offset++;
+  }
+  while (offset > -maxOffset && position < (float)offset - 0.5f - NAV_HYSTERESIS) {
+    offset--;
+  }
+}
@@ -0,0 +1,61 @@
+#include "AnalogInputs.h"
+
+#include <math.h>
+
+float analogDbTaper(float position, float rangeDb, float offBelow) {
+  if (position < offBelow) {
+    return 0.0f;
+  }
+  float db = -rangeDb * (1.0f - (position > 1.0f ? 1.0f : position));
+  return powf(10.0f, db / 20.0f);
+}
+
+bool AnalogInputs::Init(const AnalogInputConfig *configs, int count, float updateHz) {
+  numInputs = count < ANALOG_MAX_INPUTS ? count : ANALOG_MAX_INPUTS;
+  primed = false;
+  daisy::AdcChannelConfig channels[ANALOG_MAX_INPUTS];
+  for (int i = 0; i < numInputs; i++) {
+    channels[i].InitSingle(configs[i].pin);
+    // One-pole coefficient for the cutoff at the update rate
+    coefficient[i] = 1.0f - expf(-2.0f * (float)M_PI * configs[i].cutoffHz / updateHz);
+    deadBand[i] = configs[i].deadBand;
+    filtered[i] = 0.0f;
+    level[i] = 0;
+  }
+  if (numInputs == 0) {
+    return false;
+  }
+  adc.Init(channels, (size_t)numInputs, daisy::AdcHandle::OVS_32);
+  adc.Start();
+  return true;
+}
+
+void AnalogInputs::Read(uint16_t *raw) const {
+  for (int i = 0; i < numInputs; i++) {
+    raw[i] = adc.Get((uint8_t)i);
+  }
+}
+
+bool AnalogInputs::Filter(const uint16_t *raw) {
+  bool any = false;
+  for (int i = 0; i < numInputs; i++) {
+    float reading = (float)raw[i] / ANALOG_FULL_SCALE;
+    filtered[i] = primed ? filtered[i] + (reading - filtered[i]) * coefficient[i] : reading;
+    // Within the band of either end of travel counts as the end, so a knob
+    // turned all the way reaches 0 or 1 exactly
+    float target = filtered[i];
+    if (target <= deadBand[i]) {
+      target = 0.0f;
+    } else if (target >= 1.0f - deadBand[i]) {
+      target = 1.0f;
+    }
+    float current = Value(i);
+    bool atEnd = target == 0.0f || target == 1.0f;
+    if (!primed || fabsf(target - current) > deadBand[i] || (atEnd && target != current)) {
+      level[i] = (uint16_t)(target * ANALOG_FULL_SCALE + 0.5f);
+      any = true;
+    }
+  }
+  primed = true;
+  return any;
+}
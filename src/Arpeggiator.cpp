@@ -0,0 +1,375 @@
+#include "Arpeggiator.h"
+
+#include "MemoryPlacement.h"
+
+const int32_t ARP_FOREVER = 0x7FFFFFFF;
+
+void Arpeggiator::Init(float sr) {
+  sampleRate = sr;
+  pattern = ARP_OFF;
+  poolCount = 0;
+  pendingCount = 0;
+  sounding = 0;
+  restartPending = false;
+  running = false;
+  gateCountdown = -1;
+  current = -1;
+  position = -1;
+  direction = 1;
+  randomState = 1;  // Fixed seed: replays render the same notes
+  strumCount = 0;
+  strumCountdown = 0;
+  sinceStrum = ARP_FOREVER;
+  dropped = 0;
+  SetRate(4.0f);
+}
+
+void Arpeggiator::SetPattern(ArpPattern p) {
+  if (p == pattern || p >= NUM_ARP_PATTERNS) {
+    return;
+  }
+  pattern = p;
+  restartPending = true;  // Applied at the start of the next Process()
+}
+
+void Arpeggiator::SetRate(float stepsPerSecond) {
+  float rate = stepsPerSecond < ARP_RATE_MIN ? ARP_RATE_MIN
+             : (stepsPerSecond > ARP_RATE_MAX ? ARP_RATE_MAX : stepsPerSecond);
+  stepSamples = (int32_t)(sampleRate / rate);
+  gateSamples = (int32_t)((float)stepSamples * ARP_GATE);
+  strumSamples = (int32_t)((float)stepSamples * ARP_STRUM_SPREAD);
+  if (gateSamples < 1) {
+    gateSamples = 1;
+  }
+}
+
+void Arpeggiator::Hold(int note, float pitch, int32_t offset) {
+  if (note < 0 || note >= ARP_MAX_NOTES || pendingCount >= ARP_MAX_PENDING) {
+    return;
+  }
+  PoolChange &change = pending[pendingCount++];
+  change.offset = offset;
+  change.note = (uint8_t)note;
+  change.hold = true;
+  change.pitch = pitch;
+}
+
+void Arpeggiator::Release(int note, int32_t offset) {
+  if (note < 0 || note >= ARP_MAX_NOTES || pendingCount >= ARP_MAX_PENDING) {
+    return;
+  }
+  PoolChange &change = pending[pendingCount++];
+  change.offset = offset;
+  change.note = (uint8_t)note;
+  change.hold = false;
+  change.pitch = 0.0f;
+}
+
+void Arpeggiator::SetPitch(int note, float pitch) {
+  if (poolIndex(note) < 0) {
+    return;
+  }
+  // Re-sorting can move the entry the last step played (or this one is
+  // it): keep stepping from that entry
+  int last = position >= 0 && position < poolCount ? pool[position].note : -1;
+  insertPool(note, pitch);
+  if (last >= 0) {
+    position = poolIndex(last);
+  }
+}
+
+/////////////////////
+// Pool
+/////////////////////
+
+int Arpeggiator::poolIndex(int note) const {
+  for (int i = 0; i < poolCount; i++) {
+    if (pool[i].note == note) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Insert keeping ascending pitch (ties by note id); a pooled id moves
+ */
+void Arpeggiator::insertPool(int note, float pitch) {
+  removePool(note);
+  int i = poolCount;
+  while (i > 0 && (pool[i - 1].pitch > pitch || (pool[i - 1].pitch == pitch && pool[i - 1].note > note))) {
+    pool[i] = pool[i - 1];
+    i--;
+  }
+  pool[i].note = (uint8_t)note;
+  pool[i].pitch = pitch;
+  poolCount++;
+  if (position >= i) {
+    position++;  // Keep stepping from the same place
+  }
+}
+
+void Arpeggiator::removePool(int note) {
+  for (int i = 0; i < poolCount; i++) {
+    if (pool[i].note == note) {
+      for (int j = i + 1; j < poolCount; j++) {
+        pool[j - 1] = pool[j];
+      }
+      poolCount--;
+      // Keep stepping from the same place; without the entry itself, that
+      // is just before its gap going up and at the gap going down
+      bool down = pattern == ARP_DOWN || (pattern == ARP_UP_DOWN && direction < 0);
+      if (position > i || (position == i && !down)) {
+        position--;
+      }
+      return;
+    }
+  }
+}
+
+/**
+ * Pool index of the next step for the rate patterns
+ */
+int Arpeggiator::nextPosition() {
+  int count = poolCount;
+  if (count == 1) {
+    return 0;
+  }
+  switch (pattern) {
+    case ARP_DOWN:
+      return position <= 0 || position > count ? count - 1 : position - 1;
+    case ARP_UP_DOWN: {
+      int next = position + direction;
+      if (next >= count) {
+        direction = -1;
+        next = count - 2;
+      } else if (next < 0) {
+        direction = 1;
+        next = position < 0 ? 0 : 1;
+      }
+      return next;
+    }
+    case ARP_RANDOM: {
+      randomState = randomState * 1664525u + 1013904223u;  // Numerical Recipes LCG
+      int next = (int)((randomState >> 16) % (uint32_t)count);
+      return next == position ? (next + 1) % count : next;
+    }
+    default:
+      return position + 1 >= count ? 0 : position + 1;
+  }
+}
+
+/////////////////////
+// Scheduling
+/////////////////////
+
+void Arpeggiator::emit(int32_t offset, int note, bool on, float pitch) {
+  if (on) {
+    sounding |= 1ull << note;
+  } else {
+    sounding &= ~(1ull << note);
+  }
+  if (outCount >= outMax) {
+    dropped++;
+    return;
+  }
+  ArpEvent &evt = out[outCount++];
+  evt.offset = offset;
+  evt.note = (uint8_t)note;
+  evt.on = on;
+  evt.pitch = pitch;
+}
+
+ITCM_CODE void Arpeggiator::advance(int32_t samples) {
+  if (gateCountdown >= 0) {
+    gateCountdown -= samples;
+  }
+  if (running) {
+    stepCountdown -= samples;
+  }
+  if (strumCount > 0) {
+    strumCountdown -= samples;
+  }
+  sinceStrum = sinceStrum > ARP_FOREVER - samples ? ARP_FOREVER : sinceStrum + samples;
+}
+
+void Arpeggiator::stopAll(int32_t offset) {
+  for (int note = 0; note < ARP_MAX_NOTES; note++) {
+    if (sounding & (1ull << note)) {
+      emit(offset, note, false, 0.0f);
+    }
+  }
+  running = false;
+  gateCountdown = -1;
+  current = -1;
+  strumCount = 0;
+}
+
+/**
+ * Start the held pool over in the current pattern
+ */
+void Arpeggiator::restart() {
+  stopAll(0);
+  position = -1;
+  direction = 1;
+  sinceStrum = ARP_FOREVER;
+  if (pattern == ARP_STRUM) {
+    for (int i = 0; i < poolCount; i++) {
+      strum(pool[i].note, pool[i].pitch, 0);
+    }
+  } else if (pattern != ARP_OFF && poolCount > 0) {
+    running = true;
+    stepCountdown = 0;
+  }
+}
+
+/**
+ * Start a strummed note now if the last one started a spacing ago, else
+ * queue it behind the others
+ */
+void Arpeggiator::strum(int note, float pitch, int32_t offset) {
+  if (strumCount == 0 && sinceStrum >= strumSamples) {
+    emit(offset, note, true, pitch);
+    sinceStrum = 0;
+    return;
+  }
+  if (strumCount == 0) {
+    strumCountdown = strumSamples - sinceStrum;
+  }
+  strumQueue[strumCount].note = (uint8_t)note;
+  strumQueue[strumCount].pitch = pitch;
+  strumCount++;
+}
+
+void Arpeggiator::applyChange(const PoolChange &change, int32_t offset) {
+  if (change.hold) {
+    insertPool(change.note, change.pitch);
+    if (pattern == ARP_STRUM) {
+      strum(change.note, change.pitch, offset);
+    } else if (pattern != ARP_OFF && !running) {
+      // First note of an arpeggio: step now, count from here
+      running = true;
+      stepCountdown = 0;
+      position = -1;
+      direction = 1;
+    }
+    return;
+  }
+
+  removePool(change.note);
+  for (int i = 0; i < strumCount; i++) {
+    if (strumQueue[i].note == change.note) {
+      for (int j = i + 1; j < strumCount; j++) {
+        strumQueue[j - 1] = strumQueue[j];
+      }
+      strumCount--;
+      break;
+    }
+  }
+  if (sounding & (1ull << change.note)) {
+    emit(offset, change.note, false, 0.0f);
+  }
+  if (change.note == current) {
+    current = -1;
+    gateCountdown = -1;
+  }
+  if (poolCount == 0) {
+    running = false;  // The next hold starts a fresh arpeggio
+  }
+}
+
+void Arpeggiator::step(int32_t offset) {
+  if (poolCount == 0) {
+    running = false;
+    return;
+  }
+  if (current >= 0) {
+    emit(offset, current, false, 0.0f);  // Gate longer than a step
+  }
+  position = nextPosition();
+  const PoolEntry &entry = pool[position];
+  emit(offset, entry.note, true, entry.pitch);
+  current = entry.note;
+  gateCountdown = gateSamples;
+  stepCountdown = stepSamples;
+}
+
+ITCM_CODE size_t Arpeggiator::Process(size_t n, ArpEvent *events, size_t max) {
+  out = events;
+  outCount = 0;
+  outMax = max;
+  if (restartPending) {
+    restartPending = false;
+    restart();
+  }
+
+  // Walk the callback from event to event: pool changes first on a tie,
+  // then a gate ending, a step, a strummed start
+  enum Due { DUE_NONE, DUE_CHANGE, DUE_GATE, DUE_STEP, DUE_STRUM };
+  int32_t length = (int32_t)n;
+  int32_t t = 0;
+  int next = 0;
+  for (;;) {
+    int32_t at = ARP_FOREVER;
+    Due due = DUE_NONE;
+    if (next < pendingCount) {
+      at = pending[next].offset > t ? pending[next].offset : t;
+      due = DUE_CHANGE;
+    }
+    if (gateCountdown >= 0 && t + gateCountdown < at) {
+      at = t + gateCountdown;
+      due = DUE_GATE;
+    }
+    if (running && t + stepCountdown < at) {
+      at = t + (stepCountdown > 0 ? stepCountdown : 0);
+      due = DUE_STEP;
+    }
+    if (strumCount > 0 && t + strumCountdown < at) {
+      at = t + (strumCountdown > 0 ? strumCountdown : 0);
+      due = DUE_STRUM;
+    }
+    if (due == DUE_NONE || at >= length) {
+      break;
+    }
+    advance(at - t);
+    t = at;
+
+    switch (due) {
+      case DUE_CHANGE:
+        applyChange(pending[next++], t);
+        break;
+      case DUE_GATE:
+        emit(t, current, false, 0.0f);
+        current = -1;
+        gateCountdown = -1;
+        break;
+      case DUE_STEP:
+        step(t);
+        break;
+      case DUE_STRUM: {
+        PoolEntry entry = strumQueue[0];
+        for (int j = 1; j < strumCount; j++) {
+          strumQueue[j - 1] = strumQueue[j];
+        }
+        strumCount--;
+        emit(t, entry.note, true, entry.pitch);
+        sinceStrum = 0;
+        strumCountdown = strumSamples;
+        break;
+      }
+      case DUE_NONE:
+        break;
+    }
+  }
+  advance(length - t);
+
+  // Changes due after this callback wait for the next one
+  int kept = 0;
+  for (int i = next; i < pendingCount; i++) {
+    pending[kept] = pending[i];
+    pending[kept].offset -= length;
+    kept++;
+  }
+  pendingCount = kept;
+  return outCount;
+}
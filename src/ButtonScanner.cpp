@@ -0,0 +1,47 @@
+#include "ButtonScanner.h"
+
+#include <Arduino.h>
+
+void ButtonScanner::Init(const int *pins, int bits) {
+  numBits = bits < BUTTON_SCAN_BITS ? bits : BUTTON_SCAN_BITS;
+  for (int bit = 0; bit < BUTTON_SCAN_BITS; bit++) {
+    pinForBit[bit] = bit < numBits ? pins[bit] : -1;
+  }
+  count0 = 0xFFFF;
+  count1 = 0xFFFF;
+  count2 = 0xFFFF;
+  state.store(readPins(), std::memory_order_relaxed);  // Buttons held at boot count as held
+}
+
+uint16_t ButtonScanner::readPins() const {
+  uint16_t mask = 0;
+  for (int bit = 0; bit < numBits; bit++) {
+    if (pinForBit[bit] >= 0 && digitalRead(pinForBit[bit]) == LOW) {
+      mask |= (uint16_t)(1u << bit);
+    }
+  }
+  return mask;
+}
+
+void ButtonScanner::Scan(uint32_t nowMicros) {
+  uint16_t debounced = state.load(std::memory_order_relaxed);
+  uint16_t differ = readPins() ^ debounced;
+
+  // Count down from 7 while a bit differs, back to 7 when it agrees; the
+  // borrow out of 0 (eight differing samples in a row) flips the state
+  uint16_t borrow2 = (uint16_t)~(differ & (count0 | count1));
+  count2 = (uint16_t)((count2 & differ) ^ borrow2);
+  count0 = (uint16_t)~(count0 & differ);
+  count1 = (uint16_t)(count0 ^ (count1 & differ));
+  uint16_t flip = (uint16_t)(differ & count0 & count1 & count2);
+
+  scans.store(scans.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (flip) {
+    debounced ^= flip;
+    state.store(debounced, std::memory_order_relaxed);
+    ButtonEdge edge;
+    edge.timeMicros = nowMicros;
+    edge.buttons = debounced;
+    edges.Push(edge);
+  }
+}
@@ -0,0 +1,95 @@
+#include "CpuMeter.h"
+
+#include <string.h>
+
+#include "MemoryPlacement.h"
+
+#if defined(__ARM_ARCH_7EM__)
+// Cortex-M7 debug registers (CMSIS names in comments)
+#define CPU_DEMCR (*(volatile uint32_t *)0xE000EDFC)     // CoreDebug->DEMCR
+#define CPU_DWT_CTRL (*(volatile uint32_t *)0xE0001000)  // DWT->CTRL
+#define CPU_DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)  // DWT->CYCCNT
+#define CPU_DWT_LAR (*(volatile uint32_t *)0xE0001FB0)   // DWT->LAR
+extern "C" uint32_t SystemCoreClock;
+#else
+#include <chrono>
+#endif
+
+CpuMeter cpuMeter;
+
+ITCM_CODE uint32_t cpuMeterNow() {
+#if defined(__ARM_ARCH_7EM__)
+  return CPU_DWT_CYCCNT;
+#else
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void CpuMeter::Init(float sampleRate) {
+#if defined(__ARM_ARCH_7EM__)
+  CPU_DEMCR |= (1u << 24);       // TRCENA: enable DWT
+  CPU_DWT_LAR = 0xC5ACCE55;      // Unlock DWT on the M7
+  CPU_DWT_CYCCNT = 0;
+  CPU_DWT_CTRL |= 1u;            // CYCCNTENA
+  float ticksPerSecond = (float)SystemCoreClock;
+#else
+  float ticksPerSecond = 1.0e9f;
+#endif
+  ticksPerSample = ticksPerSecond / sampleRate;
+  ticksPerMicro = ticksPerSecond / 1.0e6f;
+  RequestReset();
+}
+
+ITCM_CODE void CpuMeter::Record(uint32_t ticks, size_t samples) {
+  uint32_t budget = (uint32_t)(ticksPerSample * (float)samples);
+  if (budget == 0) {
+    return;
+  }
+
+  sequence.fetch_add(1, std::memory_order_acq_rel);  // Odd: update in progress
+
+  if (resetRequested.load(std::memory_order_relaxed)) {
+    memset(&stats, 0, sizeof(stats));
+    resetRequested.store(false, std::memory_order_relaxed);
+  }
+
+  stats.blocks++;
+  stats.totalTicks += ticks;
+  stats.totalBudget += budget;
+  // Compare loads, not ticks, so blocks of different sizes rank fairly
+  if (stats.peakBudget == 0 || (uint64_t)ticks * stats.peakBudget > (uint64_t)stats.peakTicks * budget) {
+    stats.peakTicks = ticks;
+    stats.peakBudget = budget;
+  }
+  int bucket;
+  if (ticks > budget) {
+    stats.overruns++;
+    bucket = CPU_HIST_BUCKETS - 1;
+  } else {
+    bucket = (int)(((uint64_t)ticks * (CPU_HIST_BUCKETS - 1)) / budget);
+    if (bucket > CPU_HIST_BUCKETS - 2) bucket = CPU_HIST_BUCKETS - 2;
+  }
+  stats.histogram[bucket]++;
+
+  sequence.fetch_add(1, std::memory_order_acq_rel);  // Even: stats consistent
+}
+
+void CpuMeter::Snapshot(CpuStats &out) const {
+  uint32_t before;
+  uint32_t after;
+  do {
+    before = sequence.load(std::memory_order_acquire);
+    memcpy(&out, &stats, sizeof(out));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = sequence.load(std::memory_order_relaxed);
+  } while ((before & 1) || before != after);
+}
+
+float CpuMeter::AverageLoad(const CpuStats &s) {
+  return s.totalBudget ? (float)((double)s.totalTicks / (double)s.totalBudget) : 0.0f;
+}
+
+float CpuMeter::PeakLoad(const CpuStats &s) {
+  return s.peakBudget ? (float)s.peakTicks / (float)s.peakBudget : 0.0f;
+}
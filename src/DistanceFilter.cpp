@@ -0,0 +1,79 @@
+#include "DistanceFilter.h"
+
+#include <math.h>
+
+const float TOF_MAX_VALID = 1200.0f;   // Reach of the high-speed profile (mm); beyond is no target
+const int ABSENT_RANGES = 3;           // Rejected ranges in a row before the hand counts as gone
+const float SPIKE_JUMP = 120.0f;       // A jump this far (mm) needs a second range to confirm it
+const float MIN_STEP = 0.001f;         // Filter step limits (s): duplicate or long-delayed ranges
+const float MAX_STEP = 0.2f;
+
+/**
+ * One-pole smoothing factor for a cutoff at a step
+ */
+static float smoothing(float cutoffHz, float step) {
+  float tau = 1.0f / (2.0f * (float)M_PI * cutoffHz);
+  return 1.0f / (1.0f + tau / step);
+}
+
+void DistanceFilter::Init(float minCutoffHz, float speedBeta, float derivativeCutoffHz) {
+  minCutoff = minCutoffHz;
+  beta = speedBeta;
+  derivativeCutoff = derivativeCutoffHz;
+  present = false;
+  invalidRun = 0;
+  spikePending = false;
+  value = 0.0f;
+  speed = 0.0f;
+  rejected = 0;
+}
+
+void DistanceFilter::reset(float mm, uint32_t timestampMicros) {
+  value = mm;
+  speed = 0.0f;
+  lastMicros = timestampMicros;
+  spikePending = false;
+}
+
+bool DistanceFilter::Update(float mm, bool valid, uint32_t timestampMicros) {
+  if (!valid || mm <= 0.0f || mm > TOF_MAX_VALID) {
+    rejected++;
+    spikePending = false;
+    if (present && ++invalidRun >= ABSENT_RANGES) {
+      present = false;
+      return true;
+    }
+    return false;
+  }
+  invalidRun = 0;
+
+  if (!present) {
+    // Hand arriving: start from where it is, not from where it left
+    reset(mm, timestampMicros);
+    present = true;
+    return true;
+  }
+
+  if (fabsf(mm - value) > SPIKE_JUMP) {
+    if (!spikePending || fabsf(mm - spike) > SPIKE_JUMP) {
+      spikePending = true;  // Held until the next range
+      spike = mm;
+      rejected++;
+      return false;
+    }
+    // Confirmed: a real jump, taken at once
+    reset(mm, timestampMicros);
+    return true;
+  }
+  spikePending = false;
+
+  float step = (float)(uint32_t)(timestampMicros - lastMicros) * 1.0e-6f;
+  step = step < MIN_STEP ? MIN_STEP : (step > MAX_STEP ? MAX_STEP : step);
+  lastMicros = timestampMicros;
+
+  float rawSpeed = (mm - value) / step;
+  speed += (rawSpeed - speed) * smoothing(derivativeCutoff, step);
+  float cutoff = minCutoff + beta * fabsf(speed);
+  value += (mm - value) * smoothing(cutoff, step);
+  return true;
+}
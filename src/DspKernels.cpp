@@ -0,0 +1,134 @@
+#include "DspKernels.h"
+
+#include "MemoryPlacement.h"
+
+void dspClearScalar(float *dst, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    dst[i] = 0.0f;
+  }
+}
+
+ITCM_CODE void dspClearUnrolled(float *dst, size_t n) {
+  size_t blocks = n >> 2;
+  while (blocks--) {
+    dst[0] = 0.0f;
+    dst[1] = 0.0f;
+    dst[2] = 0.0f;
+    dst[3] = 0.0f;
+    dst += 4;
+  }
+  for (size_t i = 0; i < (n & 3); i++) {
+    dst[i] = 0.0f;
+  }
+}
+
+void dspScaleRampScalar(float *dst, float start, float end, size_t n) {
+  float step = (end - start) / (float)n;
+  for (size_t i = 0; i < n; i++) {
+    dst[i] *= start + step * (float)i;
+  }
+}
+
+ITCM_CODE void dspScaleRampUnrolled(float *dst, float start, float end, size_t n) {
+  float step = (end - start) / (float)n;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float g0 = start + step * (float)i;
+    float g1 = start + step * (float)(i + 1);
+    float g2 = start + step * (float)(i + 2);
+    float g3 = start + step * (float)(i + 3);
+    dst[i] *= g0;
+    dst[i + 1] *= g1;
+    dst[i + 2] *= g2;
+    dst[i + 3] *= g3;
+  }
+  for (; i < n; i++) {
+    dst[i] *= start + step * (float)i;
+  }
+}
+
+void dspScaleAccumulateScalar(float *acc, const float *src, float gain, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    acc[i] += src[i] * gain;
+  }
+}
+
+ITCM_CODE void dspScaleAccumulateUnrolled(float *acc, const float *src, float gain, size_t n) {
+  size_t blocks = n >> 2;
+  while (blocks--) {
+    float s0 = src[0];
+    float s1 = src[1];
+    float s2 = src[2];
+    float s3 = src[3];
+    acc[0] += s0 * gain;
+    acc[1] += s1 * gain;
+    acc[2] += s2 * gain;
+    acc[3] += s3 * gain;
+    acc += 4;
+    src += 4;
+  }
+  for (size_t i = 0; i < (n & 3); i++) {
+    acc[i] += src[i] * gain;
+  }
+}
+
+void dspMultiplyPanAccumulateScalar(float *left, float *right, const float *a, const float *b,
+                                    float leftStart, float leftEnd, float rightStart, float rightEnd, size_t n) {
+  float leftStep = (leftEnd - leftStart) / (float)n;
+  float rightStep = (rightEnd - rightStart) / (float)n;
+  for (size_t i = 0; i < n; i++) {
+    float s = a[i] * b[i];
+    left[i] += s * (leftStart + leftStep * (float)i);
+    right[i] += s * (rightStart + rightStep * (float)i);
+  }
+}
+
+ITCM_CODE void dspMultiplyPanAccumulateUnrolled(float *left, float *right, const float *a, const float *b,
+                                      float leftStart, float leftEnd, float rightStart, float rightEnd, size_t n) {
+  float leftStep = (leftEnd - leftStart) / (float)n;
+  float rightStep = (rightEnd - rightStart) / (float)n;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float s0 = a[i] * b[i];
+    float s1 = a[i + 1] * b[i + 1];
+    float s2 = a[i + 2] * b[i + 2];
+    float s3 = a[i + 3] * b[i + 3];
+    left[i] += s0 * (leftStart + leftStep * (float)i);
+    left[i + 1] += s1 * (leftStart + leftStep * (float)(i + 1));
+    left[i + 2] += s2 * (leftStart + leftStep * (float)(i + 2));
+    left[i + 3] += s3 * (leftStart + leftStep * (float)(i + 3));
+    right[i] += s0 * (rightStart + rightStep * (float)i);
+    right[i + 1] += s1 * (rightStart + rightStep * (float)(i + 1));
+    right[i + 2] += s2 * (rightStart + rightStep * (float)(i + 2));
+    right[i + 3] += s3 * (rightStart + rightStep * (float)(i + 3));
+  }
+  for (; i < n; i++) {
+    float s = a[i] * b[i];
+    left[i] += s * (leftStart + leftStep * (float)i);
+    right[i] += s * (rightStart + rightStep * (float)i);
+  }
+}
+
+void dspSoftClipScalar(float *dst, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    dst[i] = softClip(dst[i]);
+  }
+}
+
+ITCM_CODE void dspSoftClipUnrolled(float *dst, size_t n) {
+  size_t blocks = n >> 2;
+  while (blocks--) {
+    float d0 = dst[0];
+    float d1 = dst[1];
+    float d2 = dst[2];
+    float d3 = dst[3];
+    dst[0] = softClip(d0);
+    dst[1] = softClip(d1);
+    dst[2] = softClip(d2);
+    dst[3] = softClip(d3);
+    dst += 4;
+  }
+  for (size_t i = 0; i < (n & 3); i++) {
+    dst[i] = softClip(dst[i]);
+  }
+}
@@ -0,0 +1,323 @@
+#include "EffectsBus.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "CpuMeter.h"
+#include "MemoryPlacement.h"
+
+// Delay lines live in external SDRAM next to the wavetables; host builds
+// use ordinary memory. The storage is static, so a program has one bus.
+
+const float DELAY_TIME = 0.3f;               // Seconds per side of the ping-pong
+const float DELAY_FEEDBACK = 0.45f;          // Gain per repeat
+const float DELAY_DAMPING = 0.4f;            // Feedback low-pass coefficient (1 = no damping)
+const float REVERB_DAMPING = 0.6f;           // Per-line low-pass coefficient
+const float REVERB_OUTPUT_GAIN = 0.3f;       // Network output into each side
+const float REVERB_DECAY_MIN = 0.2f;         // RT60 range, seconds
+const float REVERB_DECAY_MAX = 10.0f;
+const float EFFECTS_SMOOTHING = 0.2f;        // One-pole coefficient per block
+const float EFFECTS_EPSILON = 0.0005f;       // Parameters snap to target within this
+const float EFFECTS_SILENCE = 3.0e-5f;       // Tail level treated as gone (-90 dB)
+const float REVERB_TAIL_RT60S = 1.5f;        // Tail length in RT60s (-90 dB)
+
+// Mutually prime line lengths at 48 kHz (30 to 43 ms)
+const size_t REVERB_LINE_LENGTHS[REVERB_LINES] = {1433, 1601, 1867, 2053};
+
+static float SDRAM_DATA delayStorage[2][DELAY_LINE_SAMPLES];
+static float SDRAM_DATA reverbStorage[REVERB_LINES][REVERB_LINE_SAMPLES];
+
+/////////////////////
+// Delay Line
+/////////////////////
+
+void DelayLine::Init(float *storage, size_t lineSize) {
+  buffer = storage;
+  size = lineSize;
+  writePos = 0;
+  SetDelay(delay);
+  Clear();
+}
+
+void DelayLine::SetDelay(size_t samples) {
+  delay = samples < MAX_BLOCK_SIZE ? MAX_BLOCK_SIZE : (samples > size ? size : samples);
+}
+
+void DelayLine::Clear() {
+  memset(buffer, 0, size * sizeof(float));
+}
+
+ITCM_CODE void DelayLine::Read(float *dst, size_t n) const {
+  size_t pos = writePos >= delay ? writePos - delay : writePos + size - delay;
+  size_t first = size - pos < n ? size - pos : n;
+  memcpy(dst, buffer + pos, first * sizeof(float));
+  memcpy(dst + first, buffer, (n - first) * sizeof(float));
+}
+
+ITCM_CODE void DelayLine::Write(const float *src, size_t n) {
+  size_t first = size - writePos < n ? size - writePos : n;
+  memcpy(buffer + writePos, src, first * sizeof(float));
+  memcpy(buffer, src + first, (n - first) * sizeof(float));
+  writePos += n;
+  if (writePos >= size) {
+    writePos -= size;
+  }
+}
+
+/////////////////////
+// Effects Bus
+/////////////////////
+
+/**
+ * One-pole step toward a target, snapping once close enough
+ */
+ITCM_CODE static float smoothToward(float current, float target) {
+  current += (target - current) * EFFECTS_SMOOTHING;
+  return fabsf(target - current) < EFFECTS_EPSILON ? target : current;
+}
+
+void EffectsBus::Init(float sr) {
+  sampleRate = sr;
+  for (int side = 0; side < 2; side++) {
+    delayLines[side].Init(delayStorage[side], DELAY_LINE_SAMPLES);
+    delayLines[side].SetDelay((size_t)(DELAY_TIME * sampleRate));
+    delayDamp[side] = 0.0f;
+  }
+  for (int i = 0; i < REVERB_LINES; i++) {
+    reverbLines[i].Init(reverbStorage[i], REVERB_LINE_SAMPLES);
+    reverbLines[i].SetDelay((size_t)((float)REVERB_LINE_LENGTHS[i] * sampleRate / 48000.0f));
+  }
+  clearReverb();
+
+  // Repeats until the feedback has taken the level below EFFECTS_SILENCE
+  float repeats = ceilf(logf(EFFECTS_SILENCE) / logf(DELAY_FEEDBACK));
+  delayTailLength = (int32_t)(repeats * (float)delayLines[0].Delay());
+  delayTail = 0;
+  reverbTail = 0;
+  delayMix = delayMixSmoothed = 0.0f;
+  reverbMix = reverbMixSmoothed = 0.0f;
+  reverbDecaySmoothed = reverbDecay;
+  updateReverbGains();
+  reverbOn = true;
+  reverbStopping = false;
+  reverbShed.store(false, std::memory_order_relaxed);
+}
+
+void EffectsBus::SetCpuBudget(float share, float ticks) {
+  budget = share;
+  ticksPerSample = ticks;
+}
+
+void EffectsBus::SetDelayMix(float send) {
+  delayMix = send > 0.0f ? send : 0.0f;
+}
+
+void EffectsBus::SetReverbMix(float send) {
+  reverbMix = send > 0.0f ? send : 0.0f;
+}
+
+void EffectsBus::SetReverbDecay(float seconds) {
+  reverbDecay = seconds < REVERB_DECAY_MIN ? REVERB_DECAY_MIN
+              : (seconds > REVERB_DECAY_MAX ? REVERB_DECAY_MAX : seconds);
+}
+
+/**
+ * Per-pass gain of each line for the smoothed RT60: -60 dB after
+ * decay seconds of passes through a line of its length
+ */
+void EffectsBus::updateReverbGains() {
+  for (int i = 0; i < REVERB_LINES; i++) {
+    float passes = reverbDecaySmoothed * sampleRate / (float)reverbLines[i].Delay();
+    reverbGain[i] = powf(10.0f, -3.0f / passes);
+  }
+}
+
+void EffectsBus::clearReverb() {
+  for (int i = 0; i < REVERB_LINES; i++) {
+    reverbLines[i].Clear();
+    reverbDamp[i] = 0.0f;
+  }
+  reverbTail = 0;
+}
+
+/**
+ * Ping-pong delay: the send enters the left line, each line's output
+ * feeds the other line through a damping low-pass
+ */
+ITCM_CODE void EffectsBus::processDelay(float *left, float *right, size_t n) {
+  float send = delayMixSmoothed;
+  delayMixSmoothed = smoothToward(delayMixSmoothed, delayMix);
+  float sendStep = (delayMixSmoothed - send) / (float)n;
+  if (send > 0.0f || delayMixSmoothed > 0.0f) {
+    delayTail = delayTailLength;
+  } else {
+    delayTail -= (int32_t)n;
+  }
+
+  float *l = delayBlock[0];
+  float *r = delayBlock[1];
+  delayLines[0].Read(l, n);
+  delayLines[1].Read(r, n);
+  float dampL = delayDamp[0];
+  float dampR = delayDamp[1];
+  for (size_t k = 0; k < n; k++) {
+    float outL = l[k];
+    float outR = r[k];
+    dampL += (outR - dampL) * DELAY_DAMPING;
+    dampR += (outL - dampR) * DELAY_DAMPING;
+    l[k] = sendBlock[k] * send + dampL * DELAY_FEEDBACK;
+    r[k] = dampR * DELAY_FEEDBACK;
+    send += sendStep;
+    left[k] += outL;
+    right[k] += outR;
+  }
+  delayDamp[0] = dampL;
+  delayDamp[1] = dampR;
+  delayLines[0].Write(l, n);
+  delayLines[1].Write(r, n);
+}
+
+/**
+ * Four-line FDN: damped line outputs go through a normalized Hadamard
+ * matrix and the per-line decay gain, plus the send, back into the lines
+ */
+ITCM_CODE void EffectsBus::processReverb(float *left, float *right, size_t n) {
+  float send = reverbMixSmoothed;
+  reverbMixSmoothed = smoothToward(reverbMixSmoothed, reverbMix);
+  float sendStep = (reverbMixSmoothed - send) / (float)n;
+  float decay = reverbDecaySmoothed;
+  reverbDecaySmoothed = smoothToward(reverbDecaySmoothed, reverbDecay);
+  if (reverbDecaySmoothed != decay) {
+    updateReverbGains();
+  }
+  if (send > 0.0f || reverbMixSmoothed > 0.0f) {
+    reverbTail = (int32_t)(REVERB_TAIL_RT60S * reverbDecaySmoothed * sampleRate);
+  } else {
+    reverbTail -= (int32_t)n;
+  }
+
+  // Shedding fades the output to silence over this block
+  float level = REVERB_OUTPUT_GAIN;
+  float levelStep = reverbStopping ? -REVERB_OUTPUT_GAIN / (float)n : 0.0f;
+
+  for (int i = 0; i < REVERB_LINES; i++) {
+    reverbLines[i].Read(reverbBlock[i], n);
+  }
+  float *b0 = reverbBlock[0];
+  float *b1 = reverbBlock[1];
+  float *b2 = reverbBlock[2];
+  float *b3 = reverbBlock[3];
+  float d0 = reverbDamp[0];
+  float d1 = reverbDamp[1];
+  float d2 = reverbDamp[2];
+  float d3 = reverbDamp[3];
+  for (size_t k = 0; k < n; k++) {
+    float y0 = b0[k];
+    float y1 = b1[k];
+    float y2 = b2[k];
+    float y3 = b3[k];
+    d0 += (y0 - d0) * REVERB_DAMPING;
+    d1 += (y1 - d1) * REVERB_DAMPING;
+    d2 += (y2 - d2) * REVERB_DAMPING;
+    d3 += (y3 - d3) * REVERB_DAMPING;
+    float a = d0 + d1;
+    float b = d0 - d1;
+    float c = d2 + d3;
+    float d = d2 - d3;
+    float x = sendBlock[k] * send;
+    b0[k] = (a + c) * 0.5f * reverbGain[0] + x;
+    b1[k] = (b + d) * 0.5f * reverbGain[1] + x;
+    b2[k] = (a - c) * 0.5f * reverbGain[2] + x;
+    b3[k] = (b - d) * 0.5f * reverbGain[3] + x;
+    send += sendStep;
+    left[k] += (y0 + y2) * level;
+    right[k] += (y1 + y3) * level;
+    level += levelStep;
+  }
+  reverbDamp[0] = d0;
+  reverbDamp[1] = d1;
+  reverbDamp[2] = d2;
+  reverbDamp[3] = d3;
+  for (int i = 0; i < REVERB_LINES; i++) {
+    reverbLines[i].Write(reverbBlock[i], n);
+  }
+
+  if (reverbStopping) {
+    reverbStopping = false;
+    reverbOn = false;
+    reverbShed.store(true, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * Publish this block's load and shed or restore the reverb
+ */
+ITCM_CODE void EffectsBus::recordLoad(uint32_t delayTicks, uint32_t reverbTicks, size_t n) {
+  if (resetRequested.load(std::memory_order_relaxed)) {
+    peakLoad.store(0.0f, std::memory_order_relaxed);
+    overBudget.store(0, std::memory_order_relaxed);
+    resetRequested.store(false, std::memory_order_relaxed);
+  }
+  float blockTicks = ticksPerSample * (float)n;
+  if (blockTicks <= 0.0f) {
+    return;
+  }
+
+  float delayLoad = (float)delayTicks / blockTicks;
+  float reverbLoad = (float)reverbTicks / blockTicks;
+  if (reverbTicks > 0) {
+    reverbCost = reverbLoad;
+  }
+  float total = delayLoad + reverbLoad;
+  load.store(total, std::memory_order_relaxed);
+  if (total > peakLoad.load(std::memory_order_relaxed)) {
+    peakLoad.store(total, std::memory_order_relaxed);
+  }
+
+  if (total > budget) {
+    overBudget.store(overBudget.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    overStreak++;
+  } else {
+    overStreak = 0;
+  }
+
+  if (reverbOn) {
+    if (reverbTicks > 0 && overStreak >= EFFECTS_SHED_BLOCKS) {
+      reverbStopping = true;  // Next reverb block fades out and stops it
+      overStreak = 0;
+    }
+  } else if (delayLoad + reverbCost <= budget * EFFECTS_RESTORE_MARGIN) {
+    if (++roomStreak >= EFFECTS_RESTORE_BLOCKS) {
+      clearReverb();
+      reverbOn = true;
+      roomStreak = 0;
+      reverbShed.store(false, std::memory_order_relaxed);
+    }
+  } else {
+    roomStreak = 0;
+  }
+}
+
+ITCM_CODE void EffectsBus::Process(float *left, float *right, size_t n) {
+  bool delayActive = delayMix > 0.0f || delayMixSmoothed > 0.0f || delayTail > 0;
+  bool reverbActive = reverbOn && (reverbMix > 0.0f || reverbMixSmoothed > 0.0f || reverbTail > 0);
+  active = delayActive || reverbActive;
+  if (!active) {
+    recordLoad(0, 0, n);
+    return;
+  }
+
+  uint32_t start = cpuMeterNow();
+  for (size_t k = 0; k < n; k++) {
+    sendBlock[k] = (left[k] + right[k]) * 0.5f;  // Both effects take the mid signal
+  }
+  if (delayActive) {
+    processDelay(left, right, n);
+  }
+  uint32_t middle = cpuMeterNow();
+  if (reverbActive) {
+    processReverb(left, right, n);
+  }
+  uint32_t end = cpuMeterNow();
+  recordLoad(middle - start, end - middle, n);
+}
@@ -0,0 +1,183 @@
+#include "EventLog.h"
+
+EventLog eventLog;
+
+void EventLog::Init(const LogEventInfo *table, size_t count, LogWriter out, uint32_t (*clockFn)()) {
+  events = table;
+  numEvents = count;
+  writer = out;
+  clock = clockFn;
+  SetAllLevels(LOG_LEVEL_DEBUG);
+}
+
+void EventLog::SetLevel(uint8_t category, LogLevel level) {
+  if (category < LOG_MAX_CATEGORIES) {
+    levels[category] = level;
+  }
+}
+
+LogLevel EventLog::Level(uint8_t category) const {
+  return category < LOG_MAX_CATEGORIES ? levels[category] : LOG_LEVEL_OFF;
+}
+
+void EventLog::SetAllLevels(LogLevel level) {
+  for (int i = 0; i < LOG_MAX_CATEGORIES; i++) {
+    levels[i] = level;
+  }
+}
+
+/////////////////////
+// Formatting
+/////////////////////
+
+namespace {
+
+struct LineBuffer {
+  char *text;
+  size_t size;
+  size_t length;
+
+  void put(char c) {
+    if (length + 1 < size) {
+      text[length++] = c;
+    }
+  }
+
+  void puts(const char *s) {
+    while (s && *s) put(*s++);
+  }
+
+  void putUnsigned(uint32_t v, unsigned base) {
+    char digits[12];
+    int n = 0;
+    do {
+      unsigned d = v % base;
+      digits[n++] = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+      v /= base;
+    } while (v > 0);
+    while (n > 0) put(digits[--n]);
+  }
+
+  void putSigned(int32_t v) {
+    if (v < 0) {
+      put('-');
+      putUnsigned((uint32_t)(-(int64_t)v), 10);
+    } else {
+      putUnsigned((uint32_t)v, 10);
+    }
+  }
+
+  // Fixed-point float without printf (newlib-nano has no %f by default)
+  void putFloat(float v, int decimals) {
+    if (v != v) {
+      puts("nan");
+      return;
+    }
+    if (v < 0.0f) {
+      put('-');
+      v = -v;
+    }
+    uint32_t scale = 1;
+    for (int i = 0; i < decimals; i++) scale *= 10;
+    if (v > 4.0e9f / scale) {
+      puts("inf");
+      return;
+    }
+    uint64_t fixed = (uint64_t)((double)v * scale + 0.5);
+    putUnsigned((uint32_t)(fixed / scale), 10);
+    if (decimals > 0) {
+      put('.');
+      uint32_t frac = (uint32_t)(fixed % scale);
+      for (uint32_t div = scale / 10; div > 0; div /= 10) {
+        put((char)('0' + (frac / div) % 10));
+      }
+    }
+  }
+};
+
+}  // namespace
+
+size_t EventLog::format(const LogRecord &record, char *line, size_t size) const {
+  LineBuffer out = {line, size, 0};
+
+  // "[   1234.567] " - milliseconds since boot
+  out.put('[');
+  uint32_t ms = record.timestampMicros / 1000;
+  for (uint32_t width = 1000000; width > 1 && ms < width; width /= 10) out.put(' ');
+  out.putUnsigned(ms, 10);
+  out.put('.');
+  uint32_t us = record.timestampMicros % 1000;
+  out.put((char)('0' + us / 100));
+  out.put((char)('0' + (us / 10) % 10));
+  out.put((char)('0' + us % 10));
+  out.puts("] ");
+
+  const char *p = record.id < numEvents ? events[record.id].format : "?";
+  int arg = 0;
+  while (*p) {
+    if (*p != '%') {
+      out.put(*p++);
+      continue;
+    }
+    p++;
+    int decimals = 2;
+    if (*p == '.' && p[1] >= '0' && p[1] <= '9') {
+      decimals = p[1] - '0';
+      p += 2;
+    }
+    char spec = *p ? *p++ : '\0';
+    if (spec == '%') {
+      out.put('%');
+      continue;
+    }
+    if (arg >= record.argc) {
+      out.puts("<?>");
+      continue;
+    }
+    const LogArg &a = record.args[arg++];
+    switch (spec) {
+      case 'd': out.putSigned(a.i); break;
+      case 'u': out.putUnsigned(a.u, 10); break;
+      case 'x': out.putUnsigned(a.u, 16); break;
+      case 's': out.puts(a.s); break;
+      case 'f': out.putFloat(a.f, decimals); break;
+      default: out.put('?'); break;
+    }
+  }
+  out.puts("\r\n");
+  line[out.length] = '\0';
+  return out.length;
+}
+
+size_t EventLog::Drain(size_t maxRecords) {
+  if (!writer.write) {
+    return 0;
+  }
+
+  char line[LOG_LINE_SIZE];
+  uint32_t dropped = Dropped();
+  if (dropped != reportedDrops && (!writer.writable || writer.writable() >= LOG_LINE_SIZE)) {
+    LineBuffer out = {line, sizeof(line), 0};
+    out.puts("[log] ");
+    out.putUnsigned(dropped - reportedDrops, 10);
+    out.puts(" records dropped\r\n");
+    writer.write(line, out.length);
+    reportedDrops = dropped;
+  }
+
+  size_t written = 0;
+  LogRecord record;
+  while (written < maxRecords) {
+    // Only take a record when a full line fits without blocking
+    if (writer.writable && writer.writable() < LOG_LINE_SIZE) {
+      break;
+    }
+    if (!records.Pop(record)) {
+      break;
+    }
+    size_t length = format(record, line, sizeof(line));
+    writer.write(line, length);
+    written++;
+  }
+  return written;
+}
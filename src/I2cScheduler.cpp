@@ -0,0 +1,78 @@
+#include "I2cScheduler.h"
+
+#include <string.h>
+
+void I2cScheduler::Init(I2cBus *b, I2cCompletion callback, void *ctx) {
+  bus = b;
+  onComplete = callback;
+  context = ctx;
+  busy = false;
+  errors = 0;
+}
+
+bool I2cScheduler::Submit(const I2cTransaction &t, uint32_t nowMicros) {
+  I2cTransaction queued = t;
+  queued.status = I2C_PENDING;
+  queued.submittedMicros = nowMicros;
+  queued.completedMicros = 0;
+  return pending.Push(queued);
+}
+
+void I2cScheduler::complete(I2cStatus status, uint32_t nowMicros) {
+  active.status = status;
+  active.completedMicros = nowMicros;
+  busy = false;
+  if (status == I2C_ERROR) {
+    errors++;
+  }
+  if (onComplete) {
+    onComplete(context, active);
+  }
+}
+
+void I2cScheduler::Service(uint32_t nowMicros) {
+  if (!bus) {
+    return;
+  }
+
+  if (!busy) {
+    if (!pending.Pop(active)) {
+      return;
+    }
+    active.status = I2C_BUSY;
+    if (!bus->Start(active)) {
+      complete(I2C_ERROR, nowMicros);
+      return;
+    }
+    busy = true;
+  }
+
+  // Synchronous backends are already done here; async ones report BUSY
+  I2cStatus status = bus->Poll(active);
+  if (status == I2C_DONE || status == I2C_ERROR) {
+    complete(status, nowMicros);
+  }
+}
+
+I2cTransaction i2cReadRegisters(uint8_t address, uint8_t reg, uint8_t rxLen, uint8_t tag) {
+  I2cTransaction t;
+  memset(&t, 0, sizeof(t));
+  t.address = address;
+  t.tag = tag;
+  t.txLen = 1;
+  t.tx[0] = reg;
+  t.rxLen = rxLen > I2C_MAX_RX ? I2C_MAX_RX : rxLen;
+  return t;
+}
+
+I2cTransaction i2cWriteRegister(uint8_t address, uint8_t reg, uint8_t value, uint8_t tag) {
+  I2cTransaction t;
+  memset(&t, 0, sizeof(t));
+  t.address = address;
+  t.tag = tag;
+  t.txLen = 2;
+  t.tx[0] = reg;
+  t.tx[1] = value;
+  t.rxLen = 0;
+  return t;
+}
@@ -0,0 +1,236 @@
+#include "InputTrace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+InputTrace inputTrace;
+
+void InputTrace::StartRecording(uint32_t nowMicros, uint16_t buttons) {
+  replaying = false;
+  count = 0;
+  flushed = 0;
+  overflows = 0;
+  startMicros = nowMicros;
+  for (int i = 0; i < ANALOG_MAX_INPUTS; i++) {
+    lastAnalog[i] = -1;  // Forces the initial values into the trace
+  }
+  recording = true;
+  append(nowMicros, INPUT_BUTTONS, 0, 0, (int16_t)buttons, 0, 0);
+}
+
+void InputTrace::StopRecording() {
+  recording = false;
+}
+
+void InputTrace::StartReplay(uint32_t nowMicros) {
+  recording = false;
+  cursor = 0;
+  startMicros = nowMicros;
+  for (int i = 0; i < ANALOG_MAX_INPUTS; i++) {
+    replayAnalog[i] = -1;
+  }
+  ButtonEdge staleEdge;
+  while (replayEdges.Pop(staleEdge)) {
+  }
+  SensorSample stale;
+  while (replaySamples.Pop(stale)) {
+  }
+  InputCommand staleCommand;
+  while (replayCommands.Pop(staleCommand)) {
+  }
+  replaying = count > 0;
+}
+
+void InputTrace::StopReplay() {
+  replaying = false;
+}
+
+bool InputTrace::push(const InputRecord &record) {
+  if (count >= INPUT_TRACE_CAPACITY) {
+    overflows++;
+    return false;
+  }
+  records[count++] = record;
+  return true;
+}
+
+bool InputTrace::Load(const InputRecord &record) {
+  if (!push(record)) {
+    return false;
+  }
+  flushed = count;
+  return true;
+}
+
+void InputTrace::append(uint32_t nowMicros, InputRecordType type, uint8_t status, int32_t offset, int16_t v0,
+                        int16_t v1, int16_t v2) {
+  InputRecord record;
+  record.timeMicros = nowMicros - startMicros;
+  record.sampleOffset = offset;
+  record.type = type;
+  record.status = status;
+  record.value[0] = v0;
+  record.value[1] = v1;
+  record.value[2] = v2;
+  push(record);
+}
+
+void InputTrace::RecordAnalog(uint32_t nowMicros, const uint16_t *levels, int count) {
+  if (!recording) {
+    return;
+  }
+  for (int i = 0; i < count && i < ANALOG_MAX_INPUTS; i++) {
+    if (levels[i] != lastAnalog[i]) {
+      append(nowMicros, INPUT_ANALOG, (uint8_t)i, 0, (int16_t)levels[i], 0, 0);
+      lastAnalog[i] = levels[i];
+    }
+  }
+}
+
+void InputTrace::RecordButtons(uint32_t nowMicros, const ButtonEdge &edge) {
+  if (recording) {
+    append(nowMicros, INPUT_BUTTONS, 0, (int32_t)(edge.timeMicros - nowMicros), (int16_t)edge.buttons, 0, 0);
+  }
+}
+
+void InputTrace::RecordSample(uint32_t nowMicros, const SensorSample &sample) {
+  if (!recording) {
+    return;
+  }
+  // Read completions land after the loop time, interrupt stamps before it
+  int32_t offset = (int32_t)(sample.timestampMicros - nowMicros);
+  if (sample.kind == SENSOR_ACCEL) {
+    append(nowMicros, INPUT_ACCEL, sample.status, offset, accelToCounts(sample.value[0]),
+           accelToCounts(sample.value[1]), accelToCounts(sample.value[2]));
+  } else {
+    append(nowMicros, INPUT_TOF, sample.status, offset, (int16_t)sample.value[0], 0, 0);
+  }
+}
+
+void InputTrace::RecordCommand(uint32_t nowMicros, uint8_t key) {
+  if (recording) {
+    append(nowMicros, INPUT_COMMAND, key, 0, 0, 0, 0);
+  }
+}
+
+void InputTrace::RecordTunable(uint32_t nowMicros, uint8_t id, float value) {
+  if (!recording) {
+    return;
+  }
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  append(nowMicros, INPUT_TUNABLE, id, 0, (int16_t)(bits & 0xFFFF), (int16_t)(bits >> 16), 0);
+}
+
+void InputTrace::ReplayDue(uint32_t nowMicros) {
+  if (!replaying) {
+    return;
+  }
+  uint32_t elapsed = nowMicros - startMicros;
+  while (cursor < count && records[cursor].timeMicros <= elapsed) {
+    const InputRecord &record = records[cursor++];
+    switch (record.type) {
+      case INPUT_BUTTONS: {
+        ButtonEdge edge;
+        edge.timeMicros = startMicros + record.timeMicros + (uint32_t)record.sampleOffset;
+        edge.buttons = (uint16_t)record.value[0];
+        replayEdges.Push(edge);
+        break;
+      }
+      case INPUT_ANALOG:
+        if (record.status < ANALOG_MAX_INPUTS) {
+          replayAnalog[record.status] = (uint16_t)record.value[0];
+        }
+        break;
+      case INPUT_TOF:
+      case INPUT_ACCEL: {
+        SensorSample sample;
+        sample.kind = record.type == INPUT_TOF ? SENSOR_TOF : SENSOR_ACCEL;
+        sample.status = record.status;
+        sample.timestampMicros = startMicros + record.timeMicros + (uint32_t)record.sampleOffset;
+        for (int axis = 0; axis < 3; axis++) {
+          sample.value[axis] = record.type == INPUT_TOF ? (axis == 0 ? (float)record.value[0] : 0.0f)
+                                                        : accelFromCounts(record.value[axis]);
+        }
+        replaySamples.Push(sample);
+        break;
+      }
+      case INPUT_COMMAND:
+      case INPUT_TUNABLE: {
+        InputCommand command;
+        command.type = record.type;
+        command.id = record.status;
+        uint32_t bits = (uint32_t)(uint16_t)record.value[0] | ((uint32_t)(uint16_t)record.value[1] << 16);
+        memcpy(&command.value, &bits, sizeof(command.value));
+        replayCommands.Push(command);
+        break;
+      }
+    }
+  }
+  if (cursor >= count) {
+    replaying = false;  // Live inputs take over after the last record
+  }
+}
+
+void InputTrace::ReplayAnalog(uint32_t nowMicros, uint16_t *levels, int count) {
+  if (!replaying) {
+    return;
+  }
+  ReplayDue(nowMicros);
+  for (int i = 0; i < count && i < ANALOG_MAX_INPUTS; i++) {
+    if (replayAnalog[i] >= 0) {
+      levels[i] = (uint16_t)replayAnalog[i];
+    }
+  }
+}
+
+/////////////////////
+// Text form: "@<time hex> <type> <status> <offset> <v0> <v1> <v2>"
+/////////////////////
+
+size_t InputTrace::FormatRecord(const InputRecord &record, char *line, size_t size) {
+  int length = snprintf(line, size, "@%08lx %u %u %ld %d %d %d\r\n", (unsigned long)record.timeMicros,
+                        (unsigned)record.type, (unsigned)record.status, (long)record.sampleOffset,
+                        (int)record.value[0], (int)record.value[1], (int)record.value[2]);
+  if (length < 0) {
+    return 0;
+  }
+  return (size_t)length < size ? (size_t)length : size - 1;
+}
+
+bool InputTrace::ParseRecord(const char *line, InputRecord &record) {
+  unsigned long time = 0;
+  unsigned type = 0, status = 0;
+  long offset = 0;
+  int v0 = 0, v1 = 0, v2 = 0;
+  if (sscanf(line, " @%lx %u %u %ld %d %d %d", &time, &type, &status, &offset, &v0, &v1, &v2) != 7 ||
+      type > INPUT_TUNABLE) {
+    return false;
+  }
+  record.timeMicros = (uint32_t)time;
+  record.type = (InputRecordType)type;
+  record.status = (uint8_t)status;
+  record.sampleOffset = (int32_t)offset;
+  record.value[0] = (int16_t)v0;
+  record.value[1] = (int16_t)v1;
+  record.value[2] = (int16_t)v2;
+  return true;
+}
+
+size_t InputTrace::Flush(LogWriter writer, size_t maxRecords) {
+  if (!writer.write) {
+    return 0;
+  }
+  char line[INPUT_TRACE_LINE_SIZE];
+  size_t written = 0;
+  while (written < maxRecords && flushed < count) {
+    // Only take a record when a full line fits without blocking
+    if (writer.writable && writer.writable() < INPUT_TRACE_LINE_SIZE) {
+      break;
+    }
+    size_t length = FormatRecord(records[flushed++], line, sizeof(line));
+    writer.write(line, length);
+    written++;
+  }
+  return written;
+}
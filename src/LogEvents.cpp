@@ -0,0 +1,43 @@
+#include "LogEvents.h"
+
+const LogEventInfo logEventTable[LOG_NUM_EVENTS] = {
+  {LOG_CAT_NOTES, LOG_LEVEL_INFO, "Note ON - Button %d, MIDI Note: %f"},
+  {LOG_CAT_NOTES, LOG_LEVEL_INFO, "Note LATCHED - Button %d, MIDI Note: %f"},
+  {LOG_CAT_NOTES, LOG_LEVEL_INFO, "Note RE-TRIGGERED - Button %d"},
+  {LOG_CAT_NOTES, LOG_LEVEL_INFO, "Note OFF - Button %d"},
+  {LOG_CAT_NOTES, LOG_LEVEL_INFO, "All latched notes cleared"},
+  {LOG_CAT_CONTROL, LOG_LEVEL_INFO, "%s"},
+  {LOG_CAT_CONTROL, LOG_LEVEL_INFO, "Scale: %s"},
+  {LOG_CAT_CONTROL, LOG_LEVEL_INFO, "New Key: %d"},
+  {LOG_CAT_CONTROL, LOG_LEVEL_INFO, "Key Set Mode - Use left hand to select key"},
+  {LOG_CAT_CONTROL, LOG_LEVEL_INFO, "Mode: %s"},
+  {LOG_CAT_CONTROL, LOG_LEVEL_INFO, "Latch Mode: %s"},
+  {LOG_CAT_CONTROL, LOG_LEVEL_INFO, "Volume: %.1f%% (%.1f dB)"},
+  {LOG_CAT_SENSORS, LOG_LEVEL_DEBUG, "Distance: %d mm - Morph: %f"},
+  {LOG_CAT_SENSORS, LOG_LEVEL_DEBUG, "Distance: %d mm - Effects: %f"},
+  {LOG_CAT_SENSORS, LOG_LEVEL_INFO, "%sWindow: %f, %f, %f, %f, %f (offset: %d semitones)"},
+  {LOG_CAT_SYSTEM, LOG_LEVEL_INFO, "Hold for 2s to calibrate center position..."},
+  {LOG_CAT_SYSTEM, LOG_LEVEL_INFO, "=== CALIBRATED === New center X: %f"},
+  {LOG_CAT_SYSTEM, LOG_LEVEL_INFO, "Calibration cancelled"},
+  {LOG_CAT_SYSTEM, LOG_LEVEL_INFO, "Trace recording (lines starting with @ are the capture)"},
+  {LOG_CAT_SYSTEM, LOG_LEVEL_INFO, "Trace stopped: %u records, %u lost (buffer full)"},
+  {LOG_CAT_SYSTEM, LOG_LEVEL_INFO, "Trace replay: %u records"},
+  {LOG_CAT_CONTROL, LOG_LEVEL_INFO, "Arpeggiator: %s"},
+  {LOG_CAT_SENSORS, LOG_LEVEL_DEBUG, "Distance: %d mm - Arp rate: %.1f steps/s"},
+  {LOG_CAT_CONTROL, LOG_LEVEL_INFO, "Preset Mode - Tap a left button to recall, hold to save"},
+  {LOG_CAT_CONTROL, LOG_LEVEL_INFO, "Preset %d saved"},
+  {LOG_CAT_CONTROL, LOG_LEVEL_INFO, "Preset %d recalled"},
+  {LOG_CAT_CONTROL, LOG_LEVEL_INFO, "Preset %d is empty"},
+  {LOG_CAT_SYSTEM, LOG_LEVEL_DEBUG, "State saved (flash: %u writes, %u sector erases)"},
+  {LOG_CAT_SYSTEM, LOG_LEVEL_INFO, "Preset flash unavailable - settings will not be kept"},
+  {LOG_CAT_SYSTEM, LOG_LEVEL_INFO, "Playable %.2f ms after reset (%u stored records, sensors %s)"},
+  {LOG_CAT_SYSTEM, LOG_LEVEL_INFO, "Memory: ITCM %u bytes, DTCM %u bytes, SDRAM %u KB"},
+  {LOG_CAT_STATS, LOG_LEVEL_INFO, "CPU: avg %.1f%% peak %.1f%% (%.1f us) overruns %u / %u blocks"},
+  {LOG_CAT_STATS, LOG_LEVEL_INFO, "Cycles per block: avg %u peak %u"},
+  {LOG_CAT_STATS, LOG_LEVEL_INFO, "Effects: %.1f%% peak %.1f%% (budget %.0f%%) over budget %u%s"},
+  {LOG_CAT_STATS, LOG_LEVEL_INFO, "CPU histogram, 10%% steps, 0-60%%: %u %u %u %u %u %u"},
+  {LOG_CAT_STATS, LOG_LEVEL_INFO, "CPU histogram, 10%% steps, 60-100%%: %u %u %u %u, over 100%%: %u"},
+  {LOG_CAT_STATS, LOG_LEVEL_INFO, "Sensors: ToF %s, bus errors %u, dropped samples %u"},
+  {LOG_CAT_STATS, LOG_LEVEL_INFO, "Buttons: %u scans, dropped edges %u, late notes %u, dropped events %u"},
+  {LOG_CAT_STATS, LOG_LEVEL_INFO, "Task %s every %u us: %u runs, avg %.1f us, max %u us, late up to %u us, overruns %u"},
+};
@@ -0,0 +1,51 @@
+#include "MemoryPlacement.h"
+
+#if defined(ARDUINO)
+#include <string.h>
+#include <stdint.h>
+
+// Section bounds from tools/linker/daisy_seed.ld (_si* = load address in flash)
+extern "C" {
+extern uint8_t _siitcm_text[], _sitcm_text[], _eitcm_text[];
+extern uint8_t _sidtcm_data[], _sdtcm_data[], _edtcm_data[];
+extern uint8_t _sdtcm_bss[], _edtcm_bss[];
+extern uint8_t _ssdram_bss[], _esdram_bss[];
+}
+
+/**
+ * Copy ITCM code and DTCM data in from flash and clear DTCM bss. The
+ * startup code only handles .data and .bss, and DTCM objects with
+ * constructors (the SynthEngine) are built by __libc_init_array. It stays
+ * in flash itself.
+ */
+static void memoryPlacementInit() {
+  memcpy(_sitcm_text, _siitcm_text, (size_t)(_eitcm_text - _sitcm_text));
+  memcpy(_sdtcm_data, _sidtcm_data, (size_t)(_edtcm_data - _sdtcm_data));
+  memset(_sdtcm_bss, 0, (size_t)(_edtcm_bss - _sdtcm_bss));
+  // The I-cache never saw ITCM (it is not cached) and the copy went
+  // through the D-side, so only the pipeline needs to see the new code
+  __asm__ volatile("dsb\n\tisb" ::: "memory");
+}
+
+// Reset_Handler calls __libc_init_array after .data and .bss are set up;
+// it runs every .preinit_array entry before the first .init_array one.
+// A constructor(101) would tie with the core's premain(), and the order
+// of equal priorities is only the link order.
+__attribute__((used, section(".preinit_array"))) static void (*const memoryPlacementEntry)() = memoryPlacementInit;
+
+MemoryUsage memoryUsage() {
+  MemoryUsage usage;
+  usage.itcmCode = (size_t)(_eitcm_text - _sitcm_text);
+  usage.dtcmData = (size_t)(_edtcm_bss - _sdtcm_data);
+  usage.sdramData = (size_t)(_esdram_bss - _ssdram_bss);
+  return usage;
+}
+
+#else
+
+MemoryUsage memoryUsage() {
+  MemoryUsage usage = {0, 0, 0};
+  return usage;
+}
+
+#endif
@@ -0,0 +1,273 @@
+#include "MidiOut.h"
+
+#include <math.h>
+
+MidiOut midiOut;
+
+const uint8_t MIDI_NOTE_OFF = 0x80;
+const uint8_t MIDI_NOTE_ON = 0x90;
+const uint8_t MIDI_CONTROL_CHANGE = 0xB0;
+const uint8_t MIDI_PITCH_BEND = 0xE0;
+
+const uint16_t BEND_CENTER = 8192;
+const uint16_t MEMBER_BEND_THRESHOLD = 4;   // 14-bit steps (about 2 cents at 48 semitones)
+const uint16_t MANAGER_BEND_THRESHOLD = 8;
+
+// Registered parameters (CC 101/100 select, CC 6/38 set)
+const uint8_t CC_DATA_ENTRY = 6;
+const uint8_t CC_DATA_ENTRY_FINE = 38;
+const uint8_t CC_RPN_LSB = 100;
+const uint8_t CC_RPN_MSB = 101;
+const uint8_t RPN_BEND_RANGE = 0;
+const uint8_t RPN_MPE_CONFIGURATION = 6;
+const uint8_t RPN_NULL = 127;
+
+/**
+ * Semitones to a 14-bit bend value for a range
+ */
+static uint16_t bendValue(float semitones, float range) {
+  long value = (long)BEND_CENTER + lroundf(semitones / range * (float)BEND_CENTER);
+  if (value < 0) {
+    value = 0;
+  } else if (value > 16383) {
+    value = 16383;
+  }
+  return (uint16_t)value;
+}
+
+static inline uint8_t memberStatus(uint8_t type, int channel) {
+  return type | (uint8_t)(channel + 1);
+}
+
+void MidiOut::Init(float managerBendRange) {
+  managerRange = managerBendRange > 0.0f ? managerBendRange : 2.0f;
+  MidiPacket stale;
+  while (queue.Pop(stale)) {
+  }
+
+  for (int slot = 0; slot < NUM_SLOTS; slot++) {
+    ControlSlot &s = slots[slot];
+    if (slot < MPE_MEMBER_CHANNELS) {
+      s.status = memberStatus(MIDI_PITCH_BEND, slot);
+      s.number = 0;
+      s.threshold = MEMBER_BEND_THRESHOLD;
+      s.rest = BEND_CENTER;
+    } else if (slot == SLOT_MANAGER_BEND) {
+      s.status = MIDI_PITCH_BEND | MPE_MANAGER_CHANNEL;
+      s.number = 0;
+      s.threshold = MANAGER_BEND_THRESHOLD;
+      s.rest = BEND_CENTER;
+    } else {
+      s.status = MIDI_CONTROL_CHANGE | MPE_MANAGER_CHANNEL;
+      s.number = slot == SLOT_TIMBRE ? MIDI_CC_TIMBRE : MIDI_CC_WINDOW;
+      s.threshold = 1;
+      s.rest = slot == SLOT_TIMBRE ? 0 : 64;
+    }
+    s.value = s.rest;
+    s.sent = s.rest;
+    s.lastMicros = 0;
+    s.pending = false;
+  }
+
+  for (int ch = 0; ch < MPE_MEMBER_CHANNELS; ch++) {
+    channelNote[ch] = -1;
+    channelAge[ch] = 0;
+  }
+  for (int id = 0; id < MIDI_MAX_NOTE_IDS; id++) {
+    noteChannel[id] = -1;
+    noteKey[id] = 0;
+  }
+  allocations = 0;
+  activeNotes = 0;
+  started = false;
+  nextSlot = 0;
+
+  SendConfiguration();
+}
+
+void MidiOut::push(uint8_t status, uint8_t data1, uint8_t data2) {
+  MidiPacket packet;
+  packet.header = status >> 4;  // Cable 0, code index = channel message type
+  packet.status = status;
+  packet.data1 = data1 & 0x7F;
+  packet.data2 = data2 & 0x7F;
+  queue.Push(packet);
+}
+
+void MidiOut::SendConfiguration() {
+  const uint8_t cc = MIDI_CONTROL_CHANGE | MPE_MANAGER_CHANNEL;
+  // Lower zone with every member channel (members default to 48 semitones of bend)
+  push(cc, CC_RPN_MSB, 0);
+  push(cc, CC_RPN_LSB, RPN_MPE_CONFIGURATION);
+  push(cc, CC_DATA_ENTRY, MPE_MEMBER_CHANNELS);
+  // Manager channel bend range, semitones and cents
+  int cents = (int)lroundf(managerRange * 100.0f);
+  push(cc, CC_RPN_LSB, RPN_BEND_RANGE);
+  push(cc, CC_DATA_ENTRY, (uint8_t)(cents / 100));
+  push(cc, CC_DATA_ENTRY_FINE, (uint8_t)(cents % 100));
+  push(cc, CC_RPN_MSB, RPN_NULL);
+  push(cc, CC_RPN_LSB, RPN_NULL);
+}
+
+/**
+ * Free channel released longest ago, else steal the oldest note's channel
+ */
+int MidiOut::allocateChannel() {
+  int best = -1;
+  for (int ch = 0; ch < MPE_MEMBER_CHANNELS; ch++) {
+    if (channelNote[ch] < 0 && (best < 0 || channelAge[ch] < channelAge[best])) {
+      best = ch;
+    }
+  }
+  if (best >= 0) {
+    return best;
+  }
+  best = 0;
+  for (int ch = 1; ch < MPE_MEMBER_CHANNELS; ch++) {
+    if (channelAge[ch] < channelAge[best]) {
+      best = ch;
+    }
+  }
+  NoteOff(channelNote[best]);
+  return best;
+}
+
+void MidiOut::NoteOn(int noteId, float pitch) {
+  if (noteId < 0 || noteId >= MIDI_MAX_NOTE_IDS) {
+    return;
+  }
+  if (noteChannel[noteId] >= 0) {
+    NoteOff(noteId);
+  }
+  int ch = allocateChannel();
+  long key = lroundf(pitch);
+  key = key < 0 ? 0 : (key > 127 ? 127 : key);
+  uint16_t bend = bendValue(pitch - (float)key, MPE_NOTE_BEND_RANGE);
+
+  // The bend goes out with the note, so the slot starts in sync
+  push(memberStatus(MIDI_PITCH_BEND, ch), bend & 0x7F, bend >> 7);
+  push(memberStatus(MIDI_NOTE_ON, ch), (uint8_t)key, MIDI_NOTE_VELOCITY);
+  slots[ch].value = bend;
+  slots[ch].sent = bend;
+  slots[ch].pending = false;
+
+  channelNote[ch] = (int8_t)noteId;
+  channelAge[ch] = ++allocations;
+  noteChannel[noteId] = (int8_t)ch;
+  noteKey[noteId] = (uint8_t)key;
+  activeNotes++;
+}
+
+void MidiOut::NoteOff(int noteId) {
+  if (noteId < 0 || noteId >= MIDI_MAX_NOTE_IDS || noteChannel[noteId] < 0) {
+    return;
+  }
+  int ch = noteChannel[noteId];
+  push(memberStatus(MIDI_NOTE_OFF, ch), noteKey[noteId], 0);
+  slots[ch].pending = false;  // Nothing left to bend
+  channelNote[ch] = -1;
+  channelAge[ch] = ++allocations;
+  noteChannel[noteId] = -1;
+  activeNotes--;
+}
+
+void MidiOut::SetNotePitch(int noteId, float pitch) {
+  if (noteId < 0 || noteId >= MIDI_MAX_NOTE_IDS || noteChannel[noteId] < 0) {
+    return;
+  }
+  setSlot(noteChannel[noteId], bendValue(pitch - (float)noteKey[noteId], MPE_NOTE_BEND_RANGE));
+}
+
+void MidiOut::SetBend(float semitones) {
+  setSlot(SLOT_MANAGER_BEND, bendValue(semitones, managerRange));
+}
+
+void MidiOut::SetTimbre(float amount) {
+  long value = lroundf(amount * 127.0f);
+  setSlot(SLOT_TIMBRE, (uint16_t)(value < 0 ? 0 : (value > 127 ? 127 : value)));
+}
+
+void MidiOut::SetWindow(int offset) {
+  int value = 64 + offset;
+  setSlot(SLOT_WINDOW, (uint16_t)(value < 0 ? 0 : (value > 127 ? 127 : value)));
+}
+
+/**
+ * Hold a controller's latest value; changes too small to matter are dropped
+ */
+void MidiOut::setSlot(int slot, uint16_t value) {
+  ControlSlot &s = slots[slot];
+  if (value == s.value) {
+    return;
+  }
+  s.value = value;
+  int change = (int)value - (int)s.sent;
+  if (change < 0) {
+    change = -change;
+  }
+  bool wasPending = s.pending;
+  s.pending = change != 0 && (change >= s.threshold || value == s.rest);
+  if (wasPending || !s.pending) {
+    coalesced++;  // An update that will never be sent on its own
+  }
+}
+
+MidiPacket MidiOut::slotPacket(int slot) const {
+  const ControlSlot &s = slots[slot];
+  MidiPacket packet;
+  packet.header = s.status >> 4;
+  packet.status = s.status;
+  if ((s.status & 0xF0) == MIDI_PITCH_BEND) {
+    packet.data1 = s.value & 0x7F;
+    packet.data2 = (s.value >> 7) & 0x7F;
+  } else {
+    packet.data1 = s.number;
+    packet.data2 = s.value & 0x7F;
+  }
+  return packet;
+}
+
+size_t MidiOut::Service(uint32_t nowMicros) {
+  if (started && nowMicros - frameMicros < MIDI_FRAME_MICROS) {
+    return 0;
+  }
+  started = true;
+  frameMicros = nowMicros;
+
+  size_t budget = MIDI_PACKETS_PER_FRAME;
+  if (writer.writable) {
+    size_t room = writer.writable();
+    budget = room < budget ? room : budget;
+  }
+
+  // Notes first, in order
+  MidiPacket frame[MIDI_PACKETS_PER_FRAME];
+  size_t count = 0;
+  while (count < budget && queue.Pop(frame[count])) {
+    count++;
+  }
+
+  // Controllers only once every queued note is out, so a bend can never
+  // overtake the note-on it belongs to; round robin keeps slots fair
+  if (queue.Empty()) {
+    for (int i = 0; i < NUM_SLOTS && count < budget; i++) {
+      int slot = (nextSlot + i) % NUM_SLOTS;
+      ControlSlot &s = slots[slot];
+      if (!s.pending || nowMicros - s.lastMicros < MIDI_CONTROL_INTERVAL_US) {
+        continue;
+      }
+      frame[count++] = slotPacket(slot);
+      s.sent = s.value;
+      s.lastMicros = nowMicros;
+      s.pending = false;
+      nextSlot = (slot + 1) % NUM_SLOTS;
+    }
+  }
+
+  if (count == 0 || !writer.write) {
+    return 0;
+  }
+  writer.write(frame, count);
+  packetsSent += count;
+  return count;
+}
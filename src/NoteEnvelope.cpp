@@ -0,0 +1,125 @@
+#include "NoteEnvelope.h"
+
+#include <math.h>
+
+#include "MemoryPlacement.h"
+
+// Exponential overshoot ratios: the curve aims past its target by this
+// fraction of the segment span, then snaps when the stage ends
+const float ATTACK_CURVE_RATIO = 0.3f;     // Gentle, close to linear
+const float DECAY_CURVE_RATIO = 0.001f;    // RC-like fall
+
+void NoteEnvelope::Init(float sr) {
+  sampleRate = sr;
+  SetTimes(0.01f, 0.0f, 1.0f, 0.1f);
+  Reset();
+}
+
+void NoteEnvelope::SetTimes(float attack, float decay, float sustain, float release) {
+  attackTime = attack;
+  decayTime = decay;
+  sustainLevel = sustain < 0.0f ? 0.0f : (sustain > 1.0f ? 1.0f : sustain);
+  releaseTime = release;
+}
+
+void NoteEnvelope::SetCurve(EnvelopeCurve c) {
+  curve = c;
+}
+
+int32_t NoteEnvelope::SamplesFor(float seconds) const {
+  int32_t samples = (int32_t)(seconds * sampleRate + 0.5f);
+  return samples < 1 ? 1 : samples;
+}
+
+void NoteEnvelope::Trigger() {
+  startSegment(ENV_ATTACK, 1.0f, SamplesFor(attackTime));
+}
+
+void NoteEnvelope::Release() {
+  if (stage == ENV_IDLE || stage == ENV_RELEASE) {
+    return;
+  }
+  startSegment(ENV_RELEASE, 0.0f, SamplesFor(releaseTime));
+}
+
+ITCM_CODE void NoteEnvelope::ProcessBlock(float *out, size_t n) {
+  size_t i = 0;
+  while (i < n) {
+    if (stage == ENV_IDLE || stage == ENV_SUSTAIN) {
+      for (; i < n; i++) {
+        out[i] = level;
+      }
+      return;
+    }
+
+    // Run to the end of the block or the end of the stage, whichever is first
+    size_t run = n - i;
+    if ((size_t)samplesLeft < run) {
+      run = (size_t)samplesLeft;
+    }
+    if (curve == ENV_CURVE_LINEAR) {
+      for (size_t k = 0; k < run; k++) {
+        level += increment;
+        out[i++] = level;
+      }
+    } else {
+      for (size_t k = 0; k < run; k++) {
+        level = base + level * coef;
+        out[i++] = level;
+      }
+    }
+    samplesLeft -= (int32_t)run;
+    if (samplesLeft <= 0) {
+      advanceStage();
+      out[i - 1] = level;
+    }
+  }
+}
+
+void NoteEnvelope::Reset() {
+  stage = ENV_IDLE;
+  level = 0.0f;
+  target = 0.0f;
+  samplesLeft = 0;
+}
+
+/**
+ * Precompute the per-sample step for a segment from the current level to
+ * target that lasts exactly `length` samples
+ */
+void NoteEnvelope::startSegment(EnvelopeStage next, float segTarget, int32_t length) {
+  stage = next;
+  target = segTarget;
+  samplesLeft = length;
+
+  float span = target - level;
+  increment = span / (float)length;
+
+  // level[n] = asymptote + (start - asymptote) * coef^n reaches target at n = length
+  float ratio = (next == ENV_ATTACK) ? ATTACK_CURVE_RATIO : DECAY_CURVE_RATIO;
+  float asymptote = target + ratio * span;
+  coef = expf(logf(ratio / (1.0f + ratio)) / (float)length);
+  base = asymptote * (1.0f - coef);
+}
+
+void NoteEnvelope::advanceStage() {
+  level = target;  // Remove accumulated rounding at the stage boundary
+
+  switch (stage) {
+    case ENV_ATTACK:
+      startSegment(ENV_DECAY, sustainLevel, SamplesFor(decayTime));
+      break;
+    case ENV_DECAY:
+      if (sustainLevel <= 0.0f) {
+        Reset();
+      } else {
+        stage = ENV_SUSTAIN;
+      }
+      break;
+    case ENV_RELEASE:
+      Reset();
+      break;
+    default:
+      break;
+  }
+}
@@ -0,0 +1,40 @@
+#include "PanTable.h"
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const double SQRT2 = 1.41421356237309504880;
+
+/**
+ * sin(x) for constant evaluation on [0, pi/2]: Taylor series, which
+ * converges to double precision well within the term limit there
+ */
+constexpr double constexprSin(double x) {
+  double term = x;
+  double sum = x;
+  for (int n = 1; n < 12; n++) {
+    term *= -x * x / ((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+constexpr PanGainTable makePanTable() {
+  PanGainTable table = {};
+  for (int i = 0; i <= PAN_TABLE_STEPS; i++) {
+    double theta = (PI / 2.0) * i / PAN_TABLE_STEPS;
+    table.left[i] = (float)(SQRT2 * constexprSin(PI / 2.0 - theta));
+    table.right[i] = (float)(SQRT2 * constexprSin(theta));
+  }
+  return table;
+}
+
+constexpr PanGainTable PAN_TABLE = makePanTable();
+static_assert(PAN_TABLE.left[PAN_TABLE_STEPS / 2] == 1.0f, "center must be unity");
+static_assert(PAN_TABLE.right[PAN_TABLE_STEPS / 2] == 1.0f, "center must be unity");
+static_assert(PAN_TABLE.right[0] == 0.0f && PAN_TABLE.left[PAN_TABLE_STEPS] < 1.0e-7f, "ends must be silent");
+
+}  // namespace
+
+// Constant-initialized: read-only data, no startup cost
+const PanGainTable panGainTable = PAN_TABLE;
@@ -0,0 +1,48 @@
+#include "PitchTable.h"
+
+namespace {
+
+/**
+ * 2^x for constant evaluation: split off the integer part, Taylor series
+ * for e^(frac * ln 2), which converges fast on [0, ln 2)
+ */
+constexpr double constexprExp2(double x) {
+  int whole = (int)x;
+  if ((double)whole > x) whole--;
+  double r = (x - whole) * 0.69314718055994530942;
+  double term = 1.0;
+  double sum = 1.0;
+  for (int n = 1; n < 24; n++) {
+    term *= r / n;
+    sum += term;
+  }
+  for (; whole > 0; whole--) sum *= 2.0;
+  for (; whole < 0; whole++) sum *= 0.5;
+  return sum;
+}
+
+constexpr NoteFrequencyTable makeNoteTable() {
+  NoteFrequencyTable table = {};
+  for (int i = 0; i < PITCH_TABLE_SIZE; i++) {
+    table.hz[i] = (float)(440.0 * constexprExp2((PITCH_NOTE_MIN + i - 69) / 12.0));
+  }
+  return table;
+}
+
+constexpr CentRatioTable makeCentTable() {
+  CentRatioTable table = {};
+  for (int c = 0; c <= PITCH_CENT_STEPS; c++) {
+    table.ratio[c] = (float)constexprExp2(c / (12.0 * PITCH_CENT_STEPS));
+  }
+  return table;
+}
+
+constexpr NoteFrequencyTable NOTE_TABLE = makeNoteTable();
+static_assert(NOTE_TABLE.hz[69 - PITCH_NOTE_MIN] == 440.0f, "A4 must be 440 Hz");
+static_assert(NOTE_TABLE.hz[81 - PITCH_NOTE_MIN] == 880.0f, "octaves must be exact");
+
+}  // namespace
+
+// Constant-initialized: read-only data, no startup cost
+const NoteFrequencyTable noteFrequencies = NOTE_TABLE;
+const CentRatioTable centRatios = makeCentTable();
@@ -0,0 +1,289 @@
+#include "PresetStore.h"
+
+#include <string.h>
+
+const uint8_t PRESET_MAGIC = 'P';
+const size_t RECORD_HEADER_SIZE = 8;
+const size_t RECORD_CRC_OFFSET = PRESET_RECORD_SIZE - 2;
+const int APPEND_ATTEMPTS = 3;   // Records skipped over bad cells before giving up
+
+static_assert(RECORD_HEADER_SIZE + PRESET_PAYLOAD_MAX == RECORD_CRC_OFFSET, "Record layout");
+
+/////////////////////
+// Encoding
+/////////////////////
+
+static void putU16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t getU16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void putU32(uint8_t *p, uint32_t v) {
+  putU16(p, (uint16_t)v);
+  putU16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint32_t getU32(const uint8_t *p) {
+  return (uint32_t)getU16(p) | ((uint32_t)getU16(p + 2) << 16);
+}
+
+static void putFloat(uint8_t *p, float v) {
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  putU32(p, bits);
+}
+
+static float getFloat(const uint8_t *p) {
+  uint32_t bits = getU32(p);
+  float v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+size_t encodeMusicalState(const MusicalState &state, uint8_t *payload) {
+  payload[0] = state.key;
+  payload[1] = state.scale;
+  payload[2] = state.octave;
+  payload[3] = state.latch ? 1 : 0;
+  payload[4] = state.arpPattern;
+  payload[5] = (uint8_t)state.windowOffset;
+  return 6;
+}
+
+void decodeMusicalState(const uint8_t *payload, size_t length, MusicalState &state) {
+  if (length >= 3) {
+    state.key = payload[0];
+    state.scale = payload[1];
+    state.octave = payload[2];
+  }
+  if (length >= 4) {
+    state.latch = (payload[3] & 1) != 0;
+  }
+  if (length >= 5) {
+    state.arpPattern = payload[4];
+  }
+  if (length >= 6) {
+    state.windowOffset = (int8_t)payload[5];
+  }
+}
+
+size_t encodeCalibration(const SensorCalibration &calibration, uint8_t *payload) {
+  putFloat(payload, calibration.accelCenterX);
+  putFloat(payload + 4, calibration.accelCenterY);
+  putU16(payload + 8, calibration.distanceMin);
+  putU16(payload + 10, calibration.distanceMax);
+  return 12;
+}
+
+void decodeCalibration(const uint8_t *payload, size_t length, SensorCalibration &calibration) {
+  if (length >= 8) {
+    calibration.accelCenterX = getFloat(payload);
+    calibration.accelCenterY = getFloat(payload + 4);
+  }
+  if (length >= 12) {
+    calibration.distanceMin = getU16(payload + 8);
+    calibration.distanceMax = getU16(payload + 10);
+  }
+}
+
+size_t encodeSensorConfig(const SensorConfig &config, uint8_t *payload) {
+  payload[0] = (uint8_t)((config.tof ? 1 : 0) | (config.accel ? 2 : 0));
+  payload[1] = config.tofAddress;
+  payload[2] = config.accelAddress;
+  return 3;
+}
+
+void decodeSensorConfig(const uint8_t *payload, size_t length, SensorConfig &config) {
+  if (length >= 3) {
+    config.tof = (payload[0] & 1) != 0;
+    config.accel = (payload[0] & 2) != 0;
+    config.tofAddress = payload[1];
+    config.accelAddress = payload[2];
+  }
+}
+
+/**
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), bitwise: records are
+ * tiny and only checked at boot and after a write
+ */
+uint16_t presetCrc16(const uint8_t *data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)(data[i] << 8);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+/////////////////////
+// Log
+/////////////////////
+
+/**
+ * Whether a record read from flash is valid; erased if it was never
+ * written (all 0xFF)
+ */
+static bool checkRecord(const uint8_t *record, bool &erased) {
+  erased = true;
+  for (size_t i = 0; i < PRESET_RECORD_SIZE; i++) {
+    if (record[i] != 0xFF) {
+      erased = false;
+      break;
+    }
+  }
+  return !erased && record[0] == PRESET_MAGIC && record[1] >= 1 && record[1] <= PRESET_FORMAT_VERSION &&
+         record[2] < NUM_RECORD_KINDS && record[3] <= PRESET_PAYLOAD_MAX &&
+         getU16(record + RECORD_CRC_OFFSET) == presetCrc16(record, RECORD_CRC_OFFSET);
+}
+
+bool PresetStore::Init(FlashMemory *memory, uint32_t baseAddress) {
+  flash = nullptr;
+  base = baseAddress;
+  sectorSize = memory->SectorSize();
+  writes = 0;
+  erases = 0;
+  found = 0;
+  uint32_t latestSequence[NUM_RECORD_KINDS];
+  for (int k = 0; k < NUM_RECORD_KINDS; k++) {
+    latest[k] = NO_RECORD;
+    latestSequence[k] = 0;
+  }
+
+  // Newest record per kind; the log continues after the newest of all
+  uint32_t newest = 0;
+  uint32_t newestSector = 0;
+  bool any = false;
+  uint32_t freeAddress[PRESET_FLASH_SECTORS];
+  uint8_t record[PRESET_RECORD_SIZE];
+  for (int s = 0; s < PRESET_FLASH_SECTORS; s++) {
+    uint32_t sectorStart = base + (uint32_t)s * sectorSize;
+    freeAddress[s] = sectorStart + sectorSize;
+    for (uint32_t address = sectorStart; address + PRESET_RECORD_SIZE <= sectorStart + sectorSize;
+         address += PRESET_RECORD_SIZE) {
+      if (!memory->Read(address, record, PRESET_RECORD_SIZE)) {
+        return false;
+      }
+      bool erased = false;
+      bool valid = checkRecord(record, erased);
+      if (erased) {
+        freeAddress[s] = address;  // Records are appended in order
+        break;
+      }
+      if (!valid) {
+        continue;  // Torn or foreign: skipped
+      }
+      found++;
+      uint8_t kind = record[2];
+      uint32_t seq = getU32(record + 4);
+      if (latest[kind] == NO_RECORD || seq > latestSequence[kind]) {
+        latest[kind] = address;
+        latestSequence[kind] = seq;
+      }
+      if (!any || seq > newest) {
+        newest = seq;
+        newestSector = (uint32_t)s;
+        any = true;
+      }
+    }
+  }
+  flash = memory;
+  sequence = any ? newest + 1 : 0;
+  sectorStart = base + newestSector * sectorSize;
+  writeAddress = freeAddress[newestSector];
+  return true;
+}
+
+bool PresetStore::Load(PresetRecordKind kind, uint8_t *payload, size_t &length) {
+  if (!flash || kind >= NUM_RECORD_KINDS || latest[kind] == NO_RECORD) {
+    return false;
+  }
+  uint8_t record[PRESET_RECORD_SIZE];
+  bool erased = false;
+  if (!flash->Read(latest[kind], record, PRESET_RECORD_SIZE) || !checkRecord(record, erased)) {
+    return false;
+  }
+  length = record[3];
+  memcpy(payload, record + RECORD_HEADER_SIZE, length);
+  return true;
+}
+
+/**
+ * Move the log to the next sector: erase it, then rewrite the newest
+ * record of every kind that was only there
+ */
+bool PresetStore::nextSector() {
+  uint32_t next = ((sectorStart - base) / sectorSize + 1) % PRESET_FLASH_SECTORS;
+  uint32_t start = base + next * sectorSize;
+
+  uint8_t carried[NUM_RECORD_KINDS][PRESET_PAYLOAD_MAX];
+  size_t carriedLength[NUM_RECORD_KINDS];
+  bool carry[NUM_RECORD_KINDS];
+  for (int k = 0; k < NUM_RECORD_KINDS; k++) {
+    carry[k] = latest[k] != NO_RECORD && latest[k] >= start && latest[k] < start + sectorSize &&
+               Load((PresetRecordKind)k, carried[k], carriedLength[k]);
+  }
+
+  if (!flash->EraseSector(start)) {
+    return false;
+  }
+  erases++;
+  sectorStart = start;
+  writeAddress = start;
+  for (int k = 0; k < NUM_RECORD_KINDS; k++) {
+    if (latest[k] >= start && latest[k] < start + sectorSize) {
+      latest[k] = NO_RECORD;  // Erased; back once carried
+    }
+  }
+  for (int k = 0; k < NUM_RECORD_KINDS; k++) {
+    if (carry[k] && !append((PresetRecordKind)k, carried[k], carriedLength[k])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PresetStore::append(PresetRecordKind kind, const uint8_t *payload, size_t length) {
+  uint8_t record[PRESET_RECORD_SIZE];
+  memset(record, 0xFF, sizeof(record));
+  record[0] = PRESET_MAGIC;
+  record[1] = PRESET_FORMAT_VERSION;
+  record[2] = kind;
+  record[3] = (uint8_t)length;
+  memcpy(record + RECORD_HEADER_SIZE, payload, length);
+
+  for (int attempt = 0; attempt < APPEND_ATTEMPTS; attempt++) {
+    if (writeAddress + PRESET_RECORD_SIZE > sectorStart + sectorSize) {
+      if (!nextSector()) {
+        return false;
+      }
+    }
+    putU32(record + 4, sequence);
+    putU16(record + RECORD_CRC_OFFSET, presetCrc16(record, RECORD_CRC_OFFSET));
+    uint32_t address = writeAddress;
+    writeAddress += PRESET_RECORD_SIZE;
+    sequence++;
+
+    // Verify: a slot that does not read back is left behind (its CRC fails)
+    uint8_t check[PRESET_RECORD_SIZE];
+    if (flash->Program(address, record, PRESET_RECORD_SIZE) && flash->Read(address, check, PRESET_RECORD_SIZE) &&
+        memcmp(check, record, PRESET_RECORD_SIZE) == 0) {
+      latest[kind] = address;
+      writes++;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PresetStore::Save(PresetRecordKind kind, const uint8_t *payload, size_t length) {
+  if (!flash || kind >= NUM_RECORD_KINDS || length > PRESET_PAYLOAD_MAX) {
+    return false;
+  }
+  return append(kind, payload, length);
+}
@@ -0,0 +1,38 @@
+#include "QspiFlash.h"
+
+#include <string.h>
+
+bool QspiFlash::Init() {
+  daisy::QSPIHandle::Config config;
+  config.device = daisy::QSPIHandle::Config::IS25LP064A;
+  config.mode = daisy::QSPIHandle::Config::MEMORY_MAPPED;
+  config.pin_config.io0 = dsy_pin(DSY_GPIOF, 8);
+  config.pin_config.io1 = dsy_pin(DSY_GPIOF, 9);
+  config.pin_config.io2 = dsy_pin(DSY_GPIOF, 7);
+  config.pin_config.io3 = dsy_pin(DSY_GPIOF, 6);
+  config.pin_config.clk = dsy_pin(DSY_GPIOF, 10);
+  config.pin_config.ncs = dsy_pin(DSY_GPIOG, 6);
+  ready = qspi.Init(config) == daisy::QSPIHandle::OK;
+  return ready;
+}
+
+bool QspiFlash::Read(uint32_t address, uint8_t *dst, size_t n) {
+  if (!ready || address + n > QSPI_FLASH_SIZE) {
+    return false;
+  }
+  uint8_t *mapped = (uint8_t *)qspi.GetData(address);
+  // Whole cache lines (32 bytes) around the range
+  uintptr_t start = (uintptr_t)mapped & ~(uintptr_t)31;
+  SCB_InvalidateDCache_by_Addr((uint32_t *)start, (int32_t)((uintptr_t)mapped + n - start + 31) & ~31);
+  memcpy(dst, mapped, n);
+  return true;
+}
+
+bool QspiFlash::EraseSector(uint32_t address) {
+  return ready && address < QSPI_FLASH_SIZE && qspi.EraseSector(address) == daisy::QSPIHandle::OK;
+}
+
+bool QspiFlash::Program(uint32_t address, const uint8_t *src, size_t n) {
+  return ready && address + n <= QSPI_FLASH_SIZE &&
+         qspi.Write(address, (uint32_t)n, const_cast<uint8_t *>(src)) == daisy::QSPIHandle::OK;
+}
@@ -0,0 +1,33 @@
+#include "Scales.h"
+
+const ScaleDef scaleRegistry[NUM_SCALES] = {
+  {"Major Pentatonic", 12, {0, 2, 4, 7, 9}},          // C, D, E, G, A
+  {"Blues", 12, {0, 3, 5, 6, 7}},                     // C, Eb, F, F#, G
+  {"Chromatic", 12, {0, 1, 2, 3, 4}},                 // C, C#, D, D#, E
+  {"19-EDO Pentatonic", 19, {0, 3, 6, 11, 14}},       // Just-leaning thirds and sixths
+  {"Quarter-tone", 24, {0, 1, 2, 3, 4}},              // C, C+, C#, C#+, D
+};
+
+const ScaleDef &scaleDef(int scale) {
+  return (scale >= 0 && scale < NUM_SCALES) ? scaleRegistry[scale] : scaleRegistry[0];
+}
+
+const ChordDef chordRegistry[NUM_CHORDS] = {
+  {"Single Note", 1, {0.0f}},
+  {"Major Chord", 3, {0.0f, 4.0f, 7.0f}},            // Root, major third, fifth
+  {"Minor Chord", 3, {0.0f, 3.0f, 7.0f}},            // Root, minor third, fifth
+};
+
+const ChordDef &chordDef(int chord) {
+  return (chord >= 0 && chord < NUM_CHORDS) ? chordRegistry[chord] : chordRegistry[0];
+}
+
+void computeScaleNotes(int octave, int key, int scale, int windowOffset, float pitches[SCALE_LENGTH]) {
+  int baseNote = (octave * 12) + key + windowOffset;
+
+  const ScaleDef &def = scaleDef(scale);
+  float semitonesPerStep = 12.0f / (float)def.stepsPerOctave;
+  for (int i = 0; i < SCALE_LENGTH; i++) {
+    pitches[i] = (float)baseNote + (float)def.steps[i] * semitonesPerStep;
+  }
+}
@@ -0,0 +1,152 @@
+#include "SensorPipeline.h"
+
+// VL53L0X registers (same raw sequence as Pololu's readRangeContinuousMillimeters)
+const uint8_t VL53L0X_SYSTEM_INTERRUPT_CLEAR = 0x0B;
+const uint8_t VL53L0X_RESULT_INTERRUPT_STATUS = 0x13;
+const uint8_t VL53L0X_RESULT_RANGE_STATUS = 0x14;
+const uint8_t VL53L0X_RESULT_LENGTH = 12;           // Status byte .. range at +10
+const uint8_t VL53L0X_DEVICE_RANGE_VALID = 11;
+
+// MSA301 registers; the Adafruit driver leaves it at 14-bit, +-4g
+const uint8_t MSA301_REG_OUT_X_L = 0x02;
+const float MSA301_LSB_PER_G = 2048.0f;
+const float STANDARD_GRAVITY = 9.80665f;
+
+// Polling fallback: no interrupt for this many periods, poll this often
+const uint32_t TOF_IRQ_TIMEOUT_PERIODS = 4;
+const uint32_t TOF_POLL_DIVISOR = 4;
+
+float accelFromCounts(int16_t counts) {
+  return (float)counts / MSA301_LSB_PER_G * STANDARD_GRAVITY;
+}
+
+int16_t accelToCounts(float value) {
+  float counts = value / STANDARD_GRAVITY * MSA301_LSB_PER_G;
+  return (int16_t)(counts < 0.0f ? counts - 0.5f : counts + 0.5f);
+}
+
+enum SensorTag : uint8_t {
+  TAG_TOF_STATUS,
+  TAG_TOF_RESULT,
+  TAG_TOF_CLEAR,
+  TAG_ACCEL_DATA
+};
+
+void SensorPipeline::Init(I2cBus *i2c) {
+  bus.Init(i2c, onComplete, this);
+  tofEnabled = false;
+  accelEnabled = false;
+}
+
+void SensorPipeline::EnableTof(uint8_t address, uint32_t periodMicros, bool useInterrupt, uint32_t nowMicros) {
+  tofAddress = address;
+  tofPeriod = periodMicros;
+  tofUseInterrupt = useInterrupt;
+  tofPolling = !useInterrupt;
+  tofInFlight = false;
+  tofLastSample = nowMicros;
+  tofLastPoll = nowMicros;
+  tofEnabled = true;
+}
+
+void SensorPipeline::EnableAccel(uint8_t address, uint32_t intervalMicros) {
+  accelAddress = address;
+  accelInterval = intervalMicros;
+  accelInFlight = false;
+  accelEnabled = true;
+}
+
+void SensorPipeline::OnTofDataReady(uint32_t nowMicros) {
+  tofIrqMicros.store(nowMicros, std::memory_order_relaxed);
+  tofIrq.store(true, std::memory_order_release);
+}
+
+void SensorPipeline::submit(const I2cTransaction &t, uint32_t nowMicros) {
+  bus.Submit(t, nowMicros);
+}
+
+void SensorPipeline::Service(uint32_t nowMicros) {
+  if (tofEnabled && !tofInFlight) {
+    if (tofIrq.exchange(false, std::memory_order_acquire)) {
+      // Data ready: read the result straight away
+      tofPolling = !tofUseInterrupt;
+      tofReadyMicros = tofIrqMicros.load(std::memory_order_relaxed);
+      tofInFlight = true;
+      submit(i2cReadRegisters(tofAddress, VL53L0X_RESULT_RANGE_STATUS, VL53L0X_RESULT_LENGTH, TAG_TOF_RESULT), nowMicros);
+    } else {
+      if (!tofPolling && nowMicros - tofLastSample > tofPeriod * TOF_IRQ_TIMEOUT_PERIODS) {
+        tofPolling = true;  // Interrupt silent: poll until it comes back
+      }
+      if (tofPolling && nowMicros - tofLastPoll >= tofPeriod / TOF_POLL_DIVISOR) {
+        tofLastPoll = nowMicros;
+        tofInFlight = true;
+        submit(i2cReadRegisters(tofAddress, VL53L0X_RESULT_INTERRUPT_STATUS, 1, TAG_TOF_STATUS), nowMicros);
+      }
+    }
+  }
+
+  if (accelEnabled && !accelInFlight && nowMicros - accelLastRequest >= accelInterval) {
+    accelLastRequest = nowMicros;
+    accelInFlight = true;
+    submit(i2cReadRegisters(accelAddress, MSA301_REG_OUT_X_L, 6, TAG_ACCEL_DATA), nowMicros);
+  }
+
+  bus.Service(nowMicros);
+}
+
+void SensorPipeline::onComplete(void *context, const I2cTransaction &t) {
+  static_cast<SensorPipeline *>(context)->handleCompletion(t);
+}
+
+void SensorPipeline::handleCompletion(const I2cTransaction &t) {
+  bool ok = t.status == I2C_DONE;
+  uint32_t now = t.completedMicros;
+
+  switch (t.tag) {
+    case TAG_TOF_STATUS:
+      if (ok && (t.rx[0] & 0x07) != 0) {
+        tofReadyMicros = now;
+        submit(i2cReadRegisters(tofAddress, VL53L0X_RESULT_RANGE_STATUS, VL53L0X_RESULT_LENGTH, TAG_TOF_RESULT), now);
+      } else {
+        tofInFlight = false;
+      }
+      break;
+
+    case TAG_TOF_RESULT:
+      if (ok) {
+        SensorSample sample;
+        uint8_t deviceStatus = (t.rx[0] & 0x78) >> 3;
+        sample.kind = SENSOR_TOF;
+        sample.status = deviceStatus == VL53L0X_DEVICE_RANGE_VALID ? 0 : deviceStatus;
+        sample.timestampMicros = tofReadyMicros;
+        sample.value[0] = (float)(((uint16_t)t.rx[10] << 8) | t.rx[11]);
+        sample.value[1] = 0.0f;
+        sample.value[2] = 0.0f;
+        samples.Push(sample);
+        tofLastSample = now;
+      }
+      // Clear even after an error so GPIO1 can signal the next range
+      submit(i2cWriteRegister(tofAddress, VL53L0X_SYSTEM_INTERRUPT_CLEAR, 0x01, TAG_TOF_CLEAR), now);
+      break;
+
+    case TAG_TOF_CLEAR:
+      tofInFlight = false;
+      break;
+
+    case TAG_ACCEL_DATA:
+      if (ok) {
+        SensorSample sample;
+        sample.kind = SENSOR_ACCEL;
+        sample.status = 0;
+        sample.timestampMicros = now;
+        for (int axis = 0; axis < 3; axis++) {
+          // 14-bit, left-justified, LSB first
+          int16_t raw = (int16_t)(((uint16_t)t.rx[axis * 2 + 1] << 8) | t.rx[axis * 2]);
+          sample.value[axis] = accelFromCounts((int16_t)(raw >> 2));
+        }
+        samples.Push(sample);
+      }
+      accelInFlight = false;
+      break;
+  }
+}
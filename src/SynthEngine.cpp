@@ -0,0 +1,620 @@
+#include "SynthEngine.h"
+
+#include <math.h>
+
+#include "MemoryPlacement.h"
+#include "PanTable.h"
+#include "PitchTable.h"
+
+const float BEND_SMOOTHING = 0.2f;    // One-pole coefficient per block
+const float PITCH_EPSILON = 0.0005f;  // Glides snap to target within this (semitones)
+const float OUTPUT_HEADROOM = 0.4f;   // Fixed gain before the soft clipper
+const float PAN_SMOOTHING = 0.2f;     // One-pole coefficient per block
+const float PAN_EPSILON = 0.001f;     // Pan glides snap to target within this
+
+void SynthEngine::Init(float sr) {
+  sampleRate = sr;
+  wavetables.Generate();
+  effects.Init(sampleRate);
+  arp.Init(sampleRate);
+  for (int i = 0; i < NUM_VOICES; i++) {
+    osc[i].Init(&wavetables, sampleRate);
+    envelopes[i].Init(sampleRate);
+  }
+  for (int i = 0; i <= NUM_VOICES; i++) {
+    polyGainTable[i] = i > 1 ? 1.0f / sqrtf((float)i) : 1.0f;
+  }
+  polyGain = 1.0f;
+
+  // Every voice starts on the free list, every note id unmapped
+  for (int i = 0; i < NUM_LISTS; i++) {
+    listHead[i] = -1;
+    listTail[i] = -1;
+  }
+  for (int i = 0; i < MAX_NOTE_IDS; i++) {
+    noteVoice[i] = -1;
+    notePan[i] = 0.0f;
+  }
+  panOffset = 0.0f;
+  for (int i = 0; i < NUM_VOICES; i++) {
+    voiceNote[i] = -1;
+    voiceStatus[i].store(0xFF, std::memory_order_relaxed);
+    voiceStartDelay[i] = 0;
+    voiceReleaseDelay[i] = -1;
+    panTarget[i] = 0.0f;
+    panCurrent[i] = 0.0f;
+    panToGains(0.0f, panGainLeft[i], panGainRight[i]);
+    listPush(LIST_FREE, i);
+  }
+  heldFirst = 0;
+  heldCount = 0;
+  stolen = 0;
+  lateEvents = 0;
+  for (int i = 0; i < NUM_FADE_SLOTS; i++) {
+    fades[i].osc.Init(&wavetables, sampleRate);
+    fades[i].gain = 0.0f;
+    fades[i].step = 0.0f;
+    fades[i].remaining = 0;
+  }
+}
+
+void SynthEngine::SetEnvelope(float attack, float decay, float sustain, float release, EnvelopeCurve curve) {
+  // Called from setup() before audio starts; PARAM_ATTACK etc. change the
+  // times later
+  attackTime = attack;
+  decayTime = decay;
+  sustainLevel = sustain;
+  releaseTime = release;
+  setEnvelopeTimes();
+  for (int i = 0; i < NUM_VOICES; i++) {
+    envelopes[i].SetCurve(curve);
+  }
+}
+
+void SynthEngine::setEnvelopeTimes() {
+  for (int i = 0; i < NUM_VOICES; i++) {
+    envelopes[i].SetTimes(attackTime, decayTime, sustainLevel, releaseTime);
+  }
+}
+
+VoiceStatus SynthEngine::Voice(int voice) const {
+  uint32_t packed = voiceStatus[voice].load(std::memory_order_relaxed);
+  VoiceStatus status;
+  status.note = (packed & 0xFF) == 0xFF ? -1 : (int)(packed & 0xFF);
+  status.stage = (EnvelopeStage)((packed >> 8) & 0xFF);
+  status.level = (float)(packed >> 16) / 65535.0f;
+  return status;
+}
+
+void SynthEngine::SetEffectsBudget(float budget, float ticksPerMicro) {
+  effects.SetCpuBudget(budget, ticksPerMicro * 1.0e6f / sampleRate);
+}
+
+static inline float clampPan(float pan) {
+  return pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+}
+
+/**
+ * Queue an event for the audio callback
+ * Never blocks; if the queue is full the event is dropped (and counted)
+ */
+void SynthEngine::post(SynthEventType type, int note, uint8_t param, float value) {
+  SynthEvent evt;
+  evt.type = type;
+  evt.note = (uint8_t)note;
+  evt.param = param;
+  evt.timed = false;
+  evt.value = value;
+  evt.timeMicros = 0;
+  events.Push(evt);
+}
+
+void SynthEngine::postAt(SynthEventType type, int note, float value, uint32_t timeMicros) {
+  SynthEvent evt;
+  evt.type = type;
+  evt.note = (uint8_t)note;
+  evt.param = 0;
+  evt.timed = true;
+  evt.value = value;
+  evt.timeMicros = timeMicros;
+  events.Push(evt);
+}
+
+void SynthEngine::NoteOn(int note, float pitch) {
+  post(EVT_NOTE_ON, note, 0, pitch);
+}
+
+void SynthEngine::NoteOn(int note, float pitch, uint32_t timeMicros) {
+  postAt(EVT_NOTE_ON, note, pitch, timeMicros);
+}
+
+void SynthEngine::NoteOff(int note) {
+  post(EVT_NOTE_OFF, note, 0, 0.0f);
+}
+
+void SynthEngine::NoteOff(int note, uint32_t timeMicros) {
+  postAt(EVT_NOTE_OFF, note, 0.0f, timeMicros);
+}
+
+void SynthEngine::SetNotePitch(int note, float pitch) {
+  post(EVT_SET_PITCH, note, 0, pitch);
+}
+
+void SynthEngine::SetNotePan(int note, float pan) {
+  post(EVT_SET_PAN, note, 0, pan);
+}
+
+void SynthEngine::SetParam(SynthParam param, float value) {
+  post(EVT_SET_PARAM, 0, param, value);
+}
+
+void SynthEngine::ArpHold(int note, float pitch, uint32_t timeMicros) {
+  postAt(EVT_ARP_HOLD, note, pitch, timeMicros);
+}
+
+void SynthEngine::ArpRelease(int note, uint32_t timeMicros) {
+  postAt(EVT_ARP_RELEASE, note, 0.0f, timeMicros);
+}
+
+/////////////////////
+// Voice Pool (audio side only)
+/////////////////////
+
+void SynthEngine::listRemove(int voice) {
+  int list = voiceList[voice];
+  int prev = voicePrev[voice];
+  int next = voiceNext[voice];
+  if (prev >= 0) {
+    voiceNext[prev] = (int8_t)next;
+  } else {
+    listHead[list] = (int8_t)next;
+  }
+  if (next >= 0) {
+    voicePrev[next] = (int8_t)prev;
+  } else {
+    listTail[list] = (int8_t)prev;
+  }
+}
+
+/**
+ * Append at the tail, so every list stays ordered oldest first
+ */
+void SynthEngine::listPush(VoiceList list, int voice) {
+  voiceList[voice] = list;
+  voicePrev[voice] = listTail[list];
+  voiceNext[voice] = -1;
+  if (listTail[list] >= 0) {
+    voiceNext[listTail[list]] = (int8_t)voice;
+  } else {
+    listHead[list] = (int8_t)voice;
+  }
+  listTail[list] = (int8_t)voice;
+}
+
+/**
+ * Take a voice for a new note: a free one, else the voice released longest
+ * ago (the quietest tail), else the oldest held note
+ */
+int SynthEngine::allocateVoice() {
+  int voice = listHead[LIST_FREE];
+  if (voice < 0) {
+    voice = listHead[LIST_RELEASING] >= 0 ? listHead[LIST_RELEASING] : listHead[LIST_HELD];
+    stealVoice(voice);
+  }
+  listRemove(voice);
+  return voice;
+}
+
+/**
+ * Start a held voice's release (now, or delay samples into the render);
+ * its note id no longer owns it
+ */
+void SynthEngine::releaseVoice(int voice, int32_t delay) {
+  if (delay > 0) {
+    voiceReleaseDelay[voice] = delay;
+  } else {
+    envelopes[voice].Release();
+  }
+  noteVoice[voiceNote[voice]] = -1;
+  voiceNote[voice] = -1;
+  listRemove(voice);
+  listPush(LIST_RELEASING, voice);
+}
+
+/**
+ * Hand a sounding voice's oscillator to a fade slot, which ramps it to
+ * silence from the current envelope level while the voice is reused
+ */
+void SynthEngine::stealVoice(int voice) {
+  stolen++;
+  if (voiceNote[voice] >= 0) {
+    noteVoice[voiceNote[voice]] = -1;
+    voiceNote[voice] = -1;
+  }
+
+  // All slots busy: cut the one closest to silence
+  int slot = 0;
+  for (int i = 1; i < NUM_FADE_SLOTS; i++) {
+    if (fades[i].remaining < fades[slot].remaining) {
+      slot = i;
+    }
+  }
+  FadeSlot &fade = fades[slot];
+  fade.osc = osc[voice];
+  fade.panLeft = panGainLeft[voice];
+  fade.panRight = panGainRight[voice];
+  fade.gain = envelopes[voice].Level();
+  fade.step = fade.gain / (float)STEAL_FADE_SAMPLES;
+  fade.remaining = STEAL_FADE_SAMPLES;
+}
+
+void SynthEngine::startNote(int note, float pitch, int32_t delay) {
+  if (noteVoice[note] >= 0) {
+    // Same id again: the old voice rings out, the new note gets its own
+    releaseVoice(noteVoice[note], delay);
+  }
+
+  int voice = allocateVoice();
+  noteVoice[note] = (int8_t)voice;
+  voiceNote[voice] = (int8_t)note;
+  listPush(LIST_HELD, voice);
+
+  // New notes start on pitch; only later pitch changes glide
+  pitchTarget[voice] = pitch;
+  pitchCurrent[voice] = pitch;
+  pitchRendered[voice] = pitch + bendSmoothed;
+  osc[voice].SetFreq(pitchToFreq(pitchRendered[voice]));
+  osc[voice].SetMorph(morphCurrent);
+  osc[voice].Reset();
+  // New notes start at their pan position too
+  panTarget[voice] = notePan[note];
+  panCurrent[voice] = clampPan(panTarget[voice] + panOffset);
+  panToGains(panCurrent[voice], panGainLeft[voice], panGainRight[voice]);
+  envelopes[voice].Reset();
+  envelopes[voice].Trigger();
+  voiceStartDelay[voice] = delay;
+  voiceReleaseDelay[voice] = -1;
+}
+
+/**
+ * Apply one control event (audio side only); notes take effect offset
+ * samples into the render
+ */
+void SynthEngine::applyEvent(const SynthEvent &evt, int32_t offset) {
+  if (evt.type != EVT_SET_PARAM && evt.note >= MAX_NOTE_IDS) {
+    return;
+  }
+  switch (evt.type) {
+    case EVT_NOTE_ON:
+      startNote(evt.note, evt.value, offset);
+      break;
+    case EVT_NOTE_OFF:
+      if (noteVoice[evt.note] >= 0) {
+        releaseVoice(noteVoice[evt.note], offset);
+      }
+      break;
+    case EVT_SET_PITCH:
+      if (noteVoice[evt.note] >= 0) {
+        pitchTarget[noteVoice[evt.note]] = evt.value;
+      }
+      arp.SetPitch(evt.note, evt.value);
+      break;
+    case EVT_SET_PAN:
+      notePan[evt.note] = evt.value;
+      if (noteVoice[evt.note] >= 0) {
+        panTarget[noteVoice[evt.note]] = evt.value;
+      }
+      break;
+    case EVT_ARP_HOLD:
+      arp.Hold(evt.note, evt.value, offset);
+      break;
+    case EVT_ARP_RELEASE:
+      arp.Release(evt.note, offset);
+      break;
+    case EVT_SET_PARAM:
+      if (evt.param == PARAM_VOLUME) {
+        // Linear ramp over volumeRamp, like the morph: successive control
+        // values join into one gain curve with no steps
+        volume = evt.value;
+        float rampSamples = volumeRamp * sampleRate;
+        volumeStep = fabsf(volume - volumeCurrent) / (rampSamples > 1.0f ? rampSamples : 1.0f);
+      } else if (evt.param == PARAM_VOLUME_RAMP) {
+        volumeRamp = evt.value > 0.0f ? evt.value : 0.0f;
+      } else if (evt.param == PARAM_MORPH) {
+        // Ramp linearly to the new target over morphRamp: a control-rate
+        // stream of targets becomes one continuous sweep, block by block
+        morph = evt.value;
+        float rampSamples = morphRamp * sampleRate;
+        morphStep = fabsf(morph - morphCurrent) / (rampSamples > 1.0f ? rampSamples : 1.0f);
+      } else if (evt.param == PARAM_MORPH_RAMP) {
+        morphRamp = evt.value > 0.0f ? evt.value : 0.0f;
+      } else if (evt.param == PARAM_BEND) {
+        bend = evt.value;
+      } else if (evt.param == PARAM_GLIDE) {
+        glideTime = evt.value > 0.0f ? evt.value : 0.0f;
+        glideBlockSize = 0;  // Recompute the per-block coefficient
+      } else if (evt.param == PARAM_DELAY_MIX) {
+        effects.SetDelayMix(evt.value);
+      } else if (evt.param == PARAM_REVERB_MIX) {
+        effects.SetReverbMix(evt.value);
+      } else if (evt.param == PARAM_REVERB_DECAY) {
+        effects.SetReverbDecay(evt.value);
+      } else if (evt.param == PARAM_PAN_OFFSET) {
+        panOffset = evt.value;
+      } else if (evt.param == PARAM_ARP_PATTERN) {
+        arp.SetPattern((ArpPattern)evt.value);
+      } else if (evt.param == PARAM_ARP_RATE) {
+        arp.SetRate(evt.value);
+      } else if (evt.param == PARAM_ATTACK) {
+        attackTime = evt.value > 0.0f ? evt.value : 0.0f;
+        setEnvelopeTimes();
+      } else if (evt.param == PARAM_DECAY) {
+        decayTime = evt.value > 0.0f ? evt.value : 0.0f;
+        setEnvelopeTimes();
+      } else if (evt.param == PARAM_SUSTAIN) {
+        sustainLevel = evt.value;  // Clamped by the envelope
+        setEnvelopeTimes();
+      } else if (evt.param == PARAM_RELEASE) {
+        releaseTime = evt.value > 0.0f ? evt.value : 0.0f;
+        setEnvelopeTimes();
+      }
+      break;
+  }
+}
+
+/**
+ * Advance one voice's glide by a block and hand the block-end frequency to
+ * its oscillator, which ramps to it per sample
+ */
+ITCM_CODE void SynthEngine::updatePitch(int voice, float glide) {
+  float diff = pitchCurrent[voice] - pitchTarget[voice];
+  if (diff != 0.0f) {
+    diff *= glide;
+    if (fabsf(diff) < PITCH_EPSILON) {
+      diff = 0.0f;
+    }
+    pitchCurrent[voice] = pitchTarget[voice] + diff;
+  }
+
+  float pitch = pitchCurrent[voice] + bendSmoothed;
+  if (pitch != pitchRendered[voice]) {
+    pitchRendered[voice] = pitch;
+    osc[voice].SetFreqTarget(pitchToFreq(pitch));
+  }
+}
+
+/**
+ * Advance one voice's pan glide by a block; left/right get the block-end
+ * gains (the previous block's end gains are where the ramp starts)
+ */
+ITCM_CODE void SynthEngine::updatePan(int voice, float &left, float &right) {
+  float target = clampPan(panTarget[voice] + panOffset);
+  float pan = panCurrent[voice];
+  if (pan != target) {
+    pan += (target - pan) * PAN_SMOOTHING;
+    if (fabsf(target - pan) < PAN_EPSILON) {
+      pan = target;
+    }
+    panCurrent[voice] = pan;
+    panToGains(pan, panGainLeft[voice], panGainRight[voice]);
+  }
+  left = panGainLeft[voice];
+  right = panGainRight[voice];
+}
+
+/**
+ * Render up to MAX_BLOCK_SIZE samples of the stereo mix into left/right
+ * Only voices on the held and releasing lists are visited
+ */
+ITCM_CODE void SynthEngine::renderBlock(float *left, float *right, size_t n) {
+  dspClear(left, n);
+  dspClear(right, n);
+  int activeNotes = 0;
+
+  // One-pole glide over n samples: exp(-n / (time * rate)), cached per block size
+  if (n != glideBlockSize) {
+    glideBlockSize = n;
+    glideBlockCoef = glideTime > 0.0f ? expf(-(float)n / (glideTime * sampleRate)) : 0.0f;
+  }
+  bendSmoothed += (bend - bendSmoothed) * BEND_SMOOTHING;
+  if (fabsf(bend - bendSmoothed) < PITCH_EPSILON) {
+    bendSmoothed = bend;
+  }
+  float morphMove = morphStep * (float)n;
+  if (fabsf(morph - morphCurrent) <= morphMove) {
+    morphCurrent = morph;
+  } else {
+    morphCurrent += morph > morphCurrent ? morphMove : -morphMove;
+  }
+
+  for (int list = LIST_HELD; list <= LIST_RELEASING; list++) {
+    int j = listHead[list];
+    while (j >= 0) {
+      int next = voiceNext[j];  // j may move to the free list below
+
+      // Timed notes: silent until their start, released mid-block
+      size_t start = (size_t)voiceStartDelay[j] < n ? (size_t)voiceStartDelay[j] : n;
+      voiceStartDelay[j] -= (int32_t)start;
+      size_t release = n;
+      if (voiceReleaseDelay[j] >= 0) {
+        size_t at = (size_t)voiceReleaseDelay[j] > start ? (size_t)voiceReleaseDelay[j] : start;
+        if (at < n) {
+          release = at;
+          voiceReleaseDelay[j] = -1;
+        } else {
+          voiceReleaseDelay[j] = (int32_t)(at - n);
+        }
+      }
+
+      if (start < n) {
+        activeNotes++;  // A timed note still waiting for its start does not count yet
+        updatePitch(j, glideBlockCoef);
+        envelopes[j].ProcessBlock(envBuffer + start, release - start);
+        if (release < n) {
+          envelopes[j].Release();
+          envelopes[j].ProcessBlock(envBuffer + release, n - release);
+        }
+        osc[j].SetMorphTarget(morphCurrent);  // Ramped per sample inside the block
+        osc[j].ProcessBlock(voiceBuffer + start, n - start);
+        float leftStart = panGainLeft[j];
+        float rightStart = panGainRight[j];
+        float leftEnd, rightEnd;
+        updatePan(j, leftEnd, rightEnd);
+        dspMultiplyPanAccumulate(left + start, right + start, voiceBuffer + start, envBuffer + start,
+                                 leftStart, leftEnd, rightStart, rightEnd, n - start);
+      }
+      if (!envelopes[j].IsActive()) {
+        if (voiceNote[j] >= 0) {
+          noteVoice[voiceNote[j]] = -1;
+          voiceNote[j] = -1;
+        }
+        listRemove(j);
+        listPush(LIST_FREE, j);
+      }
+      j = next;
+    }
+  }
+
+  // Stolen voices fade out on their own oscillator copy
+  for (int i = 0; i < NUM_FADE_SLOTS; i++) {
+    FadeSlot &fade = fades[i];
+    if (fade.remaining <= 0) {
+      continue;
+    }
+    size_t k = (size_t)fade.remaining < n ? (size_t)fade.remaining : n;
+    float end = fade.gain - fade.step * (float)k;
+    if (end < 0.0f) {
+      end = 0.0f;
+    }
+    fade.osc.ProcessBlock(voiceBuffer, k);
+    dspScaleRamp(voiceBuffer, fade.gain, end, k);
+    dspScaleAccumulate(left, voiceBuffer, fade.panLeft, k);
+    dspScaleAccumulate(right, voiceBuffer, fade.panRight, k);
+    fade.gain = end;
+    fade.remaining -= (int)k;
+  }
+
+  // Volume moves along its ramp by this block's length; polyphony
+  // compensation (quieter as more notes play) moves to this block's voice
+  // count. Both are folded into one gain ramped per sample across the
+  // block, so neither steps.
+  float startGain = volumeCurrent * polyGain;
+  float volumeMove = volumeStep * (float)n;
+  if (fabsf(volume - volumeCurrent) <= volumeMove) {
+    volumeCurrent = volume;
+  } else {
+    volumeCurrent += volume > volumeCurrent ? volumeMove : -volumeMove;
+  }
+  polyGain = polyGainTable[activeNotes];
+  dspScaleRamp(left, startGain * OUTPUT_HEADROOM, volumeCurrent * polyGain * OUTPUT_HEADROOM, n);
+  dspScaleRamp(right, startGain * OUTPUT_HEADROOM, volumeCurrent * polyGain * OUTPUT_HEADROOM, n);
+}
+
+/**
+ * Sample offset of a timed event in this render of size samples; false if
+ * it is due in a later one
+ */
+ITCM_CODE bool SynthEngine::eventOffset(const SynthEvent &evt, size_t size, uint32_t blockMicros,
+                                        int32_t &offset) {
+  offset = 0;
+  int32_t ahead = (int32_t)(evt.timeMicros - blockMicros);
+  if (ahead < 0) {
+    lateEvents++;
+  } else if ((uint32_t)ahead < MAX_SCHEDULE_AHEAD_MICROS) {
+    uint32_t sample = (uint32_t)((float)ahead * sampleRate * 1.0e-6f);
+    if (sample >= size) {
+      return false;
+    }
+    offset = (int32_t)sample;
+  }
+  return true;
+}
+
+ITCM_CODE void SynthEngine::holdEvent(const SynthEvent &evt) {
+  heldEvents[(heldFirst + heldCount) % MAX_HELD_EVENTS] = evt;
+  heldCount++;
+}
+
+/**
+ * Apply every event due in this render of size samples. A timed event due
+ * later is held, and the timed events queued behind it wait with it so
+ * notes keep their order; untimed events apply now, whatever is held.
+ */
+ITCM_CODE void SynthEngine::drainEvents(size_t size, uint32_t blockMicros) {
+  int32_t offset = 0;
+  while (heldCount > 0 && eventOffset(heldEvents[heldFirst], size, blockMicros, offset)) {
+    applyEvent(heldEvents[heldFirst], offset);
+    heldFirst = (heldFirst + 1) % MAX_HELD_EVENTS;
+    heldCount--;
+  }
+
+  // With the hold full, the rest stay queued (still in order) until it drains
+  SynthEvent evt;
+  while (heldCount < MAX_HELD_EVENTS && events.Pop(evt)) {
+    if (!evt.timed) {
+      if (evt.type == EVT_SET_PITCH) {
+        // A held start would otherwise begin at the pitch it was queued with
+        for (int i = 0; i < heldCount; i++) {
+          SynthEvent &held = heldEvents[(heldFirst + i) % MAX_HELD_EVENTS];
+          if ((held.type == EVT_NOTE_ON || held.type == EVT_ARP_HOLD) && held.note == evt.note) {
+            held.value = evt.value;
+          }
+        }
+      }
+      applyEvent(evt, 0);
+    } else if (heldCount > 0 || !eventOffset(evt, size, blockMicros, offset)) {
+      holdEvent(evt);
+    } else {
+      applyEvent(evt, offset);
+    }
+  }
+}
+
+/**
+ * Advance the arpeggiator over this render and start/stop the voices of
+ * the notes it plays, at their samples
+ */
+ITCM_CODE void SynthEngine::runArpeggiator(size_t size) {
+  size_t count = arp.Process(size, arpEvents, ARP_MAX_EVENTS);
+  for (size_t i = 0; i < count; i++) {
+    const ArpEvent &evt = arpEvents[i];
+    if (evt.on) {
+      startNote(evt.note, evt.pitch, evt.offset);
+    } else if (noteVoice[evt.note] >= 0) {
+      releaseVoice(noteVoice[evt.note], evt.offset);
+    }
+    arpNotes.Push(evt);
+  }
+}
+
+ITCM_CODE void SynthEngine::Process(float **out, size_t size, uint32_t blockMicros) {
+  drainEvents(size, blockMicros);
+  runArpeggiator(size);
+
+  for (size_t offset = 0; offset < size; offset += MAX_BLOCK_SIZE) {
+    size_t n = size - offset;
+    if (n > MAX_BLOCK_SIZE) {
+      n = MAX_BLOCK_SIZE;
+    }
+    float *left = out[0] + offset;
+    float *right = out[1] + offset;
+    renderBlock(left, right, n);
+    effects.Process(left, right, n);
+    dspSoftClip(left, n);  // Soft clipping to prevent harsh distortion
+    dspSoftClip(right, n);
+  }
+  publishVoices();
+}
+
+/**
+ * Pack each voice's note, stage and level for Voice() on the control side
+ */
+ITCM_CODE void SynthEngine::publishVoices() {
+  for (int i = 0; i < NUM_VOICES; i++) {
+    float level = envelopes[i].Level();
+    level = level < 0.0f ? 0.0f : (level > 1.0f ? 1.0f : level);
+    uint32_t packed = (uint32_t)(uint8_t)voiceNote[i] | ((uint32_t)envelopes[i].Stage() << 8) |
+                      ((uint32_t)(level * 65535.0f + 0.5f) << 16);
+    voiceStatus[i].store(packed, std::memory_order_relaxed);
+  }
+}
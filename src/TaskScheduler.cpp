@@ -0,0 +1,87 @@
+#include "TaskScheduler.h"
+
+#include <string.h>
+
+void TaskScheduler::Init(uint32_t (*clock)()) {
+  now = clock;
+  numTasks = 0;
+}
+
+int TaskScheduler::Add(const char *name, uint32_t periodMicros, uint8_t priority, TaskFunction run) {
+  if (numTasks >= SCHEDULER_MAX_TASKS || periodMicros == 0 || !run) {
+    return -1;
+  }
+  Task &task = tasks[numTasks];
+  task.name = name;
+  task.period = periodMicros;
+  task.priority = priority;
+  task.run = run;
+  task.deadline = now() + periodMicros;
+  memset(&task.stats, 0, sizeof(task.stats));
+  return numTasks++;
+}
+
+void TaskScheduler::ResetStats() {
+  for (int i = 0; i < numTasks; i++) {
+    memset(&tasks[i].stats, 0, sizeof(tasks[i].stats));
+  }
+}
+
+/**
+ * Due task with the lowest priority number; ties go to the earliest
+ * deadline, then to the first added. -1 if none is due.
+ */
+int TaskScheduler::mostUrgent(uint32_t t) const {
+  int best = -1;
+  for (int i = 0; i < numTasks; i++) {
+    int32_t late = (int32_t)(t - tasks[i].deadline);
+    if (late < 0) {
+      continue;
+    }
+    if (best < 0 || tasks[i].priority < tasks[best].priority ||
+        (tasks[i].priority == tasks[best].priority &&
+         (int32_t)(tasks[i].deadline - tasks[best].deadline) < 0)) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+uint32_t TaskScheduler::RunDue() {
+  uint32_t t = now();
+  for (int id = mostUrgent(t); id >= 0; id = mostUrgent(t)) {
+    Task &task = tasks[id];
+    uint32_t late = t - task.deadline;
+    if (late >= task.period) {
+      // Whole periods missed: run once, then back on the grid
+      uint32_t missed = late / task.period;
+      task.stats.overruns += missed;
+      task.deadline += missed * task.period;
+    }
+    task.deadline += task.period;
+    if (late > task.stats.maxLateMicros) {
+      task.stats.maxLateMicros = late;
+    }
+
+    task.run(t);
+
+    uint32_t end = now();
+    uint32_t took = end - t;
+    task.stats.runs++;
+    task.stats.totalMicros += took;
+    if (took > task.stats.maxMicros) {
+      task.stats.maxMicros = took;
+    }
+    t = end;
+  }
+
+  // Nothing is due at t, so every deadline is ahead of it
+  uint32_t wait = 0;
+  for (int i = 0; i < numTasks; i++) {
+    uint32_t until = tasks[i].deadline - t;
+    if (i == 0 || until < wait) {
+      wait = until;
+    }
+  }
+  return wait;
+}
@@ -0,0 +1,198 @@
+#include "TelemetryLink.h"
+
+#include <string.h>
+
+#include "PresetStore.h"
+
+size_t cobsEncode(const uint8_t *src, size_t length, uint8_t *dst) {
+  size_t out = 1;
+  size_t code = 0;       // Where the current block's code byte goes
+  uint8_t run = 1;       // Code: distance to the next zero (or block end)
+  for (size_t i = 0; i < length; i++) {
+    if (src[i] == 0) {
+      dst[code] = run;
+      code = out++;
+      run = 1;
+      continue;
+    }
+    dst[out++] = src[i];
+    if (++run == 0xFF) {
+      // 254 data bytes without a zero: a full block, no zero implied
+      dst[code] = run;
+      code = out++;
+      run = 1;
+    }
+  }
+  dst[code] = run;
+  return out;
+}
+
+bool cobsDecode(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity, size_t &decoded) {
+  size_t out = 0;
+  size_t i = 0;
+  while (i < length) {
+    uint8_t code = src[i++];
+    if (code == 0 || i + code - 1 > length) {
+      return false;
+    }
+    for (uint8_t k = 1; k < code; k++) {
+      if (out >= capacity || src[i] == 0) {
+        return false;
+      }
+      dst[out++] = src[i++];
+    }
+    // A block shorter than 254 bytes stands for a zero, except at the end
+    if (code < 0xFF && i < length) {
+      if (out >= capacity) {
+        return false;
+      }
+      dst[out++] = 0;
+    }
+  }
+  decoded = out;
+  return true;
+}
+
+/////////////////////
+// Payload fields
+/////////////////////
+
+void TelemetryPacket::PutU8(uint8_t value) {
+  if (length >= TELEMETRY_MAX_PAYLOAD) {
+    overflowed = true;
+    return;
+  }
+  data[length++] = value;
+}
+
+void TelemetryPacket::PutU16(uint16_t value) {
+  PutU8((uint8_t)value);
+  PutU8((uint8_t)(value >> 8));
+}
+
+void TelemetryPacket::PutU32(uint32_t value) {
+  PutU16((uint16_t)value);
+  PutU16((uint16_t)(value >> 16));
+}
+
+void TelemetryPacket::PutFloat(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  PutU32(bits);
+}
+
+void TelemetryPacket::PutString(const char *text) {
+  while (*text) {
+    PutU8((uint8_t)*text++);
+  }
+}
+
+bool TelemetryReader::GetU8(uint8_t &value) {
+  if (remaining < 1) {
+    return false;
+  }
+  value = *data++;
+  remaining--;
+  return true;
+}
+
+bool TelemetryReader::GetU16(uint16_t &value) {
+  if (remaining < 2) {
+    return false;
+  }
+  value = (uint16_t)(data[0] | (data[1] << 8));
+  data += 2;
+  remaining -= 2;
+  return true;
+}
+
+bool TelemetryReader::GetU32(uint32_t &value) {
+  if (remaining < 4) {
+    return false;
+  }
+  value = (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+  data += 4;
+  remaining -= 4;
+  return true;
+}
+
+bool TelemetryReader::GetFloat(float &value) {
+  uint32_t bits;
+  if (!GetU32(bits)) {
+    return false;
+  }
+  memcpy(&value, &bits, sizeof(value));
+  return true;
+}
+
+/////////////////////
+// Link
+/////////////////////
+
+void TelemetryLink::Init(TelemetryWriter sink) {
+  writer = sink;
+  rxLength = 0;
+  rxOverflow = false;
+  payloadLength = 0;
+}
+
+bool TelemetryLink::Receive(uint8_t byte) {
+  if (byte != 0) {
+    if (rxLength < sizeof(rx)) {
+      rx[rxLength++] = byte;
+    } else {
+      rxOverflow = true;
+    }
+    return false;
+  }
+
+  // Delimiter: decode and check what came before it
+  size_t length = rxLength;
+  bool overflow = rxOverflow;
+  rxLength = 0;
+  rxOverflow = false;
+  if (length == 0 && !overflow) {
+    return false;  // Back-to-back delimiters (resync)
+  }
+  size_t decoded = 0;
+  if (overflow || !cobsDecode(rx, length, payload, sizeof(payload), decoded) || decoded < 3) {
+    badFrames++;
+    return false;
+  }
+  size_t dataLength = decoded - 2;
+  uint16_t crc = (uint16_t)(payload[dataLength] | (payload[dataLength + 1] << 8));
+  if (crc != presetCrc16(payload, dataLength)) {
+    badFrames++;
+    return false;
+  }
+  payloadLength = dataLength;
+  return true;
+}
+
+bool TelemetryLink::Send(const uint8_t *data, size_t length) {
+  if (!writer.write || length == 0 || length > TELEMETRY_MAX_PAYLOAD) {
+    return false;
+  }
+  uint8_t raw[TELEMETRY_MAX_PAYLOAD + 2];
+  memcpy(raw, data, length);
+  uint16_t crc = presetCrc16(data, length);
+  raw[length] = (uint8_t)crc;
+  raw[length + 1] = (uint8_t)(crc >> 8);
+
+  uint8_t frame[TELEMETRY_MAX_FRAME];
+  size_t frameLength = cobsEncode(raw, length + 2, frame);
+  frame[frameLength++] = 0;
+  if (writer.writable && writer.writable() < frameLength) {
+    droppedFrames++;
+    return false;
+  }
+  writer.write(frame, frameLength);
+  return true;
+}
+
+void TelemetryLink::SendDelimiter() {
+  uint8_t zero = 0;
+  if (writer.write && (!writer.writable || writer.writable() > 0)) {
+    writer.write(&zero, 1);
+  }
+}
@@ -0,0 +1,193 @@
+#include "WavetableOsc.h"
+
+#include <math.h>
+
+#include "MemoryPlacement.h"
+
+// Tables live in external SDRAM (initialized by DAISY.init() when
+// HAL_SDRAM_MODULE_ENABLED is set); host builds use ordinary memory
+
+const int WT_TABLE_STRIDE = WT_TABLE_SIZE + 1;               // Guard sample for interpolation
+const int WT_FRAME_STRIDE = WT_NUM_LEVELS * WT_TABLE_STRIDE;
+const float WT_TARGET_RMS = 0.70710678f;                    // Every frame as loud as the sine
+const uint32_t WT_FRAC_MASK = (1u << (32 - WT_TABLE_BITS)) - 1;
+const float WT_FRAC_SCALE = 1.0f / (float)(1u << (32 - WT_TABLE_BITS));
+
+static float SDRAM_DATA wavetableData[WT_NUM_FRAMES * WT_FRAME_STRIDE];
+static float sineCycle[WT_TABLE_SIZE];   // Generation scratch: one sine cycle
+static float partialSum[WT_TABLE_SIZE];  // Generation scratch: running harmonic sum
+
+/**
+ * Fourier amplitude of harmonic h for a frame (all frames start at a
+ * rising zero crossing, so morphing never cancels the fundamental)
+ */
+static float harmonicAmplitude(int frame, int h) {
+  bool odd = (h & 1) != 0;
+  switch (frame) {
+    case WT_SINE:
+      return h == 1 ? 1.0f : 0.0f;
+    case WT_TRIANGLE:
+      if (!odd) return 0.0f;
+      return (((h - 1) / 2) & 1 ? -1.0f : 1.0f) / (float)(h * h);
+    case WT_SAW:
+      return (odd ? 1.0f : -1.0f) / (float)h;
+    case WT_SQUARE:
+      return odd ? 1.0f / (float)h : 0.0f;
+  }
+  return 0.0f;
+}
+
+ITCM_CODE const float *WavetableBank::Table(int frame, int level) const {
+  return &wavetableData[frame * WT_FRAME_STRIDE + level * WT_TABLE_STRIDE];
+}
+
+void WavetableBank::Generate() {
+  for (int i = 0; i < WT_TABLE_SIZE; i++) {
+    sineCycle[i] = sinf(2.0f * (float)M_PI * (float)i / (float)WT_TABLE_SIZE);
+  }
+
+  for (int frame = 0; frame < WT_NUM_FRAMES; frame++) {
+    for (int i = 0; i < WT_TABLE_SIZE; i++) {
+      partialSum[i] = 0.0f;
+    }
+
+    // Add harmonics in order; each mip level is a snapshot of the partial
+    // sum when it holds exactly (WT_MAX_HARMONICS >> level) harmonics
+    int level = WT_NUM_LEVELS - 1;
+    for (int h = 1; h <= WT_MAX_HARMONICS && level >= 0; h++) {
+      float amp = harmonicAmplitude(frame, h);
+      if (amp != 0.0f) {
+        for (int i = 0; i < WT_TABLE_SIZE; i++) {
+          partialSum[i] += amp * sineCycle[(h * i) & (WT_TABLE_SIZE - 1)];
+        }
+      }
+
+      while (level >= 0 && h == (WT_MAX_HARMONICS >> level)) {
+        float sumSquares = 0.0f;
+        for (int i = 0; i < WT_TABLE_SIZE; i++) {
+          sumSquares += partialSum[i] * partialSum[i];
+        }
+        float scale = WT_TARGET_RMS / sqrtf(sumSquares / (float)WT_TABLE_SIZE);
+
+        float *table = &wavetableData[frame * WT_FRAME_STRIDE + level * WT_TABLE_STRIDE];
+        for (int i = 0; i < WT_TABLE_SIZE; i++) {
+          table[i] = partialSum[i] * scale;
+        }
+        table[WT_TABLE_SIZE] = table[0];
+        level--;
+      }
+    }
+  }
+}
+
+void WavetableOsc::Init(const WavetableBank *wavetables, float sr) {
+  bank = wavetables;
+  sampleRate = sr;
+  phase = 0;
+  morph = 0.0f;
+  morphTarget = 0.0f;
+  SetFreq(440.0f);
+}
+
+/**
+ * Phase increment for freq, clamped to [0, Nyquist]
+ */
+static uint32_t phaseIncrement(float freq, float sampleRate) {
+  float inc = freq / sampleRate;  // Cycles per sample
+  if (inc < 0.0f) inc = 0.0f;
+  if (inc > 0.5f) inc = 0.5f;
+  return (uint32_t)(inc * 4294967296.0f);
+}
+
+/**
+ * Lowest mip level whose highest harmonic stays below Nyquist
+ */
+static int mipLevel(uint32_t phaseInc) {
+  float inc = (float)phaseInc * (1.0f / 4294967296.0f);
+  int level = 0;
+  while (level < WT_NUM_LEVELS - 1 && (float)(WT_MAX_HARMONICS >> level) * inc >= 0.5f) {
+    level++;
+  }
+  return level;
+}
+
+void WavetableOsc::SetFreq(float freq) {
+  phaseInc = phaseIncrement(freq, sampleRate);
+  phaseIncTarget = phaseInc;
+  level = mipLevel(phaseInc);
+}
+
+ITCM_CODE void WavetableOsc::SetFreqTarget(float freq) {
+  phaseIncTarget = phaseIncrement(freq, sampleRate);
+  level = mipLevel(phaseIncTarget > phaseInc ? phaseIncTarget : phaseInc);
+}
+
+void WavetableOsc::SetMorph(float m) {
+  SetMorphTarget(m);
+  morph = morphTarget;
+}
+
+ITCM_CODE void WavetableOsc::SetMorphTarget(float m) {
+  float maxMorph = (float)(WT_NUM_FRAMES - 1);
+  morphTarget = m < 0.0f ? 0.0f : (m > maxMorph ? maxMorph : m);
+}
+
+void WavetableOsc::Reset(float p) {
+  phase = (uint32_t)(p * 4294967296.0f);
+}
+
+ITCM_CODE void WavetableOsc::ProcessBlock(float *out, size_t n) {
+  if (n == 0) {
+    return;
+  }
+  const float *levelBase = bank->Table(0, level);
+
+  // Pitch ramp: constant increment unless a target is pending
+  uint32_t inc = phaseInc;
+  int32_t incStep = (int32_t)(((int64_t)phaseIncTarget - (int64_t)phaseInc) / (int64_t)n);
+
+  float next = morphTarget;
+
+  if (next == morph) {
+    // Steady morph: frame pair and weight are constant for the block
+    int frameA = (int)morph;
+    if (frameA > WT_NUM_FRAMES - 2) frameA = WT_NUM_FRAMES - 2;
+    float weight = morph - (float)frameA;
+    const float *ta = levelBase + frameA * WT_FRAME_STRIDE;
+    const float *tb = ta + WT_FRAME_STRIDE;
+
+    for (size_t i = 0; i < n; i++) {
+      uint32_t idx = phase >> (32 - WT_TABLE_BITS);
+      float frac = (float)(phase & WT_FRAC_MASK) * WT_FRAC_SCALE;
+      float a = ta[idx] + (ta[idx + 1] - ta[idx]) * frac;
+      float b = tb[idx] + (tb[idx + 1] - tb[idx]) * frac;
+      out[i] = a + (b - a) * weight;
+      phase += inc;
+      inc += incStep;
+    }
+    phaseInc = phaseIncTarget;
+    return;
+  }
+
+  // Morph moving: ramp linearly from this block's start to its end
+  float m = morph;
+  float step = (next - morph) / (float)n;
+  for (size_t i = 0; i < n; i++) {
+    int frameA = (int)m;
+    if (frameA > WT_NUM_FRAMES - 2) frameA = WT_NUM_FRAMES - 2;
+    float weight = m - (float)frameA;
+    const float *ta = levelBase + frameA * WT_FRAME_STRIDE;
+    const float *tb = ta + WT_FRAME_STRIDE;
+
+    uint32_t idx = phase >> (32 - WT_TABLE_BITS);
+    float frac = (float)(phase & WT_FRAC_MASK) * WT_FRAC_SCALE;
+    float a = ta[idx] + (ta[idx + 1] - ta[idx]) * frac;
+    float b = tb[idx] + (tb[idx + 1] - tb[idx]) * frac;
+    out[i] = a + (b - a) * weight;
+    phase += inc;
+    inc += incStep;
+    m += step;
+  }
+  phaseInc = phaseIncTarget;
+  morph = next;
+}
@@ -0,0 +1,29 @@
+#include "WireBus.h"
+
+bool WireBus::Start(I2cTransaction &t) {
+  I2C_HandleTypeDef *handle = &wire.getHandle()->handle;
+  uint16_t address = (uint16_t)(t.address << 1);  // The HAL takes the 8-bit form
+  HAL_StatusTypeDef status;
+  if (t.rxLen > 0) {
+    if (t.txLen != 1) {
+      return false;  // Reads are register reads: one address byte, then the burst
+    }
+    status = HAL_I2C_Mem_Read_IT(handle, address, t.tx[0], I2C_MEMADD_SIZE_8BIT, t.rx, t.rxLen);
+  } else {
+    status = HAL_I2C_Master_Transmit_IT(handle, address, t.tx, t.txLen);
+  }
+  startMicros = micros();
+  return status == HAL_OK;
+}
+
+I2cStatus WireBus::Poll(I2cTransaction &t) {
+  I2C_HandleTypeDef *handle = &wire.getHandle()->handle;
+  if (HAL_I2C_GetState(handle) != HAL_I2C_STATE_READY) {
+    if (micros() - startMicros < I2C_TRANSFER_TIMEOUT_US) {
+      return I2C_BUSY;
+    }
+    HAL_I2C_Master_Abort_IT(handle, (uint16_t)(t.address << 1));
+    return I2C_ERROR;
+  }
+  return HAL_I2C_GetError(handle) == HAL_I2C_ERROR_NONE ? I2C_DONE : I2C_ERROR;
+}
@@ -0,0 +1,47 @@
+/**
+ * Host stub for Adafruit_MSA301: acceleration comes from the host driver
+ */
+
+#pragma once
+
+#include "Wire.h"
+
+typedef enum {
+  MSA301_DATARATE_1_HZ = 0,
+  MSA301_DATARATE_1_95_HZ,
+  MSA301_DATARATE_3_9_HZ,
+  MSA301_DATARATE_7_81_HZ,
+  MSA301_DATARATE_15_63_HZ,
+  MSA301_DATARATE_31_25_HZ,
+  MSA301_DATARATE_62_5_HZ,
+  MSA301_DATARATE_125_HZ,
+  MSA301_DATARATE_250_HZ,
+  MSA301_DATARATE_500_HZ,
+  MSA301_DATARATE_1000_HZ
+} msa301_dataRate_t;
+
+typedef enum {
+  MSA301_BANDWIDTH_1_95_HZ = 0,
+  MSA301_BANDWIDTH_3_9_HZ,
+  MSA301_BANDWIDTH_7_81_HZ,
+  MSA301_BANDWIDTH_15_63_HZ,
+  MSA301_BANDWIDTH_31_25_HZ,
+  MSA301_BANDWIDTH_62_5_HZ,
+  MSA301_BANDWIDTH_125_HZ,
+  MSA301_BANDWIDTH_250_HZ,
+  MSA301_BANDWIDTH_500_HZ
+} msa301_bandwidth_t;
+
+class Adafruit_MSA301 {
+public:
+  bool begin(uint8_t address = 0x26, TwoWire *wire = &Wire);
+  void read();
+  void setDataRate(msa301_dataRate_t rate) { dataRate = rate; }
+  void setBandwidth(msa301_bandwidth_t bw) { bandwidth = bw; }
+
+  float x = 0.0f;
+  float y = 0.0f;
+  float z = 0.0f;
+  msa301_dataRate_t dataRate = MSA301_DATARATE_500_HZ;   // Adafruit begin() default
+  msa301_bandwidth_t bandwidth = MSA301_BANDWIDTH_250_HZ;
+};
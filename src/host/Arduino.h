@@ -0,0 +1,129 @@
+/**
+ * Host stub for the Arduino core API used by the firmware
+ *
+ * Only compiled in the [env:native] build (src/host is on the include path
+ * there and excluded from the Daisy build). Time is simulated: millis()
+ * and micros() read a clock that the host driver and delay() advance, so
+ * renders are deterministic and run faster than real time.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef uint8_t byte;
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795f
+#endif
+
+#define DEC 10
+#define HEX 16
+
+#define LOW 0
+#define HIGH 1
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define A0 100
+#define A1 101
+#define A2 102
+#define A3 103
+#define A4 104
+#define A5 105
+#define A6 106
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(int pin, int mode);
+int digitalRead(int pin);
+void digitalWrite(int pin, int value);
+int analogRead(int pin);
+
+/**
+ * Interrupts fire from the host driver (hostServiceInterrupts), between
+ * loop() iterations, like an ISR preempting the main loop
+ */
+void attachInterrupt(int interrupt, void (*handler)(), int mode);
+void detachInterrupt(int interrupt);
+inline int digitalPinToInterrupt(int pin) { return pin; }
+
+/**
+ * Hardware timer (STM32 core API subset): the overflow callback runs from
+ * the simulated clock, at every period boundary the clock passes, with
+ * micros() reading that boundary, like an interrupt preempting loop()
+ */
+struct TIM_TypeDef;
+#define TIM6 ((TIM_TypeDef *)6)
+#define TIM7 ((TIM_TypeDef *)7)
+
+typedef enum {
+  TICK_FORMAT,
+  MICROSEC_FORMAT,
+  HERTZ_FORMAT
+} TimerFormat_t;
+
+class HardwareTimer {
+public:
+  explicit HardwareTimer(TIM_TypeDef *instance);
+  void setOverflow(uint32_t value, TimerFormat_t format = TICK_FORMAT);
+  void attachInterrupt(void (*callback)());
+  void resume();
+  void pause();
+
+  uint32_t periodMicros = 1000;
+  uint64_t nextMicros = 0;
+  void (*handler)() = nullptr;
+  bool running = false;
+};
+
+class Print {
+public:
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+
+  size_t print(const char *s);
+  size_t print(char c);
+  size_t print(int n, int base = DEC);
+  size_t print(unsigned int n, int base = DEC);
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+
+  size_t println();
+  size_t println(const char *s);
+  size_t println(char c);
+  size_t println(int n, int base = DEC);
+  size_t println(unsigned int n, int base = DEC);
+  size_t println(long n, int base = DEC);
+  size_t println(unsigned long n, int base = DEC);
+  size_t println(double n, int digits = 2);
+};
+
+class HostSerial : public Print {
+public:
+  void begin(unsigned long baud);
+  int available();
+  int read();
+  int availableForWrite();
+  void flush();
+  operator bool() const { return true; }
+};
+
+extern HostSerial Serial;
@@ -0,0 +1,132 @@
+/**
+ * Host stub for the parts of DaisyDuino the firmware uses
+ *
+ * DAISY.begin() only records the audio callback; the host driver calls it
+ * with simulated time (see HostPlatform.h). Switch reads the simulated pin
+ * level, so scripted presses go through the firmware's own debouncing path.
+ * QSPIHandle emulates the Seed's NOR flash in memory (erase sets 0xFF,
+ * program only clears bits) and charges typical erase and program times to
+ * the simulated clock. AdcHandle returns the simulated analog pin levels
+ * (hostSetAnalog, 10-bit) scaled to the 16-bit oversampled range.
+ */
+
+#pragma once
+
+#include "Arduino.h"
+
+#define DSY_SDRAM_BSS
+
+enum DaisyBoard {
+  DAISY_SEED = 0
+};
+
+enum DaisyAudioSampleRate {
+  AUDIO_SR_48K = 48000
+};
+
+struct DaisyHardware {
+  int num_channels = 2;
+};
+
+typedef void (*DaisyDuinoCallback)(float **in, float **out, size_t size);
+
+class AudioClass {
+public:
+  DaisyHardware init(DaisyBoard board, DaisyAudioSampleRate sr);
+  void begin(DaisyDuinoCallback cb);
+  void end();
+  float get_samplerate() const { return sampleRate; }
+  size_t get_blocksize() const { return blockSize; }
+
+  DaisyDuinoCallback callback = nullptr;
+  float sampleRate = 48000.0f;
+  size_t blockSize = 48;
+};
+
+extern AudioClass DAISY;
+
+enum dsy_gpio_port {
+  DSY_GPIOA, DSY_GPIOB, DSY_GPIOC, DSY_GPIOD, DSY_GPIOE, DSY_GPIOF, DSY_GPIOG
+};
+
+struct dsy_gpio_pin {
+  dsy_gpio_port port;
+  uint8_t pin;
+};
+
+inline dsy_gpio_pin dsy_pin(dsy_gpio_port port, uint8_t pin) {
+  return {port, pin};
+}
+
+/**
+ * Cortex-M7 D-cache maintenance (no cache on the host)
+ */
+inline void SCB_InvalidateDCache_by_Addr(uint32_t *addr, int32_t size) {
+  (void)addr;
+  (void)size;
+}
+
+namespace daisy {
+
+class QSPIHandle {
+public:
+  enum Result { OK = 0, ERR };
+
+  struct Config {
+    struct {
+      dsy_gpio_pin io0, io1, io2, io3, clk, ncs;
+    } pin_config;
+    enum Device { IS25LP080D, IS25LP064A, DEVICE_LAST } device;
+    enum Mode { MEMORY_MAPPED, INDIRECT_POLLING, MODE_LAST } mode;
+  };
+
+  Result Init(const Config &config);
+  Result EraseSector(uint32_t address);
+  Result Write(uint32_t address, uint32_t size, uint8_t *buffer);
+  void *GetData(uint32_t offset = 0);
+};
+
+class AdcChannelConfig {
+public:
+  void InitSingle(dsy_gpio_pin p) { pin = p; }
+
+  dsy_gpio_pin pin = {DSY_GPIOA, 0};
+};
+
+class AdcHandle {
+public:
+  enum OverSampling { OVS_NONE, OVS_4, OVS_8, OVS_16, OVS_32, OVS_64, OVS_128, OVS_256, OVS_512, OVS_1024, OVS_LAST };
+
+  void Init(AdcChannelConfig *cfg, size_t numChannels, OverSampling ovs = OVS_32);
+  void Start() {}
+  void Stop() {}
+  uint16_t Get(uint8_t chn) const;
+
+private:
+  int pins[8];
+  size_t channels = 0;
+};
+
+}  // namespace daisy
+
+/**
+ * MIDI note to frequency (DaisySP mtof)
+ */
+inline float mtof(float m) {
+  return powf(2.0f, (m - 69.0f) / 12.0f) * 440.0f;
+}
+
+class Switch {
+public:
+  void Init(float updateRate, bool invert, int pin, int mode);
+  void Debounce();
+  bool Pressed() const { return pressed; }
+  bool RisingEdge() const { return pressed && !wasPressed; }
+  bool FallingEdge() const { return !pressed && wasPressed; }
+
+private:
+  int pin = -1;
+  bool invert = false;
+  bool pressed = false;
+  bool wasPressed = false;
+};
@@ -0,0 +1,995 @@
+#include "HostBench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <math.h>
+#include <memory>
+#include <poll.h>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "AnalogInputs.h"
+#include "EffectsBus.h"
+#include "MidiOut.h"
+#include "PanTable.h"
+#include "PresetStore.h"
+#include "SynthEngine.h"
+#include "TaskScheduler.h"
+#include "TelemetryLink.h"
+
+namespace {
+
+typedef std::chrono::steady_clock BenchClock;
+
+const float BENCH_SAMPLE_RATE = 48000.0f;
+const int BENCH_REPEATS = 20000;
+
+double elapsedNanos(BenchClock::time_point start) {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() - start).count();
+}
+
+/**
+ * Apply queued events without rendering (Process with zero samples)
+ */
+double timeEvents(SynthEngine &synth) {
+  float silence[1];
+  float *out[2] = {silence, silence};
+  BenchClock::time_point start = BenchClock::now();
+  synth.Process(out, 0, 0);
+  return elapsedNanos(start);
+}
+
+/**
+ * Render (untimed) until released voices are back on the free list
+ */
+void settle(SynthEngine &synth) {
+  float left[MAX_BLOCK_SIZE], right[MAX_BLOCK_SIZE];
+  float *out[2] = {left, right};
+  synth.Process(out, MAX_BLOCK_SIZE, 0);
+  synth.Process(out, MAX_BLOCK_SIZE, 0);
+}
+
+std::unique_ptr<SynthEngine> makeEngine() {
+  std::unique_ptr<SynthEngine> synth(new SynthEngine());
+  synth->Init(BENCH_SAMPLE_RATE);
+  // 1 ms release so settle() frees voices within two blocks
+  synth->SetEnvelope(0.001f, 0.05f, 0.7f, 0.001f, ENV_CURVE_LINEAR);
+  return synth;
+}
+
+/**
+ * Cost per note event against the number of voices already sounding:
+ * note-ons taking free voices, note-offs, and note-ons that steal from a
+ * full pool. An O(1) allocator keeps every column flat.
+ */
+int benchVoiceAllocation() {
+  printf("Voice allocation (%d voices, ns per event)\n", NUM_VOICES);
+  printf("  active   note-on   note-off\n");
+
+  for (int active = 0; active < NUM_VOICES; active += (NUM_VOICES / 4 > 0 ? NUM_VOICES / 4 : 1)) {
+    std::unique_ptr<SynthEngine> synth = makeEngine();
+    for (int i = 0; i < active; i++) {
+      synth->NoteOn(i, 48.0f + i);
+    }
+    timeEvents(*synth);
+
+    // Fill the remaining free voices, release them, let them die, repeat
+    int batch = NUM_VOICES - active;
+    double onNanos = 0.0;
+    double offNanos = 0.0;
+    long count = 0;
+    for (int r = 0; r < BENCH_REPEATS / batch + 1; r++) {
+      for (int i = 0; i < batch; i++) {
+        synth->NoteOn(active + i, 60.0f + i);
+      }
+      onNanos += timeEvents(*synth);
+      for (int i = 0; i < batch; i++) {
+        synth->NoteOff(active + i);
+      }
+      offNanos += timeEvents(*synth);
+      count += batch;
+      settle(*synth);
+    }
+    printf("  %6d  %8.1f  %9.1f\n", active, onNanos / count, offNanos / count);
+  }
+
+  // Full pool: every note-on steals (oldest held voice, or a releasing one)
+  std::unique_ptr<SynthEngine> synth = makeEngine();
+  for (int i = 0; i < NUM_VOICES; i++) {
+    synth->NoteOn(i, 48.0f + i);
+  }
+  timeEvents(*synth);
+  double stealNanos = 0.0;
+  long count = 0;
+  for (int r = 0; r < BENCH_REPEATS / NUM_VOICES; r++) {
+    for (int i = 0; i < NUM_VOICES; i++) {
+      synth->NoteOn((int)(count++ % MAX_NOTE_IDS), 60.0f + i);
+    }
+    stealNanos += timeEvents(*synth);
+  }
+  printf("  %6d  %8.1f  (stealing, %u steals)\n", NUM_VOICES, stealNanos / count, synth->StolenVoices());
+  return 0;
+}
+
+/**
+ * Buffers a kernel works on: two in-place or accumulating outputs and two
+ * inputs
+ */
+struct KernelBuffers {
+  float left[MAX_BLOCK_SIZE];
+  float right[MAX_BLOCK_SIZE];
+  float a[MAX_BLOCK_SIZE];
+  float b[MAX_BLOCK_SIZE];
+};
+
+struct KernelPair {
+  const char *name;
+  void (*scalar)(KernelBuffers &k, size_t n);
+  void (*unrolled)(KernelBuffers &k, size_t n);
+};
+
+// Gains near 1 so repeated runs over the same buffers stay in range
+const KernelPair kernelPairs[] = {
+  {"clear", [](KernelBuffers &k, size_t n) { dspClearScalar(k.left, n); },
+   [](KernelBuffers &k, size_t n) { dspClearUnrolled(k.left, n); }},
+  {"scale ramp", [](KernelBuffers &k, size_t n) { dspScaleRampScalar(k.left, 0.999f, 1.001f, n); },
+   [](KernelBuffers &k, size_t n) { dspScaleRampUnrolled(k.left, 0.999f, 1.001f, n); }},
+  {"scale accumulate", [](KernelBuffers &k, size_t n) { dspScaleAccumulateScalar(k.left, k.a, 0.7f, n); },
+   [](KernelBuffers &k, size_t n) { dspScaleAccumulateUnrolled(k.left, k.a, 0.7f, n); }},
+  {"multiply pan accumulate",
+   [](KernelBuffers &k, size_t n) {
+     dspMultiplyPanAccumulateScalar(k.left, k.right, k.a, k.b, 0.3f, 1.2f, 1.3f, 0.4f, n);
+   },
+   [](KernelBuffers &k, size_t n) {
+     dspMultiplyPanAccumulateUnrolled(k.left, k.right, k.a, k.b, 0.3f, 1.2f, 1.3f, 0.4f, n);
+   }},
+  {"soft clip", [](KernelBuffers &k, size_t n) { dspSoftClipScalar(k.left, n); },
+   [](KernelBuffers &k, size_t n) { dspSoftClipUnrolled(k.left, n); }},
+};
+
+void fillRandom(float *dst, size_t n, uint32_t &seed) {
+  for (size_t i = 0; i < n; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    dst[i] = (float)(seed >> 8) / 16777216.0f * 6.0f - 3.0f;  // -3 to 3: into the clipper's knee
+  }
+}
+
+/**
+ * Time one kernel variant over full blocks, in ns per sample
+ */
+double timeKernel(void (*kernel)(KernelBuffers &, size_t), const KernelBuffers &input) {
+  KernelBuffers k = input;
+  volatile float sink = 0.0f;
+  const int blocks = BENCH_REPEATS * 10;
+  BenchClock::time_point start = BenchClock::now();
+  for (int b = 0; b < blocks; b++) {
+    kernel(k, MAX_BLOCK_SIZE);
+    sink = sink + k.left[b % MAX_BLOCK_SIZE];
+  }
+  return elapsedNanos(start) / ((double)blocks * MAX_BLOCK_SIZE);
+}
+
+/**
+ * Scalar against unrolled variant of every kernel: ns per sample on the
+ * same random buffers, and their outputs compared bit for bit at every
+ * block length (every remainder of the unrolled loops)
+ */
+int benchKernels() {
+  uint32_t seed = 7;
+  KernelBuffers input;
+  fillRandom(input.left, MAX_BLOCK_SIZE, seed);
+  fillRandom(input.right, MAX_BLOCK_SIZE, seed);
+  fillRandom(input.a, MAX_BLOCK_SIZE, seed);
+  fillRandom(input.b, MAX_BLOCK_SIZE, seed);
+
+  bool ok = true;
+  printf("DSP kernels, %zu-sample blocks (ns per sample)\n", MAX_BLOCK_SIZE);
+  printf("  kernel                     scalar  unrolled\n");
+  for (const KernelPair &pair : kernelPairs) {
+    bool identical = true;
+    for (size_t n = 1; n <= MAX_BLOCK_SIZE; n++) {
+      KernelBuffers scalar = input;
+      KernelBuffers unrolled = input;
+      pair.scalar(scalar, n);
+      pair.unrolled(unrolled, n);
+      identical = identical && memcmp(scalar.left, unrolled.left, sizeof(scalar.left)) == 0 &&
+                  memcmp(scalar.right, unrolled.right, sizeof(scalar.right)) == 0;
+    }
+    ok = ok && identical;
+    printf("  %-24s %7.3f  %8.3f  %s\n", pair.name, timeKernel(pair.scalar, input), timeKernel(pair.unrolled, input),
+           identical ? "identical" : "DIFFER");
+  }
+  return ok ? 0 : 1;
+}
+
+/**
+ * The tanhf() saturator softClip() replaced, as reference and baseline
+ */
+float softClipTanh(float sample) {
+  return tanhf(sample * SOFT_CLIP_DRIVE) / SOFT_CLIP_DRIVE;
+}
+
+void softClipTanhBlock(float *dst, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    dst[i] = softClipTanh(dst[i]);
+  }
+}
+
+/**
+ * Time a block saturator on a mix-like signal, in ns per sample
+ */
+double timeSaturator(void (*clip)(float *, size_t)) {
+  float input[MAX_BLOCK_SIZE];
+  float block[MAX_BLOCK_SIZE];
+  for (size_t i = 0; i < MAX_BLOCK_SIZE; i++) {
+    input[i] = 2.5f * sinf(0.1f * (float)i);  // Mostly linear region, some clipping
+  }
+  volatile float sink = 0.0f;
+  const int blocks = BENCH_REPEATS * 10;
+  BenchClock::time_point start = BenchClock::now();
+  for (int b = 0; b < blocks; b++) {
+    memcpy(block, input, sizeof(block));
+    clip(block, MAX_BLOCK_SIZE);
+    sink = sink + block[b % MAX_BLOCK_SIZE];
+  }
+  double nanos = elapsedNanos(start);
+  return nanos / ((double)blocks * MAX_BLOCK_SIZE);
+}
+
+/**
+ * Worst-case error of softClip() against tanhf() over a dense sweep, then
+ * the cost per sample of each saturator (memcpy overhead included in all)
+ */
+int benchSoftClip() {
+  float maxError = 0.0f;
+  float worstInput = 0.0f;
+  for (int i = -400000; i <= 400000; i++) {
+    float x = (float)i * 0.00002f;  // -8 to +8, well past full saturation
+    float error = fabsf(softClip(x) - softClipTanh(x));
+    if (error > maxError) {
+      maxError = error;
+      worstInput = x;
+    }
+  }
+  printf("Soft clip error vs tanhf: max %.2e at x = %.4f (bound %.0e)\n", maxError, worstInput,
+         SOFT_CLIP_MAX_ERROR);
+
+  double tanhNanos = timeSaturator(softClipTanhBlock);
+  double scalarNanos = timeSaturator(dspSoftClipScalar);
+  double unrolledNanos = timeSaturator(dspSoftClipUnrolled);
+  printf("Soft clip cost (ns per sample)\n");
+  printf("  tanhf               %6.2f\n", tanhNanos);
+  printf("  rational, scalar    %6.2f  (%.1fx)\n", scalarNanos, tanhNanos / scalarNanos);
+  printf("  rational, unrolled  %6.2f  (%.1fx)\n", unrolledNanos, tanhNanos / unrolledNanos);
+  return 0;
+}
+
+/**
+ * Voice signals for the mixer benchmark: one oscillator and one envelope
+ * block per voice, each voice with its own pan position
+ */
+struct MixerVoices {
+  float osc[NUM_VOICES][MAX_BLOCK_SIZE];
+  float env[NUM_VOICES][MAX_BLOCK_SIZE];
+  float pan[NUM_VOICES];
+};
+
+/**
+ * The mono output stage: one mix, ramped, clipped and copied to both sides
+ */
+void mixMono(const MixerVoices &v, float *left, float *right, size_t n) {
+  float mix[MAX_BLOCK_SIZE];
+  dspClear(mix, n);
+  for (int j = 0; j < NUM_VOICES; j++) {
+    for (size_t i = 0; i < n; i++) {
+      mix[i] += v.osc[j][i] * v.env[j][i];
+    }
+  }
+  dspScaleRamp(mix, 0.3f, 0.31f, n);
+  dspSoftClip(mix, n);
+  for (size_t i = 0; i < n; i++) {
+    left[i] = mix[i];
+    right[i] = mix[i];
+  }
+}
+
+/**
+ * The stereo output stage: per-voice pan gains looked up and ramped per
+ * block, both sides ramped and clipped
+ */
+void mixStereo(const MixerVoices &v, float *left, float *right, size_t n) {
+  dspClear(left, n);
+  dspClear(right, n);
+  for (int j = 0; j < NUM_VOICES; j++) {
+    float leftStart, rightStart, leftEnd, rightEnd;
+    panToGains(v.pan[j], leftStart, rightStart);
+    panToGains(v.pan[j] + 0.01f, leftEnd, rightEnd);  // Every voice gliding
+    dspMultiplyPanAccumulate(left, right, v.osc[j], v.env[j], leftStart, leftEnd, rightStart, rightEnd, n);
+  }
+  dspScaleRamp(left, 0.3f, 0.31f, n);
+  dspScaleRamp(right, 0.3f, 0.31f, n);
+  dspSoftClip(left, n);
+  dspSoftClip(right, n);
+}
+
+/**
+ * Time an output stage over every voice, in ns per block
+ */
+double timeMixer(void (*mix)(const MixerVoices &, float *, float *, size_t), const MixerVoices &voices) {
+  float left[MAX_BLOCK_SIZE], right[MAX_BLOCK_SIZE];
+  volatile float sink = 0.0f;
+  BenchClock::time_point start = BenchClock::now();
+  for (int b = 0; b < BENCH_REPEATS; b++) {
+    mix(voices, left, right, MAX_BLOCK_SIZE);
+    sink = sink + left[b % MAX_BLOCK_SIZE] + right[b % MAX_BLOCK_SIZE];
+  }
+  return elapsedNanos(start) / BENCH_REPEATS;
+}
+
+/**
+ * Stereo panning mixer against the mono output stage it replaced, with
+ * every voice sounding (pan gains are tested in test/test_pan_table)
+ */
+int benchPan() {
+  std::unique_ptr<MixerVoices> voices(new MixerVoices());
+  for (int j = 0; j < NUM_VOICES; j++) {
+    for (size_t i = 0; i < MAX_BLOCK_SIZE; i++) {
+      voices->osc[j][i] = sinf(0.05f * (float)(j + 1) * (float)i);
+      voices->env[j][i] = 0.5f + 0.002f * (float)i;
+    }
+    voices->pan[j] = -1.0f + 2.0f * (float)j / (float)(NUM_VOICES > 1 ? NUM_VOICES - 1 : 1);
+  }
+
+  double monoNanos = timeMixer(mixMono, *voices);
+  double stereoNanos = timeMixer(mixStereo, *voices);
+  printf("Output stage, %d voices, %zu-sample blocks (ns per block)\n", NUM_VOICES, MAX_BLOCK_SIZE);
+  printf("  mono, copied to both sides  %8.1f\n", monoNanos);
+  printf("  stereo, panned per voice    %8.1f  (%.2fx)\n", stereoNanos, stereoNanos / monoNanos);
+  return 0;
+}
+
+/**
+ * MIDI frames captured by benchMidi(), with the simulated time they left
+ */
+struct MidiFrame {
+  uint32_t micros;
+  std::vector<MidiPacket> packets;
+};
+
+std::vector<MidiFrame> midiFrames;
+uint32_t midiNow = 0;
+
+void captureMidiFrame(const MidiPacket *packets, size_t count) {
+  midiFrames.push_back({midiNow, std::vector<MidiPacket>(packets, packets + count)});
+}
+
+/**
+ * A dense two-second gesture through MidiOut on a 100 us loop: 15-note
+ * chord bursts every 50 ms, every note's pitch wiggled, manager bend,
+ * timbre and window swept on every iteration. Reports the cost of
+ * Service(), the note-on latency and how far the stream was thinned;
+ * ordering and rate limits are asserted in test/test_midi_out.
+ */
+int benchMidi() {
+  std::unique_ptr<MidiOut> midi(new MidiOut());
+  midiFrames.clear();
+  midiNow = 0;
+  midi->SetWriter({captureMidiFrame, nullptr});
+  midi->Init(1.0f);
+  midi->Service(0);
+  midiFrames.clear();  // Configuration
+
+  const uint32_t LOOP_MICROS = 100;
+  const uint32_t GESTURE_MICROS = 2000000;
+  const int CHORD_NOTES = MPE_MEMBER_CHANNELS;
+  std::vector<uint32_t> noteOnTimes;
+  long updates = 0;
+  double serviceNanos = 0.0;
+  long services = 0;
+  bool held = false;
+
+  for (midiNow = LOOP_MICROS; midiNow < GESTURE_MICROS + 100000; midiNow += LOOP_MICROS) {
+    if (midiNow < GESTURE_MICROS) {
+      float t = (float)midiNow * 1.0e-6f;
+      if (midiNow % 50000 == 0) {
+        for (int n = 0; n < CHORD_NOTES; n++) {
+          if (held) {
+            midi->NoteOff(n);
+            updates++;
+          } else {
+            midi->NoteOn(n, 48.0f + (float)n * 1.5f);  // Quarter-tone steps
+            noteOnTimes.push_back(midiNow);
+            updates += 2;
+          }
+        }
+        held = !held;
+      }
+      for (int n = 0; n < CHORD_NOTES; n++) {
+        midi->SetNotePitch(n, 48.0f + (float)n * 1.5f + 0.5f * sinf(t * 7.0f + (float)n));
+      }
+      midi->SetBend(sinf(t * 5.0f));
+      midi->SetTimbre(0.5f + 0.5f * sinf(t * 3.0f));
+      midi->SetWindow((int)(6.0f * sinf(t)));
+      updates += CHORD_NOTES + 3;
+    } else if (midiNow == GESTURE_MICROS) {
+      midi->SetBend(0.0f);
+    }
+    BenchClock::time_point start = BenchClock::now();
+    midi->Service(midiNow);
+    serviceNanos += elapsedNanos(start);
+    services++;
+  }
+
+  size_t packets = 0;
+  size_t maxFrame = 0;
+  uint32_t maxLatency = 0;
+  size_t noteOns = 0;
+  for (const MidiFrame &frame : midiFrames) {
+    maxFrame = std::max(maxFrame, frame.packets.size());
+    for (const MidiPacket &p : frame.packets) {
+      if ((p.status & 0xF0) == 0x90 && noteOns < noteOnTimes.size()) {
+        maxLatency = std::max(maxLatency, frame.micros - noteOnTimes[noteOns++]);
+      }
+      packets++;
+    }
+  }
+
+  printf("MIDI output, %.1f s dense gesture (%d-note chords every 50 ms)\n", GESTURE_MICROS * 1.0e-6,
+         CHORD_NOTES);
+  printf("  updates requested   %ld\n", updates);
+  printf("  packets sent        %zu in %zu frames (max %zu per frame)\n", packets, midiFrames.size(), maxFrame);
+  printf("  note-on latency     max %u us\n", maxLatency);
+  printf("  Service()           %.1f ns per call\n", serviceNanos / services);
+  return 0;
+}
+
+/**
+ * Effects bus cost per 48-sample block with both sends up, with the reverb
+ * shed by an impossible budget, and idle with the sends at zero. Shedding,
+ * restoring and idling are asserted in test/test_effects_bus.
+ */
+int benchEffects() {
+  const size_t BLOCK = 48;
+  const float TICKS_PER_SAMPLE = 1.0e9f / BENCH_SAMPLE_RATE;  // Host ticks are nanoseconds
+  const int COST_BLOCKS = 20000;
+  std::unique_ptr<EffectsBus> bus(new EffectsBus());
+  bus->Init(BENCH_SAMPLE_RATE);
+  bus->SetDelayMix(0.35f);
+  bus->SetReverbMix(0.5f);
+  bus->SetReverbDecay(4.0f);
+
+  float left[BLOCK], right[BLOCK];
+  float phase = 0.0f;
+  auto timeBlocks = [&]() {
+    double nanos = 0.0;
+    for (int b = 0; b < COST_BLOCKS; b++) {
+      for (size_t i = 0; i < BLOCK; i++) {
+        left[i] = right[i] = 0.3f * sinf(phase);
+        phase += 2.0f * 3.14159265f * 220.0f / BENCH_SAMPLE_RATE;
+      }
+      BenchClock::time_point start = BenchClock::now();
+      bus->Process(left, right, BLOCK);
+      nanos += elapsedNanos(start);
+    }
+    return nanos / COST_BLOCKS;
+  };
+
+  double bothNanos = timeBlocks();
+  bus->SetCpuBudget(1.0e-6f, TICKS_PER_SAMPLE);
+  double delayNanos = timeBlocks();
+  bus->SetCpuBudget(EFFECTS_CPU_BUDGET, 0.0f);
+  bus->SetDelayMix(0.0f);
+  bus->SetReverbMix(0.0f);
+  while (bus->Active()) {
+    timeBlocks();
+  }
+  double idleNanos = timeBlocks();
+
+  double blockNanos = BLOCK / BENCH_SAMPLE_RATE * 1.0e9;
+  printf("Effects bus (ping-pong delay + %d-line FDN reverb, %zu-sample blocks, ns per block)\n", REVERB_LINES,
+         BLOCK);
+  printf("  both effects    %6.0f  (%.2f%% of %.0f us)\n", bothNanos, 100.0 * bothNanos / blockNanos,
+         blockNanos * 1.0e-3);
+  printf("  reverb shed     %6.0f  (%.2f%%)\n", delayNanos, 100.0 * delayNanos / blockNanos);
+  printf("  idle            %6.0f\n", idleNanos);
+  return 0;
+}
+
+/**
+ * Note onsets (first non-zero sample after a silence) of a rendered
+ * arpeggio over three held notes, in blocks of the given size. With
+ * loopTimed the steps are instead posted as untimed NoteOn/NoteOff by a
+ * simulated loop() that checks a millisecond clock between callbacks and
+ * is held up by a random 0-2 ms of other work, as a millis() scheduler
+ * in loop() would be.
+ */
+std::vector<long> renderArpOnsets(size_t block, bool loopTimed) {
+  const float RATE = 12.0f;               // Steps per second: 4000 samples
+  const long SAMPLES = (long)BENCH_SAMPLE_RATE * 2;
+  const long SILENCE = 64;                // Zero run that counts as a gap
+  const float pitches[3] = {60.0f, 64.0f, 67.0f};
+  std::unique_ptr<SynthEngine> synth = makeEngine();
+  if (!loopTimed) {
+    synth->SetParam(PARAM_ARP_PATTERN, (float)ARP_UP);
+    synth->SetParam(PARAM_ARP_RATE, RATE);
+    for (int i = 0; i < 3; i++) {
+      synth->ArpHold(i, pitches[i], 0);
+    }
+  }
+
+  std::vector<float> left(block), right(block);
+  float *out[2] = {left.data(), right.data()};
+  std::vector<long> onsets;
+  uint32_t random = 1;
+  double stepMicros = 1.0e6 / RATE;
+  double nextOn = 0.0;
+  double nextOff = -1.0;
+  int step = 0;
+  long zeros = SILENCE;
+  for (long s = 0; s < SAMPLES; s += (long)block) {
+    uint32_t blockMicros = (uint32_t)((double)s * 1.0e6 / BENCH_SAMPLE_RATE);
+    if (loopTimed && nextOff >= 0.0 && (double)blockMicros >= nextOff) {
+      synth->NoteOff((step + 2) % 3);
+      nextOff = -1.0;
+    }
+    if (loopTimed && (double)blockMicros >= nextOn) {
+      random = random * 1664525u + 1013904223u;
+      double late = (double)((random >> 16) % 2000);  // The loop's other work
+      synth->NoteOn(step % 3, pitches[step % 3]);
+      nextOff = (double)(step) * stepMicros + stepMicros * ARP_GATE + late;
+      step++;
+      nextOn = (double)step * stepMicros + late;
+    }
+    synth->Process(out, block, blockMicros);
+    for (size_t i = 0; i < block && s + (long)i < SAMPLES; i++) {
+      if (left[i] == 0.0f) {
+        zeros++;
+        continue;
+      }
+      if (zeros >= SILENCE) {
+        onsets.push_back(s + (long)i);
+      }
+      zeros = 0;
+    }
+  }
+  return onsets;
+}
+
+/**
+ * Step spacing of rendered arpeggios at several block sizes: the
+ * arpeggiator's onsets against steps timed from loop(), which wander with
+ * the loop and the block grid (exact spacing is asserted in
+ * test/test_arpeggiator)
+ */
+int benchArpeggiator() {
+  const size_t blocks[] = {16, 37, 48, 64};
+  const long STEP = (long)(BENCH_SAMPLE_RATE / 12.0f);
+  auto jitter = [&](const std::vector<long> &onsets) {
+    long worst = 0;
+    for (size_t i = 1; i < onsets.size(); i++) {
+      worst = std::max(worst, std::abs(onsets[i] - onsets[i - 1] - STEP));
+    }
+    return worst;
+  };
+
+  printf("Arpeggiator onsets (3 notes, up, %ld-sample steps, 2 s)\n", STEP);
+  printf("  block   onsets   first   max interval error (samples)\n");
+  for (size_t block : blocks) {
+    std::vector<long> onsets = renderArpOnsets(block, false);
+    printf("  %5zu  %7zu  %6ld   %ld\n", block, onsets.size(), onsets.empty() ? -1L : onsets[0], jitter(onsets));
+  }
+  for (size_t block : blocks) {
+    std::vector<long> onsets = renderArpOnsets(block, true);
+    printf("  %5zu  %7zu  %6ld   %ld  (stepped from loop())\n", block, onsets.size(),
+           onsets.empty() ? -1L : onsets[0], jitter(onsets));
+  }
+  return 0;
+}
+
+/**
+ * NOR flash in RAM: erase sets 0xFF, program clears bits; counts erases
+ * per sector
+ */
+class RamFlash : public FlashMemory {
+public:
+  static const uint32_t SECTOR = 4096;
+
+  RamFlash() : bytes(SECTOR * PRESET_FLASH_SECTORS, 0xFF), sectorErases(PRESET_FLASH_SECTORS, 0) {}
+
+  uint32_t SectorSize() const override { return SECTOR; }
+
+  bool Read(uint32_t address, uint8_t *dst, size_t n) override {
+    if (address + n > bytes.size()) {
+      return false;
+    }
+    memcpy(dst, &bytes[address], n);
+    return true;
+  }
+
+  bool EraseSector(uint32_t address) override {
+    if (address >= bytes.size()) {
+      return false;
+    }
+    address -= address % SECTOR;
+    memset(&bytes[address], 0xFF, SECTOR);
+    sectorErases[address / SECTOR]++;
+    return true;
+  }
+
+  bool Program(uint32_t address, const uint8_t *src, size_t n) override {
+    if (address + n > bytes.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+      bytes[address + i] &= src[i];
+    }
+    return true;
+  }
+
+  std::vector<uint8_t> bytes;
+  std::vector<uint32_t> sectorErases;
+};
+
+/**
+ * The flash log under the autosave: one preset and the calibration saved
+ * once, then the last state over and over. Reports the cost of a save and
+ * of the boot scan of a full log, and how the erases spread; encodings,
+ * torn records and wear leveling are asserted in test/test_preset_store.
+ */
+int benchPresets() {
+  const int SAVES = 50000;
+  const int SCANS = 100;
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  SensorCalibration calibration = {0.25f, -1.5f, 40, 320};
+  RamFlash flash;
+  PresetStore store;
+  store.Init(&flash, 0);
+  store.Save((PresetRecordKind)(RECORD_PRESET_FIRST + 2), payload,
+             encodeMusicalState({7, 1, 4, false, ARP_UP, 0}, payload));
+  store.Save(RECORD_CALIBRATION, payload, encodeCalibration(calibration, payload));
+
+  BenchClock::time_point start = BenchClock::now();
+  for (int i = 0; i < SAVES; i++) {
+    MusicalState state = {(uint8_t)(i % 12), (uint8_t)(i % 3), (uint8_t)(1 + i % 8), (i & 1) != 0,
+                          (uint8_t)(i % NUM_ARP_PATTERNS), (int8_t)(i % 49 - 24)};
+    store.Save(RECORD_LAST_STATE, payload, encodeMusicalState(state, payload));
+  }
+  double perSave = elapsedNanos(start) / SAVES;
+  start = BenchClock::now();
+  for (int i = 0; i < SCANS; i++) {
+    store.Init(&flash, 0);
+  }
+  double perScan = elapsedNanos(start) / SCANS;
+
+  uint32_t fewest = *std::min_element(flash.sectorErases.begin(), flash.sectorErases.end());
+  uint32_t most = *std::max_element(flash.sectorErases.begin(), flash.sectorErases.end());
+  uint32_t totalErases = 0;
+  for (uint32_t erases : flash.sectorErases) {
+    totalErases += erases;
+  }
+  printf("Preset store (%zu-byte records, %d x %u-byte sectors)\n", PRESET_RECORD_SIZE, PRESET_FLASH_SECTORS,
+         RamFlash::SECTOR);
+  printf("  %d saves: %u sector erases (%u-%u per sector, %.0f saves per erase), %.0f ns per save\n", SAVES,
+         totalErases, fewest, most, (double)SAVES / (totalErases ? totalErases : 1), perSave);
+  printf("  boot scan of the full log %.1f us, %u records found\n", perScan * 1.0e-3, store.RecordsFound());
+  return 0;
+}
+
+/**
+ * Simulated control loop for the scheduler: tasks advance the clock by
+ * what they cost, button edges arrive on their own schedule
+ */
+uint32_t schedNow = 0;
+uint32_t schedStart = 0;
+uint32_t nextEdge = 0;
+uint32_t worstPickup = 0;
+uint32_t logRuns = 0;
+
+const uint32_t EDGE_SPACING = 3700;     // A button edge every 3.7 ms
+const uint32_t LOG_STALL_EVERY = 100;   // Every 100th log run blocks...
+const uint32_t LOG_STALL_MICROS = 1200; // ...this long (a long serial write)
+
+uint32_t schedClock() {
+  return schedNow;
+}
+
+void pickUpEdges(uint32_t now) {
+  while ((int32_t)(now - nextEdge) >= 0) {
+    worstPickup = std::max(worstPickup, now - nextEdge);
+    nextEdge += EDGE_SPACING;
+  }
+}
+
+void benchButtonTask(uint32_t now) {
+  pickUpEdges(now);
+  schedNow += 5;
+}
+
+void benchMidiTask(uint32_t) {
+  schedNow += 50;
+}
+
+void benchLogTask(uint32_t) {
+  schedNow += ++logRuns % LOG_STALL_EVERY == 0 ? LOG_STALL_MICROS : 30;
+}
+
+/**
+ * Control task scheduler on a simulated clock that wraps mid-run, with a
+ * long log write now and then: runs, overruns and lateness per task, and
+ * button pickup latency against the old loop (every task in turn, then
+ * delay(1)). Ordering and overrun accounting are asserted in
+ * test/test_task_scheduler.
+ */
+int benchScheduler() {
+  const uint32_t RUN_MICROS = 1000000;
+  schedStart = schedNow = 0xFFFFFFFFu - 300000;  // Wraps 0.3 s in
+  nextEdge = schedStart + 1234;
+  worstPickup = 0;
+  logRuns = 0;
+
+  // Added least urgent first: the order comes from the priorities
+  TaskScheduler scheduler;
+  scheduler.Init(schedClock);
+  int logId = scheduler.Add("log", 2000, 5, benchLogTask);
+  int midiId = scheduler.Add("midi", 1000, 2, benchMidiTask);
+  int buttonId = scheduler.Add("buttons", 250, 0, benchButtonTask);
+  uint64_t idleMicros = 0;
+  while (schedNow - schedStart < RUN_MICROS) {
+    uint32_t idle = scheduler.RunDue();
+    schedNow += idle;
+    idleMicros += idle;
+  }
+  scheduler.RunDue();  // Everything due at the end has run
+  uint32_t elapsed = schedNow - schedStart;
+  uint32_t schedulerPickup = worstPickup;
+
+  // The old loop: every task once, then a fixed 1 ms sleep
+  schedNow = schedStart;
+  nextEdge = schedStart + 1234;
+  worstPickup = 0;
+  logRuns = 0;
+  while (schedNow - schedStart < RUN_MICROS) {
+    benchButtonTask(schedNow);
+    benchMidiTask(schedNow);
+    benchLogTask(schedNow);
+    schedNow += 1000;
+  }
+  uint32_t loopPickup = worstPickup;
+
+  printf("Control task scheduler (1 s simulated, clock wraps mid-run)\n");
+  printf("  task      period   runs  overruns  max late (us)\n");
+  for (int id : {buttonId, midiId, logId}) {
+    const TaskStats &stats = scheduler.Stats(id);
+    printf("  %-8s  %6u  %5u  %8u  %u\n", scheduler.Name(id), scheduler.Period(id), stats.runs, stats.overruns,
+           stats.maxLateMicros);
+  }
+  printf("  idle %.1f%% of the time\n", 100.0 * (double)idleMicros / elapsed);
+  printf("  button edge pickup: worst %u us scheduled, %u us with delay(1)\n", schedulerPickup, loopPickup);
+  return 0;
+}
+
+/**
+ * Analog input filtering at the firmware's settings (8 Hz IIR, 0.2% dead
+ * band, 500 Hz updates): level changes of a still pot with 12-bit-class
+ * ADC noise, how long a full-travel step takes to settle, and the dB
+ * taper. The same cases are asserted in test/test_analog_inputs.
+ */
+int benchAnalog() {
+  const float UPDATE_HZ = 500.0f;
+  const AnalogInputConfig config = {dsy_pin(DSY_GPIOC, 1), 8.0f, 0.002f};
+  const int NOISE_LSB = 256;  // +-4 LSB at 12 bits, in 16-bit counts
+  AnalogInputs inputs;
+  inputs.Init(&config, 1, UPDATE_HZ);
+
+  // Still pot: count level changes once the filter has settled (250 ms)
+  uint32_t seed = 1;
+  int stillChanges = 0;
+  uint16_t raw;
+  for (int i = 0; i < (int)UPDATE_HZ * 4; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    raw = (uint16_t)(30000 + (int)(seed >> 16) % (2 * NOISE_LSB + 1) - NOISE_LSB);
+    if (inputs.Filter(&raw) && i >= (int)UPDATE_HZ / 4) {
+      stillChanges++;
+    }
+  }
+
+  // Full-travel step
+  int settle90 = -1;
+  int updates = 0;
+  float start = inputs.Value(0);
+  raw = 65535;
+  for (; updates < (int)UPDATE_HZ; updates++) {
+    inputs.Filter(&raw);
+    if (settle90 < 0 && inputs.Value(0) >= start + 0.9f * (1.0f - start)) {
+      settle90 = updates + 1;
+    }
+  }
+  float settleMs = settle90 * 1000.0f / UPDATE_HZ;
+
+  printf("Analog inputs (8 Hz IIR, 0.2%% dead band, %.0f Hz updates)\n", UPDATE_HZ);
+  printf("  still pot, +-%d counts of noise: %d level changes in 3.75 s after settling\n", NOISE_LSB, stillChanges);
+  printf("  full-travel step: 90%% after %.0f ms, ends at level %u\n", settleMs, (unsigned)inputs.Level(0));
+  printf("  taper (40 dB):");
+  for (int i = 0; i <= 4; i++) {
+    float gain = analogDbTaper(i / 4.0f, 40.0f, 0.01f);
+    printf(" %d%% %.1f dB%s", i * 25, gain > 0.0f ? 20.0f * log10f(gain) : -INFINITY, i < 4 ? "," : "\n");
+  }
+  return 0;
+}
+
+/**
+ * Telemetry link ends: the last frame sent, and the two sides of a
+ * pseudo-terminal
+ */
+uint8_t telemetryFrame[TELEMETRY_MAX_FRAME];
+size_t telemetryFrameLength = 0;
+int ptyMaster = -1;
+int ptySlave = -1;
+
+void captureFrame(const uint8_t *data, size_t length) {
+  memcpy(telemetryFrame, data, length);
+  telemetryFrameLength = length;
+}
+
+void writeAll(int fd, const uint8_t *data, size_t length) {
+  while (length > 0) {
+    ssize_t n = write(fd, data, length);
+    if (n <= 0) {
+      return;
+    }
+    data += n;
+    length -= (size_t)n;
+  }
+}
+
+void writeMaster(const uint8_t *data, size_t length) {
+  writeAll(ptyMaster, data, length);
+}
+
+void writeSlave(const uint8_t *data, size_t length) {
+  writeAll(ptySlave, data, length);
+}
+
+/**
+ * Feed what arrives on fd to the link until it completes a frame (false
+ * after a second without one). Only one frame is in flight at a time.
+ */
+bool receiveFrame(int fd, TelemetryLink &link) {
+  uint8_t buffer[256];
+  pollfd ready = {fd, POLLIN, 0};
+  while (poll(&ready, 1, 1000) > 0) {
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    if (n <= 0) {
+      return false;
+    }
+    for (ssize_t i = 0; i < n; i++) {
+      if (link.Receive(buffer[i])) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * Telemetry link: framing cost per payload size, and round trips through
+ * a pseudo-terminal (as between tools/telemetry.py and `program --pty`).
+ * The framing itself is asserted in test/test_telemetry_link.
+ */
+int benchTelemetry() {
+  uint32_t seed = 1;
+  uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+  for (size_t i = 0; i < sizeof(payload); i++) {
+    seed = seed * 1664525u + 1013904223u;
+    payload[i] = (uint8_t)(seed >> 24) % 3 == 0 ? 0 : (uint8_t)(seed >> 16);  // Plenty of zeros
+  }
+
+  // Send and receive in memory: encode, CRC and decode per frame
+  TelemetryLink sender, receiver;
+  sender.Init({captureFrame, nullptr});
+  receiver.Init({nullptr, nullptr});
+  const size_t SIZES[] = {2, 32, TELEMETRY_MAX_PAYLOAD};
+  const int FRAMES = 20000;
+  double frameNanos[3];
+  for (int s = 0; s < 3; s++) {
+    BenchClock::time_point start = BenchClock::now();
+    for (int i = 0; i < FRAMES; i++) {
+      sender.Send(payload, SIZES[s]);
+      for (size_t k = 0; k < telemetryFrameLength; k++) {
+        receiver.Receive(telemetryFrame[k]);
+      }
+    }
+    frameNanos[s] = elapsedNanos(start) / FRAMES;
+  }
+
+  // Pseudo-terminal loopback, in lockstep: a request down, its echo back
+  int roundTrips = 0;
+  double perRoundTrip = 0.0;
+  ptyMaster = posix_openpt(O_RDWR | O_NOCTTY);
+  if (ptyMaster >= 0 && grantpt(ptyMaster) == 0 && unlockpt(ptyMaster) == 0) {
+    ptySlave = open(ptsname(ptyMaster), O_RDWR | O_NOCTTY);
+  }
+  if (ptySlave >= 0) {
+    termios settings;
+    tcgetattr(ptySlave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(ptySlave, TCSANOW, &settings);
+    TelemetryLink host, device;
+    host.Init({writeMaster, nullptr});
+    device.Init({writeSlave, nullptr});
+    const int ROUND_TRIPS = 2000;
+    BenchClock::time_point start = BenchClock::now();
+    for (; roundTrips < ROUND_TRIPS; roundTrips++) {
+      seed = seed * 1664525u + 1013904223u;
+      host.Send(payload, 1 + (seed >> 8) % TELEMETRY_MAX_PAYLOAD);
+      if (!receiveFrame(ptySlave, device)) {
+        break;
+      }
+      device.Send(device.Payload(), device.PayloadLength());
+      if (!receiveFrame(ptyMaster, host)) {
+        break;
+      }
+    }
+    perRoundTrip = elapsedNanos(start) / 1000.0 / (roundTrips ? roundTrips : 1);
+  }
+  if (ptySlave >= 0) {
+    close(ptySlave);
+  }
+  if (ptyMaster >= 0) {
+    close(ptyMaster);
+  }
+  ptyMaster = ptySlave = -1;
+
+  printf("Telemetry link (COBS + CRC-16, payloads up to %zu bytes)\n", TELEMETRY_MAX_PAYLOAD);
+  printf("  send + receive in memory:");
+  for (int s = 0; s < 3; s++) {
+    printf(" %zu bytes %.0f ns%s", SIZES[s], frameNanos[s], s < 2 ? "," : "\n");
+  }
+  printf("  pseudo-terminal: %d random payloads both ways, %.1f us per round trip\n", roundTrips, perRoundTrip);
+  return 0;
+}
+
+struct Bench {
+  const char *name;
+  int (*run)();
+};
+
+const Bench benches[] = {
+  {"voices", benchVoiceAllocation},
+  {"kernels", benchKernels},
+  {"softclip", benchSoftClip},
+  {"pan", benchPan},
+  {"midi", benchMidi},
+  {"effects", benchEffects},
+  {"arp", benchArpeggiator},
+  {"presets", benchPresets},
+  {"scheduler", benchScheduler},
+  {"analog", benchAnalog},
+  {"telemetry", benchTelemetry},
+};
+
+}  // namespace
+
+int hostRunBench(const char *name) {
+  bool found = false;
+  for (const Bench &bench : benches) {
+    if (name && strcmp(name, bench.name) != 0) {
+      continue;
+    }
+    found = true;
+    int result = bench.run();
+    if (result != 0) {
+      return result;
+    }
+  }
+  if (!found) {
+    fprintf(stderr, "Unknown benchmark %s\n", name);
+    return 2;
+  }
+  return 0;
+}
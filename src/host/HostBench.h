@@ -0,0 +1,14 @@
+/**
+ * HostBench - micro-benchmarks of engine internals on the native build
+ *
+ * Run with: program --bench [name]
+ * Without a name every benchmark runs. Results are host timings: use them
+ * to compare costs and check how they scale, not as Daisy cycle counts.
+ */
+
+#pragma once
+
+/**
+ * Run one benchmark by name, or all when name is null; returns an exit code
+ */
+int hostRunBench(const char *name);
@@ -0,0 +1,858 @@
+#include "HostPlatform.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Adafruit_MSA301.h"
+#include "Adafruit_VL53L0X.h"
+#include "DaisyDuino.h"
+#include "Wire.h"
+
+const int HOST_NUM_PINS = 128;
+const int HOST_DEFAULT_POT = 614;  // Matches the firmware's initial 0.3 volume
+
+HostSerial Serial;
+AudioClass DAISY;
+TwoWire Wire;
+
+static uint64_t simMicros = 0;
+static int pinLevels[HOST_NUM_PINS];
+static int analogValues[HOST_NUM_PINS];
+static bool pinsInitialized = false;
+static bool devicePresent[128];
+static float accelX = 0.0f;
+static float accelY = 0.0f;
+static float accelZ = 9.81f;
+static bool serialMuted = false;
+static std::string serialInput;     // Bytes the firmware has not read yet
+static int serialPty = -1;          // Pseudo-terminal master, when Serial is connected to one
+static std::string serialOutput;    // Bytes the pseudo-terminal has not taken yet
+const size_t HOST_PTY_BUFFER = 4096;   // Like a USB CDC transmit buffer: full = availableForWrite() 0
+
+// QSPI NOR flash (IS25LP064A timings, typical)
+const uint32_t HOST_FLASH_SIZE = 8 * 1024 * 1024;
+const uint32_t HOST_FLASH_SECTOR = 4096;
+const uint32_t HOST_FLASH_PAGE = 256;
+const uint64_t HOST_FLASH_ERASE_US = 45000;     // Per 4 KB sector
+const uint64_t HOST_FLASH_PROGRAM_US = 200;     // Per page
+static std::vector<uint8_t> flashMemory(HOST_FLASH_SIZE, 0xFF);
+static bool flashFailing = false;
+
+// I2C timing
+static uint32_t i2cClock = 100000;
+static uint32_t i2cLatency = 0;
+static uint64_t i2cNanosRemainder = 0;
+static uint8_t registerPointer[128];
+
+// VL53L0X continuous ranging
+static bool tofRanging = false;
+static uint64_t tofPeriodMicros = 50000;
+static uint64_t tofBudgetMicros = 33000;   // Timing budget: the default profile's
+static std::vector<std::pair<uint64_t, int>> tofHistory;  // Distance set at each time
+static int tofResult = 8190;               // Last completed range ("out of range" until a value is set)
+static uint64_t tofNextReady = 0;
+static bool tofIrqPending = false;
+static bool tofInterruptWired = true;
+
+// Interrupt handlers, dispatched on pin edges by hostServiceInterrupts()
+static void (*pinHandlers[HOST_NUM_PINS])() = {nullptr};
+static int pinHandlerModes[HOST_NUM_PINS];
+static int pinDispatchedLevels[HOST_NUM_PINS];
+
+// Hardware timers, run by advanceClock()
+const int HOST_MAX_TIMERS = 4;
+static HardwareTimer *timers[HOST_MAX_TIMERS];
+static int numTimers = 0;
+static bool inTimerHandler = false;
+
+// Scheduled pin changes, applied by advanceClock() in time order
+struct PinChange {
+  uint64_t atMicros;
+  int pin;
+  int level;
+};
+static std::vector<PinChange> pinSchedule;  // Sorted by time
+static size_t nextPinChange = 0;
+
+// Interrupt time override (hostBeginInterrupt)
+static bool interruptClock = false;
+static uint64_t interruptMicros = 0;
+
+static void initPins() {
+  if (pinsInitialized) {
+    return;
+  }
+  for (int i = 0; i < HOST_NUM_PINS; i++) {
+    pinLevels[i] = HIGH;  // Buttons use INPUT_PULLUP: released reads HIGH
+    analogValues[i] = HOST_DEFAULT_POT;
+  }
+  devicePresent[HOST_TOF_ADDRESS] = true;
+  devicePresent[HOST_ACCEL_ADDRESS] = true;
+  pinsInitialized = true;
+}
+
+/////////////////////
+// Host driver API
+/////////////////////
+
+uint64_t hostMicros() {
+  return simMicros;
+}
+
+/**
+ * Move the clock forward, applying scheduled pin changes and firing each
+ * due timer overflow at its own time (a change and an overflow at the same
+ * time: the overflow sees the new level)
+ */
+static void advanceClock(uint64_t us) {
+  uint64_t end = simMicros + us;
+  if (!inTimerHandler) {
+    inTimerHandler = true;
+    for (;;) {
+      HardwareTimer *due = nullptr;
+      for (int i = 0; i < numTimers; i++) {
+        if (timers[i]->running && timers[i]->handler && timers[i]->nextMicros <= end &&
+            (!due || timers[i]->nextMicros < due->nextMicros)) {
+          due = timers[i];
+        }
+      }
+      if (nextPinChange < pinSchedule.size() && pinSchedule[nextPinChange].atMicros <= end &&
+          (!due || pinSchedule[nextPinChange].atMicros <= due->nextMicros)) {
+        const PinChange &change = pinSchedule[nextPinChange++];
+        simMicros = change.atMicros > simMicros ? change.atMicros : simMicros;
+        hostSetPin(change.pin, change.level);
+        continue;
+      }
+      if (!due) {
+        break;
+      }
+      simMicros = due->nextMicros > simMicros ? due->nextMicros : simMicros;
+      due->nextMicros += due->periodMicros;
+      due->handler();
+    }
+    inTimerHandler = false;
+  }
+  simMicros = end > simMicros ? end : simMicros;
+}
+
+void hostAdvanceMicros(uint64_t us) {
+  advanceClock(us);
+}
+
+void hostBeginInterrupt(uint64_t atMicros) {
+  interruptClock = true;
+  interruptMicros = atMicros;
+}
+
+void hostEndInterrupt() {
+  interruptClock = false;
+}
+
+void hostSetPin(int pin, int level) {
+  initPins();
+  if (pin >= 0 && pin < HOST_NUM_PINS) {
+    pinLevels[pin] = level;
+  }
+}
+
+void hostSchedulePin(uint64_t atMicros, int pin, int level) {
+  PinChange change = {atMicros, pin, level};
+  size_t i = pinSchedule.size();
+  pinSchedule.push_back(change);
+  while (i > nextPinChange && pinSchedule[i - 1].atMicros > atMicros) {
+    pinSchedule[i] = pinSchedule[i - 1];
+    i--;
+  }
+  pinSchedule[i] = change;
+}
+
+void hostSetAnalog(int pin, int value) {
+  initPins();
+  if (pin >= 0 && pin < HOST_NUM_PINS) {
+    analogValues[pin] = value;
+  }
+}
+
+void hostSetDevicePresent(uint8_t address, bool present) {
+  initPins();
+  devicePresent[address & 0x7F] = present;
+}
+
+void hostSetDistance(int mm) {
+  tofHistory.push_back(std::make_pair(simMicros, mm));
+}
+
+/**
+ * Distance the hand was at, at a past time
+ */
+static int tofDistanceAt(uint64_t atMicros) {
+  int mm = 8190;
+  for (size_t i = tofHistory.size(); i-- > 0;) {
+    if (tofHistory[i].first <= atMicros) {
+      mm = tofHistory[i].second;
+      break;
+    }
+  }
+  return mm;
+}
+
+void hostSetAccel(float x, float y, float z) {
+  accelX = x;
+  accelY = y;
+  accelZ = z;
+}
+
+void hostSetI2cLatency(uint32_t us) {
+  i2cLatency = us;
+}
+
+void hostSetTofInterruptWired(bool wired) {
+  tofInterruptWired = wired;
+}
+
+static void setTofGpio(bool asserted) {
+  if (tofInterruptWired) {
+    hostSetPin(HOST_TOF_INT_PIN, asserted ? LOW : HIGH);
+  }
+}
+
+void hostServiceInterrupts() {
+  initPins();
+  if (tofRanging && simMicros >= tofNextReady) {
+    uint64_t readyMicros = tofNextReady;
+    while (tofNextReady <= simMicros) {
+      readyMicros = tofNextReady;
+      tofNextReady += tofPeriodMicros;
+    }
+    // A range integrates over the timing budget before it: report the
+    // distance at the middle of it
+    uint64_t half = tofBudgetMicros / 2;
+    tofResult = tofDistanceAt(readyMicros > half ? readyMicros - half : 0);
+    tofIrqPending = true;
+    setTofGpio(true);
+  }
+
+  for (int pin = 0; pin < HOST_NUM_PINS; pin++) {
+    if (!pinHandlers[pin] || pinLevels[pin] == pinDispatchedLevels[pin]) {
+      continue;
+    }
+    bool falling = pinLevels[pin] == LOW;
+    pinDispatchedLevels[pin] = pinLevels[pin];
+    int mode = pinHandlerModes[pin];
+    if (mode == CHANGE || (mode == FALLING && falling) || (mode == RISING && !falling)) {
+      pinHandlers[pin]();
+    }
+  }
+}
+
+void hostSetSerialMuted(bool muted) {
+  serialMuted = muted;
+}
+
+int hostPinFromName(const char *name) {
+  if (name[0] == 'D' || name[0] == 'd') {
+    return atoi(name + 1);
+  }
+  if (name[0] == 'A' || name[0] == 'a') {
+    return A0 + atoi(name + 1);
+  }
+  return -1;
+}
+
+/////////////////////
+// Arduino core
+/////////////////////
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+unsigned long millis() {
+  return (unsigned long)((interruptClock ? interruptMicros : simMicros) / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)(interruptClock ? interruptMicros : simMicros);
+}
+
+void delay(unsigned long ms) {
+  advanceClock((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  advanceClock(us);
+}
+
+void pinMode(int pin, int mode) {
+  (void)pin;
+  (void)mode;
+  initPins();
+}
+
+int digitalRead(int pin) {
+  initPins();
+  return (pin >= 0 && pin < HOST_NUM_PINS) ? pinLevels[pin] : LOW;
+}
+
+void digitalWrite(int pin, int value) {
+  hostSetPin(pin, value);
+}
+
+int analogRead(int pin) {
+  initPins();
+  return (pin >= 0 && pin < HOST_NUM_PINS) ? analogValues[pin] : 0;
+}
+
+void attachInterrupt(int interrupt, void (*handler)(), int mode) {
+  initPins();
+  if (interrupt >= 0 && interrupt < HOST_NUM_PINS) {
+    pinHandlers[interrupt] = handler;
+    pinHandlerModes[interrupt] = mode;
+    pinDispatchedLevels[interrupt] = pinLevels[interrupt];
+  }
+}
+
+void detachInterrupt(int interrupt) {
+  if (interrupt >= 0 && interrupt < HOST_NUM_PINS) {
+    pinHandlers[interrupt] = nullptr;
+  }
+}
+
+/////////////////////
+// Serial
+/////////////////////
+
+/**
+ * Move bytes between the pseudo-terminal and the Serial buffers
+ */
+static void pollSerialPty() {
+  if (serialPty < 0) {
+    return;
+  }
+  if (!serialOutput.empty()) {
+    ssize_t n = write(serialPty, serialOutput.data(), serialOutput.size());
+    if (n > 0) {
+      serialOutput.erase(0, (size_t)n);
+    }
+  }
+  char buf[256];
+  ssize_t n;
+  while ((n = read(serialPty, buf, sizeof(buf))) > 0) {
+    serialInput.append(buf, (size_t)n);
+  }
+}
+
+static size_t serialOut(const char *data, size_t length) {
+  if (serialPty >= 0) {
+    length = std::min(length, HOST_PTY_BUFFER - serialOutput.size());
+    serialOutput.append(data, length);
+    pollSerialPty();
+    return length;
+  }
+  if (!serialMuted) {
+    fwrite(data, 1, length, stderr);
+  }
+  return length;
+}
+
+static size_t emit(const char *s) {
+  return serialOut(s, strlen(s));
+}
+
+static size_t emitNumber(unsigned long long n, bool negative, int base) {
+  char buf[72];
+  char *p = buf + sizeof(buf) - 1;
+  *p = '\0';
+  if (base < 2) base = DEC;
+  do {
+    int digit = (int)(n % (unsigned)base);
+    *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    n /= (unsigned)base;
+  } while (n > 0);
+  if (negative) *--p = '-';
+  return emit(p);
+}
+
+size_t Print::write(uint8_t c) {
+  char s[2] = {(char)c, '\0'};
+  return emit(s);
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  return serialOut((const char *)buffer, size);
+}
+
+size_t Print::print(const char *s) { return emit(s); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(int n, int base) { return print((long)n, base); }
+size_t Print::print(unsigned int n, int base) { return emitNumber(n, false, base); }
+size_t Print::print(unsigned long n, int base) { return emitNumber(n, false, base); }
+
+size_t Print::print(long n, int base) {
+  if (base == DEC && n < 0) {
+    return emitNumber((unsigned long long)(-(long long)n), true, base);
+  }
+  return emitNumber((unsigned long)n, false, base);
+}
+
+size_t Print::print(double n, int digits) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return emit(buf);
+}
+
+size_t Print::println() { return emit("\r\n"); }
+size_t Print::println(const char *s) { return print(s) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(int n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned int n, int base) { return print(n, base) + println(); }
+size_t Print::println(long n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned long n, int base) { return print(n, base) + println(); }
+size_t Print::println(double n, int digits) { return print(n, digits) + println(); }
+
+void HostSerial::begin(unsigned long baud) { (void)baud; }
+int HostSerial::available() {
+  pollSerialPty();
+  return (int)serialInput.size();
+}
+
+int HostSerial::read() {
+  if (serialInput.empty()) {
+    return -1;
+  }
+  int c = (unsigned char)serialInput[0];
+  serialInput.erase(0, 1);
+  return c;
+}
+int HostSerial::availableForWrite() {
+  return serialPty >= 0 ? (int)(HOST_PTY_BUFFER - serialOutput.size()) : 4096;
+}
+void HostSerial::flush() { fflush(stderr); }
+
+void hostSerialInput(const char *text) {
+  serialInput += text;
+}
+
+const char *hostOpenSerialPty() {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    return nullptr;
+  }
+  const char *path = ptsname(master);
+  // Raw from the start, so nothing is echoed or translated before a client
+  // opens it; holding the slave open keeps the master readable meanwhile
+  int slave = path ? open(path, O_RDWR | O_NOCTTY) : -1;
+  if (slave < 0) {
+    close(master);
+    return nullptr;
+  }
+  struct termios settings;
+  tcgetattr(slave, &settings);
+  cfmakeraw(&settings);
+  tcsetattr(slave, TCSANOW, &settings);
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+  serialPty = master;
+  return path;
+}
+
+/////////////////////
+// ADC
+/////////////////////
+
+/**
+ * Seed analog inputs A0-A6 by GPIO (the pins the firmware configures)
+ */
+static const dsy_gpio_pin seedAnalogPins[] = {
+  {DSY_GPIOC, 0}, {DSY_GPIOA, 3}, {DSY_GPIOB, 1}, {DSY_GPIOA, 7}, {DSY_GPIOA, 6}, {DSY_GPIOC, 1}, {DSY_GPIOC, 4},
+};
+
+void daisy::AdcHandle::Init(AdcChannelConfig *cfg, size_t numChannels, OverSampling ovs) {
+  (void)ovs;
+  channels = numChannels < 8 ? numChannels : 8;
+  for (size_t i = 0; i < channels; i++) {
+    pins[i] = -1;
+    for (int a = 0; a < (int)(sizeof(seedAnalogPins) / sizeof(seedAnalogPins[0])); a++) {
+      if (cfg[i].pin.port == seedAnalogPins[a].port && cfg[i].pin.pin == seedAnalogPins[a].pin) {
+        pins[i] = A0 + a;
+      }
+    }
+  }
+}
+
+uint16_t daisy::AdcHandle::Get(uint8_t chn) const {
+  if (chn >= channels || pins[chn] < 0) {
+    return 0;
+  }
+  int level = constrain(analogRead(pins[chn]), 0, 1023);
+  return (uint16_t)((uint32_t)level * 65535 / 1023);
+}
+
+/////////////////////
+// QSPI flash
+/////////////////////
+
+daisy::QSPIHandle::Result daisy::QSPIHandle::Init(const Config &config) {
+  (void)config;
+  return flashFailing ? ERR : OK;
+}
+
+daisy::QSPIHandle::Result daisy::QSPIHandle::EraseSector(uint32_t address) {
+  if (flashFailing || address >= HOST_FLASH_SIZE) {
+    return ERR;
+  }
+  address -= address % HOST_FLASH_SECTOR;
+  memset(&flashMemory[address], 0xFF, HOST_FLASH_SECTOR);
+  hostAdvanceMicros(HOST_FLASH_ERASE_US);
+  return OK;
+}
+
+daisy::QSPIHandle::Result daisy::QSPIHandle::Write(uint32_t address, uint32_t size, uint8_t *buffer) {
+  if (flashFailing || address + size > HOST_FLASH_SIZE) {
+    return ERR;
+  }
+  for (uint32_t i = 0; i < size; i++) {
+    flashMemory[address + i] &= buffer[i];  // NOR programming only clears bits
+  }
+  hostAdvanceMicros(HOST_FLASH_PROGRAM_US * ((size + HOST_FLASH_PAGE - 1) / HOST_FLASH_PAGE));
+  return OK;
+}
+
+void *daisy::QSPIHandle::GetData(uint32_t offset) {
+  return &flashMemory[offset];
+}
+
+bool hostLoadFlash(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return false;  // First run: the flash starts erased
+  }
+  size_t n = fread(flashMemory.data(), 1, flashMemory.size(), f);
+  fclose(f);
+  return n == flashMemory.size();
+}
+
+bool hostSaveFlash(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    return false;
+  }
+  size_t n = fwrite(flashMemory.data(), 1, flashMemory.size(), f);
+  fclose(f);
+  return n == flashMemory.size();
+}
+
+void hostSetFlashFailing(bool failing) {
+  flashFailing = failing;
+}
+
+/////////////////////
+// DaisyDuino
+/////////////////////
+
+DaisyHardware AudioClass::init(DaisyBoard board, DaisyAudioSampleRate sr) {
+  (void)board;
+  sampleRate = (float)sr;
+  initPins();
+  return DaisyHardware();
+}
+
+void AudioClass::begin(DaisyDuinoCallback cb) {
+  callback = cb;
+}
+
+void AudioClass::end() {
+  callback = nullptr;
+}
+
+void Switch::Init(float updateRate, bool invertLogic, int switchPin, int mode) {
+  (void)updateRate;
+  (void)mode;
+  pin = switchPin;
+  invert = invertLogic;
+  pressed = false;
+  wasPressed = false;
+}
+
+void Switch::Debounce() {
+  wasPressed = pressed;
+  bool level = digitalRead(pin) == HIGH;
+  pressed = invert ? !level : level;
+}
+
+/////////////////////
+// Hardware timers
+/////////////////////
+
+HardwareTimer::HardwareTimer(TIM_TypeDef *instance) {
+  (void)instance;
+  if (numTimers < HOST_MAX_TIMERS) {
+    timers[numTimers++] = this;
+  }
+}
+
+void HardwareTimer::setOverflow(uint32_t value, TimerFormat_t format) {
+  if (format == HERTZ_FORMAT) {
+    periodMicros = value > 0 ? 1000000 / value : 1000000;
+  } else {
+    periodMicros = value > 0 ? value : 1;  // Ticks are taken as microseconds
+  }
+}
+
+void HardwareTimer::attachInterrupt(void (*callback)()) {
+  handler = callback;
+}
+
+void HardwareTimer::resume() {
+  if (!running) {
+    running = true;
+    nextMicros = simMicros + periodMicros;
+  }
+}
+
+void HardwareTimer::pause() {
+  running = false;
+}
+
+/////////////////////
+// I2C and sensors
+/////////////////////
+
+/**
+ * Advance the clock by a transfer of `bytes` bytes plus the address byte
+ * (9 clocks each, ACK included) and the injected latency
+ */
+static void chargeBus(int bytes) {
+  uint64_t nanos = (uint64_t)(bytes + 1) * 9 * 1000000000ULL / i2cClock + i2cNanosRemainder;
+  advanceClock(nanos / 1000 + i2cLatency);
+  i2cNanosRemainder = nanos % 1000;
+}
+
+static void writeRegister(uint8_t address, uint8_t reg, uint8_t value) {
+  if (address == HOST_TOF_ADDRESS && reg == 0x0B && (value & 0x01)) {
+    tofIrqPending = false;  // SYSTEM_INTERRUPT_CLEAR releases GPIO1
+    setTofGpio(false);
+  }
+}
+
+static uint8_t readRegister(uint8_t address, uint8_t reg) {
+  if (address == HOST_TOF_ADDRESS) {
+    bool valid = tofResult < 8190;
+    switch (reg) {
+      case 0x13: return tofIrqPending ? 0x04 : 0x00;        // RESULT_INTERRUPT_STATUS
+      case 0x14: return (uint8_t)((valid ? 11 : 4) << 3);   // RESULT_RANGE_STATUS
+      case 0x1E: return (uint8_t)(tofResult >> 8);          // Range, big endian
+      case 0x1F: return (uint8_t)(tofResult & 0xFF);
+      default: return 0;
+    }
+  }
+  if (address == HOST_ACCEL_ADDRESS && reg >= 0x02 && reg <= 0x07) {
+    const float axes[3] = {accelX, accelY, accelZ};
+    int axis = (reg - 0x02) / 2;
+    // 14-bit, +-4g (2048 LSB/g), left-justified, LSB first
+    long counts = lroundf(axes[axis] / 9.80665f * 2048.0f);
+    counts = constrain(counts, -8192L, 8191L);
+    uint16_t raw = (uint16_t)(int16_t)(counts * 4);
+    return (reg & 1) ? (uint8_t)(raw >> 8) : (uint8_t)(raw & 0xFF);
+  }
+  return 0;
+}
+
+void TwoWire::begin() {
+  initPins();
+}
+
+void TwoWire::setClock(uint32_t freq) {
+  if (freq > 0) {
+    i2cClock = freq;
+  }
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddress = address;
+  txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLength >= HOST_WIRE_BUFFER) {
+    return 0;
+  }
+  txBuffer[txLength++] = data;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  (void)sendStop;
+  uint8_t address = txAddress & 0x7F;
+  chargeBus(txLength);
+  if (!devicePresent[address]) {
+    return 2;  // Address NACK
+  }
+  if (txLength > 0) {
+    registerPointer[address] = txBuffer[0];
+    for (int i = 1; i < txLength; i++) {
+      writeRegister(address, (uint8_t)(txBuffer[0] + i - 1), txBuffer[i]);
+    }
+  }
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+  address &= 0x7F;
+  rxLength = 0;
+  rxIndex = 0;
+  chargeBus(quantity);
+  if (!devicePresent[address]) {
+    return 0;
+  }
+  for (int i = 0; i < quantity && i < HOST_WIRE_BUFFER; i++) {
+    rxBuffer[rxLength++] = readRegister(address, registerPointer[address]++);
+  }
+  return (uint8_t)rxLength;
+}
+
+/**
+ * Time `bytes` bytes plus the address byte take on the wire (the HAL
+ * calls do not move the clock; their transfer ends this much later)
+ */
+static uint64_t busMicros(int bytes) {
+  return (uint64_t)(bytes + 1) * 9 * 1000000ULL / i2cClock;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint16_t memAddress,
+                                      uint16_t memAddSize, uint8_t *data, uint16_t size) {
+  (void)memAddSize;
+  if (HAL_I2C_GetState(hi2c) != HAL_I2C_STATE_READY) {
+    return HAL_BUSY;
+  }
+  hi2c->State = HAL_I2C_STATE_BUSY_RX;
+  hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+  hi2c->address = (uint8_t)((devAddress >> 1) & 0x7F);
+  hi2c->tx[0] = (uint8_t)memAddress;
+  hi2c->txLength = 1;
+  hi2c->rx = data;
+  hi2c->rxLength = size;
+  hi2c->doneMicros = simMicros + busMicros(1) + busMicros(size) + i2cLatency;  // Repeated start between
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint8_t *data,
+                                             uint16_t size) {
+  if (HAL_I2C_GetState(hi2c) != HAL_I2C_STATE_READY) {
+    return HAL_BUSY;
+  }
+  if (size > HOST_WIRE_BUFFER) {
+    return HAL_ERROR;
+  }
+  hi2c->State = HAL_I2C_STATE_BUSY_TX;
+  hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+  hi2c->address = (uint8_t)((devAddress >> 1) & 0x7F);
+  memcpy(hi2c->tx, data, size);
+  hi2c->txLength = size;
+  hi2c->rx = nullptr;
+  hi2c->rxLength = 0;
+  hi2c->doneMicros = simMicros + busMicros(size) + i2cLatency;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t devAddress) {
+  (void)devAddress;
+  hi2c->State = HAL_I2C_STATE_READY;
+  hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+  return HAL_OK;
+}
+
+/**
+ * The transfer's "interrupts" all run here, once it is due: the device
+ * model sees the bytes and the handle returns to READY
+ */
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c) {
+  if (hi2c->State == HAL_I2C_STATE_READY || simMicros < hi2c->doneMicros) {
+    return hi2c->State;
+  }
+  uint8_t address = hi2c->address;
+  if (!devicePresent[address]) {
+    hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+  } else {
+    registerPointer[address] = hi2c->tx[0];
+    for (int i = 1; i < hi2c->txLength; i++) {
+      writeRegister(address, (uint8_t)(hi2c->tx[0] + i - 1), hi2c->tx[i]);
+    }
+    for (int i = 0; i < hi2c->rxLength; i++) {
+      hi2c->rx[i] = readRegister(address, registerPointer[address]++);
+    }
+  }
+  hi2c->State = HAL_I2C_STATE_READY;
+  return hi2c->State;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c) {
+  return hi2c->ErrorCode;
+}
+
+int TwoWire::available() {
+  return rxLength - rxIndex;
+}
+
+int TwoWire::read() {
+  return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1;
+}
+
+bool Adafruit_VL53L0X::begin(uint8_t address, bool debug, TwoWire *i2c) {
+  (void)debug;
+  (void)i2c;
+  initPins();
+  return devicePresent[address & 0x7F];
+}
+
+bool Adafruit_VL53L0X::configSensor(VL53L0X_Sense_config_t config) {
+  switch (config) {
+    case VL53L0X_SENSE_LONG_RANGE: tofBudgetMicros = 33000; break;
+    case VL53L0X_SENSE_HIGH_SPEED: tofBudgetMicros = 20000; break;
+    case VL53L0X_SENSE_HIGH_ACCURACY: tofBudgetMicros = 200000; break;
+    default: tofBudgetMicros = 33000; break;
+  }
+  return true;
+}
+
+bool Adafruit_VL53L0X::setMeasurementTimingBudgetMicroSeconds(uint32_t budgetMicros) {
+  tofBudgetMicros = budgetMicros;
+  return true;
+}
+
+bool Adafruit_VL53L0X::startRangeContinuous(uint16_t periodMs) {
+  // Back to back when the period is shorter than a measurement
+  tofPeriodMicros = std::max<uint64_t>((uint64_t)periodMs * 1000, tofBudgetMicros);
+  tofNextReady = simMicros + tofPeriodMicros;
+  tofIrqPending = false;
+  tofRanging = true;
+  return true;
+}
+
+bool Adafruit_VL53L0X::isRangeComplete() {
+  return tofIrqPending;
+}
+
+uint16_t Adafruit_VL53L0X::readRange() {
+  writeRegister(HOST_TOF_ADDRESS, 0x0B, 0x01);
+  return (uint16_t)tofResult;
+}
+
+bool Adafruit_MSA301::begin(uint8_t address, TwoWire *wire) {
+  (void)wire;
+  initPins();
+  return devicePresent[address & 0x7F];
+}
+
+void Adafruit_MSA301::read() {
+  x = accelX;
+  y = accelY;
+  z = accelZ;
+}
@@ -0,0 +1,89 @@
+/**
+ * HostPlatform - simulated hardware state behind the host stubs
+ *
+ * The host driver (HostRender.cpp) uses these to move the simulated clock,
+ * press buttons, turn the pot and feed sensor values, then pulls audio
+ * through the callback the firmware registered with DAISY.begin().
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+const uint8_t HOST_TOF_ADDRESS = 0x29;
+const uint8_t HOST_ACCEL_ADDRESS = 0x26;
+const int HOST_TOF_INT_PIN = 7;  // Where the firmware expects VL53L0X GPIO1
+
+uint64_t hostMicros();
+void hostAdvanceMicros(uint64_t us);
+
+void hostSetPin(int pin, int level);
+
+/**
+ * Change a pin's level at an exact time, even in the middle of a loop()
+ * iteration (timer interrupts sampling it see the change when it happens)
+ */
+void hostSchedulePin(uint64_t atMicros, int pin, int level);
+void hostSetAnalog(int pin, int value);
+
+void hostSetDevicePresent(uint8_t address, bool present);
+void hostSetDistance(int mm);
+void hostSetAccel(float x, float y, float z);
+
+/**
+ * Extra time every I2C transfer takes (clock stretching, a slow bus)
+ */
+void hostSetI2cLatency(uint32_t us);
+
+/**
+ * Leave VL53L0X GPIO1 unconnected: the firmware must fall back to polling
+ */
+void hostSetTofInterruptWired(bool wired);
+
+/**
+ * Complete due VL53L0X ranges and run interrupt handlers whose pin edge
+ * occurred; call between loop() iterations
+ */
+void hostServiceInterrupts();
+
+/**
+ * Run an interrupt handler at an earlier time: until hostEndInterrupt(),
+ * micros() and millis() read atMicros. The driver renders audio blocks
+ * after the fact, so it wraps each callback in these with the block's start.
+ */
+void hostBeginInterrupt(uint64_t atMicros);
+void hostEndInterrupt();
+
+void hostSetSerialMuted(bool muted);
+
+/**
+ * Queue bytes for the firmware to read from Serial (its command keys)
+ */
+void hostSerialInput(const char *text);
+
+/**
+ * Connect Serial to a new pseudo-terminal instead: output goes to it (up to
+ * 4 KB the other end has not read; availableForWrite() says how much
+ * room is left) and input comes from it. Returns the path a client opens,
+ * or null.
+ */
+const char *hostOpenSerialPty();
+
+/**
+ * Load the emulated QSPI flash from an image file (false if there is none
+ * yet: the flash stays erased) and save it back after a run, so the next
+ * run boots from what this one stored
+ */
+bool hostLoadFlash(const char *path);
+bool hostSaveFlash(const char *path);
+
+/**
+ * Make every QSPI operation fail (a missing or dead flash chip)
+ */
+void hostSetFlashFailing(bool failing);
+
+/**
+ * Resolve a Daisy pin name ("D8", "A5") to the number the stubs use
+ * Returns -1 for unknown names
+ */
+int hostPinFromName(const char *name);
@@ -0,0 +1,666 @@
+/**
+ * Offline renderer for the native build
+ *
+ * Runs the unmodified firmware (setup()/loop() from main.cpp) against the
+ * host stubs with a simulated clock, replays a gesture script into the
+ * simulated buttons, pot and sensors, pulls audio through the registered
+ * AudioCallback, writes a WAV file and reports the firmware's own CpuMeter
+ * stats (nanosecond ticks on the host).
+ *
+ * Usage: program <script.txt> [-o out.wav] [-b blocksize] [-q] [--no-tof] [--no-accel]
+ *                [--no-tof-int] [--i2c-latency us] [--record trace.txt] [--replay trace.txt]
+ *                [--midi out.txt] [--flash image.bin] [--no-flash] [--pty]
+ *        program --bench [name]
+ *
+ * --no-tof-int leaves the VL53L0X data-ready pin unconnected (the firmware
+ * falls back to polling); --i2c-latency adds time to every I2C transfer.
+ * --bench runs the engine micro-benchmarks in HostBench.cpp instead.
+ *
+ * --record saves the firmware's input trace (InputTrace.h) of the run;
+ * --replay feeds a trace (or a serial log containing '@' lines) back into
+ * the firmware in place of the live inputs, and the script becomes optional.
+ * Rendering a recorded run's trace reproduces its audio bit-exactly.
+ *
+ * --midi writes every MIDI packet the firmware sent (MidiOut.h), one line
+ * per packet: frame time in us, the four packet bytes and a decoding.
+ *
+ * --flash loads the emulated QSPI flash (presets, last state, calibration,
+ * sensor configuration) from an image file before setup() and saves it
+ * back after the run, so a second run boots like a power cycle; without
+ * it every run starts from erased flash. --no-flash makes the flash fail.
+ * --pty connects the firmware's serial port to a pseudo-terminal (its path
+ * is printed) and runs in real time, so a client such as
+ * tools/telemetry.py can talk to it; no WAV is written, and without a
+ * script it runs until interrupted.
+ * The time setup() took on the simulated clock is reported as boot time,
+ * and each control task's runs, late starts and overruns after the render
+ * (simulated time: only I2C transfers and delays take any).
+ *
+ * When the script moves the distance, the morph position the engine
+ * rendered each block is compared with the distance the script set: the
+ * delay at which the two correlate best is reported as gesture-to-sound
+ * latency, with the largest morph step in one block (zipper noise).
+ *
+ * Script lines (times in ms, '#' starts a comment):
+ *   100  press D8          button down (INPUT_PULLUP: pin goes LOW), at that exact
+ *                          time, even mid-iteration
+ *   600  release D8        button up
+ *   0    pot 800           volume pot (A5) raw ADC value 0-1023
+ *   0    analog A3 512     any analog pin
+ *   200  tof 120           VL53L0X distance in mm
+ *   300  accel 0.5 0 9.8   MSA301 acceleration (y and z optional)
+ *   300  accel-trace t.csv replay recorded MSA301 readings from this time on
+ *                          (lines "ms x y z", ms relative to the command;
+ *                          path relative to the script)
+ *   300  tof-trace t.csv   replay recorded VL53L0X distances the same way
+ *                          (lines "ms mm")
+ *   0    serial a          send characters to the firmware's serial commands
+ *   4000 end               stop rendering
+ */
+
+// The unit tests (test/, `pio test -e native`) link the firmware and the
+// host stubs with their own main()
+#ifndef PIO_UNIT_TESTING
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include "ButtonScanner.h"
+#include "CpuMeter.h"
+#include "DaisyDuino.h"
+#include "HostBench.h"
+#include "HostPlatform.h"
+#include "InputTrace.h"
+#include "MidiOut.h"
+#include "SynthEngine.h"
+#include "TaskScheduler.h"
+
+void setup();
+void loop();
+extern ButtonScanner buttonScanner;
+extern SynthEngine synth;
+extern TaskScheduler scheduler;
+
+enum ScriptCommand {
+  CMD_PRESS,
+  CMD_RELEASE,
+  CMD_ANALOG,
+  CMD_TOF,
+  CMD_ACCEL,
+  CMD_SERIAL,
+  CMD_END
+};
+
+struct ScriptEvent {
+  unsigned long timeMs;
+  ScriptCommand command;
+  int pin;
+  float values[3];
+  char text[16];
+};
+
+/**
+ * Expand a sensor trace into CMD_ACCEL ("ms x y z") or CMD_TOF ("ms mm")
+ * events starting at startMs
+ */
+static bool loadSensorTrace(const std::string &path, ScriptCommand command, unsigned long startMs,
+                            std::vector<ScriptEvent> &events, unsigned long &endMs) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f) {
+    fprintf(stderr, "Cannot open sensor trace %s\n", path.c_str());
+    return false;
+  }
+  int columns = command == CMD_ACCEL ? 4 : 2;
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    char *hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    ScriptEvent evt;
+    memset(&evt, 0, sizeof(evt));
+    float ms = 0.0f;
+    if (sscanf(line, "%f %f %f %f", &ms, &evt.values[0], &evt.values[1], &evt.values[2]) < columns) {
+      continue;
+    }
+    evt.timeMs = startMs + (unsigned long)(ms + 0.5f);
+    evt.command = command;
+    events.push_back(evt);
+    endMs = std::max(endMs, evt.timeMs);
+  }
+  fclose(f);
+  return true;
+}
+
+static bool parseScript(const char *path, std::vector<ScriptEvent> &events, unsigned long &endMs) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "Cannot open script %s\n", path);
+    return false;
+  }
+
+  char line[256];
+  int lineNumber = 0;
+  endMs = 0;
+  while (fgets(line, sizeof(line), f)) {
+    lineNumber++;
+    char *hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+
+    char cmd[32] = {0};
+    char arg[128] = {0};
+    unsigned long t = 0;
+    ScriptEvent evt;
+    memset(&evt, 0, sizeof(evt));
+    evt.values[2] = 9.81f;
+
+    int fields = sscanf(line, "%lu %31s %127s", &t, cmd, arg);
+    if (fields <= 0) {
+      continue;
+    }
+    evt.timeMs = t;
+
+    if (fields >= 3 && strcmp(cmd, "press") == 0) {
+      evt.command = CMD_PRESS;
+      evt.pin = hostPinFromName(arg);
+    } else if (fields >= 3 && strcmp(cmd, "release") == 0) {
+      evt.command = CMD_RELEASE;
+      evt.pin = hostPinFromName(arg);
+    } else if (fields >= 3 && strcmp(cmd, "pot") == 0) {
+      evt.command = CMD_ANALOG;
+      evt.pin = A5;
+      evt.values[0] = (float)atof(arg);
+    } else if (fields >= 3 && strcmp(cmd, "analog") == 0) {
+      evt.command = CMD_ANALOG;
+      evt.pin = hostPinFromName(arg);
+      sscanf(line, "%*u %*s %*s %f", &evt.values[0]);
+    } else if (fields >= 3 && strcmp(cmd, "tof") == 0) {
+      evt.command = CMD_TOF;
+      evt.values[0] = (float)atof(arg);
+    } else if (fields >= 3 && strcmp(cmd, "accel") == 0) {
+      evt.command = CMD_ACCEL;
+      sscanf(line, "%*u %*s %f %f %f", &evt.values[0], &evt.values[1], &evt.values[2]);
+    } else if (fields >= 3 && (strcmp(cmd, "accel-trace") == 0 || strcmp(cmd, "tof-trace") == 0)) {
+      std::string tracePath = arg;
+      const char *slash = strrchr(path, '/');
+      if (tracePath[0] != '/' && slash) {
+        tracePath = std::string(path, slash + 1) + tracePath;
+      }
+      ScriptCommand command = strcmp(cmd, "tof-trace") == 0 ? CMD_TOF : CMD_ACCEL;
+      if (!loadSensorTrace(tracePath, command, t, events, endMs)) {
+        fclose(f);
+        return false;
+      }
+      continue;
+    } else if (fields >= 3 && strcmp(cmd, "serial") == 0) {
+      evt.command = CMD_SERIAL;
+      snprintf(evt.text, sizeof(evt.text), "%s", arg);
+    } else if (fields >= 2 && strcmp(cmd, "end") == 0) {
+      evt.command = CMD_END;
+    } else {
+      fprintf(stderr, "%s:%d: cannot parse '%s'\n", path, lineNumber, line);
+      fclose(f);
+      return false;
+    }
+    if ((evt.command == CMD_PRESS || evt.command == CMD_RELEASE || evt.command == CMD_ANALOG) && evt.pin < 0) {
+      fprintf(stderr, "%s:%d: unknown pin '%s'\n", path, lineNumber, arg);
+      fclose(f);
+      return false;
+    }
+
+    events.push_back(evt);
+    endMs = std::max(endMs, t);
+  }
+  fclose(f);
+
+  std::stable_sort(events.begin(), events.end(), [](const ScriptEvent &a, const ScriptEvent &b) {
+    return a.timeMs < b.timeMs;
+  });
+  return true;
+}
+
+static void applyEvent(const ScriptEvent &evt) {
+  switch (evt.command) {
+    case CMD_PRESS:
+    case CMD_RELEASE:
+      break;  // Scheduled up front, applied at their exact time
+    case CMD_ANALOG:
+      hostSetAnalog(evt.pin, (int)evt.values[0]);
+      break;
+    case CMD_TOF:
+      hostSetDistance((int)evt.values[0]);
+      break;
+    case CMD_ACCEL:
+      hostSetAccel(evt.values[0], evt.values[1], evt.values[2]);
+      break;
+    case CMD_SERIAL:
+      hostSerialInput(evt.text);
+      break;
+    case CMD_END:
+      break;
+  }
+}
+
+/**
+ * Load the '@' records of a trace or serial log into the firmware's trace
+ */
+static bool loadInputTrace(const char *path, unsigned long &endMs) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "Cannot open trace %s\n", path);
+    return false;
+  }
+  char line[128];
+  InputRecord record;
+  while (fgets(line, sizeof(line), f)) {
+    if (!InputTrace::ParseRecord(line, record)) {
+      continue;
+    }
+    if (!inputTrace.Load(record)) {
+      fprintf(stderr, "Trace %s longer than %zu records, truncated\n", path, INPUT_TRACE_CAPACITY);
+      break;
+    }
+    endMs = std::max(endMs, (unsigned long)(record.timeMicros / 1000));
+  }
+  fclose(f);
+  return true;
+}
+
+static bool saveInputTrace(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    fprintf(stderr, "Cannot write %s\n", path);
+    return false;
+  }
+  char line[INPUT_TRACE_LINE_SIZE];
+  for (size_t i = 0; i < inputTrace.Count(); i++) {
+    size_t length = InputTrace::FormatRecord(inputTrace.At(i), line, sizeof(line));
+    fwrite(line, 1, length, f);
+  }
+  fclose(f);
+  return true;
+}
+
+struct MidiCapture {
+  uint32_t micros;
+  MidiPacket packet;
+};
+
+static std::vector<MidiCapture> midiCapture;
+
+static void captureMidi(const MidiPacket *packets, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    midiCapture.push_back({(uint32_t)hostMicros(), packets[i]});
+  }
+}
+
+static bool saveMidi(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    fprintf(stderr, "Cannot write %s\n", path);
+    return false;
+  }
+  for (const MidiCapture &m : midiCapture) {
+    const MidiPacket &p = m.packet;
+    int channel = (p.status & 0x0F) + 1;
+    fprintf(f, "%10lu  %02X %02X %02X %02X  ch%-2d ", (unsigned long)m.micros, p.header, p.status, p.data1, p.data2,
+            channel);
+    switch (p.status & 0xF0) {
+      case 0x80:
+        fprintf(f, "note-off %d\n", p.data1);
+        break;
+      case 0x90:
+        fprintf(f, "note-on  %d vel %d\n", p.data1, p.data2);
+        break;
+      case 0xB0:
+        fprintf(f, "cc %d = %d\n", p.data1, p.data2);
+        break;
+      case 0xE0:
+        fprintf(f, "bend %+d\n", (p.data1 | (p.data2 << 7)) - 8192);
+        break;
+      default:
+        fprintf(f, "?\n");
+        break;
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static void put16(FILE *f, uint16_t v) {
+  fputc(v & 0xFF, f);
+  fputc(v >> 8, f);
+}
+
+static void put32(FILE *f, uint32_t v) {
+  put16(f, v & 0xFFFF);
+  put16(f, v >> 16);
+}
+
+/**
+ * Write interleaved stereo float samples as a 32-bit float WAV
+ */
+static bool writeWav(const char *path, const std::vector<float> &samples, uint32_t sampleRate) {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    fprintf(stderr, "Cannot write %s\n", path);
+    return false;
+  }
+  uint32_t dataBytes = (uint32_t)(samples.size() * sizeof(float));
+  fwrite("RIFF", 1, 4, f);
+  put32(f, 36 + dataBytes);
+  fwrite("WAVEfmt ", 1, 8, f);
+  put32(f, 16);
+  put16(f, 3);                      // IEEE float
+  put16(f, 2);                      // Stereo
+  put32(f, sampleRate);
+  put32(f, sampleRate * 2 * sizeof(float));
+  put16(f, 2 * sizeof(float));
+  put16(f, 32);
+  fwrite("data", 1, 4, f);
+  put32(f, dataBytes);
+  fwrite(samples.data(), sizeof(float), samples.size(), f);
+  fclose(f);
+  return true;
+}
+
+/**
+ * Morph position at the end of each rendered block, for the latency report
+ */
+struct MorphSample {
+  double timeMs;
+  float morph;
+};
+
+/**
+ * Distance the script had set at a time (a script time in ms)
+ */
+static float scriptDistanceAt(const std::vector<ScriptEvent> &tofEvents, double timeMs) {
+  auto after = std::upper_bound(tofEvents.begin(), tofEvents.end(), timeMs,
+                                [](double t, const ScriptEvent &evt) { return t < (double)evt.timeMs; });
+  return after == tofEvents.begin() ? -1.0f : (after - 1)->values[0];
+}
+
+/**
+ * Gesture-to-sound latency: the delay of the script's distance (within
+ * reach of the sensor) that best correlates with the rendered morph
+ */
+static void reportGestureLatency(const std::vector<ScriptEvent> &events, const std::vector<MorphSample> &morph) {
+  const float REACH_MM = 1200.0f;
+  const int MAX_LAG_MS = 250;
+  std::vector<ScriptEvent> tofEvents;
+  for (const ScriptEvent &evt : events) {
+    if (evt.command == CMD_TOF) {
+      tofEvents.push_back(evt);
+    }
+  }
+  if (tofEvents.size() < 2 || morph.size() < 2) {
+    return;
+  }
+
+  float largestStep = 0.0f;
+  for (size_t i = 1; i < morph.size(); i++) {
+    largestStep = std::max(largestStep, fabsf(morph[i].morph - morph[i - 1].morph));
+  }
+
+  int bestLag = -1;
+  double bestR = 0.0;
+  for (int lag = 0; lag <= MAX_LAG_MS; lag++) {
+    double n = 0, sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+    for (const MorphSample &sample : morph) {
+      float mm = scriptDistanceAt(tofEvents, sample.timeMs - lag);
+      if (mm <= 0.0f || mm > REACH_MM) {
+        continue;  // No hand: nothing to follow
+      }
+      n++;
+      sx += mm;
+      sy += sample.morph;
+      sxx += (double)mm * mm;
+      syy += (double)sample.morph * sample.morph;
+      sxy += (double)mm * sample.morph;
+    }
+    double vx = n * sxx - sx * sx;
+    double vy = n * syy - sy * sy;
+    if (n < 2 || vx <= 0.0 || vy <= 0.0) {
+      continue;
+    }
+    double r = fabs((n * sxy - sx * sy) / sqrt(vx * vy));  // Closer = more morph: r is negative
+    if (r > bestR) {
+      bestR = r;
+      bestLag = lag;
+    }
+  }
+  if (bestLag < 0) {
+    return;  // Morph never moved (not in single-note mode)
+  }
+  printf("Gesture: morph follows distance %d ms late (r %.3f), largest block step %.4f\n", bestLag, bestR,
+         largestStep);
+}
+
+int main(int argc, char **argv) {
+  const char *scriptPath = nullptr;
+  const char *wavPath = "render.wav";
+  const char *recordPath = nullptr;
+  const char *replayPath = nullptr;
+  const char *midiPath = nullptr;
+  const char *flashPath = nullptr;
+  size_t blockSize = 48;
+  bool quiet = false;
+  bool pty = false;
+
+  if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+    return hostRunBench(argc >= 3 ? argv[2] : nullptr);
+  }
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      wavPath = argv[++i];
+    } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      blockSize = (size_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-q") == 0) {
+      quiet = true;
+    } else if (strcmp(argv[i], "--no-tof") == 0) {
+      hostSetDevicePresent(HOST_TOF_ADDRESS, false);
+    } else if (strcmp(argv[i], "--no-accel") == 0) {
+      hostSetDevicePresent(HOST_ACCEL_ADDRESS, false);
+    } else if (strcmp(argv[i], "--no-tof-int") == 0) {
+      hostSetTofInterruptWired(false);
+    } else if (strcmp(argv[i], "--i2c-latency") == 0 && i + 1 < argc) {
+      hostSetI2cLatency((uint32_t)atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      recordPath = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replayPath = argv[++i];
+    } else if (strcmp(argv[i], "--midi") == 0 && i + 1 < argc) {
+      midiPath = argv[++i];
+    } else if (strcmp(argv[i], "--flash") == 0 && i + 1 < argc) {
+      flashPath = argv[++i];
+    } else if (strcmp(argv[i], "--no-flash") == 0) {
+      hostSetFlashFailing(true);
+    } else if (strcmp(argv[i], "--pty") == 0) {
+      pty = true;
+    } else if (argv[i][0] != '-' && !scriptPath) {
+      scriptPath = argv[i];
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if ((!scriptPath && !replayPath && !pty) || blockSize == 0) {
+    fprintf(stderr,
+            "Usage: %s <script.txt> [-o out.wav] [-b blocksize] [-q] [--no-tof] [--no-accel]\n"
+            "       [--no-tof-int] [--i2c-latency us] [--record trace.txt] [--replay trace.txt]\n"
+            "       [--midi out.txt] [--flash image.bin] [--no-flash] [--pty]\n"
+            "       %s --bench [name]\n",
+            argv[0], argv[0]);
+    return 2;
+  }
+
+  std::vector<ScriptEvent> events;
+  unsigned long endMs = 0;
+  if (scriptPath && !parseScript(scriptPath, events, endMs)) {
+    return 1;
+  }
+  if (replayPath) {
+    unsigned long traceEndMs = 0;
+    if (!loadInputTrace(replayPath, traceEndMs)) {
+      return 1;
+    }
+    if (!scriptPath) {
+      endMs = traceEndMs + 500;  // Let release tails finish
+    }
+  }
+  if (pty) {
+    const char *ptyPath = hostOpenSerialPty();
+    if (!ptyPath) {
+      fprintf(stderr, "Cannot open a pseudo-terminal\n");
+      return 1;
+    }
+    printf("Serial port: %s\n", ptyPath);
+    fflush(stdout);
+    if (!scriptPath && !replayPath) {
+      endMs = ~0ul;
+    }
+  }
+
+  for (const ScriptEvent &evt : events) {
+    if (evt.command == CMD_PRESS || evt.command == CMD_RELEASE) {
+      hostSchedulePin((uint64_t)evt.timeMs * 1000, evt.pin, evt.command == CMD_PRESS ? LOW : HIGH);
+    }
+  }
+  hostSetSerialMuted(quiet);
+  DAISY.blockSize = blockSize;
+  if (flashPath && !hostLoadFlash(flashPath)) {
+    printf("No flash image at %s: booting from erased flash\n", flashPath);
+  }
+  uint64_t setupStart = hostMicros();
+  setup();
+  double bootMs = (double)(hostMicros() - setupStart) / 1000.0;
+  if (!DAISY.callback) {
+    fprintf(stderr, "Firmware did not start audio (DAISY.begin not called)\n");
+    return 1;
+  }
+  if (midiPath) {
+    midiOut.SetWriter({captureMidi, nullptr});
+  }
+  if (replayPath) {
+    inputTrace.StartReplay(micros());
+  } else if (recordPath) {
+    inputTrace.StartRecording(micros(), buttonScanner.State());
+  }
+
+  const double sampleRate = DAISY.get_samplerate();
+  std::vector<float> left(blockSize), right(blockSize), silence(blockSize, 0.0f);
+  float *in[2] = {silence.data(), silence.data()};
+  float *out[2] = {left.data(), right.data()};
+  std::vector<float> wav;
+  std::vector<MorphSample> morph;
+  uint64_t renderedSamples = 0;
+  size_t nextEvent = 0;
+  struct timespec wallStart;
+  clock_gettime(CLOCK_MONOTONIC, &wallStart);
+
+  while (millis() < endMs) {
+    while (nextEvent < events.size() && events[nextEvent].timeMs <= millis()) {
+      applyEvent(events[nextEvent++]);
+    }
+
+    hostServiceInterrupts();
+    loop();
+
+    // Render every block whose end falls before the simulated clock
+    uint64_t dueSamples = (uint64_t)((double)hostMicros() * sampleRate / 1.0e6);
+    while (renderedSamples + blockSize <= dueSamples) {
+      hostBeginInterrupt((uint64_t)((double)renderedSamples * 1.0e6 / sampleRate));
+      DAISY.callback(in, out, blockSize);
+      hostEndInterrupt();
+
+      renderedSamples += blockSize;
+      if (pty) {
+        continue;  // Runs for as long as the client wants: nothing is kept
+      }
+      for (size_t i = 0; i < blockSize; i++) {
+        wav.push_back(left[i]);
+        wav.push_back(right[i]);
+      }
+      morph.push_back({(double)renderedSamples * 1000.0 / sampleRate, synth.Morph()});
+    }
+
+    if (pty) {
+      // Hold the simulated clock to the wall clock
+      struct timespec wall;
+      clock_gettime(CLOCK_MONOTONIC, &wall);
+      int64_t wallMicros = (int64_t)(wall.tv_sec - wallStart.tv_sec) * 1000000
+                           + (wall.tv_nsec - wallStart.tv_nsec) / 1000;
+      int64_t ahead = (int64_t)hostMicros() - wallMicros;
+      if (ahead > 0) {
+        struct timespec pause = {(time_t)(ahead / 1000000), (long)(ahead % 1000000) * 1000};
+        nanosleep(&pause, nullptr);
+      }
+    }
+  }
+
+  if (!pty && !writeWav(wavPath, wav, (uint32_t)sampleRate)) {
+    return 1;
+  }
+  if (recordPath) {
+    if (!saveInputTrace(recordPath)) {
+      return 1;
+    }
+    printf("Recorded %zu input records to %s\n", inputTrace.Count(), recordPath);
+  }
+  if (flashPath) {
+    if (!hostSaveFlash(flashPath)) {
+      fprintf(stderr, "Cannot write %s\n", flashPath);
+      return 1;
+    }
+    printf("Saved flash image to %s\n", flashPath);
+  }
+  if (midiPath) {
+    if (!saveMidi(midiPath)) {
+      return 1;
+    }
+    printf("Wrote %zu MIDI packets to %s (%u updates coalesced, %u dropped)\n", midiCapture.size(), midiPath,
+           midiOut.Coalesced(), midiOut.Dropped());
+  }
+
+  printf("Boot: setup() took %.2f ms\n", bootMs);
+  reportGestureLatency(events, morph);
+  for (int id = 0; id < scheduler.Count(); id++) {
+    const TaskStats &stats = scheduler.Stats(id);
+    printf("Task %-8s every %6u us: %7u runs, max %4u us, late up to %4u us, overruns %u\n", scheduler.Name(id),
+           scheduler.Period(id), stats.runs, stats.maxMicros, stats.maxLateMicros, stats.overruns);
+  }
+  printf("Rendered %.3f s (%llu samples, blocks of %zu) to %s\n", (double)renderedSamples / sampleRate,
+         (unsigned long long)renderedSamples, blockSize, pty ? "nowhere (--pty)" : wavPath);
+
+#if CPU_METER_ENABLED
+  CpuStats stats;
+  cpuMeter.Snapshot(stats);
+  double budget = (double)blockSize / sampleRate * 1.0e6;
+  double avg = stats.blocks ? (double)stats.totalTicks / stats.blocks / cpuMeter.TicksPerMicro() : 0.0;
+  printf("Block budget: %.1f us\n", budget);
+  printf("CPU per block: avg %.2f us (%.2f%%), peak %.2f us (%.2f%%), overruns %u / %u\n",
+         avg, 100.0f * CpuMeter::AverageLoad(stats), stats.peakTicks / cpuMeter.TicksPerMicro(),
+         100.0f * CpuMeter::PeakLoad(stats), stats.overruns, stats.blocks);
+  printf("CPU histogram:");
+  for (int i = 0; i < CPU_HIST_BUCKETS; i++) {
+    if (i < CPU_HIST_BUCKETS - 1) {
+      printf(" %d-%d%%:%u", i * 10, (i + 1) * 10, stats.histogram[i]);
+    } else {
+      printf(" >100%%:%u", stats.histogram[i]);
+    }
+  }
+  printf("\n");
+  EffectsBus &effects = synth.Effects();
+  printf("Effects: peak %.2f%% of block (budget %.0f%%), over budget %u%s\n", 100.0f * effects.PeakLoad(),
+         100.0f * effects.Budget(), effects.OverBudget(), effects.ReverbShed() ? ", reverb shed" : "");
+#endif
+  return 0;
+}
+
+#endif  // PIO_UNIT_TESTING
@@ -0,0 +1,85 @@
+/**
+ * Host stub for the Arduino Wire (I2C) library
+ *
+ * Address probes succeed only for devices the host driver marks present,
+ * so i2cScan() reports the simulated bus. Register reads and writes reach a
+ * small model of the VL53L0X result/interrupt registers and the MSA301
+ * data registers. Every transfer advances the simulated clock by its time
+ * on the wire plus an injectable latency (hostSetI2cLatency), so blocking
+ * bus access shows up in renders.
+ *
+ * The handle getHandle() returns stands in for the STM32 HAL's: the
+ * interrupt-driven calls WireBus makes return at once, and the transfer
+ * completes (registers read or written, handle back to READY) the first
+ * time its state is read at or after its end on the simulated clock.
+ */
+
+#pragma once
+
+#include "Arduino.h"
+
+const int HOST_WIRE_BUFFER = 32;
+
+enum HAL_StatusTypeDef {
+  HAL_OK = 0,
+  HAL_ERROR = 1,
+  HAL_BUSY = 2
+};
+
+enum HAL_I2C_StateTypeDef {
+  HAL_I2C_STATE_READY = 0x20,
+  HAL_I2C_STATE_BUSY_TX = 0x21,
+  HAL_I2C_STATE_BUSY_RX = 0x22
+};
+
+const uint32_t HAL_I2C_ERROR_NONE = 0x00;
+const uint32_t HAL_I2C_ERROR_AF = 0x04;     // No acknowledge
+const uint16_t I2C_MEMADD_SIZE_8BIT = 1;
+
+struct I2C_HandleTypeDef {
+  HAL_I2C_StateTypeDef State = HAL_I2C_STATE_READY;
+  uint32_t ErrorCode = HAL_I2C_ERROR_NONE;
+  // Transfer in flight
+  uint64_t doneMicros = 0;
+  uint8_t address = 0;
+  uint8_t tx[HOST_WIRE_BUFFER];
+  uint16_t txLength = 0;
+  uint8_t *rx = nullptr;
+  uint16_t rxLength = 0;
+};
+
+struct i2c_t {
+  I2C_HandleTypeDef handle;
+};
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint16_t memAddress,
+                                      uint16_t memAddSize, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t devAddress, uint8_t *data,
+                                             uint16_t size);
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t devAddress);
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c);
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c);
+
+class TwoWire {
+public:
+  void begin();
+  void setClock(uint32_t freq);
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity);
+  int available();
+  int read();
+  i2c_t *getHandle() { return &i2c; }
+
+private:
+  i2c_t i2c;
+  uint8_t txAddress = 0;
+  uint8_t txBuffer[HOST_WIRE_BUFFER];
+  int txLength = 0;
+  uint8_t rxBuffer[HOST_WIRE_BUFFER];
+  int rxLength = 0;
+  int rxIndex = 0;
+};
+
+extern TwoWire Wire;
@@ -6,73 +6,147 @@
  * 
  * Left Hand (Note Articulation):
  *   - 5 buttons for scale degrees (D8-D12)
- *   - VL53L0X ToF sensor for waveform morphing (I2C1: D11=SDA, D12=SCL)
+ *   - VL53L0X ToF sensor for waveform morphing (I2C1: D11=SDA, D12=SCL,
+ *     GPIO1 data-ready on D7)
  * 
  * Right Hand (Modifiers):
  *   - 5 buttons for control (D15-D19)
  *   - Thumb = SHIFT key for combinations
  * 
  * Additional:
- *   - Volume pot on A5
+ *   - Volume pot on A5 (sampled by ADC DMA, see AnalogInputs.h)
  *   - Audio output: 48kHz stereo
  */
 
+// The unit tests (test/, `pio test -e native`) link the modules, not the
+// firmware: its globals and tasks would clash with theirs
+#ifndef PIO_UNIT_TESTING
+
 #include "DaisyDuino.h"
 #include <Adafruit_VL53L0X.h>
 #include <Adafruit_MSA301.h>
 #include <Wire.h>
+#include "AccelEstimator.h"
+#include "AnalogInputs.h"
+#include "ButtonScanner.h"
+#include "CpuMeter.h"
+#include "DistanceFilter.h"
+#include "InputTrace.h"
+#include "LogEvents.h"
+#include "MemoryPlacement.h"
+#include "MidiOut.h"
+#include "PresetStore.h"
+#include "QspiFlash.h"
+#include "Scales.h"
+#include "SensorPipeline.h"
+#include "SynthEngine.h"
+#include "TaskScheduler.h"
+#include "TelemetryLink.h"
+#include "WireBus.h"
 
 DaisyHardware hw;
-Oscillator oscSine[5];  // Sine oscillators for each button
-Oscillator oscTri[5];   // Triangle oscillators for each button
+SynthEngine DTCM_BSS synth;        // Voices, mixer and output stage (hardware-neutral)
 
 // Envelope System
 const float ATTACK_TIME = 0.02f;   // 20ms attack to eliminate clicks
+const float DECAY_TIME = 0.0f;     // No decay stage by default (organ-style)
+const float SUSTAIN_LEVEL = 1.0f;  // Held notes stay at full level
 const float RELEASE_TIME = 0.15f;  // 150ms release for smooth fade
-struct NoteEnvelope {
-  float level;              // Current envelope amplitude (0.0 to 1.0)
-  bool isActive;            // Note is playing
-  bool isReleasing;         // In release phase
-  unsigned long attackStartTime;
-  unsigned long releaseStartTime;
-};
-NoteEnvelope envelopes[5];
+const EnvelopeCurve ENVELOPE_CURVE = ENV_CURVE_LINEAR;
+float attackTime = ATTACK_TIME;    // Settings in use (live-tunable, see Telemetry)
+float decayTime = DECAY_TIME;
+float sustainLevel = SUSTAIN_LEVEL;
+float releaseTime = RELEASE_TIME;
 
-// Volume Control
-const int VOLUME_PIN = A5;
-const int VOLUME_CHANGE_THRESHOLD = 10;  // ADC counts hysteresis to reduce jitter
+// Volume Control (ADC1 scans every analog input by DMA; AnalogInputs.h)
+enum AnalogInput {
+  ANALOG_VOLUME = 0,
+  NUM_ANALOG_INPUTS
+};
+const AnalogInputConfig analogConfigs[NUM_ANALOG_INPUTS] = {
+  {dsy_pin(DSY_GPIOC, 1), 8.0f, 0.002f},  // A5 volume pot: 8 Hz IIR, 0.2% dead band
+};
 const float VOLUME_SCALE = 0.5f;         // Maximum volume (0.0 to 1.0)
-int lastVolumeRaw = -1;
+const float VOLUME_RANGE_DB = 40.0f;     // Pot taper: fully down is this far below VOLUME_SCALE
+const float VOLUME_OFF_BELOW = 0.01f;    // ...except the last 1% of travel, which is silent
+const uint32_t VOLUME_LOG_SETTLE_US = 50000;  // Log the volume once the pot has rested this long
+AnalogInputs analogInputs;
+int lastVolumeLevel = -1;
+uint32_t volumeChangedAt = 0;
+bool volumeLogPending = false;
+
+// Deferred Logging (send 'v' over serial to cycle verbosity)
+const size_t LOG_DRAIN_PER_RUN = 8;   // Records formatted per log task run
+
+// Input Trace (send 't' to start/stop recording, 'p' to replay the capture)
+const size_t TRACE_FLUSH_PER_RUN = 16;  // Records streamed per log task run while recording
+
+// MIDI Output (send 'm' to switch the serial port between log text and raw MIDI)
+bool midiOverSerial = false;
+
+// Telemetry (send 'b' to switch the serial port to binary frames for
+// tools/telemetry.py: sensor and voice state out, parameter changes in)
+const uint16_t TELEMETRY_RATE_MAX = 200;  // Frames per second (the log task runs every 2 ms)
+TelemetryLink telemetry;
+bool telemetryOn = false;
+uint16_t telemetryRate = 0;               // Frames per second, 0 = replies only
+uint32_t lastTelemetryAt = 0;
+CpuStats lastTelemetryCpu = {};           // Meter totals at the previous frame
+
+// Presets and boot state (QSPI flash, see PresetStore.h)
+const uint32_t PRESET_FLASH_BASE = QSPI_FLASH_SIZE - 16 * QSPI_SECTOR_SIZE;  // Last 64 KB
+const unsigned long PRESET_SAVE_HOLD = 1000;   // Hold a left button this long in preset mode to save
+const unsigned long STATE_SAVE_DELAY = 5000;   // Settled this long (and no notes held) before saving
+QspiFlash qspiFlash;
+PresetStore presets;
+bool stateDirty = false;                       // Changed since last saved for the next boot
+unsigned long stateChangedAt = 0;
+
+// CPU Load Reporting (send 'c' over serial for a report now, 'r' to reset)
+const unsigned long CPU_REPORT_INTERVAL = 10000;  // Automatic report period in ms
 
 //////////////
 // Left hand
 //////////////
 
+// Sensor Pipeline (drivers configure the parts; reads are queued I2C transactions)
+WireBus sensorBus(Wire);
+SensorPipeline sensors;
+
 // Distance Sensor (VL53L0X Time-of-Flight)
 Adafruit_VL53L0X sensor = Adafruit_VL53L0X();
+const uint8_t TOF_ADDRESS = 0x29;
+const int TOF_INT_PIN = 7;                    // VL53L0X GPIO1 (open drain, low = range ready)
 
 // Accelerometer (MSA311 3-axis)
 Adafruit_MSA301 accel = Adafruit_MSA301();
+const uint8_t ACCEL_ADDRESS = 0x26;
 bool accelAvailable = false;
-const int DISTANCE_CHANGE_THRESHOLD = 5;      // Minimum change in mm to process
+const float DISTANCE_CHANGE_THRESHOLD = 1.0f; // Minimum filtered change in mm to process
 const int DISTANCE_MIN = 50;                  // Minimum distance for mapping (mm)
 const int DISTANCE_MAX = 300;                 // Maximum distance for mapping (mm)
-const unsigned long SENSOR_INTERVAL = 50;     // Poll interval in ms
-int lastDistance = -1;
-unsigned long lastSensorRead = 0;
+int distanceMin = DISTANCE_MIN;               // Mapping in use (stored with the calibration)
+int distanceMax = DISTANCE_MAX;
+const unsigned long SENSOR_INTERVAL = 20;     // Ranging period in ms (high-speed profile: 20 ms budget)
+const float TOF_NO_TARGET = 8190.0f;          // What an empty field reads as
+// One Euro tuning: still hand ~1 Hz (no jitter), a 200 mm/s sweep ~21 Hz
+const float TOF_MIN_CUTOFF = 1.0f;            // Hz
+const float TOF_SPEED_BETA = 0.1f;            // Hz per mm/s
+const float TOF_SPEED_CUTOFF = 1.0f;          // Hz, smoothing of the speed
+DistanceFilter distanceFilter;                // Outlier rejection + One Euro filter (DistanceFilter.h)
+float lastDistance = -1.0f;
 bool tofAvailable = false;
 
 // Sliding Window (Accelerometer-based note selection)
 const int WINDOW_SIZE = 5;                    // Number of notes in window
 int windowOffset = 0;                         // Current offset in semitones within scale
 const int MAX_WINDOW_OFFSET = 24;             // ±2 octaves
-float accelCenterX = 0.0f;                    // Calibrated center X acceleration
-float accelPositionOffset = 0.0f;             // Integrated position from center
-float lastAccelX = 0.0f;                      // Previous X acceleration
-unsigned long lastAccelRead = 0;
-const unsigned long ACCEL_INTERVAL = 20;      // 50Hz polling
-const float COARSE_SENSITIVITY = 8.0f;        // Semitones per second of movement (index)
-const float FINE_SENSITIVITY = 2.0f;          // Semitones per second of movement (pinky)
+AccelEstimator tiltEstimator;                 // Filtered tilt, center and window position
+const unsigned long ACCEL_INTERVAL_US = 4000; // 250Hz reads (matches the configured ODR)
+const float COARSE_SENSITIVITY = 8.0f;        // Semitones per second per m/s^2 of tilt (index)
+const float FINE_SENSITIVITY = 2.0f;          // Semitones per second per m/s^2 of tilt (pinky)
+float coarseSensitivity = COARSE_SENSITIVITY;
+float fineSensitivity = FINE_SENSITIVITY;
 
 // Calibration
 unsigned long calibrationStartTime = 0;
@@ -81,9 +155,9 @@ bool isCalibrating = false;
 
 // Left Hand Buttons (Note Articulation)
 const int NUM_LEFT_BUTTONS = 5;
-Switch leftButton[NUM_LEFT_BUTTONS];
 const int leftButtonPins[NUM_LEFT_BUTTONS] = {8, 9, 10, 13, 14};  // D8-D12 (skip D11)
 bool leftButtonStates[NUM_LEFT_BUTTONS] = {false};      // Logical note states (can be latched)
+bool leftButtonPressed[NUM_LEFT_BUTTONS] = {false};     // Debounced (or replayed) physical states
 bool leftButtonPrevStates[NUM_LEFT_BUTTONS] = {false};  // Previous physical button states
 
 ///////////////
@@ -92,7 +166,6 @@ bool leftButtonPrevStates[NUM_LEFT_BUTTONS] = {false};  // Previous physical but
 
 // Right Hand Buttons (Modifiers & Control)
 const int NUM_RIGHT_BUTTONS = 5;
-Switch rightButton[NUM_RIGHT_BUTTONS];
 const int rightButtonPins[NUM_RIGHT_BUTTONS] = {15, 16, 17, 18, 19};  // D15-D19
 bool rightButtonStates[NUM_RIGHT_BUTTONS] = {false};
 bool rightButtonPrevStates[NUM_RIGHT_BUTTONS] = {false};
@@ -106,15 +179,71 @@ enum RightHandButtons {
   RIGHT_THUMB = 4     // SHIFT key (D19)
 };
 
+// Preset mode: ring + pinky without the thumb (or index) turns the left
+// buttons into preset slots
+static_assert(PRESET_SLOTS == NUM_LEFT_BUTTONS, "One preset slot per left button");
+bool presetPressed[NUM_LEFT_BUTTONS] = {false};   // Press started in preset mode, not yet released
+bool presetSaved[NUM_LEFT_BUTTONS] = {false};     // This press already saved
+unsigned long presetPressStart[NUM_LEFT_BUTTONS] = {0};
+
+bool presetModeHeld() {
+  return rightButtonStates[RIGHT_RING] && rightButtonStates[RIGHT_PINKY] && !rightButtonStates[RIGHT_INDEX] &&
+         !rightButtonStates[RIGHT_THUMB];
+}
+
+///////////////
+// Button scanning
+///////////////
+
+// A timer interrupt samples and debounces every button (ButtonScanner.h);
+// the button task takes the timestamped edges and schedules notes from them
+const uint32_t BUTTON_SCAN_HZ = 4000;      // 8-sample debounce = 2 ms
+const int RIGHT_BUTTON_BIT = 8;            // Scanner bit of right button 0 (left buttons from bit 0)
+const uint32_t NOTE_LATENCY_US = 2000;     // Edge to sound: button task pickup (<= 600 us) plus one audio block, with margin
+ButtonScanner buttonScanner;
+HardwareTimer *buttonTimer = nullptr;      // TIM7: a basic timer, no pins
+uint32_t noteTimeMicros = 0;               // When the note events being posted should sound
+
+///////////////
+// Control tasks
+///////////////
+
+// loop() runs the control work as fixed-rate tasks (TaskScheduler.h), most
+// urgent first, and idles until the next deadline (send 'k' for run times)
+const uint32_t BUTTON_TASK_US = 1000000 / BUTTON_SCAN_HZ;  // Every scan: edges picked up within 250 us
+const uint32_t SENSOR_TASK_US = 500;       // One I2C transfer per run (accel every 4 ms, ToF every 20 ms)
+const uint32_t ANALOG_TASK_US = 2000;      // Filters the DMA'd pot readings (no conversions)
+const uint32_t PRESET_TASK_US = 100000;
+const uint32_t LOG_TASK_US = 2000;         // Serial commands and log text, lowest priority
+TaskScheduler scheduler;
+void startTasks();
+
 //////////////////////
 // Musical Structure
 /////////////////////
 // Audio Parameters
+// Control-side copies; the audio callback only sees them through synth events
 float volume = 0.3f;                // Global volume (0.0 to 1.0)
-float waveformBlend = 0.0f;         // Blend position (0.0 = sine, 1.0 = triangle)
-float sineAmp = 1.0f;               // Sine wave amplitude (equal-power crossfade)
-float triAmp = 0.0f;                // Triangle wave amplitude (equal-power crossfade)
-float triBoost = 1.0f;              // Boost triangle amplitude for more dramatic morph
+float waveformBlend = 0.0f;         // Blend position (0.0 = far, 1.0 = close)
+const float MORPH_MAX = 1.0f;       // Wavetable frame reached at blend 1.0 (1 = triangle, 3 = square)
+float morphMax = MORPH_MAX;
+float effectAmount = 0.0f;          // Chord-mode effects position (0.0 = far/dry, 1.0 = close)
+const float DELAY_MIX_MAX = 0.35f;  // Delay send at amount 1.0
+const float REVERB_MIX_MAX = 0.5f;  // Reverb send at amount 1.0
+float delayMixMax = DELAY_MIX_MAX;
+float reverbMixMax = REVERB_MIX_MAX;
+const float REVERB_DECAY_MIN = 1.0f;    // RT60 at amount 0.0 (s)
+const float REVERB_DECAY_MAX = 4.0f;    // RT60 at amount 1.0 (s)
+
+// Arpeggiator (send 'a' over serial to cycle patterns; see Arpeggiator.h)
+// Held notes go to the engine's arpeggiator, which plays them on the audio
+// sample clock; the hand distance sets its rate in place of morph/effects
+const ArpPattern ARP_DEFAULT_PATTERN = ARP_OFF;
+const float ARP_RATE_SLOW = 3.0f;       // Steps per second, hand far
+const float ARP_RATE_FAST = 16.0f;      // Steps per second, hand close
+const char *const arpPatternNames[NUM_ARP_PATTERNS] = {"Off", "Up", "Down", "Up-Down", "Random", "Strum"};
+ArpPattern arpPattern = ARP_DEFAULT_PATTERN;
+float arpRate = ARP_RATE_SLOW;
 
 // Scale & Key Settings
 const int OCTAVE_MIN = 1;
@@ -122,20 +251,37 @@ const int OCTAVE_MAX = 8;
 int currentOctave = 4;                  // Start in middle octave (MIDI note 60 = C4)
 int currentKey = 0;                     // Root note offset (0 = C)
 int pitchOffset = 0;                    // Momentary sharp/flat in semitones
+int currentScale = SCALE_MAJOR_PENTATONIC;  // See Scales.h
 
-enum ScaleType {
-  SCALE_MAJOR_PENTATONIC = 0,
-  SCALE_BLUES = 1,
-  SCALE_CHROMATIC = 2
-};
-int currentScale = SCALE_MAJOR_PENTATONIC;
+float currentScaleNotes[NUM_LEFT_BUTTONS];        // Current MIDI pitches (fractional for EDO scales)
 
-// Scale intervals (semitones from root, mapped to 5 buttons)
-const int majorPentatonic[] = {0, 2, 4, 7, 9};    // C, D, E, G, A
-const int bluesScale[] = {0, 3, 5, 6, 7};         // C, Eb, F, F#, G  
-const int chromaticScale[] = {0, 1, 2, 3, 4};     // C, C#, D, D#, E
+// Pitch Glide & Bend (the engine slews pitch per voice; see SynthEngine.h)
+enum BendSource {
+  BEND_NONE = 0,
+  BEND_ACCEL_TILT = 1,    // Y tilt away from the calibrated center
+  BEND_TOF = 2            // Hand distance (close = up, far = down)
+};
+const BendSource BEND_SOURCE = BEND_ACCEL_TILT;
+const float GLIDE_TIME = 0.03f;             // Sharp/flat glide time constant (s)
+float glideTime = GLIDE_TIME;
+const float BEND_RANGE = 1.0f;              // Semitones at full bend
+const float BEND_DEAD_ZONE = 1.5f;          // Tilt ignored within this (m/s^2)
+const float BEND_FULL_TILT = 4.0f;          // Tilt beyond the dead zone for full bend (m/s^2)
+const float BEND_CHANGE_THRESHOLD = 0.01f;  // Semitones; smaller changes are not sent
+float pitchBend = 0.0f;
 
-int currentScaleNotes[NUM_LEFT_BUTTONS];          // Current MIDI note numbers
+// Stereo Placement (each note id has a pan position; see SynthEngine.h)
+enum PanSource {
+  PAN_CENTER = 0,
+  PAN_SCALE_DEGREE = 1,   // Buttons spread left to right, chord tones fan out around them
+  PAN_ACCEL_TILT = 2      // Notes centered, Y tilt moves the image (pair with another BEND_SOURCE)
+};
+const PanSource PAN_SOURCE = PAN_SCALE_DEGREE;
+const float PAN_SPREAD = 0.6f;              // Pan of the outer buttons (1 = hard left/right)
+const float PAN_CHORD_SPREAD = 0.15f;       // Chord tones either side of their button
+const float PAN_FULL_TILT = 4.0f;           // Tilt for a hard pan (m/s^2)
+const float PAN_CHANGE_THRESHOLD = 0.02f;   // Smaller tilt pan changes are not sent
+float panOffset = 0.0f;
 
 /////////////////////
 // Additional setup
@@ -167,126 +313,270 @@ void i2cScan() {
   }
 }
 
+/**
+ * Whether a device acknowledges its address
+ */
+bool i2cProbe(uint8_t address) {
+  Wire.beginTransmission(address);
+  return Wire.endTransmission() == 0;
+}
+
 // Play Modes
 enum PlayMode {
   MODE_SINGLE_NOTE = 0,     // Individual note per button
-  MODE_MAJOR_CHORD = 1,     // Reserved for future chord implementation
-  MODE_MINOR_CHORD = 2      // Reserved for future chord implementation
+  MODE_MAJOR_CHORD = 1,     // Root, major third and fifth per button
+  MODE_MINOR_CHORD = 2      // Root, minor third and fifth per button
 };
+static_assert((int)MODE_MINOR_CHORD == (int)CHORD_MINOR, "PlayMode indexes chordRegistry");
 int currentMode = MODE_SINGLE_NOTE;
 bool latchMode = false;             // When true, buttons latch notes ON
 
+void releaseNote(int noteIndex);
+
 void clearAllLatchedNotes() {
   for (int i = 0; i < NUM_LEFT_BUTTONS; i++) {
     leftButtonStates[i] = false;
     releaseNote(i);  // Trigger envelope release for smooth fade-out
   }
-  Serial.println("All latched notes cleared");
+  LOG_EVENT(LOG_NOTES_CLEARED);
 }
 
 /**
  * Update the current scale notes based on octave, key, scale type, and window offset
- * Calculates MIDI note numbers for each of the 5 buttons
+ * Calculates MIDI pitches for each of the 5 buttons
  * Window offset allows sliding through the scale
  */
 void updateScaleNotes() {
-  int baseNote = (currentOctave * 12) + currentKey + windowOffset;
+  computeScaleNotes(currentOctave, currentKey, currentScale, windowOffset, currentScaleNotes);
+  midiOut.SetWindow(windowOffset);
+}
 
-  switch (currentScale) {
-    case SCALE_MAJOR_PENTATONIC:
-      for (int i = 0; i < NUM_LEFT_BUTTONS; i++) {
-        currentScaleNotes[i] = baseNote + majorPentatonic[i];
-      }
-      break;
-    case SCALE_BLUES:
-      for (int i = 0; i < NUM_LEFT_BUTTONS; i++) {
-        currentScaleNotes[i] = baseNote + bluesScale[i];
-      }
-      break;
-    case SCALE_CHROMATIC:
-      for (int i = 0; i < NUM_LEFT_BUTTONS; i++) {
-        currentScaleNotes[i] = baseNote + chromaticScale[i];
+/**
+ * Log current sliding window information
+ */
+void printWindow(const char *prefix = "") {
+  static_assert(NUM_LEFT_BUTTONS == 5, "LOG_WINDOW format lists five notes");
+  LOG_EVENT(LOG_WINDOW, prefix, currentScaleNotes[0], currentScaleNotes[1], currentScaleNotes[2],
+            currentScaleNotes[3], currentScaleNotes[4], windowOffset);
+}
+
+// Each button owns MAX_CHORD_TONES engine note ids, one per chord tone
+static_assert(NUM_LEFT_BUTTONS * MAX_CHORD_TONES <= MAX_NOTE_IDS, "Not enough note ids");
+int heldChord[NUM_LEFT_BUTTONS] = {CHORD_SINGLE};  // Chord each button was started with
+bool heldArp[NUM_LEFT_BUTTONS] = {false};          // Whether it went to the arpeggiator
+
+inline int chordNoteId(int noteIndex, int tone) {
+  return noteIndex * MAX_CHORD_TONES + tone;
+}
+
+/**
+ * Give every note id its pan position (scale degree, then chord tone)
+ */
+void setNotePans() {
+  for (int i = 0; i < NUM_LEFT_BUTTONS; i++) {
+    for (int t = 0; t < MAX_CHORD_TONES; t++) {
+      float pan = 0.0f;
+      if (PAN_SOURCE == PAN_SCALE_DEGREE) {
+        pan = PAN_SPREAD * (2.0f * (float)i / (float)(NUM_LEFT_BUTTONS - 1) - 1.0f)
+              + PAN_CHORD_SPREAD * (float)(t - (MAX_CHORD_TONES - 1) / 2);
       }
-      break;
+      synth.SetNotePan(chordNoteId(i, t), pan);
+    }
   }
-};
+}
 
 /**
- * Print current sliding window information
+ * Trigger envelope attack for a button at a MIDI pitch
+ * Chord modes start one voice per chord tone; with the arpeggiator on, the
+ * tones join its pool instead and it plays them (MIDI follows in loop())
  */
-void printWindow() {
-  Serial.print("Window: ");
-  for (int i = 0; i < NUM_LEFT_BUTTONS; i++) {
-    Serial.print(currentScaleNotes[i]);
-    if (i < NUM_LEFT_BUTTONS - 1) Serial.print(", ");
+void triggerNote(int noteIndex, float pitch) {
+  heldChord[noteIndex] = currentMode;
+  heldArp[noteIndex] = arpPattern != ARP_OFF;
+  const ChordDef &chord = chordDef(currentMode);
+  for (int t = 0; t < chord.numTones; t++) {
+    if (heldArp[noteIndex]) {
+      synth.ArpHold(chordNoteId(noteIndex, t), pitch + chord.intervals[t], noteTimeMicros);
+    } else {
+      synth.NoteOn(chordNoteId(noteIndex, t), pitch + chord.intervals[t], noteTimeMicros);
+      midiOut.NoteOn(chordNoteId(noteIndex, t), pitch + chord.intervals[t]);
+    }
   }
-  Serial.print(" (offset: ");
-  Serial.print(windowOffset);
-  Serial.println(" semitones)");
 }
 
 /**
- * Soft clipping function to prevent harsh distortion
- * Uses tanh for smooth saturation
+ * Re-trigger a sounding button: its tails ring out, fresh voices start
  */
-float softClip(float sample) {
-  return tanhf(sample * 1.5f) / 1.5f;  // Gentle saturation
+void retriggerNote(int noteIndex, float pitch) {
+  releaseNote(noteIndex);  // Tones the new chord does not reuse
+  triggerNote(noteIndex, pitch);
 }
 
 /**
- * Process envelope for a note (Attack/Release)
- * Returns current envelope level (0.0 to 1.0)
+ * Release a button's notes (start release phase)
  */
-float processEnvelope(int noteIndex) {
-  NoteEnvelope &env = envelopes[noteIndex];
-  
-  if (!env.isActive) {
-    return 0.0f;
+void releaseNote(int noteIndex) {
+  const ChordDef &chord = chordDef(heldChord[noteIndex]);
+  for (int t = 0; t < chord.numTones; t++) {
+    if (heldArp[noteIndex]) {
+      synth.ArpRelease(chordNoteId(noteIndex, t), noteTimeMicros);
+    } else {
+      synth.NoteOff(chordNoteId(noteIndex, t), noteTimeMicros);
+      midiOut.NoteOff(chordNoteId(noteIndex, t));
+    }
   }
-  
-  unsigned long currentTime = millis();
-  
-  if (env.isReleasing) {
-    // Release phase
-    float elapsed = (currentTime - env.releaseStartTime) / 1000.0f;
-    if (elapsed >= RELEASE_TIME) {
-      env.isActive = false;
-      env.level = 0.0f;
-      return 0.0f;
-    }
-    env.level = 1.0f - (elapsed / RELEASE_TIME);
-  } else {
-    // Attack phase
-    float elapsed = (currentTime - env.attackStartTime) / 1000.0f;
-    if (elapsed >= ATTACK_TIME) {
-      env.level = 1.0f;
+}
+
+/**
+ * Mirror the notes the arpeggiator played to MIDI
+ */
+void forwardArpNotes() {
+  ArpEvent evt;
+  while (synth.PopArpNote(evt)) {
+    if (evt.on) {
+      midiOut.NoteOn(evt.note, evt.pitch);
     } else {
-      env.level = elapsed / ATTACK_TIME;
+      midiOut.NoteOff(evt.note);
     }
   }
-  
-  return env.level;
+}
+
+/////////////////////
+// Presets
+/////////////////////
+
+MusicalState currentMusicalState() {
+  MusicalState state;
+  state.key = (uint8_t)currentKey;
+  state.scale = (uint8_t)currentScale;
+  state.octave = (uint8_t)currentOctave;
+  state.latch = latchMode;
+  state.arpPattern = (uint8_t)arpPattern;
+  state.windowOffset = (int8_t)windowOffset;
+  return state;
 }
 
 /**
- * Trigger envelope attack for a note
+ * Note a change to what the next boot restores; saved once it settles
  */
-void triggerNote(int noteIndex) {
-  NoteEnvelope &env = envelopes[noteIndex];
-  env.isActive = true;
-  env.isReleasing = false;
-  env.attackStartTime = millis();
-  env.level = 0.0f;
+void markStateChanged() {
+  stateDirty = true;
+  stateChangedAt = millis();
 }
 
 /**
- * Release a note (start release phase)
+ * Take over a stored state (out-of-range fields from a damaged or foreign
+ * record keep the current value)
  */
-void releaseNote(int noteIndex) {
-  NoteEnvelope &env = envelopes[noteIndex];
-  if (env.isActive && !env.isReleasing) {
-    env.isReleasing = true;
-    env.releaseStartTime = millis();
+void applyMusicalState(const MusicalState &state) {
+  if (state.key < 12) {
+    currentKey = state.key;
+  }
+  if (state.scale < NUM_SCALES) {
+    currentScale = state.scale;
+  }
+  if (state.octave >= OCTAVE_MIN && state.octave <= OCTAVE_MAX) {
+    currentOctave = state.octave;
+  }
+  if (abs(state.windowOffset) <= MAX_WINDOW_OFFSET) {
+    windowOffset = state.windowOffset;
+    tiltEstimator.SetWindowOffset(windowOffset);
+  }
+  if (state.arpPattern < NUM_ARP_PATTERNS && state.arpPattern != arpPattern) {
+    arpPattern = (ArpPattern)state.arpPattern;
+    synth.SetParam(PARAM_ARP_PATTERN, (float)arpPattern);
+    LOG_EVENT(LOG_ARP_PATTERN, arpPatternNames[arpPattern]);
+  }
+  if (state.latch != latchMode) {
+    latchMode = state.latch;
+    if (!latchMode) {
+      clearAllLatchedNotes();
+    }
+  }
+  updateScaleNotes();
+}
+
+void savePreset(int slot) {
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  size_t length = encodeMusicalState(currentMusicalState(), payload);
+  if (presets.Save((PresetRecordKind)(RECORD_PRESET_FIRST + slot), payload, length)) {
+    LOG_EVENT(LOG_PRESET_SAVED, slot + 1);
+  } else {
+    LOG_EVENT(LOG_PRESET_FLASH_ERROR);
+  }
+}
+
+void recallPreset(int slot) {
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  size_t length = 0;
+  if (!presets.Load((PresetRecordKind)(RECORD_PRESET_FIRST + slot), payload, length)) {
+    LOG_EVENT(LOG_PRESET_EMPTY, slot + 1);
+    return;
+  }
+  MusicalState state = currentMusicalState();
+  decodeMusicalState(payload, length, state);
+  applyMusicalState(state);
+  markStateChanged();
+  LOG_EVENT(LOG_PRESET_RECALLED, slot + 1);
+  printWindow();
+}
+
+/**
+ * Save the state for the next boot once it has settled and nothing is
+ * sounding: a sector erase can hold up loop() for tens of ms
+ */
+void saveStateWhenIdle() {
+  if (!stateDirty || millis() - stateChangedAt < STATE_SAVE_DELAY || !presets.Ready()) {
+    return;
+  }
+  for (int i = 0; i < NUM_LEFT_BUTTONS; i++) {
+    if (leftButtonStates[i]) {
+      return;
+    }
+  }
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  size_t length = encodeMusicalState(currentMusicalState(), payload);
+  if (presets.Save(RECORD_LAST_STATE, payload, length)) {
+    LOG_EVENT(LOG_STATE_SAVED, presets.Writes(), presets.Erases());
+  } else {
+    LOG_EVENT(LOG_PRESET_FLASH_ERROR);
+  }
+  stateDirty = false;
+}
+
+void saveCalibration() {
+  SensorCalibration calibration;
+  calibration.accelCenterX = tiltEstimator.CenterX();
+  calibration.accelCenterY = tiltEstimator.CenterY();
+  calibration.distanceMin = (uint16_t)distanceMin;
+  calibration.distanceMax = (uint16_t)distanceMax;
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  size_t length = encodeCalibration(calibration, payload);
+  if (presets.Ready() && !presets.Save(RECORD_CALIBRATION, payload, length)) {
+    LOG_EVENT(LOG_PRESET_FLASH_ERROR);
+  }
+}
+
+/**
+ * Boot: the calibration and the state the last session left
+ */
+void restoreStoredState() {
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  size_t length = 0;
+  if (presets.Load(RECORD_CALIBRATION, payload, length)) {
+    SensorCalibration calibration = {tiltEstimator.CenterX(), tiltEstimator.CenterY(), (uint16_t)distanceMin,
+                                     (uint16_t)distanceMax};
+    decodeCalibration(payload, length, calibration);
+    tiltEstimator.SetCenter(calibration.accelCenterX, calibration.accelCenterY);
+    if (calibration.distanceMin < calibration.distanceMax) {
+      distanceMin = calibration.distanceMin;
+      distanceMax = calibration.distanceMax;
+    }
+  }
+  if (presets.Load(RECORD_LAST_STATE, payload, length)) {
+    MusicalState state = currentMusicalState();
+    decodeMusicalState(payload, length, state);
+    applyMusicalState(state);
   }
 }
 
@@ -297,74 +587,464 @@ void releaseNote(int noteIndex) {
 void applyPitchOffset() {
   for (int i = 0; i < NUM_LEFT_BUTTONS; i++) {
     if (leftButtonStates[i]) {
-      // Note is playing, shift its frequency
-      int shiftedNote = currentScaleNotes[i] + pitchOffset;
-      float freq = mtof(shiftedNote);
-      oscSine[i].SetFreq(freq);
-      oscTri[i].SetFreq(freq);
+      // Note is playing, glide every chord tone to the shifted pitch
+      const ChordDef &chord = chordDef(heldChord[i]);
+      for (int t = 0; t < chord.numTones; t++) {
+        float pitch = currentScaleNotes[i] + chord.intervals[t] + pitchOffset;
+        synth.SetNotePitch(chordNoteId(i, t), pitch);
+        midiOut.SetNotePitch(chordNoteId(i, t), pitch);
+      }
     }
   }
 }
 
-void AudioCallback(float **in, float **out, size_t size) {
-  for (size_t i = 0; i < size; i++) {
-    float mixedSig = 0.0f;
-    int activeNotes = 0;
-    
-    // Mix oscillators with envelope and crossfade
-    for (int j = 0; j < NUM_LEFT_BUTTONS; j++) {
-      float envLevel = processEnvelope(j);
-      
-      if (envLevel > 0.001f) {  // Only process if envelope is active
-        activeNotes++;
-        float sineSig = oscSine[j].Process() * sineAmp;
-        float triSig = oscTri[j].Process() * triAmp * triBoost;
-        mixedSig += (sineSig + triSig) * envLevel;
+/**
+ * Button timer overflow: one scan of every button
+ */
+void buttonScanIsr() {
+  buttonScanner.Scan(micros());
+}
+
+/**
+ * VL53L0X GPIO1 falling edge: a new range is ready
+ */
+void tofDataReadyIsr() {
+  sensors.OnTofDataReady(micros());
+}
+
+/**
+ * EventLog sink: USB serial, drained only as fast as it accepts data
+ */
+void logWrite(const char *text, size_t length) {
+  Serial.write((const uint8_t *)text, length);
+}
+
+size_t logWritable() {
+  return (size_t)Serial.availableForWrite();
+}
+
+uint32_t logClock() {
+  return micros();
+}
+
+/**
+ * MIDI sink while the serial port carries MIDI: the plain MIDI bytes of
+ * each packet, for a serial-to-MIDI bridge. The USB stack is built with
+ * the CDC class only, so there is no USB-MIDI endpoint to take the packets.
+ */
+void midiSerialWrite(const MidiPacket *packets, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    Serial.write(&packets[i].status, 3);
+  }
+}
+
+size_t midiSerialWritable() {
+  return (size_t)Serial.availableForWrite() / 3;
+}
+
+ITCM_CODE void AudioCallback(float **in, float **out, size_t size) {
+  CPU_METER_BEGIN();
+  synth.Process(out, size, micros());  // Note times are on the micros() clock
+  CPU_METER_END(size);
+}
+
+#if CPU_METER_ENABLED
+/**
+ * Report audio callback load: average, peak, overruns, cycles and
+ * histogram (logged, so the serial port is written as it has room)
+ */
+void reportCpuLoad() {
+  CpuStats stats;
+  cpuMeter.Snapshot(stats);
+
+  LOG_EVENT(LOG_CPU_LOAD, CpuMeter::AverageLoad(stats) * 100.0f, CpuMeter::PeakLoad(stats) * 100.0f,
+            stats.peakTicks / cpuMeter.TicksPerMicro(), stats.overruns, stats.blocks);
+  // DWT cycles on the Seed: compare builds with and without MEMORY_PLACEMENT
+  LOG_EVENT(LOG_CPU_CYCLES, stats.blocks ? (uint32_t)(stats.totalTicks / stats.blocks) : 0u, stats.peakTicks);
+
+  EffectsBus &effects = synth.Effects();
+  LOG_EVENT(LOG_EFFECTS_LOAD, effects.Load() * 100.0f, effects.PeakLoad() * 100.0f, effects.Budget() * 100.0f,
+            effects.OverBudget(), effects.ReverbShed() ? ", reverb shed" : "");
+
+  static_assert(CPU_HIST_BUCKETS == 11, "LOG_CPU_HISTOGRAM_LOW/HIGH print 11 buckets");
+  const uint32_t *h = stats.histogram;
+  LOG_EVENT(LOG_CPU_HISTOGRAM_LOW, h[0], h[1], h[2], h[3], h[4], h[5]);
+  LOG_EVENT(LOG_CPU_HISTOGRAM_HIGH, h[6], h[7], h[8], h[9], h[10]);
+}
+#endif
+
+/**
+ * Report sensor pipeline health
+ */
+void reportSensorStats() {
+  LOG_EVENT(LOG_SENSOR_STATS, !tofAvailable ? "off" : (sensors.TofPolling() ? "polling" : "interrupt"),
+            sensors.BusErrors(), sensors.DroppedSamples());
+  LOG_EVENT(LOG_BUTTON_STATS, buttonScanner.Scans(), buttonScanner.DroppedEdges(), synth.LateEvents(),
+            synth.DroppedEvents());
+}
+
+/**
+ * Report control task run times, late starts and overruns
+ */
+void reportTaskStats() {
+  for (int id = 0; id < scheduler.Count(); id++) {
+    const TaskStats &stats = scheduler.Stats(id);
+    LOG_EVENT(LOG_TASK_STATS, scheduler.Name(id), scheduler.Period(id), stats.runs,
+              stats.runs ? (float)stats.totalMicros / stats.runs : 0.0f, stats.maxMicros, stats.maxLateMicros,
+              stats.overruns);
+  }
+}
+
+/////////////////////
+// Telemetry and live tuning
+/////////////////////
+
+/**
+ * A setting the telemetry client can read and write. Writes are clamped
+ * to min..max, posted to the engine when synthParam is one of its
+ * parameters (the rest are read where they are used) and undone if
+ * valid() rejects the combination.
+ */
+struct Tunable {
+  const char *name;
+  float *value;             // Float settings...
+  int *intValue;            // ...or integer ones
+  float min;
+  float max;
+  int synthParam;           // SynthParam, or -1
+  bool (*valid)();          // Null = any value in range
+};
+
+bool distanceRangeValid() {
+  return distanceMin < distanceMax;
+}
+
+const Tunable tunables[] = {
+  {"attack", &attackTime, nullptr, 0.001f, 2.0f, PARAM_ATTACK, nullptr},
+  {"decay", &decayTime, nullptr, 0.0f, 2.0f, PARAM_DECAY, nullptr},
+  {"sustain", &sustainLevel, nullptr, 0.0f, 1.0f, PARAM_SUSTAIN, nullptr},
+  {"release", &releaseTime, nullptr, 0.005f, 5.0f, PARAM_RELEASE, nullptr},
+  {"glide", &glideTime, nullptr, 0.0f, 1.0f, PARAM_GLIDE, nullptr},
+  {"coarse_sensitivity", &coarseSensitivity, nullptr, 0.5f, 32.0f, -1, nullptr},
+  {"fine_sensitivity", &fineSensitivity, nullptr, 0.1f, 16.0f, -1, nullptr},
+  {"distance_min", nullptr, &distanceMin, 20.0f, 1000.0f, -1, distanceRangeValid},
+  {"distance_max", nullptr, &distanceMax, 30.0f, 2000.0f, -1, distanceRangeValid},
+  {"morph_max", &morphMax, nullptr, 0.0f, (float)(WT_NUM_FRAMES - 1), -1, nullptr},
+  {"delay_mix_max", &delayMixMax, nullptr, 0.0f, 1.0f, -1, nullptr},
+  {"reverb_mix_max", &reverbMixMax, nullptr, 0.0f, 1.0f, -1, nullptr},
+};
+const int NUM_TUNABLES = sizeof(tunables) / sizeof(tunables[0]);
+
+float tunableValue(const Tunable &tunable) {
+  return tunable.value ? *tunable.value : (float)*tunable.intValue;
+}
+
+/**
+ * Write one setting; false (and the old value kept) if valid() rejects it
+ */
+bool setTunable(const Tunable &tunable, float value) {
+  value = constrain(value, tunable.min, tunable.max);
+  float previous = tunableValue(tunable);
+  if (tunable.value) {
+    *tunable.value = value;
+  } else {
+    *tunable.intValue = (int)lroundf(value);
+  }
+  if (tunable.valid && !tunable.valid()) {
+    if (tunable.value) {
+      *tunable.value = previous;
+    } else {
+      *tunable.intValue = (int)previous;
+    }
+    return false;
+  }
+  if (tunable.synthParam >= 0) {
+    synth.SetParam((SynthParam)tunable.synthParam, tunableValue(tunable));
+  }
+  return true;
+}
+
+void telemetryWrite(const uint8_t *data, size_t length) {
+  Serial.write(data, length);
+}
+
+size_t telemetryWritable() {
+  return (size_t)Serial.availableForWrite();
+}
+
+void sendPong() {
+  TelemetryPacket packet(TM_PONG);
+  packet.PutU8(TELEMETRY_VERSION);
+  packet.PutU8((uint8_t)NUM_TUNABLES);
+  telemetry.Send(packet);
+}
+
+void sendTelemetryError(TelemetryError error, uint8_t type) {
+  TelemetryPacket packet(TM_ERROR);
+  packet.PutU8(error);
+  packet.PutU8(type);
+  telemetry.Send(packet);
+}
+
+// Fixed TM_TELEMETRY fields, then 4 bytes per voice
+static_assert(1 + 4 + 2 + 2 + 1 + 5 * 4 + 1 + 4 * NUM_VOICES <= TELEMETRY_MAX_PAYLOAD,
+              "Telemetry frame does not fit the voice count");
+
+/**
+ * One TM_TELEMETRY frame. The CPU average covers the time since the
+ * previous frame (the meter keeps running totals); the peak is since the
+ * last reset ('r').
+ */
+void sendTelemetry(uint32_t now) {
+  CpuStats stats;
+  cpuMeter.Snapshot(stats);
+  CpuStats interval = stats;
+  if (stats.blocks >= lastTelemetryCpu.blocks) {
+    interval.totalTicks -= lastTelemetryCpu.totalTicks;
+    interval.totalBudget -= lastTelemetryCpu.totalBudget;
+  }
+  lastTelemetryCpu = stats;
+
+  VoiceStatus voices[NUM_VOICES];
+  int active = 0;
+  for (int i = 0; i < NUM_VOICES; i++) {
+    voices[i] = synth.Voice(i);
+    if (voices[i].note >= 0) {
+      active++;
+    }
+  }
+
+  TelemetryPacket packet(TM_TELEMETRY);
+  packet.PutU32(now);
+  packet.PutU16((uint16_t)constrain(CpuMeter::AverageLoad(interval) * 1000.0f, 0.0f, 65535.0f));
+  packet.PutU16((uint16_t)constrain(CpuMeter::PeakLoad(stats) * 1000.0f, 0.0f, 65535.0f));
+  packet.PutU8((uint8_t)active);
+  packet.PutFloat(tofAvailable && distanceFilter.Present() ? distanceFilter.Distance() : -1.0f);
+  packet.PutFloat(synth.Morph());
+  packet.PutFloat(tiltEstimator.TiltY());
+  packet.PutFloat(pitchBend);
+  packet.PutFloat(volume);
+  packet.PutU8((uint8_t)NUM_VOICES);
+  for (int i = 0; i < NUM_VOICES; i++) {
+    packet.PutU8(voices[i].note >= 0 ? (uint8_t)voices[i].note : 0xFF);
+    packet.PutU8((uint8_t)voices[i].stage);
+    packet.PutU16((uint16_t)(voices[i].level * 65535.0f));
+  }
+  telemetry.Send(packet);
+}
+
+/**
+ * Switch the serial port to telemetry frames (from log text or MIDI)
+ */
+void startTelemetry() {
+  if (midiOverSerial) {
+    midiOverSerial = false;
+    midiOut.SetWriter({nullptr, nullptr});
+  }
+  Serial.println("Telemetry: binary frames (tools/telemetry.py)");
+  telemetry.Init({telemetryWrite, telemetryWritable});
+  telemetry.SendDelimiter();  // Whatever text the host was in the middle of ends here
+  telemetryOn = true;
+  telemetryRate = 0;
+  cpuMeter.Snapshot(lastTelemetryCpu);
+  sendPong();
+}
+
+/**
+ * Act on one received message; every request gets a reply. Parameter
+ * writes are recorded into an input trace; while one replays, the trace's
+ * writes stand in for live ones, which are rejected.
+ */
+void handleTelemetryMessage(uint32_t now) {
+  TelemetryReader message(telemetry.Payload(), telemetry.PayloadLength());
+  uint8_t type = 0;
+  message.GetU8(type);
+  switch (type) {
+    case TM_PING:
+      sendPong();
+      break;
+    case TM_GET_PARAM:
+    case TM_SET_PARAM:
+    case TM_GET_INFO: {
+      uint8_t id = 0;
+      float value = 0.0f;
+      if (!message.GetU8(id) || (type == TM_SET_PARAM && !message.GetFloat(value))) {
+        sendTelemetryError(TE_BAD_LENGTH, type);
+        break;
+      }
+      if (id >= NUM_TUNABLES) {
+        sendTelemetryError(TE_UNKNOWN_PARAM, type);
+        break;
       }
+      const Tunable &tunable = tunables[id];
+      if (type == TM_SET_PARAM) {
+        if (inputTrace.Replaying() || !setTunable(tunable, value)) {
+          sendTelemetryError(TE_REJECTED, type);
+          break;
+        }
+        inputTrace.RecordTunable(now, id, value);
+      }
+      TelemetryPacket packet(type == TM_GET_INFO ? TM_PARAM_INFO : TM_PARAM);
+      packet.PutU8(id);
+      packet.PutFloat(tunableValue(tunable));
+      if (type == TM_GET_INFO) {
+        packet.PutFloat(tunable.min);
+        packet.PutFloat(tunable.max);
+        packet.PutString(tunable.name);
+      }
+      telemetry.Send(packet);
+      break;
     }
-    
-    // Dynamic polyphony scaling (reduce volume as more notes play)
-    if (activeNotes > 0) {
-      float polyScale = 1.0f / sqrtf((float)activeNotes);
-      mixedSig *= polyScale;
+    case TM_SET_RATE: {
+      uint16_t rate = 0;
+      if (!message.GetU16(rate)) {
+        sendTelemetryError(TE_BAD_LENGTH, type);
+        break;
+      }
+      telemetryRate = rate > TELEMETRY_RATE_MAX ? TELEMETRY_RATE_MAX : rate;
+      lastTelemetryAt = micros();
+      TelemetryPacket packet(TM_RATE);
+      packet.PutU16(telemetryRate);
+      telemetry.Send(packet);
+      break;
     }
-    
-    // Apply volume
-    mixedSig *= volume * 0.4f;
-    
-    // Soft clipping to prevent harsh distortion
-    mixedSig = softClip(mixedSig);
-    
-    out[0][i] = mixedSig; // left out
-    out[1][i] = mixedSig; // right out
+    case TM_EXIT:
+      telemetryOn = false;
+      Serial.println();
+      Serial.println("Telemetry: off");
+      break;
+    default:
+      sendTelemetryError(TE_UNKNOWN_MESSAGE, type);
+      break;
+  }
+}
+
+/**
+ * Serial commands that change what plays (recorded into input traces)
+ */
+bool isPlayCommand(int c) {
+  return c == 'a';
+}
+
+void handlePlayCommand(int c) {
+  if (c == 'a') {
+    // Cycle arpeggiator patterns; held notes keep the path they started on
+    arpPattern = (ArpPattern)((arpPattern + 1) % NUM_ARP_PATTERNS);
+    synth.SetParam(PARAM_ARP_PATTERN, (float)arpPattern);
+    markStateChanged();
+    LOG_EVENT(LOG_ARP_PATTERN, arpPatternNames[arpPattern]);
+  }
+}
+
+/**
+ * Play commands and tunable writes from a replayed input trace
+ */
+void replayCommands() {
+  InputCommand command;
+  while (inputTrace.PopCommand(command)) {
+    if (command.type == INPUT_COMMAND && isPlayCommand(command.id)) {
+      handlePlayCommand(command.id);
+    } else if (command.type == INPUT_TUNABLE && command.id < NUM_TUNABLES) {
+      setTunable(tunables[command.id], command.value);
+    }
+  }
+}
+
+/**
+ * Single-character serial commands (or telemetry frames, in binary mode).
+ * Play commands go into an input trace like the buttons do, and are
+ * ignored while one replays.
+ */
+void handleSerialCommands(uint32_t now) {
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (telemetryOn) {
+      if (telemetry.Receive((uint8_t)c)) {
+        handleTelemetryMessage(now);
+      }
+      continue;
+    }
+    if (isPlayCommand(c)) {
+      if (!inputTrace.Replaying()) {  // Else the trace stands in for live play commands
+        inputTrace.RecordCommand(now, (uint8_t)c);
+        handlePlayCommand(c);
+      }
+      continue;
+    }
+    if (c == 's') {
+      reportSensorStats();
+    } else if (c == 'k') {
+      reportTaskStats();
+    } else if (c == 't') {
+      if (inputTrace.Recording()) {
+        inputTrace.StopRecording();
+        LOG_EVENT(LOG_TRACE_STOPPED, (uint32_t)inputTrace.Count(), inputTrace.Overflows());
+      } else {
+        inputTrace.StartRecording(micros(), buttonScanner.State());
+        LOG_EVENT(LOG_TRACE_RECORDING);
+      }
+    } else if (c == 'p') {
+      inputTrace.StartReplay(micros());
+      LOG_EVENT(LOG_TRACE_REPLAY, (uint32_t)inputTrace.Count());
+    } else if (c == 'm') {
+      // Log text and MIDI bytes cannot share the port
+      midiOverSerial = !midiOverSerial;
+      if (midiOverSerial) {
+        Serial.println("MIDI over serial: on (send 'm' to stop)");
+        midiOut.SetWriter({midiSerialWrite, midiSerialWritable});
+        midiOut.SendConfiguration();
+      } else {
+        midiOut.SetWriter({nullptr, nullptr});
+        Serial.println("MIDI over serial: off");
+      }
+    } else if (c == 'b') {
+      startTelemetry();
+    } else if (c == 'v') {
+      // Cycle verbosity: debug -> info -> off
+      LogLevel level = eventLog.Level(LOG_CAT_NOTES);
+      level = level == LOG_LEVEL_DEBUG ? LOG_LEVEL_INFO : (level == LOG_LEVEL_INFO ? LOG_LEVEL_OFF : LOG_LEVEL_DEBUG);
+      eventLog.SetAllLevels(level);
+      eventLog.SetLevel(LOG_CAT_STATS, LOG_LEVEL_INFO);  // Reports asked for are always answered
+      Serial.print("Log level: ");
+      Serial.println(level == LOG_LEVEL_DEBUG ? "debug" : (level == LOG_LEVEL_INFO ? "info" : "off"));
+    }
+#if CPU_METER_ENABLED
+    if (c == 'c') {
+      reportCpuLoad();
+    } else if (c == 'r') {
+      cpuMeter.RequestReset();
+      synth.Effects().RequestReset();
+      scheduler.ResetStats();
+      Serial.println("CPU and task stats reset");
+    }
+#endif
   }
 }
 
 void setup() {
   Serial.begin(115200);
+  eventLog.Init(logEventTable, LOG_NUM_EVENTS, {logWrite, logWritable}, logClock);
 
   // init Daisy
   hw = DAISY.init(DAISY_SEED, AUDIO_SR_48K);
   float sample_rate = DAISY.get_samplerate();
 
-  // init oscillators (sine and triangle pairs)
-  for (int i = 0; i < NUM_LEFT_BUTTONS; i++) {
-    oscSine[i].Init(sample_rate);
-    oscSine[i].SetWaveform(Oscillator::WAVE_SIN);
-    oscSine[i].SetAmp(1.0f);
-    
-    oscTri[i].Init(sample_rate);
-    oscTri[i].SetWaveform(Oscillator::WAVE_TRI);
-    oscTri[i].SetAmp(1.0f);  // Now controlled by blend factor
-    
-    // Initialize envelopes
-    envelopes[i].level = 0.0f;
-    envelopes[i].isActive = false;
-    envelopes[i].isReleasing = false;
-  }
+  // init synth engine (wavetables are built once into SDRAM)
+  synth.Init(sample_rate);
+  synth.SetEnvelope(attackTime, decayTime, sustainLevel, releaseTime, ENVELOPE_CURVE);
+  synth.SetParam(PARAM_GLIDE, glideTime);
+  synth.SetParam(PARAM_ARP_PATTERN, (float)arpPattern);
+  synth.SetParam(PARAM_ARP_RATE, arpRate);
+  synth.SetParam(PARAM_MORPH_RAMP, SENSOR_INTERVAL / 1000.0f);  // One ranging period: ramps join up
+  synth.SetParam(PARAM_VOLUME_RAMP, ANALOG_TASK_US / 1.0e6f);   // One analog update, likewise
+  distanceFilter.Init(TOF_MIN_CUTOFF, TOF_SPEED_BETA, TOF_SPEED_CUTOFF);
+  setNotePans();
+  cpuMeter.Init(sample_rate);
+  synth.SetEffectsBudget(EFFECTS_CPU_BUDGET, cpuMeter.TicksPerMicro());
+  midiOut.Init(BEND_RANGE);
 
   DAISY.begin(AudioCallback); // start audio processing
-  pinMode(VOLUME_PIN, INPUT); // volume pot
+  analogInputs.Init(analogConfigs, NUM_ANALOG_INPUTS, 1.0e6f / ANALOG_TASK_US);  // pots: DMA scan from here on
 
   // distance sensor
   // Wire.setSDA(13);  // I2C4 SDA on Daisy Seed
@@ -372,15 +1052,44 @@ void setup() {
   Wire.begin();
   Wire.setClock(400000);
   
-  // ALWAYS run I2C scan first to see what's connected
-  Serial.println("=== Running I2C scan ===");
-  i2cScan();
-  Serial.println("=== Scan complete ===");
+
+  // Presets, calibration and the sensors found last boot (see PresetStore.h)
+  if (!qspiFlash.Init() || !presets.Init(&qspiFlash, PRESET_FLASH_BASE)) {
+    LOG_EVENT(LOG_PRESET_FLASH_ERROR);
+  }
+
+  // Probe the sensor addresses; the full scan only runs when what answers
+  // differs from the stored configuration (first boot, changed hardware)
+  SensorConfig found = {i2cProbe(TOF_ADDRESS), i2cProbe(ACCEL_ADDRESS), TOF_ADDRESS, ACCEL_ADDRESS};
+  SensorConfig stored = {false, false, 0, 0};
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  size_t length = 0;
+  if (presets.Load(RECORD_SENSOR_CONFIG, payload, length)) {
+    decodeSensorConfig(payload, length, stored);
+  }
+  bool sensorsKnown = stored.tofAddress == found.tofAddress && stored.accelAddress == found.accelAddress &&
+                      stored.tof == found.tof && stored.accel == found.accel;
+  if (sensorsKnown) {
+    Serial.println("=== Sensors as stored - I2C scan skipped ===");
+  } else {
+    Serial.println("=== Running I2C scan ===");
+    i2cScan();
+    Serial.println("=== Scan complete ===");
+    if (presets.Ready()) {
+      presets.Save(RECORD_SENSOR_CONFIG, payload, encodeSensorConfig(found, payload));
+    }
+  }
+  sensors.Init(&sensorBus);
   
   Serial.println("Adafruit VL53L0X init...");
-  if (sensor.begin()) {
+  if (found.tof && sensor.begin(TOF_ADDRESS)) {
       Serial.println("VL53L0X OK - starting continuous ranging");
-      sensor.startRangeContinuous();
+      sensor.configSensor(Adafruit_VL53L0X::VL53L0X_SENSE_HIGH_SPEED);
+      sensor.startRangeContinuous(SENSOR_INTERVAL);
+      // GPIO1 defaults to "new sample ready", active low
+      pinMode(TOF_INT_PIN, INPUT_PULLUP);
+      attachInterrupt(digitalPinToInterrupt(TOF_INT_PIN), tofDataReadyIsr, FALLING);
+      sensors.EnableTof(TOF_ADDRESS, SENSOR_INTERVAL * 1000, true, micros());
       tofAvailable = true;
     } else {
       Serial.println("Failed to boot VL53L0X - continuing without ToF");
@@ -388,34 +1097,56 @@ void setup() {
   }
   
   Serial.println("MSA301 Accelerometer init...");
-  if (accel.begin()) {
+  if (found.accel && accel.begin(ACCEL_ADDRESS)) {
     Serial.println("MSA301 OK - ready for motion control");
     accelAvailable = true;
+    accel.setDataRate(MSA301_DATARATE_250_HZ);
+    accel.setBandwidth(MSA301_BANDWIDTH_125_HZ);
     // Initial calibration
     accel.read();
-    accelCenterX = accel.x;
+    tiltEstimator.Init(ACCEL_INTERVAL_US, MAX_WINDOW_OFFSET);
+    tiltEstimator.Reset(accel.x, accel.y, accel.z);
+    sensors.EnableAccel(ACCEL_ADDRESS, ACCEL_INTERVAL_US);
     Serial.print("Initial center calibration: X=");
-    Serial.println(accelCenterX);
+    Serial.println(tiltEstimator.CenterX());
   } else {
     Serial.println("Failed to initialize MSA301 - continuing without accelerometer");
     Serial.println("Tip: Verify sensor is wired to I2C bus");
   }
 
-  // left hand buttons
+  // buttons: sampled and debounced by a timer interrupt
+  int scanPins[BUTTON_SCAN_BITS];
+  for (int bit = 0; bit < BUTTON_SCAN_BITS; bit++) {
+    scanPins[bit] = -1;
+  }
   for (int i = 0; i < NUM_LEFT_BUTTONS; i++) {
-    leftButton[i].Init(1000, true, leftButtonPins[i], INPUT_PULLUP);
+    pinMode(leftButtonPins[i], INPUT_PULLUP);
+    scanPins[i] = leftButtonPins[i];
   }
-
-  // right hand buttons
   for (int i = 0; i < NUM_RIGHT_BUTTONS; i++) {
-    rightButton[i].Init(1000, true, rightButtonPins[i], INPUT_PULLUP);
+    pinMode(rightButtonPins[i], INPUT_PULLUP);
+    scanPins[RIGHT_BUTTON_BIT + i] = rightButtonPins[i];
   }
+  buttonScanner.Init(scanPins, BUTTON_SCAN_BITS);
+  buttonTimer = new HardwareTimer(TIM7);
+  buttonTimer->setOverflow(BUTTON_SCAN_HZ, HERTZ_FORMAT);
+  buttonTimer->attachInterrupt(buttonScanIsr);
+  buttonTimer->resume();
 
   updateScaleNotes();  // init scale notes
+  restoreStoredState();
   Serial.println("Two-handed NIME controller initialized!");
   Serial.println("Left hand: Note articulation (D8-D12)");
   Serial.println("Right hand: Modifiers (D15-D19)");
-  Serial.println("Current key: C, Octave: 4, Scale: Major Pentatonic");
+  Serial.print("Current scale: ");
+  Serial.println(scaleDef(currentScale).name);
+  printWindow();
+#if MEMORY_PLACEMENT
+  MemoryUsage memory = memoryUsage();
+  LOG_EVENT(LOG_MEMORY, (uint32_t)memory.itcmCode, (uint32_t)memory.dtcmData, (uint32_t)(memory.sdramData / 1024));
+#endif
+  LOG_EVENT(LOG_BOOT, micros() / 1000.0f, presets.RecordsFound(), sensorsKnown ? "as stored" : "scanned");
+  startTasks();
 }
 
 void handleRightHand() {
@@ -432,22 +1163,23 @@ void handleRightHand() {
     if (middlePressed && !rightButtonPrevStates[RIGHT_MIDDLE]) {
       pitchOffset = 1;
       applyPitchOffset();
-      Serial.println("Momentary Sharp (#): +1 semitone to playing notes");
+      LOG_EVENT(LOG_PITCH_OFFSET, "Momentary Sharp (#): +1 semitone to playing notes");
     } else if (!middlePressed && rightButtonPrevStates[RIGHT_MIDDLE]) {
       pitchOffset = 0;
       applyPitchOffset();
-      Serial.println("Sharp Released: back to normal pitch");
+      LOG_EVENT(LOG_PITCH_OFFSET, "Sharp Released: back to normal pitch");
     }
     
-    // Momentary flat (ring finger)
-    if (ringPressed && !rightButtonPrevStates[RIGHT_RING]) {
+    // Momentary flat (ring finger); ring + pinky is the preset mode combo,
+    // so the pinky keeps the ring from bending and cancels a flat it joins
+    if (ringPressed && !rightButtonPrevStates[RIGHT_RING] && !pinkyPressed) {
       pitchOffset = -1;
       applyPitchOffset();
-      Serial.println("Momentary Flat (♭): -1 semitone to playing notes");
-    } else if (!ringPressed && rightButtonPrevStates[RIGHT_RING]) {
+      LOG_EVENT(LOG_PITCH_OFFSET, "Momentary Flat (♭): -1 semitone to playing notes");
+    } else if (pitchOffset < 0 && (!ringPressed || pinkyPressed)) {
       pitchOffset = 0;
       applyPitchOffset();
-      Serial.println("Flat Released: back to normal pitch");
+      LOG_EVENT(LOG_PITCH_OFFSET, "Flat Released: back to normal pitch");
     }
   }
 
@@ -457,23 +1189,28 @@ void handleRightHand() {
     if (indexPressed && !rightButtonPrevStates[RIGHT_INDEX]) {
       currentScale = SCALE_MAJOR_PENTATONIC;
       updateScaleNotes();
-      Serial.println("Scale: Major Pentatonic");
+      markStateChanged();
+      LOG_EVENT(LOG_SCALE, scaleDef(currentScale).name);
     }
     if (middlePressed && !rightButtonPrevStates[RIGHT_MIDDLE]) {
       currentScale = SCALE_BLUES;
       updateScaleNotes();
-      Serial.println("Scale: Blues");
+      markStateChanged();
+      LOG_EVENT(LOG_SCALE, scaleDef(currentScale).name);
     }
     if (ringPressed && !rightButtonPrevStates[RIGHT_RING]) {
-      currentScale = SCALE_CHROMATIC;
+      // Chromatic first, then each following registry entry (microtonal) in turn
+      bool cycling = currentScale >= SCALE_CHROMATIC && currentScale < NUM_SCALES - 1;
+      currentScale = cycling ? currentScale + 1 : SCALE_CHROMATIC;
       updateScaleNotes();
-      Serial.println("Scale: Chromatic");
+      markStateChanged();
+      LOG_EVENT(LOG_SCALE, scaleDef(currentScale).name);
     }
     // latch
     if (pinkyPressed && !rightButtonPrevStates[RIGHT_PINKY]) {
       latchMode = !latchMode;
-      Serial.print("Latch Mode: ");
-      Serial.println(latchMode ? "ON" : "OFF");
+      markStateChanged();
+      LOG_EVENT(LOG_LATCH_MODE, latchMode ? "ON" : "OFF");
       // When turning OFF latch mode, clear all latched notes
       if (!latchMode) {
         clearAllLatchedNotes();
@@ -483,19 +1220,21 @@ void handleRightHand() {
     else if (indexPressed && middlePressed) {
       if (currentMode != MODE_MAJOR_CHORD) {
         currentMode = MODE_MAJOR_CHORD;
-        Serial.println("Mode: Major Chord");
+        LOG_EVENT(LOG_PLAY_MODE, "Major Chord");
       }
     } 
     else if (indexPressed && ringPressed) {
       if (currentMode != MODE_MINOR_CHORD) {
         currentMode = MODE_MINOR_CHORD;
-        Serial.println("Mode: Minor Chord");
+        LOG_EVENT(LOG_PLAY_MODE, "Minor Chord");
       }
     } 
     // change key
     else if (middlePressed && ringPressed) {
       // key set mode – handled in left hand
-      Serial.println("Key Set Mode – Use left hand to select key");
+      if (!(rightButtonPrevStates[RIGHT_MIDDLE] && rightButtonPrevStates[RIGHT_RING])) {
+        LOG_EVENT(LOG_KEY_SET_MODE);  // Announce once on entry
+      }
     }
   }
   // single button actions (now control sliding window mode)
@@ -504,18 +1243,16 @@ void handleRightHand() {
     if (indexPressed && pinkyPressed) {
       if (!isCalibrating && calibrationStartTime == 0) {
         calibrationStartTime = millis();
-        Serial.println("Hold for 2s to calibrate center position...");
+        LOG_EVENT(LOG_CALIBRATION_HOLD);
       } else if (millis() - calibrationStartTime >= CALIBRATION_HOLD_TIME) {
         // Calibrate!
         if (accelAvailable) {
-          accel.read();
-          accelCenterX = accel.x;
-          accelPositionOffset = 0.0f;
+          tiltEstimator.Recenter();
           windowOffset = 0;
           updateScaleNotes();
-          Serial.println("=== CALIBRATED ===");
-          Serial.print("New center X: ");
-          Serial.println(accelCenterX);
+          markStateChanged();
+          saveCalibration();
+          LOG_EVENT(LOG_CALIBRATED, tiltEstimator.CenterX());
           printWindow();
         }
         isCalibrating = false;
@@ -524,15 +1261,19 @@ void handleRightHand() {
     } else {
       // Reset calibration timer if buttons released
       if (calibrationStartTime != 0 && !isCalibrating) {
-        Serial.println("Calibration cancelled");
+        LOG_EVENT(LOG_CALIBRATION_CANCELLED);
       }
       calibrationStartTime = 0;
       isCalibrating = false;
     }
+    // preset mode – handled in left hand
+    if (presetModeHeld() && !(rightButtonPrevStates[RIGHT_RING] && rightButtonPrevStates[RIGHT_PINKY])) {
+      LOG_EVENT(LOG_PRESET_MODE);  // Announce once on entry
+    }
     // reset to single note (no combos pressed)
     if (!indexPressed && !middlePressed && !ringPressed && currentMode != MODE_SINGLE_NOTE) {
       currentMode = MODE_SINGLE_NOTE;
-      Serial.println("Mode: Single Note");
+      LOG_EVENT(LOG_PLAY_MODE, "Single Note");
     }
   }
   
@@ -545,11 +1286,10 @@ void handleRightHand() {
 
 void handleLeftHand() {
   bool keySetMode = rightButtonStates[RIGHT_MIDDLE] && rightButtonStates[RIGHT_RING];
+  bool presetMode = presetModeHeld();
 
   for (int i = 0; i < NUM_LEFT_BUTTONS; i++) {
-    leftButton[i].Debounce();
-
-    bool pressed     = leftButton[i].Pressed();        // current physical state
+    bool pressed     = leftButtonPressed[i];           // current physical state
     bool wasPressed  = leftButtonPrevStates[i];        // previous physical state
     bool rising      =  pressed && !wasPressed;        // just pressed
     bool falling     = !pressed &&  wasPressed;        // just released
@@ -560,8 +1300,24 @@ void handleLeftHand() {
         int newKey = (i * 2) % 12; // simple mapping, tweak as desired
         currentKey = newKey;
         updateScaleNotes();
-        Serial.print("New Key: ");
-        Serial.println(currentKey);
+        markStateChanged();
+        LOG_EVENT(LOG_KEY, currentKey);
+      }
+    } else if (rising ? presetMode : presetPressed[i]) {
+      // Preset slot per button: tap recalls, holding saves (once); a press
+      // is followed to its release even if the mode combo is let go first
+      if (rising) {
+        presetPressed[i] = true;
+        presetSaved[i] = false;
+        presetPressStart[i] = millis();
+      } else if (pressed && !presetSaved[i] && millis() - presetPressStart[i] >= PRESET_SAVE_HOLD) {
+        savePreset(i);
+        presetSaved[i] = true;
+      } else if (falling) {
+        if (!presetSaved[i]) {
+          recallPreset(i);
+        }
+        presetPressed[i] = false;
       }
     } else if (latchMode) {
       // Latch mode: press latches note ON, press again re-triggers
@@ -569,29 +1325,13 @@ void handleLeftHand() {
         if (!leftButtonStates[i]) {
           // Note was off, latch it on
           leftButtonStates[i] = true;
-          int note = currentScaleNotes[i];
-          float freq = mtof(note);
-          oscSine[i].SetFreq(freq);
-          oscTri[i].SetFreq(freq);
-          triggerNote(i);  // Start envelope attack
-          Serial.print("Note LATCHED - Button ");
-          Serial.print(i + 1);
-          Serial.print(", MIDI Note: ");
-          Serial.print(note);
-          Serial.print(" (");
-          Serial.print(freq);
-          Serial.println(" Hz)");
+          float note = currentScaleNotes[i];
+          triggerNote(i, note);  // Start envelope attack
+          LOG_EVENT(LOG_NOTE_LATCHED, i + 1, note);
         } else {
           // Note already latched, re-trigger envelope
-          int note = currentScaleNotes[i];
-          float freq = mtof(note);
-          oscSine[i].SetFreq(freq);
-          oscTri[i].SetFreq(freq);
-          oscSine[i].Reset();
-          oscTri[i].Reset();
-          triggerNote(i);  // Retrigger envelope from start
-          Serial.print("Note RE-TRIGGERED - Button ");
-          Serial.println(i + 1);
+          retriggerNote(i, currentScaleNotes[i]);  // Restart cycle and envelope from start
+          LOG_EVENT(LOG_NOTE_RETRIGGERED, i + 1);
         }
       }
       // Ignore release in latch mode
@@ -599,24 +1339,14 @@ void handleLeftHand() {
       // Normal: press = ON, release = OFF
       if (rising) {
         leftButtonStates[i] = true;
-        int note = currentScaleNotes[i];
-        float freq = mtof(note);
-        oscSine[i].SetFreq(freq);
-        oscTri[i].SetFreq(freq);
-        triggerNote(i);  // Start envelope attack
-        Serial.print("Note ON - Button ");
-        Serial.print(i + 1);
-        Serial.print(", MIDI Note: ");
-        Serial.print(note);
-        Serial.print(" (");
-        Serial.print(freq);
-        Serial.println(" Hz)");
+        float note = currentScaleNotes[i];
+        triggerNote(i, note);  // Start envelope attack
+        LOG_EVENT(LOG_NOTE_ON, i + 1, note);
       }
       if (falling) {
         leftButtonStates[i] = false;
         releaseNote(i);  // Start envelope release
-        Serial.print("Note OFF - Button ");
-        Serial.println(i + 1);
+        LOG_EVENT(LOG_NOTE_OFF, i + 1);
       }
     }
 
@@ -625,120 +1355,310 @@ void handleLeftHand() {
   }
 };
 
-void loop() {
-  // volume
-  int volumeRaw = analogRead(VOLUME_PIN);
-  
-  if (abs((volumeRaw - lastVolumeRaw)) > VOLUME_CHANGE_THRESHOLD) {
-    volume = (volumeRaw / 1023.0f) * VOLUME_SCALE;
-    float volumePercent = volume * 200; // Convert back to percentage for display
-    Serial.print("Volume: ");
-    Serial.print(volumePercent, 1);
-    Serial.println("%");
-    lastVolumeRaw = volumeRaw;
+/**
+ * Send a continuous bend (semitones) when it has moved enough to matter
+ */
+void setPitchBend(float bend) {
+  bend = constrain(bend, -BEND_RANGE, BEND_RANGE);
+  if (fabsf(bend - pitchBend) >= BEND_CHANGE_THRESHOLD || (bend == 0.0f && pitchBend != 0.0f)) {
+    pitchBend = bend;
+    synth.SetParam(PARAM_BEND, pitchBend);
+    midiOut.SetBend(pitchBend);
   }
+}
 
-  // right hand
-  for (int i = 0; i < NUM_RIGHT_BUTTONS; i++) {
-    rightButton[i].Debounce();
-    rightButtonStates[i] = rightButton[i].Pressed();
+/**
+ * Y tilt pans the whole image, proportionally
+ */
+void updateTiltPan(float tilt) {
+  float pan = constrain(tilt / PAN_FULL_TILT, -1.0f, 1.0f);
+  if (fabsf(pan - panOffset) >= PAN_CHANGE_THRESHOLD) {
+    panOffset = pan;
+    synth.SetParam(PARAM_PAN_OFFSET, panOffset);
   }
+}
 
-  handleRightHand();
+/**
+ * Y tilt outside the dead zone bends up or down, proportionally
+ */
+void updateTiltBend(float tilt) {
+  float excess = fabsf(tilt) - BEND_DEAD_ZONE;
+  float amount = excess > 0.0f ? excess / BEND_FULL_TILT : 0.0f;
+  setPitchBend((tilt > 0.0f ? amount : -amount) * BEND_RANGE);
+}
 
-  // left hand
-  handleLeftHand();
+/**
+ * Accelerometer sample: X tilt moves the sliding window, Y tilt bends
+ * and/or pans
+ */
+void handleAccelSample(const SensorSample &sample) {
+  // Only navigate if index or pinky pressed (not both - that's calibration)
+  bool indexPressed = rightButtonStates[RIGHT_INDEX];
+  bool pinkyPressed = rightButtonStates[RIGHT_PINKY];
+  bool navigating = (indexPressed || pinkyPressed) && !(indexPressed && pinkyPressed) && !presetModeHeld();
 
-  // accelerometer (sliding window control)
-  if (accelAvailable && (millis() - lastAccelRead >= ACCEL_INTERVAL)) {
-    accel.read();
-    float accelX = accel.x;
-    float deltaT = (millis() - lastAccelRead) / 1000.0f;  // Time in seconds
-    
-    // Only process if index or pinky pressed (not both - that's calibration)
-    bool indexPressed = rightButtonStates[RIGHT_INDEX];
-    bool pinkyPressed = rightButtonStates[RIGHT_PINKY];
-    
-    if ((indexPressed || pinkyPressed) && !(indexPressed && pinkyPressed)) {
-      // Calculate velocity (change from center)
-      float velocity = accelX - accelCenterX;
-      
-      // Choose sensitivity based on which button is pressed
-      float sensitivity = indexPressed ? COARSE_SENSITIVITY : FINE_SENSITIVITY;
-      
-      // Integrate velocity to position
-      accelPositionOffset += velocity * sensitivity * deltaT;
-      
-      // Update window offset (convert to integer semitones)
-      int newWindowOffset = (int)round(accelPositionOffset);
-      newWindowOffset = constrain(newWindowOffset, -MAX_WINDOW_OFFSET, MAX_WINDOW_OFFSET);
-      
-      // Only update if changed
-      if (newWindowOffset != windowOffset) {
-        windowOffset = newWindowOffset;
-        updateScaleNotes();
+  // Choose sensitivity based on which button is pressed
+  float sensitivity = navigating ? (indexPressed ? coarseSensitivity : fineSensitivity) : 0.0f;
+  tiltEstimator.Update(sample.value, sample.timestampMicros, sensitivity);
+
+  // Only update if changed
+  if (navigating && tiltEstimator.WindowOffset() != windowOffset) {
+    windowOffset = tiltEstimator.WindowOffset();
+    updateScaleNotes();
+    markStateChanged();
+
+    // Log window info
+    printWindow(indexPressed ? "[COARSE] " : "[FINE] ");
+  }
+
+  if (BEND_SOURCE == BEND_ACCEL_TILT) {
+    updateTiltBend(tiltEstimator.TiltY());
+  }
+  if (PAN_SOURCE == PAN_ACCEL_TILT) {
+    updateTiltPan(tiltEstimator.TiltY());
+  }
+}
+
+/**
+ * Distance sample: arpeggiator rate while it is on, else morph in
+ * single-note mode and delay and reverb otherwise. Ranges go through the
+ * distance filter first; a rejected one leaves everything where it was.
+ */
+void handleDistanceSample(const SensorSample &sample) {
+  if (!distanceFilter.Update(sample.value[0], sample.status == 0, sample.timestampMicros)) {
+    return;
+  }
+  float distance = distanceFilter.Present() ? distanceFilter.Distance() : TOF_NO_TARGET;
+  // Close = 1, far (or no hand) = 0
+  float closeness = 1.0f - (constrain(distance, (float)distanceMin, (float)distanceMax) - distanceMin)
+                           / (float)(distanceMax - distanceMin);
+
+  if (BEND_SOURCE == BEND_TOF) {
+    // Close = bend up, far = bend down; no hand = no bend
+    if (distance > distanceMax) {
+      setPitchBend(0.0f);
+    } else {
+      setPitchBend((2.0f * closeness - 1.0f) * BEND_RANGE);
+    }
+  }
+  
+  if (fabsf(distance - lastDistance) > DISTANCE_CHANGE_THRESHOLD && arpPattern != ARP_OFF) {
+    // Tempo: close = fast, far = slow; morph and effects stay where they were
+    arpRate = ARP_RATE_SLOW + closeness * (ARP_RATE_FAST - ARP_RATE_SLOW);
+    synth.SetParam(PARAM_ARP_RATE, arpRate);
+    LOG_EVENT(LOG_DISTANCE_ARP, (int)distance, arpRate);
+    lastDistance = distance;
+  } else if (fabsf(distance - lastDistance) > DISTANCE_CHANGE_THRESHOLD) {
+    switch (currentMode) {
+      case MODE_SINGLE_NOTE: {
+        // waveform morphing: triangle when close, sine when far; the
+        // engine ramps to each new position over one ranging period
+        waveformBlend = closeness;
+        synth.SetParam(PARAM_MORPH, waveformBlend * morphMax);
+        midiOut.SetTimbre(waveformBlend);
         
-        // Print window info
-        Serial.print(indexPressed ? "[COARSE] " : "[FINE] ");
-        printWindow();
+        // Frames are RMS-normalized, so the morph keeps constant
+        // perceived volume without per-waveform gain curves
+        LOG_EVENT(LOG_DISTANCE_MORPH, (int)distance, waveformBlend * morphMax);
+        break;
+      }
+      case MODE_MAJOR_CHORD:
+      case MODE_MINOR_CHORD: {
+        // Effects: close = wet and long, far = dry; the sends stay where
+        // they were left when the mode changes back
+        effectAmount = closeness;
+        synth.SetParam(PARAM_DELAY_MIX, effectAmount * delayMixMax);
+        synth.SetParam(PARAM_REVERB_MIX, effectAmount * reverbMixMax);
+        synth.SetParam(PARAM_REVERB_DECAY, REVERB_DECAY_MIN + effectAmount * (REVERB_DECAY_MAX - REVERB_DECAY_MIN));
+        LOG_EVENT(LOG_DISTANCE_EFFECTS, (int)distance, effectAmount);
+        break;
       }
     }
-    
-    lastAccelX = accelX;
-    lastAccelRead = millis();
+    lastDistance = distance;
   }
+}
 
-  // distance sensor
-  if (tofAvailable && (millis() - lastSensorRead >= SENSOR_INTERVAL)) {
-    if (sensor.isRangeComplete()) {
-      int distance = sensor.readRange();
-      
-      if (abs(distance - lastDistance) > DISTANCE_CHANGE_THRESHOLD) {
-        switch (currentMode) {
-          case MODE_SINGLE_NOTE: {
-            // waveform crossfading: triangle when close, sine when far
-            waveformBlend = map(constrain(distance, DISTANCE_MIN, DISTANCE_MAX), 
-                               DISTANCE_MIN, DISTANCE_MAX, 100, 0) / 100.0f;
-            
-            // Equal-power crossfade to maintain constant perceived volume
-            // Uses square root curves so that sine²(x) + cosine²(x) = 1
-            float blendRadians = waveformBlend * (PI / 2.0f);  // 0 to π/2
-            triAmp = sinf(blendRadians);      // 0.0 to 1.0 (curved)
-            sineAmp = cosf(blendRadians);     // 1.0 to 0.0 (curved)
-            
-            // Boost triangle for more dramatic timbral difference
-            // Close = more aggressive triangle character
-            triBoost = 1.0f + (waveformBlend * 0.8f);  // 1.0x to 1.8x boost
-            
-            Serial.print("Distance: ");
-            Serial.print(distance);
-            Serial.print(" mm - Blend: Sine ");
-            Serial.print(sineAmp * 100, 0);
-            Serial.print("% / Tri ");
-            Serial.print(triAmp * 100, 0);
-            Serial.print("% (boost: ");
-            Serial.print(triBoost, 2);
-            Serial.println("x)");
-            break;
-          }
-          case MODE_MAJOR_CHORD:
-            // arpeggiator or strum 
-            Serial.print("Distance: ");
-            Serial.print(distance);
-            Serial.println(" mm - chord effect");
-            break;
-          case MODE_MINOR_CHORD:
-            // arpeggiator or strum 
-            Serial.print("Distance: ");
-            Serial.print(distance);
-            Serial.println(" mm - chord effect");
-            break;
-        }
-        lastDistance = distance;
-      }
+/**
+ * Apply one debounced button mask and run both hands' handlers, with any
+ * notes they start or stop timed from the edge
+ */
+void handleButtonEdge(const ButtonEdge &edge) {
+  for (int i = 0; i < NUM_LEFT_BUTTONS; i++) {
+    leftButtonPressed[i] = (edge.buttons >> i) & 1;
+  }
+  for (int i = 0; i < NUM_RIGHT_BUTTONS; i++) {
+    rightButtonStates[i] = (edge.buttons >> (RIGHT_BUTTON_BIT + i)) & 1;
+  }
+  noteTimeMicros = edge.timeMicros + NOTE_LATENCY_US;
+  handleRightHand();
+  handleLeftHand();
+}
+
+void handleSensorSample(const SensorSample &sample) {
+  if (sample.kind == SENSOR_ACCEL) {
+    handleAccelSample(sample);
+  } else {
+    handleDistanceSample(sample);
+  }
+}
+
+/////////////////////
+// Control tasks
+/////////////////////
+
+/**
+ * Analog inputs: filter the latest DMA readings (and substitute the
+ * trace's levels while replaying), then the volume through its dB taper;
+ * the engine ramps the gain over one task period
+ */
+void analogTask(uint32_t now) {
+  // The readings are filtered even during replay so task timing stays the same
+  uint16_t raw[NUM_ANALOG_INPUTS];
+  analogInputs.Read(raw);
+  analogInputs.Filter(raw);
+  uint16_t levels[NUM_ANALOG_INPUTS];
+  for (int i = 0; i < NUM_ANALOG_INPUTS; i++) {
+    levels[i] = analogInputs.Level(i);
+  }
+  if (inputTrace.Replaying()) {
+    inputTrace.ReplayAnalog(now, levels, NUM_ANALOG_INPUTS);
+  } else {
+    inputTrace.RecordAnalog(now, levels, NUM_ANALOG_INPUTS);
+  }
+
+  if (levels[ANALOG_VOLUME] != lastVolumeLevel) {
+    float position = (float)levels[ANALOG_VOLUME] / ANALOG_FULL_SCALE;
+    float gain = analogDbTaper(position, VOLUME_RANGE_DB, VOLUME_OFF_BELOW);
+    volume = gain * VOLUME_SCALE;
+    synth.SetParam(PARAM_VOLUME, volume);
+    lastVolumeLevel = levels[ANALOG_VOLUME];
+    volumeChangedAt = now;
+    volumeLogPending = true;
+  } else if (volumeLogPending && now - volumeChangedAt >= VOLUME_LOG_SETTLE_US) {
+    // One line per turn of the knob, not one per filter step
+    float position = (float)lastVolumeLevel / ANALOG_FULL_SCALE;
+    float gain = analogDbTaper(position, VOLUME_RANGE_DB, VOLUME_OFF_BELOW);
+    LOG_EVENT(LOG_VOLUME, position * 100.0f, 20.0f * log10f(gain));
+    volumeLogPending = false;
+  }
+}
+
+/**
+ * Hands: every debounced edge in order
+ */
+void buttonTask(uint32_t now) {
+  inputTrace.ReplayDue(now);  // Replayed edges as soon as they are due, not at the next pot read
+  bool replaying = inputTrace.Replaying();
+  ButtonEdge edge;
+  bool edges = false;
+  while (buttonScanner.Pop(edge)) {
+    if (replaying) {
+      continue;  // The trace stands in for the live buttons
     }
-    lastSensorRead = millis();
+    inputTrace.RecordButtons(now, edge);
+    handleButtonEdge(edge);
+    edges = true;
+  }
+  while (inputTrace.PopButtons(edge)) {
+    handleButtonEdge(edge);
+    edges = true;
+  }
+  if (!edges) {
+    // Held gestures (calibration) advance without edges
+    noteTimeMicros = now + NOTE_LATENCY_US;
+    handleRightHand();
+    handleLeftHand();
   }
+}
+
+/**
+ * Sensors: at most one short I2C transfer per run
+ */
+void sensorTask(uint32_t now) {
+  inputTrace.ReplayDue(now);
+  bool replaying = inputTrace.Replaying();
+  sensors.Service(now);
+  SensorSample sample;
+  while (sensors.Pop(sample)) {
+    if (replaying) {
+      continue;  // The trace stands in for the live sensors
+    }
+    inputTrace.RecordSample(now, sample);
+    handleSensorSample(sample);
+  }
+  while (inputTrace.PopSample(sample)) {
+    handleSensorSample(sample);
+  }
+}
+
+/**
+ * MIDI: one frame of packets per run
+ */
+void midiTask(uint32_t now) {
+  forwardArpNotes();
+  midiOut.Service(now);
+}
+
+/**
+ * Presets: the state for the next boot, once it has settled
+ */
+void presetTask(uint32_t now) {
+  (void)now;
+  saveStateWhenIdle();
+}
+
+/**
+ * Diagnostics: serial commands, then log text (while the port carries
+ * MIDI or telemetry, log records wait in the ring or drop when it fills)
+ */
+void logTask(uint32_t now) {
+  inputTrace.ReplayDue(now);
+  replayCommands();
+  handleSerialCommands(now);
+  if (telemetryOn) {
+    if (telemetryRate > 0 && now - lastTelemetryAt >= 1000000u / telemetryRate) {
+      lastTelemetryAt = now;
+      sendTelemetry(now);
+    }
+  } else if (!midiOverSerial) {
+#if LOG_ENABLED
+    eventLog.Drain(LOG_DRAIN_PER_RUN);
+#endif
+    inputTrace.Flush({logWrite, logWritable}, TRACE_FLUSH_PER_RUN);  // Recorded, not yet sent
+  }
+}
+
+#if CPU_METER_ENABLED
+void cpuReportTask(uint32_t now) {
+  (void)now;
+  if (!midiOverSerial && !telemetryOn) {
+    reportCpuLoad();
+  }
+}
+#endif
+
+/**
+ * Register the control tasks, most urgent first
+ */
+void startTasks() {
+  scheduler.Init(logClock);
+  scheduler.Add("buttons", BUTTON_TASK_US, 0, buttonTask);
+  scheduler.Add("sensors", SENSOR_TASK_US, 1, sensorTask);
+  scheduler.Add("midi", MIDI_FRAME_MICROS, 2, midiTask);
+  scheduler.Add("analog", ANALOG_TASK_US, 3, analogTask);
+  scheduler.Add("presets", PRESET_TASK_US, 4, presetTask);
+  scheduler.Add("log", LOG_TASK_US, 5, logTask);
+#if CPU_METER_ENABLED
+  scheduler.Add("cpu", CPU_REPORT_INTERVAL * 1000, 6, cpuReportTask);
+#endif
+}
+
+void loop() {
+  // Interrupts (button scans, audio, ToF data ready) run while idling
+  uint32_t idle = scheduler.RunDue();
+  if (idle > 0) {
+    delayMicroseconds(idle);
+  }
+}
 
-  delay(1);
-}
\ No newline at end of file
+#endif  // PIO_UNIT_TESTING
@@ -0,0 +1,151 @@
+/**
+ * AccelEstimator on the accelerometer trace tools/render/accel_window.txt
+ * replays (0.35 m/s^2 mount bias, noise, a tilt right, a tilt left, two
+ * knocks, a level hold): the window follows the tilts step by step, and
+ * neither the knocks nor the hold move it
+ */
+
+#include <stdio.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+#include "AccelEstimator.h"
+
+// The firmware's settings (main.cpp) and the render script's timing
+const uint32_t STEP_MICROS = 4000;
+const int MAX_OFFSET = 24;
+const float COARSE_SENSITIVITY = 8.0f;
+const float PRESS_MS = 900.0f;     // Index pressed (coarse navigation)
+const float RELEASE_MS = 6000.0f;
+const char *const TRACE = "tools/render/traces/accel_tilt.csv";
+
+struct Reading {
+  float ms;
+  float accel[3];
+};
+
+struct Step {
+  float ms;
+  int offset;
+};
+
+static std::vector<Reading> trace;
+static AccelEstimator estimator;
+static std::vector<Step> steps;
+static size_t next = 0;  // Next reading to replay
+
+/**
+ * The trace from the project root (where `pio test` runs), else from
+ * this file's location
+ */
+bool loadTrace() {
+  FILE *file = fopen(TRACE, "r");
+  if (!file) {
+    std::string path(__FILE__);
+    path = path.substr(0, path.rfind("test/")) + TRACE;
+    file = fopen(path.c_str(), "r");
+  }
+  if (!file) {
+    return false;
+  }
+  char line[128];
+  Reading r;
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] != '#' && sscanf(line, "%f %f %f %f", &r.ms, &r.accel[0], &r.accel[1], &r.accel[2]) == 4) {
+      trace.push_back(r);
+    }
+  }
+  fclose(file);
+  return !trace.empty();
+}
+
+/**
+ * Replay the trace up to (not including) untilMs, navigating while the
+ * index is held as handleAccelSample() does, and note every window step
+ */
+void replayUntil(float untilMs) {
+  for (; next < trace.size() && trace[next].ms < untilMs; next++) {
+    const Reading &r = trace[next];
+    float sensitivity = r.ms >= PRESS_MS && r.ms < RELEASE_MS ? COARSE_SENSITIVITY : 0.0f;
+    int before = estimator.WindowOffset();
+    estimator.Update(r.accel, (uint32_t)(r.ms * 1000.0f), sensitivity);
+    if (estimator.WindowOffset() != before) {
+      steps.push_back({r.ms, estimator.WindowOffset()});
+    }
+  }
+}
+
+int stepsBetween(float fromMs, float toMs) {
+  int count = 0;
+  for (const Step &step : steps) {
+    count += step.ms >= fromMs && step.ms < toMs ? 1 : 0;
+  }
+  return count;
+}
+
+void setUp() {
+  TEST_ASSERT_TRUE_MESSAGE(!trace.empty() || loadTrace(), "accel_tilt.csv not found");
+  estimator.Init(STEP_MICROS, MAX_OFFSET);
+  estimator.Reset(trace[0].accel[0], trace[0].accel[1], trace[0].accel[2]);
+  steps.clear();
+  next = 0;
+}
+
+void tearDown() {}
+
+/**
+ * Six semitones up while tilted right (1.0-1.6 s), three back down while
+ * tilted left (2.5-3.0 s), one step at a time
+ */
+void test_tilts_step_the_window() {
+  replayUntil(RELEASE_MS);
+  TEST_ASSERT_EQUAL_INT(6, stepsBetween(1000.0f, 1700.0f));
+  TEST_ASSERT_EQUAL_INT(3, stepsBetween(2500.0f, 3100.0f));
+  TEST_ASSERT_EQUAL_INT(9, (int)steps.size());
+  int offset = 0;
+  for (const Step &step : steps) {
+    TEST_ASSERT_EQUAL_INT(step.ms < 2000.0f ? offset + 1 : offset - 1, step.offset);
+    offset = step.offset;
+  }
+  TEST_ASSERT_EQUAL_INT(3, estimator.WindowOffset());
+}
+
+/**
+ * The knocks at 2.0 s and 4.2 s, both while navigating, leave the
+ * position exactly where it was
+ */
+void test_knocks_do_not_move_the_window() {
+  const float KNOCKS_MS[] = {2000.0f, 4200.0f};
+  for (float knock : KNOCKS_MS) {
+    replayUntil(knock - 200.0f);
+    float position = estimator.Position();
+    int offset = estimator.WindowOffset();
+    replayUntil(knock + 200.0f);
+    TEST_ASSERT_EQUAL_FLOAT(position, estimator.Position());
+    TEST_ASSERT_EQUAL_INT(offset, estimator.WindowOffset());
+  }
+}
+
+/**
+ * Level with the mount bias, from the end of the left tilt until the
+ * index is released: no window step and no drift toward one
+ */
+void test_level_hold_does_not_move_the_window() {
+  replayUntil(3100.0f);
+  float position = estimator.Position();
+  replayUntil(RELEASE_MS);
+  TEST_ASSERT_EQUAL_INT(0, stepsBetween(3100.0f, RELEASE_MS));
+  TEST_ASSERT_EQUAL_FLOAT(position, estimator.Position());
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, estimator.TiltX());
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_tilts_step_the_window);
+  RUN_TEST(test_knocks_do_not_move_the_window);
+  RUN_TEST(test_level_hold_does_not_move_the_window);
+  return UNITY_END();
+}
@@ -0,0 +1,169 @@
+/**
+ * AnalogInputs: the first reading taken as is, a noisy knob left alone
+ * reading perfectly still, a turn settling quickly and landing exactly on
+ * the end however slowly it is made, inputs filtered independently, and
+ * the dB taper
+ */
+
+#include <unity.h>
+
+#include "AnalogInputs.h"
+
+// The firmware's settings (main.cpp)
+const float UPDATE_HZ = 500.0f;
+const float RANGE_DB = 40.0f;
+const float OFF_BELOW = 0.01f;
+const AnalogInputConfig CONFIGS[2] = {
+  {dsy_pin(DSY_GPIOC, 1), 8.0f, 0.002f},
+  {dsy_pin(DSY_GPIOC, 0), 8.0f, 0.002f},
+};
+const int NOISE = 256;  // +-4 LSB at 12 bits, in 16-bit counts
+
+static AnalogInputs inputs;
+static uint32_t seed = 1;
+
+/**
+ * A reading around level with ADC noise
+ */
+uint16_t noisy(int level) {
+  seed = seed * 1664525u + 1013904223u;
+  return (uint16_t)(level + (int)(seed >> 16) % (2 * NOISE + 1) - NOISE);
+}
+
+void setUp() {
+  inputs.Init(CONFIGS, 1, UPDATE_HZ);
+  seed = 1;
+}
+
+void tearDown() {}
+
+void test_first_reading_is_taken_as_is() {
+  uint16_t raw = 30000;
+  TEST_ASSERT_TRUE(inputs.Filter(&raw));
+  TEST_ASSERT_EQUAL_UINT16(30000, inputs.Level(0));
+}
+
+void test_still_knob_reads_still() {
+  uint16_t raw = noisy(30000);
+  inputs.Filter(&raw);
+  for (int i = 0; i < (int)UPDATE_HZ / 4; i++) {  // Settle
+    raw = noisy(30000);
+    inputs.Filter(&raw);
+  }
+  uint16_t settled = inputs.Level(0);
+  for (int i = 0; i < (int)UPDATE_HZ * 4; i++) {
+    raw = noisy(30000);
+    TEST_ASSERT_FALSE(inputs.Filter(&raw));
+  }
+  TEST_ASSERT_EQUAL_UINT16(settled, inputs.Level(0));
+}
+
+void test_full_turn_settles_within_100_ms_at_full_scale() {
+  uint16_t raw = 0;
+  inputs.Filter(&raw);
+  TEST_ASSERT_EQUAL_UINT16(0, inputs.Level(0));
+  raw = 65535;
+  int updates = 0;
+  while (inputs.Value(0) < 0.9f && updates < (int)UPDATE_HZ) {
+    inputs.Filter(&raw);
+    updates++;
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(UPDATE_HZ / 10, updates);
+  for (int i = 0; i < (int)UPDATE_HZ; i++) {
+    inputs.Filter(&raw);
+  }
+  TEST_ASSERT_EQUAL_UINT16(65535, inputs.Level(0));
+
+  raw = 0;
+  for (int i = 0; i < (int)UPDATE_HZ; i++) {
+    inputs.Filter(&raw);
+  }
+  TEST_ASSERT_EQUAL_UINT16(0, inputs.Level(0));
+}
+
+/**
+ * A move smaller than the dead band never shows; a larger one does
+ */
+void test_dead_band() {
+  uint16_t raw = 30000;
+  inputs.Filter(&raw);
+  raw = 30000 + 100;  // 0.15%
+  for (int i = 0; i < (int)UPDATE_HZ; i++) {
+    TEST_ASSERT_FALSE(inputs.Filter(&raw));
+  }
+  TEST_ASSERT_EQUAL_UINT16(30000, inputs.Level(0));
+  raw = 30000 + 1000;  // 1.5%
+  for (int i = 0; i < (int)UPDATE_HZ; i++) {
+    inputs.Filter(&raw);
+  }
+  TEST_ASSERT_UINT16_WITHIN(132, 31000, inputs.Level(0));
+}
+
+/**
+ * Turned slowly, the last step can be smaller than the dead band; it
+ * still lands on the end
+ */
+void test_slow_turn_reaches_the_ends_exactly() {
+  uint16_t raw = 60000;
+  inputs.Filter(&raw);
+  while (raw < 65535) {
+    raw = raw > 65535 - 7 ? 65535 : raw + 7;
+    inputs.Filter(&raw);
+  }
+  for (int i = 0; i < (int)UPDATE_HZ; i++) {
+    inputs.Filter(&raw);
+  }
+  TEST_ASSERT_EQUAL_UINT16(65535, inputs.Level(0));
+
+  raw = 5000;
+  inputs.Init(CONFIGS, 1, UPDATE_HZ);
+  inputs.Filter(&raw);
+  while (raw > 0) {
+    raw = raw < 7 ? 0 : raw - 7;
+    inputs.Filter(&raw);
+  }
+  for (int i = 0; i < (int)UPDATE_HZ; i++) {
+    inputs.Filter(&raw);
+  }
+  TEST_ASSERT_EQUAL_UINT16(0, inputs.Level(0));
+}
+
+void test_inputs_are_filtered_independently() {
+  inputs.Init(CONFIGS, 2, UPDATE_HZ);
+  TEST_ASSERT_EQUAL_INT(2, inputs.Count());
+  uint16_t raw[2] = {10000, 50000};
+  inputs.Filter(raw);
+  raw[1] = 20000;
+  for (int i = 0; i < (int)UPDATE_HZ; i++) {
+    inputs.Filter(raw);
+  }
+  TEST_ASSERT_EQUAL_UINT16(10000, inputs.Level(0));
+  TEST_ASSERT_UINT16_WITHIN(132, 20000, inputs.Level(1));
+}
+
+void test_taper_is_monotonic_from_silence_to_0_db() {
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, analogDbTaper(0.0f, RANGE_DB, OFF_BELOW));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, analogDbTaper(OFF_BELOW / 2, RANGE_DB, OFF_BELOW));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, analogDbTaper(1.0f, RANGE_DB, OFF_BELOW));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.1f, analogDbTaper(0.5f, RANGE_DB, OFF_BELOW));  // -20 dB
+  float previous = 0.0f;
+  for (int i = 1; i <= 1000; i++) {
+    float gain = analogDbTaper(i / 1000.0f, RANGE_DB, OFF_BELOW);
+    TEST_ASSERT_TRUE(gain >= previous);
+    previous = gain;
+  }
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_first_reading_is_taken_as_is);
+  RUN_TEST(test_still_knob_reads_still);
+  RUN_TEST(test_full_turn_settles_within_100_ms_at_full_scale);
+  RUN_TEST(test_dead_band);
+  RUN_TEST(test_slow_turn_reaches_the_ends_exactly);
+  RUN_TEST(test_inputs_are_filtered_independently);
+  RUN_TEST(test_taper_is_monotonic_from_silence_to_0_db);
+  return UNITY_END();
+}
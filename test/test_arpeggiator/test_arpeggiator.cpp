@@ -0,0 +1,235 @@
+/**
+ * Arpeggiator: step order of each pattern, steps exact on the sample clock
+ * at any callback size, strum spacing, and the pool keeping its place when
+ * notes are added, released or re-pitched mid-arpeggio
+ */
+
+#include <unity.h>
+#include <vector>
+
+#include "Arpeggiator.h"
+
+const float SAMPLE_RATE = 48000.0f;
+const float RATE = 12.0f;                        // Steps per second
+const long STEP = (long)(SAMPLE_RATE / RATE);    // 4000 samples
+const size_t BLOCK = 48;
+
+struct TimedEvent {
+  long sample;
+  int note;
+  bool on;
+  float pitch;
+};
+
+static Arpeggiator arp;
+static long now = 0;  // Samples processed since setUp()
+
+void setUp() {
+  arp.Init(SAMPLE_RATE);
+  arp.SetRate(RATE);
+  now = 0;
+}
+
+void tearDown() {}
+
+/**
+ * Process samples in callbacks of block, collecting events at absolute times
+ */
+std::vector<TimedEvent> run(long samples, size_t block = BLOCK) {
+  std::vector<TimedEvent> events;
+  ArpEvent out[ARP_MAX_EVENTS];
+  for (long done = 0; done < samples;) {
+    size_t n = samples - done < (long)block ? (size_t)(samples - done) : block;
+    size_t count = arp.Process(n, out, ARP_MAX_EVENTS);
+    for (size_t i = 0; i < count; i++) {
+      events.push_back({now + out[i].offset, out[i].note, out[i].on, out[i].pitch});
+    }
+    done += (long)n;
+    now += (long)n;
+  }
+  return events;
+}
+
+/**
+ * Note ids of the note-ons, in order
+ */
+std::vector<int> noteOns(const std::vector<TimedEvent> &events) {
+  std::vector<int> notes;
+  for (const TimedEvent &e : events) {
+    if (e.on) {
+      notes.push_back(e.note);
+    }
+  }
+  return notes;
+}
+
+/**
+ * Hold notes 0..2 (ids in pitch order) at the start of the next callback
+ */
+void holdTriad(ArpPattern pattern) {
+  arp.SetPattern(pattern);
+  arp.Hold(0, 60.0f, 0);
+  arp.Hold(1, 64.0f, 0);
+  arp.Hold(2, 67.0f, 0);
+}
+
+void test_patterns_step_in_their_order() {
+  holdTriad(ARP_UP);
+  std::vector<int> expected = {0, 1, 2, 0, 1, 2};
+  TEST_ASSERT_TRUE(noteOns(run(6 * STEP)) == expected);
+
+  setUp();
+  holdTriad(ARP_DOWN);
+  expected = {2, 1, 0, 2, 1, 0};
+  TEST_ASSERT_TRUE(noteOns(run(6 * STEP)) == expected);
+
+  setUp();
+  holdTriad(ARP_UP_DOWN);
+  expected = {0, 1, 2, 1, 0, 1, 2};
+  TEST_ASSERT_TRUE(noteOns(run(7 * STEP)) == expected);
+
+  setUp();
+  holdTriad(ARP_RANDOM);
+  std::vector<int> notes = noteOns(run(40 * STEP));
+  for (size_t i = 1; i < notes.size(); i++) {
+    TEST_ASSERT_NOT_EQUAL(notes[i - 1], notes[i]);
+  }
+}
+
+/**
+ * Every step on, gate off, exactly a step apart from the hold, and on the
+ * same samples at every callback size
+ */
+void test_steps_land_on_the_same_samples_at_any_block_size() {
+  std::vector<TimedEvent> reference;
+  const size_t blocks[] = {16, 37, 48, 64, 480};
+  for (size_t block : blocks) {
+    setUp();
+    arp.SetPattern(ARP_UP);
+    run(100, block);
+    arp.Hold(0, 60.0f, 5);
+    arp.Hold(1, 64.0f, 5);
+    std::vector<TimedEvent> events = run(24 * STEP, block);
+
+    size_t ons = 0;
+    for (const TimedEvent &e : events) {
+      if (e.on) {
+        TEST_ASSERT_EQUAL_INT(100 + 5 + (long)ons * STEP, e.sample);
+        ons++;
+      } else {
+        TEST_ASSERT_EQUAL_INT(100 + 5 + (long)(ons - 1) * STEP + (long)(STEP * ARP_GATE), e.sample);
+      }
+    }
+    TEST_ASSERT_EQUAL_UINT32(24, ons);
+    if (reference.empty()) {
+      reference = events;
+      continue;
+    }
+    TEST_ASSERT_EQUAL_UINT32(reference.size(), events.size());
+    for (size_t i = 0; i < events.size(); i++) {
+      TEST_ASSERT_EQUAL_INT(reference[i].sample, events[i].sample);
+      TEST_ASSERT_EQUAL_INT(reference[i].note, events[i].note);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, arp.DroppedEvents());
+}
+
+void test_strum_spaces_chord_tones_and_holds_them() {
+  holdTriad(ARP_STRUM);
+  std::vector<TimedEvent> events = run(2 * STEP);
+  TEST_ASSERT_EQUAL_UINT32(3, events.size());
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_TRUE(events[i].on);
+    TEST_ASSERT_EQUAL_INT(i, events[i].note);
+    TEST_ASSERT_EQUAL_INT((long)i * (long)(STEP * ARP_STRUM_SPREAD), events[i].sample);
+  }
+
+  arp.Release(1, 10);
+  events = run(BLOCK);
+  TEST_ASSERT_EQUAL_UINT32(1, events.size());
+  TEST_ASSERT_FALSE(events[0].on);
+  TEST_ASSERT_EQUAL_INT(1, events[0].note);
+}
+
+void test_release_stops_the_sounding_step_and_skips_it() {
+  holdTriad(ARP_UP);
+  run(STEP + STEP / 4);  // Note 1 sounding
+  arp.Release(1, 0);
+  std::vector<TimedEvent> events = run(3 * STEP);
+  TEST_ASSERT_FALSE(events[0].on);
+  TEST_ASSERT_EQUAL_INT(1, events[0].note);
+  std::vector<int> expected = {2, 0, 2};
+  TEST_ASSERT_TRUE(noteOns(events) == expected);
+
+  setUp();
+  holdTriad(ARP_DOWN);
+  run(STEP + STEP / 4);  // Note 1 sounding, going down
+  arp.Release(1, 0);
+  expected = {0, 2, 0};
+  TEST_ASSERT_TRUE(noteOns(run(3 * STEP)) == expected);
+}
+
+/**
+ * A note held below the current step during an arpeggio joins the cycle
+ * without the next step repeating or skipping a note
+ */
+void test_hold_below_the_current_step_keeps_the_order() {
+  arp.SetPattern(ARP_UP);
+  arp.Hold(1, 64.0f, 0);
+  arp.Hold(2, 67.0f, 0);
+  run(STEP / 2);  // Note 1 stepped
+  arp.Hold(0, 60.0f, 0);
+  std::vector<int> expected = {2, 0, 1, 2};
+  TEST_ASSERT_TRUE(noteOns(run(4 * STEP)) == expected);
+
+  setUp();
+  arp.SetPattern(ARP_DOWN);
+  arp.Hold(1, 64.0f, 0);
+  arp.Hold(2, 67.0f, 0);
+  run(STEP / 2);  // Note 2 stepped
+  arp.Hold(0, 60.0f, 0);
+  expected = {1, 0, 2, 1};
+  TEST_ASSERT_TRUE(noteOns(run(4 * STEP)) == expected);
+}
+
+/**
+ * Re-pitching the note just stepped, so it sorts to the other end, keeps
+ * the arpeggio moving on from that note rather than jumping
+ */
+void test_set_pitch_keeps_stepping_from_the_same_note() {
+  const float pitches[4] = {60.0f, 62.0f, 64.0f, 67.0f};
+  arp.SetPattern(ARP_UP);
+  for (int note = 0; note < 4; note++) {
+    arp.Hold(note, pitches[note], 0);
+  }
+  run(STEP + STEP / 2);  // Notes 0 then 1 stepped
+  arp.SetPitch(1, 70.0f);  // Now the highest: pool 0, 2, 3, 1
+  std::vector<TimedEvent> events = run(4 * STEP);
+  std::vector<int> expected = {0, 2, 3, 1};  // Past the top, wrap to the bottom
+  TEST_ASSERT_TRUE(noteOns(events) == expected);
+  TEST_ASSERT_EQUAL_FLOAT(70.0f, events.back().pitch);
+
+  // Re-pitching another note around the current one leaves it in place
+  setUp();
+  arp.SetPattern(ARP_UP);
+  for (int note = 0; note < 4; note++) {
+    arp.Hold(note, pitches[note], 0);
+  }
+  run(2 * STEP + STEP / 2);  // Notes 0, 1, 2 stepped
+  arp.SetPitch(3, 59.0f);  // Now the lowest: pool 3, 0, 1, 2
+  expected = {3, 0, 1, 2};
+  TEST_ASSERT_TRUE(noteOns(run(4 * STEP)) == expected);
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_patterns_step_in_their_order);
+  RUN_TEST(test_steps_land_on_the_same_samples_at_any_block_size);
+  RUN_TEST(test_strum_spaces_chord_tones_and_holds_them);
+  RUN_TEST(test_release_stops_the_sounding_step_and_skips_it);
+  RUN_TEST(test_hold_below_the_current_step_keeps_the_order);
+  RUN_TEST(test_set_pitch_keeps_stepping_from_the_same_note);
+  return UNITY_END();
+}
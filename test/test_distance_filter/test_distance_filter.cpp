@@ -0,0 +1,152 @@
+/**
+ * DistanceFilter: hand arrival and departure, outliers and unconfirmed
+ * jumps held back, confirmed jumps taken at once, and the One Euro filter
+ * smoothing a still hand while following a moving one
+ */
+
+#include <math.h>
+#include <unity.h>
+
+#include "DistanceFilter.h"
+
+// The firmware's settings (main.cpp)
+const float MIN_CUTOFF = 1.0f;
+const float SPEED_BETA = 0.1f;
+const float SPEED_CUTOFF = 1.0f;
+const uint32_t PERIOD = 20000;  // High-speed ranging, us
+
+static DistanceFilter filter;
+static uint32_t now = 0;
+
+/**
+ * Feed one range a ranging period after the last
+ */
+bool range(float mm, bool valid = true) {
+  now += PERIOD;
+  return filter.Update(mm, valid, now);
+}
+
+void setUp() {
+  filter.Init(MIN_CUTOFF, SPEED_BETA, SPEED_CUTOFF);
+  now = 0;
+}
+
+void tearDown() {}
+
+void test_hand_arrives_at_its_first_range() {
+  TEST_ASSERT_FALSE(filter.Present());
+  TEST_ASSERT_TRUE(range(200.0f));
+  TEST_ASSERT_TRUE(filter.Present());
+  TEST_ASSERT_EQUAL_FLOAT(200.0f, filter.Distance());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, filter.Speed());
+}
+
+/**
+ * Error statuses and ranges beyond reach hold the distance; only the
+ * third in a row means the hand has gone, and it returns where it is
+ */
+void test_invalid_ranges_hold_then_mark_the_hand_gone() {
+  range(200.0f);
+  TEST_ASSERT_FALSE(range(200.0f, false));
+  TEST_ASSERT_FALSE(range(8190.0f));
+  TEST_ASSERT_TRUE(filter.Present());
+  TEST_ASSERT_EQUAL_FLOAT(200.0f, filter.Distance());
+  TEST_ASSERT_TRUE(range(0.0f));
+  TEST_ASSERT_FALSE(filter.Present());
+  TEST_ASSERT_EQUAL_UINT32(3, filter.Rejected());
+
+  TEST_ASSERT_TRUE(range(90.0f));
+  TEST_ASSERT_TRUE(filter.Present());
+  TEST_ASSERT_EQUAL_FLOAT(90.0f, filter.Distance());
+}
+
+void test_valid_range_resets_the_absence_count() {
+  range(200.0f);
+  range(0.0f, false);
+  range(0.0f, false);
+  range(201.0f);
+  range(0.0f, false);
+  range(0.0f, false);
+  TEST_ASSERT_TRUE(filter.Present());
+}
+
+/**
+ * A single spurious return never reaches the output; a jump the next
+ * range confirms is taken at once
+ */
+void test_jumps_need_a_second_range() {
+  for (int i = 0; i < 20; i++) {
+    range(200.0f);
+  }
+  TEST_ASSERT_FALSE(range(600.0f));
+  TEST_ASSERT_EQUAL_FLOAT(200.0f, filter.Distance());
+  range(200.0f);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 200.0f, filter.Distance());
+
+  TEST_ASSERT_FALSE(range(450.0f));
+  TEST_ASSERT_TRUE(range(460.0f));
+  TEST_ASSERT_EQUAL_FLOAT(460.0f, filter.Distance());
+
+  // Two far ranges that disagree with each other confirm nothing
+  TEST_ASSERT_FALSE(range(100.0f));
+  TEST_ASSERT_FALSE(range(300.0f));
+  TEST_ASSERT_EQUAL_FLOAT(460.0f, filter.Distance());
+}
+
+/**
+ * +-3 mm of noise on a still hand moves the output far less than the
+ * noise; a steady 200 mm/s sweep is followed within a few mm
+ */
+void test_still_hand_is_smoothed_and_moving_one_followed() {
+  range(200.0f);
+  float low = 1.0e9f, high = -1.0e9f;
+  for (int i = 0; i < 200; i++) {
+    range(200.0f + (float)((i * 5) % 7 - 3));
+    if (i >= 50) {
+      low = fminf(low, filter.Distance());
+      high = fmaxf(high, filter.Distance());
+    }
+  }
+  TEST_ASSERT_TRUE(high - low < 1.0f);
+
+  float mm = 200.0f;
+  for (int i = 0; i < 50; i++) {  // 4 mm per range, under the jump threshold
+    mm += 4.0f;
+    range(mm);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(6.0f, mm, filter.Distance());
+  TEST_ASSERT_TRUE(filter.Speed() > 100.0f);  // Away from the sensor
+}
+
+/**
+ * The filter step comes from the timestamps: the same motion ranged at
+ * half the rate lands within a millimetre of the same place
+ */
+void test_response_follows_the_timestamps() {
+  range(200.0f);
+  for (int i = 1; i <= 50; i++) {
+    range(200.0f + 2.0f * (float)i);
+  }
+  float everyRange = filter.Distance();
+
+  setUp();
+  range(200.0f);
+  for (int i = 2; i <= 50; i += 2) {
+    now += PERIOD;  // Skipped
+    range(200.0f + 2.0f * (float)i);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, everyRange, filter.Distance());
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_hand_arrives_at_its_first_range);
+  RUN_TEST(test_invalid_ranges_hold_then_mark_the_hand_gone);
+  RUN_TEST(test_valid_range_resets_the_absence_count);
+  RUN_TEST(test_jumps_need_a_second_range);
+  RUN_TEST(test_still_hand_is_smoothed_and_moving_one_followed);
+  RUN_TEST(test_response_follows_the_timestamps);
+  return UNITY_END();
+}
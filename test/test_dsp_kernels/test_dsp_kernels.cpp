@@ -0,0 +1,167 @@
+/**
+ * DspKernels: scalar and unrolled variants bit-identical on random buffers
+ * at every block length, what each kernel computes, and softClip() against
+ * the tanhf() curve it approximates
+ */
+
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+
+#include "DspKernels.h"
+
+float left[2][MAX_BLOCK_SIZE];
+float right[2][MAX_BLOCK_SIZE];
+float a[MAX_BLOCK_SIZE];
+float b[MAX_BLOCK_SIZE];
+uint32_t seed = 1;
+
+void fillRandom(float *dst, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    dst[i] = (float)(seed >> 8) / 16777216.0f * 12.0f - 6.0f;  // Past the clipper's knee both ways
+  }
+}
+
+/**
+ * Fresh random outputs (the same for both variants) and inputs
+ */
+void setUp() {
+  fillRandom(left[0], MAX_BLOCK_SIZE);
+  fillRandom(right[0], MAX_BLOCK_SIZE);
+  memcpy(left[1], left[0], sizeof(left[0]));
+  memcpy(right[1], right[0], sizeof(right[0]));
+  fillRandom(a, MAX_BLOCK_SIZE);
+  fillRandom(b, MAX_BLOCK_SIZE);
+}
+
+void tearDown() {}
+
+void assertVariantsMatch() {
+  TEST_ASSERT_EQUAL_MEMORY(left[0], left[1], sizeof(left[0]));
+  TEST_ASSERT_EQUAL_MEMORY(right[0], right[1], sizeof(right[0]));
+}
+
+void test_clear_variants_match() {
+  for (size_t n = 0; n <= MAX_BLOCK_SIZE; n++) {
+    setUp();
+    dspClearScalar(left[0], n);
+    dspClearUnrolled(left[1], n);
+    assertVariantsMatch();
+    for (size_t i = 0; i < n; i++) {
+      TEST_ASSERT_EQUAL_FLOAT(0.0f, left[1][i]);
+    }
+  }
+}
+
+void test_scale_ramp_variants_match() {
+  for (size_t n = 1; n <= MAX_BLOCK_SIZE; n++) {
+    setUp();
+    dspScaleRampScalar(left[0], 0.2f, 1.4f, n);
+    dspScaleRampUnrolled(left[1], 0.2f, 1.4f, n);
+    assertVariantsMatch();
+  }
+}
+
+void test_scale_accumulate_variants_match() {
+  for (size_t n = 1; n <= MAX_BLOCK_SIZE; n++) {
+    setUp();
+    dspScaleAccumulateScalar(left[0], a, -0.7f, n);
+    dspScaleAccumulateUnrolled(left[1], a, -0.7f, n);
+    assertVariantsMatch();
+  }
+}
+
+void test_multiply_pan_accumulate_variants_match() {
+  for (size_t n = 1; n <= MAX_BLOCK_SIZE; n++) {
+    setUp();
+    dspMultiplyPanAccumulateScalar(left[0], right[0], a, b, 0.3f, 1.2f, 1.3f, 0.4f, n);
+    dspMultiplyPanAccumulateUnrolled(left[1], right[1], a, b, 0.3f, 1.2f, 1.3f, 0.4f, n);
+    assertVariantsMatch();
+  }
+}
+
+void test_soft_clip_variants_match() {
+  for (size_t n = 1; n <= MAX_BLOCK_SIZE; n++) {
+    setUp();
+    dspSoftClipScalar(left[0], n);
+    dspSoftClipUnrolled(left[1], n);
+    assertVariantsMatch();
+  }
+}
+
+void test_variants_leave_the_rest_of_the_buffer() {
+  float before[MAX_BLOCK_SIZE];
+  memcpy(before, left[1], sizeof(before));
+  dspScaleRampUnrolled(left[1], 0.5f, 0.5f, 7);
+  TEST_ASSERT_EQUAL_MEMORY(before + 7, left[1] + 7, sizeof(float) * (MAX_BLOCK_SIZE - 7));
+}
+
+void test_scale_ramp_starts_at_start_and_steps_toward_end() {
+  float ones[8] = {1, 1, 1, 1, 1, 1, 1, 1};
+  dspScaleRamp(ones, 0.0f, 1.0f, 8);
+  for (int i = 0; i < 8; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(i / 8.0f, ones[i]);  // Reaches end at the next block's first sample
+  }
+}
+
+void test_multiply_pan_accumulate_adds_the_panned_product() {
+  float l[4] = {1, 1, 1, 1};
+  float r[4] = {0, 0, 0, 0};
+  const float x[4] = {1, 2, 3, 4};
+  const float y[4] = {0.5f, 0.5f, 0.5f, 0.5f};
+  dspMultiplyPanAccumulate(l, r, x, y, 1.0f, 1.0f, 0.5f, 0.5f, 4);
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(1.0f + x[i] * 0.5f, l[i]);
+    TEST_ASSERT_EQUAL_FLOAT(x[i] * 0.25f, r[i]);
+  }
+}
+
+/**
+ * Within SOFT_CLIP_MAX_ERROR of tanh(1.5x) / 1.5 over a dense sweep well
+ * past full saturation
+ */
+void test_soft_clip_tracks_tanh() {
+  float maxError = 0.0f;
+  for (int i = -400000; i <= 400000; i++) {
+    float x = (float)i * 0.00002f;
+    float error = fabsf(softClip(x) - tanhf(x * SOFT_CLIP_DRIVE) / SOFT_CLIP_DRIVE);
+    maxError = error > maxError ? error : maxError;
+  }
+  TEST_ASSERT_LESS_OR_EQUAL_FLOAT(SOFT_CLIP_MAX_ERROR, maxError);
+}
+
+/**
+ * Odd, monotonic and never past the tanh asymptote, so loud mixes flatten
+ * rather than fold back
+ */
+void test_soft_clip_is_odd_monotonic_and_bounded() {
+  float previous = softClip(-10.0f);
+  for (int i = -10000; i <= 10000; i++) {
+    float x = (float)i * 0.001f;
+    float y = softClip(x);
+    TEST_ASSERT_EQUAL_FLOAT(-y, softClip(-x));
+    TEST_ASSERT_GREATER_OR_EQUAL_FLOAT(previous, y);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(1.0f / SOFT_CLIP_DRIVE, fabsf(y));
+    previous = y;
+  }
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, softClip(0.0f));
+  TEST_ASSERT_FLOAT_WITHIN(1.0e-6f, 1.0f / SOFT_CLIP_DRIVE, softClip(100.0f));
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_clear_variants_match);
+  RUN_TEST(test_scale_ramp_variants_match);
+  RUN_TEST(test_scale_accumulate_variants_match);
+  RUN_TEST(test_multiply_pan_accumulate_variants_match);
+  RUN_TEST(test_soft_clip_variants_match);
+  RUN_TEST(test_variants_leave_the_rest_of_the_buffer);
+  RUN_TEST(test_scale_ramp_starts_at_start_and_steps_toward_end);
+  RUN_TEST(test_multiply_pan_accumulate_adds_the_panned_product);
+  RUN_TEST(test_soft_clip_tracks_tanh);
+  RUN_TEST(test_soft_clip_is_odd_monotonic_and_bounded);
+  return UNITY_END();
+}
@@ -0,0 +1,196 @@
+/**
+ * EffectsBus: delay line wrap, ping-pong echo timing, shedding the reverb
+ * over budget without a click, restoring it, and going idle to exact dry
+ */
+
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#include "EffectsBus.h"
+
+const float SAMPLE_RATE = 48000.0f;
+const size_t BLOCK = 48;
+const float TICKS_PER_SAMPLE = 1.0e9f / SAMPLE_RATE;  // Host ticks are nanoseconds
+const size_t ECHO_SAMPLES = 14400;                    // 0.3 s per side of the ping-pong
+
+// The lines' storage is static: one bus per program
+static EffectsBus bus;
+
+static float dry[BLOCK], left[BLOCK], right[BLOCK];
+static float phase = 0.0f;
+
+/**
+ * Next block of a 220 Hz tone into dry, left and right
+ */
+void fillTone() {
+  for (size_t i = 0; i < BLOCK; i++) {
+    dry[i] = 0.3f * sinf(phase);
+    left[i] = dry[i];
+    right[i] = dry[i];
+    phase += 2.0f * 3.14159265f * 220.0f / SAMPLE_RATE;
+  }
+}
+
+/**
+ * Largest sample-to-sample step of the wet left signal over some blocks
+ */
+float largestWetStep(int blocks, float &last) {
+  float step = 0.0f;
+  for (int b = 0; b < blocks; b++) {
+    fillTone();
+    bus.Process(left, right, BLOCK);
+    for (size_t i = 0; i < BLOCK; i++) {
+      step = fmaxf(step, fabsf(left[i] - dry[i] - last));
+      last = left[i] - dry[i];
+    }
+  }
+  return step;
+}
+
+void setUp() {
+  bus.Init(SAMPLE_RATE);
+  phase = 0.0f;
+}
+
+void tearDown() {}
+
+void test_delay_line_reads_what_was_written_delay_samples_ago() {
+  const size_t SIZE = 200;
+  static float storage[SIZE];
+  DelayLine line;
+  line.Init(storage, SIZE);
+  line.SetDelay(100);
+  TEST_ASSERT_EQUAL_UINT32(100, line.Delay());
+
+  float block[BLOCK], out[BLOCK];
+  float next = 1.0f;
+  for (int b = 0; b < 20; b++) {  // Several times round the line
+    line.Read(out, BLOCK);
+    for (size_t i = 0; i < BLOCK; i++) {
+      float written = next + (float)i - 100.0f;
+      TEST_ASSERT_EQUAL_FLOAT(written >= 1.0f ? written : 0.0f, out[i]);
+      block[i] = next + (float)i;
+    }
+    line.Write(block, BLOCK);
+    next += (float)BLOCK;
+  }
+
+  line.SetDelay(1);
+  TEST_ASSERT_EQUAL_UINT32(MAX_BLOCK_SIZE, line.Delay());
+  line.SetDelay(SIZE + 1);
+  TEST_ASSERT_EQUAL_UINT32(SIZE, line.Delay());
+}
+
+void test_idle_bus_leaves_the_mix_untouched() {
+  for (int b = 0; b < 10; b++) {
+    fillTone();
+    bus.Process(left, right, BLOCK);
+    TEST_ASSERT_FALSE(bus.Active());
+    TEST_ASSERT_EQUAL_MEMORY(dry, left, sizeof(dry));
+    TEST_ASSERT_EQUAL_MEMORY(dry, right, sizeof(dry));
+  }
+}
+
+void test_echo_lands_left_then_right() {
+  bus.SetDelayMix(0.5f);
+  float silence[BLOCK] = {};
+  for (int b = 0; b < 100; b++) {  // Let the send settle on its target
+    memcpy(left, silence, sizeof(left));
+    memcpy(right, silence, sizeof(right));
+    bus.Process(left, right, BLOCK);
+  }
+
+  std::vector<float> outLeft, outRight;
+  for (size_t b = 0; b < 2 * ECHO_SAMPLES / BLOCK + 1; b++) {
+    memcpy(left, silence, sizeof(left));
+    memcpy(right, silence, sizeof(right));
+    if (b == 0) {
+      left[0] = right[0] = 1.0f;
+    }
+    bus.Process(left, right, BLOCK);
+    outLeft.insert(outLeft.end(), left, left + BLOCK);
+    outRight.insert(outRight.end(), right, right + BLOCK);
+  }
+  outLeft[0] -= 1.0f;
+  outRight[0] -= 1.0f;
+
+  for (size_t i = 0; i < outLeft.size(); i++) {
+    if (i != ECHO_SAMPLES) {
+      TEST_ASSERT_EQUAL_FLOAT(0.0f, outLeft[i]);
+    }
+    if (i < 2 * ECHO_SAMPLES) {
+      TEST_ASSERT_EQUAL_FLOAT(0.0f, outRight[i]);
+    }
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1.0e-6f, 0.5f, outLeft[ECHO_SAMPLES]);
+  TEST_ASSERT_TRUE(outRight[2 * ECHO_SAMPLES] > 0.0f);
+}
+
+/**
+ * Under a budget nothing can meet the reverb fades out within
+ * EFFECTS_SHED_BLOCKS + 1 blocks, no step larger than while playing, and
+ * with room again it comes back after EFFECTS_RESTORE_BLOCKS
+ */
+void test_reverb_sheds_smoothly_and_restores() {
+  bus.SetDelayMix(0.35f);
+  bus.SetReverbMix(0.5f);
+  bus.SetReverbDecay(4.0f);
+  float last = 0.0f;
+  float playingStep = largestWetStep(2000, last);
+
+  bus.SetCpuBudget(1.0e-6f, TICKS_PER_SAMPLE);
+  float shedStep = 0.0f;
+  int shedBlocks = 0;
+  while (!bus.ReverbShed() && shedBlocks < 100) {
+    shedStep = fmaxf(shedStep, largestWetStep(1, last));
+    shedBlocks++;
+  }
+  TEST_ASSERT_TRUE(bus.ReverbShed());
+  TEST_ASSERT_LESS_OR_EQUAL_INT(EFFECTS_SHED_BLOCKS + 1, shedBlocks);
+  TEST_ASSERT_GREATER_THAN(0, bus.OverBudget());
+  TEST_ASSERT_TRUE(shedStep <= playingStep);
+
+  bus.SetCpuBudget(1.0e6f, TICKS_PER_SAMPLE);
+  int restoreBlocks = 0;
+  while (bus.ReverbShed() && restoreBlocks < 10 * EFFECTS_RESTORE_BLOCKS) {
+    largestWetStep(1, last);
+    restoreBlocks++;
+  }
+  TEST_ASSERT_FALSE(bus.ReverbShed());
+  TEST_ASSERT_EQUAL_INT(EFFECTS_RESTORE_BLOCKS, restoreBlocks);
+}
+
+void test_sends_off_go_idle_after_the_tails_then_exactly_dry() {
+  bus.SetDelayMix(0.35f);
+  bus.SetReverbMix(0.5f);
+  bus.SetReverbDecay(4.0f);
+  float last = 0.0f;
+  largestWetStep(1000, last);
+
+  bus.SetDelayMix(0.0f);
+  bus.SetReverbMix(0.0f);
+  int blocks = 0;
+  const int TEN_SECONDS = (int)(10.0f * SAMPLE_RATE / BLOCK);
+  do {
+    fillTone();
+    bus.Process(left, right, BLOCK);
+    blocks++;
+  } while (bus.Active() && blocks < TEN_SECONDS);
+  TEST_ASSERT_FALSE(bus.Active());
+  TEST_ASSERT_EQUAL_MEMORY(dry, left, sizeof(dry));
+  TEST_ASSERT_EQUAL_MEMORY(dry, right, sizeof(dry));
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_delay_line_reads_what_was_written_delay_samples_ago);
+  RUN_TEST(test_idle_bus_leaves_the_mix_untouched);
+  RUN_TEST(test_echo_lands_left_then_right);
+  RUN_TEST(test_reverb_sheds_smoothly_and_restores);
+  RUN_TEST(test_sends_off_go_idle_after_the_tails_then_exactly_dry);
+  return UNITY_END();
+}
@@ -0,0 +1,173 @@
+/**
+ * NoteEnvelope: stage lengths in samples and levels at segment ends, for
+ * both curves, rendered one sample at a time and in blocks
+ */
+
+#include <unity.h>
+
+#include "NoteEnvelope.h"
+
+const float SAMPLE_RATE = 48000.0f;
+
+// The firmware's envelope (main.cpp ATTACK_TIME .. RELEASE_TIME)
+const float ATTACK_TIME = 0.02f;
+const float DECAY_TIME = 0.0f;
+const float SUSTAIN_LEVEL = 1.0f;
+const float RELEASE_TIME = 0.15f;
+
+// A full ADSR with a real decay
+const float ADSR_ATTACK = 0.005f;
+const float ADSR_DECAY = 0.05f;
+const float ADSR_SUSTAIN = 0.5f;
+const float ADSR_RELEASE = 0.1f;
+
+NoteEnvelope envelope;
+
+void setUp() {
+  envelope.Init(SAMPLE_RATE);
+}
+
+void tearDown() {}
+
+// The exponential curve aims past its target and snaps to it at the stage
+// end: a rounding-sized step back is allowed there
+const float SNAP_TOLERANCE = 1e-6f;
+
+/**
+ * Process() until the stage changes; returns the samples it took and
+ * checks the level moved monotonically toward the end level
+ */
+int32_t runStage(EnvelopeStage stage, bool rising) {
+  int32_t samples = 0;
+  float previous = envelope.Level();
+  while (envelope.Stage() == stage && samples < 10 * (int32_t)SAMPLE_RATE) {
+    float level = envelope.Process();
+    if (rising) {
+      TEST_ASSERT_GREATER_OR_EQUAL_FLOAT(previous - SNAP_TOLERANCE, level);
+    } else {
+      TEST_ASSERT_LESS_OR_EQUAL_FLOAT(previous + SNAP_TOLERANCE, level);
+    }
+    previous = level;
+    samples++;
+  }
+  return samples;
+}
+
+void checkFirmwareEnvelope(EnvelopeCurve curve) {
+  envelope.SetTimes(ATTACK_TIME, DECAY_TIME, SUSTAIN_LEVEL, RELEASE_TIME);
+  envelope.SetCurve(curve);
+  envelope.Trigger();
+  TEST_ASSERT_EQUAL_INT(ENV_ATTACK, envelope.Stage());
+
+  TEST_ASSERT_EQUAL_INT32((int32_t)(ATTACK_TIME * SAMPLE_RATE), runStage(ENV_ATTACK, true));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, envelope.Level());
+  // No decay: one sample at full level, then sustain
+  TEST_ASSERT_EQUAL_INT32(1, runStage(ENV_DECAY, false));
+  TEST_ASSERT_EQUAL_INT(ENV_SUSTAIN, envelope.Stage());
+  for (int i = 0; i < 1000; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(SUSTAIN_LEVEL, envelope.Process());
+  }
+
+  envelope.Release();
+  TEST_ASSERT_EQUAL_INT32((int32_t)(RELEASE_TIME * SAMPLE_RATE), runStage(ENV_RELEASE, false));
+  TEST_ASSERT_EQUAL_INT(ENV_IDLE, envelope.Stage());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, envelope.Level());
+}
+
+void checkAdsr(EnvelopeCurve curve) {
+  envelope.SetTimes(ADSR_ATTACK, ADSR_DECAY, ADSR_SUSTAIN, ADSR_RELEASE);
+  envelope.SetCurve(curve);
+  envelope.Trigger();
+  TEST_ASSERT_EQUAL_INT32(240, runStage(ENV_ATTACK, true));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, envelope.Level());
+  TEST_ASSERT_EQUAL_INT32(2400, runStage(ENV_DECAY, false));
+  TEST_ASSERT_EQUAL_INT(ENV_SUSTAIN, envelope.Stage());
+  TEST_ASSERT_EQUAL_FLOAT(ADSR_SUSTAIN, envelope.Level());
+  envelope.Release();
+  TEST_ASSERT_EQUAL_INT32(4800, runStage(ENV_RELEASE, false));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, envelope.Level());
+}
+
+void test_firmware_envelope_linear() {
+  checkFirmwareEnvelope(ENV_CURVE_LINEAR);
+}
+
+void test_firmware_envelope_exponential() {
+  checkFirmwareEnvelope(ENV_CURVE_EXPONENTIAL);
+}
+
+void test_adsr_linear() {
+  checkAdsr(ENV_CURVE_LINEAR);
+}
+
+void test_adsr_exponential() {
+  checkAdsr(ENV_CURVE_EXPONENTIAL);
+}
+
+void test_linear_attack_is_a_straight_line() {
+  envelope.SetTimes(ATTACK_TIME, DECAY_TIME, SUSTAIN_LEVEL, RELEASE_TIME);
+  envelope.SetCurve(ENV_CURVE_LINEAR);
+  envelope.Trigger();
+  const int32_t length = (int32_t)(ATTACK_TIME * SAMPLE_RATE);
+  for (int32_t i = 1; i < length; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, (float)i / length, envelope.Process());
+  }
+}
+
+void test_release_mid_attack_starts_from_current_level() {
+  envelope.SetTimes(ATTACK_TIME, DECAY_TIME, SUSTAIN_LEVEL, RELEASE_TIME);
+  envelope.SetCurve(ENV_CURVE_LINEAR);
+  envelope.Trigger();
+  for (int i = 0; i < 480; i++) {
+    envelope.Process();
+  }
+  float held = envelope.Level();
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.5f, held);
+  envelope.Release();
+  // Full release time from wherever it was, no jump
+  TEST_ASSERT_LESS_OR_EQUAL_FLOAT(held, envelope.Process());
+  TEST_ASSERT_EQUAL_INT32((int32_t)(RELEASE_TIME * SAMPLE_RATE) - 1, runStage(ENV_RELEASE, false));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, envelope.Level());
+}
+
+void test_block_matches_per_sample() {
+  const EnvelopeCurve curves[] = {ENV_CURVE_LINEAR, ENV_CURVE_EXPONENTIAL};
+  for (EnvelopeCurve curve : curves) {
+    NoteEnvelope single, block;
+    single.Init(SAMPLE_RATE);
+    block.Init(SAMPLE_RATE);
+    single.SetTimes(ADSR_ATTACK, ADSR_DECAY, ADSR_SUSTAIN, ADSR_RELEASE);
+    block.SetTimes(ADSR_ATTACK, ADSR_DECAY, ADSR_SUSTAIN, ADSR_RELEASE);
+    single.SetCurve(curve);
+    block.SetCurve(curve);
+    single.Trigger();
+    block.Trigger();
+    float out[48];
+    for (int b = 0; b < 300; b++) {
+      if (b == 100) {
+        single.Release();
+        block.Release();
+      }
+      block.ProcessBlock(out, 48);
+      for (int i = 0; i < 48; i++) {
+        float expected = single.Process();
+        TEST_ASSERT_EQUAL_MEMORY(&expected, &out[i], sizeof(float));
+      }
+    }
+    TEST_ASSERT_EQUAL_INT(ENV_IDLE, block.Stage());
+  }
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_firmware_envelope_linear);
+  RUN_TEST(test_firmware_envelope_exponential);
+  RUN_TEST(test_adsr_linear);
+  RUN_TEST(test_adsr_exponential);
+  RUN_TEST(test_linear_attack_is_a_straight_line);
+  RUN_TEST(test_release_mid_attack_starts_from_current_level);
+  RUN_TEST(test_block_matches_per_sample);
+  return UNITY_END();
+}
@@ -0,0 +1,225 @@
+/**
+ * I2cScheduler: Service() returns at once while a transfer is on the bus,
+ * one transfer at a time, with submit and completion times on the caller's
+ * clock, against a mock bus with injected latency and against WireBus on
+ * the host's simulated HAL
+ */
+
+#include <unity.h>
+
+#include "HostPlatform.h"
+#include "I2cScheduler.h"
+#include "WireBus.h"
+
+/**
+ * A bus whose transfers finish latency microseconds after Start(), on a
+ * clock only the test moves
+ */
+class LatencyBus : public I2cBus {
+public:
+  uint32_t now = 0;
+  uint32_t latency = 0;
+  uint32_t doneAt = 0;
+  bool inFlight = false;
+  int starts = 0;
+  int polls = 0;
+  int overlapping = 0;    // Starts while a transfer was still running
+  bool nack = false;
+
+  bool Start(I2cTransaction &t) override {
+    if (inFlight) {
+      overlapping++;
+    }
+    starts++;
+    inFlight = true;
+    doneAt = now + latency;
+    for (int i = 0; i < t.rxLen; i++) {
+      t.rx[i] = (uint8_t)(t.tx[0] + i);  // Register contents = their address
+    }
+    return true;
+  }
+
+  I2cStatus Poll(I2cTransaction &t) override {
+    (void)t;
+    polls++;
+    if ((int32_t)(now - doneAt) < 0) {
+      return I2C_BUSY;
+    }
+    inFlight = false;
+    return nack ? I2C_ERROR : I2C_DONE;
+  }
+};
+
+const int MAX_COMPLETIONS = 8;
+
+struct Completions {
+  I2cTransaction done[MAX_COMPLETIONS];
+  int count = 0;
+};
+
+void record(void *context, const I2cTransaction &t) {
+  Completions *c = (Completions *)context;
+  if (c->count < MAX_COMPLETIONS) {
+    c->done[c->count] = t;
+  }
+  c->count++;
+}
+
+static LatencyBus mock;
+static Completions completions;
+static I2cScheduler scheduler;
+
+void setUp() {
+  mock = LatencyBus();
+  completions = Completions();
+  scheduler.Init(&mock, record, &completions);
+}
+
+void tearDown() {}
+
+void test_service_returns_while_the_bus_is_busy() {
+  mock.now = 1000;
+  mock.latency = 350;
+  TEST_ASSERT_TRUE(scheduler.Submit(i2cReadRegisters(0x29, 0x14, 12, 1), mock.now));
+
+  scheduler.Service(mock.now);  // Starts the transfer and returns
+  TEST_ASSERT_EQUAL_INT(1, mock.starts);
+  TEST_ASSERT_EQUAL_INT(0, completions.count);
+  TEST_ASSERT_FALSE(scheduler.Idle());
+
+  // Each call polls once and returns; nothing completes early
+  for (mock.now = 1010; mock.now < 1350; mock.now += 10) {
+    int polls = mock.polls;
+    scheduler.Service(mock.now);
+    TEST_ASSERT_EQUAL_INT(polls + 1, mock.polls);
+    TEST_ASSERT_EQUAL_INT(0, completions.count);
+  }
+  scheduler.Service(mock.now);
+  TEST_ASSERT_EQUAL_INT(1, completions.count);
+  TEST_ASSERT_TRUE(scheduler.Idle());
+
+  const I2cTransaction &t = completions.done[0];
+  TEST_ASSERT_EQUAL_INT(I2C_DONE, t.status);
+  TEST_ASSERT_EQUAL_UINT32(1000, t.submittedMicros);
+  TEST_ASSERT_EQUAL_UINT32(1350, t.completedMicros);
+  TEST_ASSERT_EQUAL_UINT8(1, t.tag);
+  TEST_ASSERT_EQUAL_UINT8(0x14, t.rx[0]);
+  TEST_ASSERT_EQUAL_UINT8(0x14 + 11, t.rx[11]);
+}
+
+/**
+ * Queued transactions go out one at a time, in order; each one's wait in
+ * the queue shows in its submit-to-completion time
+ */
+void test_one_transfer_at_a_time_with_queue_wait() {
+  mock.latency = 200;
+  mock.now = 5000;
+  for (uint8_t tag = 0; tag < 3; tag++) {
+    TEST_ASSERT_TRUE(scheduler.Submit(i2cWriteRegister(0x26, 0x10, tag, tag), mock.now));
+  }
+  for (; completions.count < 3 && mock.now < 7000; mock.now += 50) {
+    scheduler.Service(mock.now);
+  }
+  TEST_ASSERT_EQUAL_INT(3, completions.count);
+  TEST_ASSERT_EQUAL_INT(3, mock.starts);
+  TEST_ASSERT_EQUAL_INT(0, mock.overlapping);
+  for (int i = 0; i < 3; i++) {
+    const I2cTransaction &t = completions.done[i];
+    TEST_ASSERT_EQUAL_UINT8(i, t.tag);
+    TEST_ASSERT_EQUAL_UINT32(5000, t.submittedMicros);
+    // Started on the call after the previous completion, done 200 us later
+    TEST_ASSERT_EQUAL_UINT32(5000 + 200 + i * 250, t.completedMicros);
+  }
+}
+
+void test_errors_are_reported_and_counted() {
+  mock.nack = true;
+  mock.latency = 100;
+  scheduler.Submit(i2cReadRegisters(0x29, 0x13, 1, 7), mock.now);
+  for (int i = 0; i < 5; i++, mock.now += 50) {
+    scheduler.Service(mock.now);
+  }
+  TEST_ASSERT_EQUAL_INT(1, completions.count);
+  TEST_ASSERT_EQUAL_INT(I2C_ERROR, completions.done[0].status);
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.Errors());
+}
+
+/**
+ * WireBus on the host's HAL stub: the simulated clock does not move inside
+ * Service(), and the injected latency shows in the completion time
+ */
+void test_wire_bus_does_not_block_under_latency() {
+  WireBus wireBus(Wire);
+  Wire.begin();
+  Wire.setClock(400000);
+  hostSetDevicePresent(HOST_ACCEL_ADDRESS, true);
+  hostSetAccel(0.0f, 0.0f, 9.80665f);
+  hostSetI2cLatency(2000);
+  scheduler.Init(&wireBus, record, &completions);
+
+  uint32_t submitted = (uint32_t)hostMicros();
+  scheduler.Submit(i2cReadRegisters(HOST_ACCEL_ADDRESS, 0x02, 6, 3), submitted);
+  uint32_t completed = 0;
+  for (int i = 0; i < 100 && completions.count == 0; i++) {
+    uint64_t before = hostMicros();
+    scheduler.Service((uint32_t)before);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)before, (uint32_t)hostMicros());  // Returned without waiting
+    completed = (uint32_t)before;
+    hostAdvanceMicros(100);
+  }
+  TEST_ASSERT_EQUAL_INT(1, completions.count);
+
+  // Two 400 kHz transfers (address + register, address + 6 bytes) plus the latency
+  const I2cTransaction &t = completions.done[0];
+  TEST_ASSERT_EQUAL_INT(I2C_DONE, t.status);
+  TEST_ASSERT_EQUAL_UINT32(submitted, t.submittedMicros);
+  TEST_ASSERT_EQUAL_UINT32(completed, t.completedMicros);
+  TEST_ASSERT_GREATER_OR_EQUAL(2000 + 45 + 157, t.completedMicros - t.submittedMicros);
+  TEST_ASSERT_LESS_OR_EQUAL(2000 + 45 + 157 + 100, t.completedMicros - t.submittedMicros);
+  int16_t z = (int16_t)(t.rx[4] | (t.rx[5] << 8)) / 4;
+  TEST_ASSERT_EQUAL_INT(2048, z);  // 1 g at +-4 g full scale
+
+  // A device that does not answer is an error, not a hang
+  hostSetDevicePresent(HOST_ACCEL_ADDRESS, false);
+  scheduler.Submit(i2cReadRegisters(HOST_ACCEL_ADDRESS, 0x02, 6, 4), (uint32_t)hostMicros());
+  for (int i = 0; i < 100 && completions.count == 1; i++) {
+    scheduler.Service((uint32_t)hostMicros());
+    hostAdvanceMicros(100);
+  }
+  TEST_ASSERT_EQUAL_INT(2, completions.count);
+  TEST_ASSERT_EQUAL_INT(I2C_ERROR, completions.done[1].status);
+  hostSetI2cLatency(0);
+}
+
+/**
+ * A transfer that never finishes is aborted after I2C_TRANSFER_TIMEOUT_US
+ */
+void test_wire_bus_times_out_a_stuck_transfer() {
+  WireBus wireBus(Wire);
+  hostSetDevicePresent(HOST_TOF_ADDRESS, true);
+  hostSetI2cLatency(1000000);
+  scheduler.Init(&wireBus, record, &completions);
+
+  uint32_t submitted = (uint32_t)hostMicros();
+  scheduler.Submit(i2cReadRegisters(HOST_TOF_ADDRESS, 0x13, 1, 5), submitted);
+  for (int i = 0; i < 100 && completions.count == 0; i++) {
+    scheduler.Service((uint32_t)hostMicros());
+    hostAdvanceMicros(100);
+  }
+  TEST_ASSERT_EQUAL_INT(1, completions.count);
+  TEST_ASSERT_EQUAL_INT(I2C_ERROR, completions.done[0].status);
+  TEST_ASSERT_GREATER_OR_EQUAL(I2C_TRANSFER_TIMEOUT_US, completions.done[0].completedMicros - submitted);
+  hostSetI2cLatency(0);
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_service_returns_while_the_bus_is_busy);
+  RUN_TEST(test_one_transfer_at_a_time_with_queue_wait);
+  RUN_TEST(test_errors_are_reported_and_counted);
+  RUN_TEST(test_wire_bus_does_not_block_under_latency);
+  RUN_TEST(test_wire_bus_times_out_a_stuck_transfer);
+  return UNITY_END();
+}
@@ -0,0 +1,105 @@
+/**
+ * InputTrace: serial play commands and tunable writes survive the text
+ * format and come back from a replay at their time, with the exact float
+ */
+
+#include <string.h>
+#include <unity.h>
+
+#include "InputTrace.h"
+
+// 64 KB of records: too big for the stack
+static InputTrace trace;
+
+void setUp() {
+  trace.StopReplay();
+  trace.StopRecording();
+}
+
+void tearDown() {}
+
+void test_command_records_survive_the_text_format() {
+  InputRecord record = {0x1234, 0, INPUT_TUNABLE, 7, {-21555, 16457, 0}};
+  char line[INPUT_TRACE_LINE_SIZE];
+  TEST_ASSERT_TRUE(InputTrace::FormatRecord(record, line, sizeof(line)) > 0);
+
+  InputRecord parsed;
+  TEST_ASSERT_TRUE(InputTrace::ParseRecord(line, parsed));
+  TEST_ASSERT_EQUAL_UINT32(record.timeMicros, parsed.timeMicros);
+  TEST_ASSERT_EQUAL_UINT8(INPUT_TUNABLE, parsed.type);
+  TEST_ASSERT_EQUAL_UINT8(7, parsed.status);
+  TEST_ASSERT_EQUAL_INT16(-21555, parsed.value[0]);
+  TEST_ASSERT_EQUAL_INT16(16457, parsed.value[1]);
+
+  TEST_ASSERT_TRUE(InputTrace::ParseRecord("@00000010 4 97 0 0 0 0", parsed));
+  TEST_ASSERT_EQUAL_UINT8(INPUT_COMMAND, parsed.type);
+  TEST_ASSERT_EQUAL_UINT8('a', parsed.status);
+  TEST_ASSERT_FALSE(InputTrace::ParseRecord("@00000010 6 0 0 0 0 0", parsed));  // Unknown type
+}
+
+void test_nothing_is_recorded_unless_recording() {
+  trace.StartRecording(0, 0);
+  size_t base = trace.Count();  // The starting button state
+  trace.StopRecording();
+  trace.RecordCommand(100, 'a');
+  trace.RecordTunable(100, 2, 0.5f);
+  TEST_ASSERT_EQUAL_UINT32(base, trace.Count());
+}
+
+void test_replay_returns_commands_at_their_time() {
+  const uint32_t start = 1000000;
+  const float tuned = 0.1234567f;  // Not representable in 16 bits
+  trace.StartRecording(start, 0);
+  trace.RecordCommand(start + 2000, 'a');
+  trace.RecordTunable(start + 5000, 3, tuned);
+  trace.RecordCommand(start + 5000, 'a');
+  trace.StopRecording();
+
+  const uint32_t replayStart = 7000000;
+  InputCommand command;
+  trace.StartReplay(replayStart);
+  trace.ReplayDue(replayStart + 1999);
+  TEST_ASSERT_FALSE(trace.PopCommand(command));
+
+  trace.ReplayDue(replayStart + 2000);
+  TEST_ASSERT_TRUE(trace.PopCommand(command));
+  TEST_ASSERT_EQUAL_UINT8(INPUT_COMMAND, command.type);
+  TEST_ASSERT_EQUAL_UINT8('a', command.id);
+  TEST_ASSERT_FALSE(trace.PopCommand(command));
+
+  // Same-time records come back in the order they were made
+  trace.ReplayDue(replayStart + 6000);
+  TEST_ASSERT_TRUE(trace.PopCommand(command));
+  TEST_ASSERT_EQUAL_UINT8(INPUT_TUNABLE, command.type);
+  TEST_ASSERT_EQUAL_UINT8(3, command.id);
+  TEST_ASSERT_EQUAL_MEMORY(&tuned, &command.value, sizeof(float));
+  TEST_ASSERT_TRUE(trace.PopCommand(command));
+  TEST_ASSERT_EQUAL_UINT8(INPUT_COMMAND, command.type);
+  TEST_ASSERT_FALSE(trace.PopCommand(command));
+}
+
+void test_restarted_replay_drops_unread_commands() {
+  trace.StartRecording(0, 0);
+  trace.RecordCommand(10, 'a');
+  trace.StopRecording();
+
+  InputCommand command;
+  trace.StartReplay(0);
+  trace.ReplayDue(100);  // Queued, never popped
+  trace.StartReplay(200);
+  TEST_ASSERT_FALSE(trace.PopCommand(command));
+  trace.ReplayDue(210);
+  TEST_ASSERT_TRUE(trace.PopCommand(command));
+  TEST_ASSERT_FALSE(trace.PopCommand(command));
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_command_records_survive_the_text_format);
+  RUN_TEST(test_nothing_is_recorded_unless_recording);
+  RUN_TEST(test_replay_returns_commands_at_their_time);
+  RUN_TEST(test_restarted_replay_drops_unread_commands);
+  return UNITY_END();
+}
@@ -0,0 +1,262 @@
+/**
+ * MidiOut: MPE note messages with their bends, frame pacing, controller
+ * coalescing and rate limits, and a dense gesture decoded packet by packet
+ */
+
+#include <math.h>
+#include <unity.h>
+#include <vector>
+
+#include "MidiOut.h"
+
+/**
+ * A frame as the writer saw it, with the note packets queued before it
+ */
+struct Frame {
+  uint32_t micros;
+  uint32_t notePacketsQueued;
+  std::vector<MidiPacket> packets;
+};
+
+static MidiOut midi;
+static std::vector<Frame> frames;
+static uint32_t now = 0;
+static uint32_t notePacketsQueued = 0;
+
+void captureFrame(const MidiPacket *packets, size_t count) {
+  frames.push_back({now, notePacketsQueued, std::vector<MidiPacket>(packets, packets + count)});
+}
+
+void setUp() {
+  frames.clear();
+  now = 0;
+  notePacketsQueued = 0;
+  midi.SetWriter({captureFrame, nullptr});
+  midi.Init(2.0f);
+  midi.Service(now);
+  frames.clear();  // Configuration
+}
+
+void tearDown() {}
+
+/**
+ * Service every frame period up to until, returning the packets sent
+ */
+std::vector<MidiPacket> serviceUntil(uint32_t until) {
+  size_t first = frames.size();
+  for (now += MIDI_FRAME_MICROS; now <= until; now += MIDI_FRAME_MICROS) {
+    midi.Service(now);
+  }
+  now -= MIDI_FRAME_MICROS;
+  std::vector<MidiPacket> packets;
+  for (size_t f = first; f < frames.size(); f++) {
+    packets.insert(packets.end(), frames[f].packets.begin(), frames[f].packets.end());
+  }
+  return packets;
+}
+
+uint16_t bendOf(const MidiPacket &packet) { return (uint16_t)(packet.data1 | (packet.data2 << 7)); }
+
+void test_configuration_selects_the_lower_zone() {
+  midi.Init(2.0f);
+  std::vector<MidiPacket> packets = serviceUntil(now + MIDI_FRAME_MICROS);
+  TEST_ASSERT_EQUAL_UINT32(8, packets.size());
+  // RPN 6 (MPE configuration) = 15 member channels, on the manager channel
+  TEST_ASSERT_EQUAL_HEX8(0xB0, packets[0].status);
+  TEST_ASSERT_EQUAL_UINT8(101, packets[0].data1);
+  TEST_ASSERT_EQUAL_UINT8(100, packets[1].data1);
+  TEST_ASSERT_EQUAL_UINT8(6, packets[1].data2);
+  TEST_ASSERT_EQUAL_UINT8(6, packets[2].data1);
+  TEST_ASSERT_EQUAL_UINT8(MPE_MEMBER_CHANNELS, packets[2].data2);
+  // Manager bend range 2 semitones 0 cents
+  TEST_ASSERT_EQUAL_UINT8(2, packets[4].data2);
+  TEST_ASSERT_EQUAL_UINT8(0, packets[5].data2);
+}
+
+void test_note_on_follows_its_bend_on_a_member_channel() {
+  midi.NoteOn(3, 60.25f);
+  std::vector<MidiPacket> packets = serviceUntil(now + MIDI_FRAME_MICROS);
+  TEST_ASSERT_EQUAL_UINT32(2, packets.size());
+  int channel = packets[0].status & 0x0F;
+  TEST_ASSERT_NOT_EQUAL(MPE_MANAGER_CHANNEL, channel);
+  TEST_ASSERT_EQUAL_HEX8(0xE0 | channel, packets[0].status);
+  TEST_ASSERT_EQUAL_HEX8(0x90 | channel, packets[1].status);
+  TEST_ASSERT_EQUAL_UINT8(60, packets[1].data1);
+  TEST_ASSERT_EQUAL_UINT8(MIDI_NOTE_VELOCITY, packets[1].data2);
+  float pitch = 60.0f + ((float)bendOf(packets[0]) - 8192.0f) / 8192.0f * MPE_NOTE_BEND_RANGE;
+  TEST_ASSERT_FLOAT_WITHIN(MPE_NOTE_BEND_RANGE / 8192.0f, 60.25f, pitch);
+  TEST_ASSERT_EQUAL_INT(1, midi.ActiveNotes());
+
+  midi.NoteOff(3);
+  packets = serviceUntil(now + MIDI_FRAME_MICROS);
+  TEST_ASSERT_EQUAL_UINT32(1, packets.size());
+  TEST_ASSERT_EQUAL_HEX8(0x80 | channel, packets[0].status);
+  TEST_ASSERT_EQUAL_UINT8(60, packets[0].data1);
+  TEST_ASSERT_EQUAL_INT(0, midi.ActiveNotes());
+}
+
+void test_every_note_gets_its_own_channel_until_they_run_out() {
+  bool used[16] = {false};
+  for (int n = 0; n < MPE_MEMBER_CHANNELS; n++) {
+    midi.NoteOn(n, 48.0f + (float)n);
+  }
+  std::vector<MidiPacket> packets = serviceUntil(now + 3 * MIDI_FRAME_MICROS);
+  TEST_ASSERT_EQUAL_UINT32(2 * MPE_MEMBER_CHANNELS, packets.size());
+  for (const MidiPacket &p : packets) {
+    if ((p.status & 0xF0) == 0x90) {
+      TEST_ASSERT_FALSE(used[p.status & 0x0F]);
+      used[p.status & 0x0F] = true;
+    }
+  }
+
+  // One more steals the oldest note's channel: its note-off goes first
+  midi.NoteOn(MPE_MEMBER_CHANNELS, 80.0f);
+  packets = serviceUntil(now + MIDI_FRAME_MICROS);
+  TEST_ASSERT_EQUAL_UINT32(3, packets.size());
+  TEST_ASSERT_EQUAL_HEX8(0x80 | (packets[2].status & 0x0F), packets[0].status);
+  TEST_ASSERT_EQUAL_UINT8(48, packets[0].data1);
+  TEST_ASSERT_EQUAL_INT(MPE_MEMBER_CHANNELS, midi.ActiveNotes());
+}
+
+void test_frames_are_paced_and_bounded() {
+  TEST_ASSERT_EQUAL_UINT32(0, midi.Service(now + MIDI_FRAME_MICROS - 1));
+  for (int n = 0; n < 20; n++) {
+    midi.NoteOn(n, 60.0f);
+    midi.NoteOff(n);
+  }
+  // 40 bends and note-ons, 20 note-offs
+  TEST_ASSERT_EQUAL_UINT32(MIDI_PACKETS_PER_FRAME, midi.Service(now + MIDI_FRAME_MICROS));
+  TEST_ASSERT_EQUAL_UINT32(0, midi.Service(now + MIDI_FRAME_MICROS + 999));
+  now += MIDI_FRAME_MICROS;
+  std::vector<MidiPacket> packets = serviceUntil(now + 10 * MIDI_FRAME_MICROS);
+  TEST_ASSERT_EQUAL_UINT32(60 - MIDI_PACKETS_PER_FRAME, packets.size());
+  TEST_ASSERT_EQUAL_UINT32(0, midi.Dropped());
+}
+
+void test_controller_changes_coalesce_and_keep_their_interval() {
+  for (int i = 1; i <= 10; i++) {
+    midi.SetBend(0.1f * (float)i);
+  }
+  std::vector<MidiPacket> packets = serviceUntil(now + MIDI_CONTROL_INTERVAL_US);
+  TEST_ASSERT_EQUAL_UINT32(1, packets.size());
+  TEST_ASSERT_EQUAL_HEX8(0xE0, packets[0].status);
+  TEST_ASSERT_EQUAL_UINT16(8192 + 4096, bendOf(packets[0]));
+  uint32_t sentAt = frames.back().micros;
+
+  // Within the interval the next value waits, then goes out once
+  midi.SetBend(0.0f);
+  for (uint32_t t = now + MIDI_FRAME_MICROS; t < sentAt + MIDI_CONTROL_INTERVAL_US; t += MIDI_FRAME_MICROS) {
+    TEST_ASSERT_EQUAL_UINT32(0, midi.Service(t));
+    now = t;
+  }
+  packets = serviceUntil(sentAt + MIDI_CONTROL_INTERVAL_US);
+  TEST_ASSERT_EQUAL_UINT32(1, packets.size());
+  TEST_ASSERT_EQUAL_UINT16(8192, bendOf(packets[0]));
+
+  // A change below the threshold is never sent, a return to rest always is
+  midi.SetTimbre(0.5f);
+  packets = serviceUntil(now + MIDI_CONTROL_INTERVAL_US);
+  TEST_ASSERT_EQUAL_UINT32(1, packets.size());
+  midi.SetBend(0.001f);
+  packets = serviceUntil(now + 2 * MIDI_CONTROL_INTERVAL_US);
+  TEST_ASSERT_EQUAL_UINT32(0, packets.size());
+}
+
+/**
+ * 15-note chord bursts every 50 ms on a 100 us loop, every pitch wiggled
+ * and the manager controllers swept on every iteration: each note-on must
+ * follow its channel's bend, no controller may pass a waiting note packet,
+ * every slot keeps its rate, and the stream ends on the last values set
+ */
+void test_dense_gesture_keeps_order_rate_and_final_values() {
+  const uint32_t LOOP_MICROS = 100;
+  const uint32_t GESTURE_MICROS = 1000000;
+  size_t noteOnsQueued = 0;
+  bool held = false;
+  for (now = LOOP_MICROS; now < GESTURE_MICROS + 100000; now += LOOP_MICROS) {
+    if (now < GESTURE_MICROS) {
+      float t = (float)now * 1.0e-6f;
+      if (now % 50000 == 0) {
+        for (int n = 0; n < MPE_MEMBER_CHANNELS; n++) {
+          if (held) {
+            midi.NoteOff(n);
+            notePacketsQueued++;
+          } else {
+            midi.NoteOn(n, 48.0f + (float)n * 1.5f);
+            notePacketsQueued += 2;
+            noteOnsQueued++;
+          }
+        }
+        held = !held;
+      }
+      for (int n = 0; n < MPE_MEMBER_CHANNELS; n++) {
+        midi.SetNotePitch(n, 48.0f + (float)n * 1.5f + 0.5f * sinf(t * 7.0f + (float)n));
+      }
+      midi.SetBend(sinf(t * 5.0f));
+      midi.SetTimbre(0.5f + 0.5f * sinf(t * 3.0f));
+      midi.SetWindow((int)(6.0f * sinf(t)));
+    } else if (now == GESTURE_MICROS) {
+      midi.SetBend(0.0f);
+    }
+    midi.Service(now);
+  }
+
+  size_t noteOns = 0;
+  uint32_t notePacketsSent = 0;
+  uint32_t lastSent[256] = {0};  // By status (bends) or 0x80 + controller number
+  bool sentBefore[256] = {false};
+  uint16_t lastManagerBend = 0;
+  MidiPacket previous[16] = {};
+  for (size_t f = 0; f < frames.size(); f++) {
+    const Frame &frame = frames[f];
+    TEST_ASSERT_TRUE(frame.packets.size() <= MIDI_PACKETS_PER_FRAME);
+    if (f > 0) {
+      TEST_ASSERT_TRUE(frame.micros - frames[f - 1].micros >= MIDI_FRAME_MICROS);
+    }
+    for (size_t i = 0; i < frame.packets.size(); i++) {
+      const MidiPacket &p = frame.packets[i];
+      int type = p.status & 0xF0;
+      int channel = p.status & 0x0F;
+      // A note's bend may end one frame with its note-on starting the next
+      const MidiPacket *next = i + 1 < frame.packets.size() ? &frame.packets[i + 1]
+                               : (f + 1 < frames.size() ? &frames[f + 1].packets[0] : nullptr);
+      bool noteBend = type == 0xE0 && next && next->status == (0x90 | channel);
+      if (type == 0x90) {
+        TEST_ASSERT_EQUAL_HEX8(0xE0 | channel, previous[channel].status);
+        noteOns++;
+      }
+      if (type == 0x80 || type == 0x90 || noteBend) {
+        notePacketsSent++;
+      } else {
+        TEST_ASSERT_EQUAL_UINT32(frame.notePacketsQueued, notePacketsSent);
+        int key = type == 0xB0 ? 0x80 + p.data1 : p.status;
+        if (sentBefore[key]) {
+          TEST_ASSERT_TRUE(frame.micros - lastSent[key] >= MIDI_CONTROL_INTERVAL_US);
+        }
+        sentBefore[key] = true;
+        lastSent[key] = frame.micros;
+        if (p.status == 0xE0) {
+          lastManagerBend = bendOf(p);
+        }
+      }
+      previous[channel] = p;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(noteOnsQueued, noteOns);
+  TEST_ASSERT_EQUAL_UINT32(notePacketsQueued, notePacketsSent);
+  TEST_ASSERT_EQUAL_UINT16(8192, lastManagerBend);
+  TEST_ASSERT_EQUAL_UINT32(0, midi.Dropped());
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_configuration_selects_the_lower_zone);
+  RUN_TEST(test_note_on_follows_its_bend_on_a_member_channel);
+  RUN_TEST(test_every_note_gets_its_own_channel_until_they_run_out);
+  RUN_TEST(test_frames_are_paced_and_bounded);
+  RUN_TEST(test_controller_changes_coalesce_and_keep_their_interval);
+  RUN_TEST(test_dense_gesture_keeps_order_rate_and_final_values);
+  return UNITY_END();
+}
@@ -0,0 +1,78 @@
+/**
+ * PanTable: the sine/cosine law within the interpolation error, unity at
+ * the center, exact hard pans and clamping outside -1..1
+ */
+
+#include <math.h>
+#include <unity.h>
+
+#include "PanTable.h"
+
+// Worst-case linear interpolation error over 64 steps of a quarter sine
+const float PAN_INTERPOLATION_ERROR = 2.0e-4f;
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_gains_follow_the_sine_cosine_law() {
+  for (int i = -1000; i <= 1000; i++) {
+    float pan = (float)i * 0.001f;
+    float left, right;
+    panToGains(pan, left, right);
+    double theta = (pan + 1.0) * M_PI / 4.0;
+    TEST_ASSERT_FLOAT_WITHIN(PAN_INTERPOLATION_ERROR, (float)(M_SQRT2 * cos(theta)), left);
+    TEST_ASSERT_FLOAT_WITHIN(PAN_INTERPOLATION_ERROR, (float)(M_SQRT2 * sin(theta)), right);
+    TEST_ASSERT_FLOAT_WITHIN(1.0e-3f, 2.0f, left * left + right * right);
+  }
+}
+
+void test_center_is_unity_and_hard_pans_silence_the_far_side() {
+  float left, right;
+  panToGains(0.0f, left, right);
+  TEST_ASSERT_FLOAT_WITHIN(1.0e-6f, 1.0f, left);
+  TEST_ASSERT_FLOAT_WITHIN(1.0e-6f, 1.0f, right);
+
+  panToGains(-1.0f, left, right);
+  TEST_ASSERT_FLOAT_WITHIN(1.0e-6f, sqrtf(2.0f), left);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, right);
+  panToGains(1.0f, left, right);
+  TEST_ASSERT_FLOAT_WITHIN(1.0e-6f, 0.0f, left);
+  TEST_ASSERT_FLOAT_WITHIN(1.0e-6f, sqrtf(2.0f), right);
+}
+
+void test_positions_outside_the_range_clamp() {
+  float left, right, edgeLeft, edgeRight;
+  panToGains(-1.0f, edgeLeft, edgeRight);
+  panToGains(-7.5f, left, right);
+  TEST_ASSERT_EQUAL_FLOAT(edgeLeft, left);
+  TEST_ASSERT_EQUAL_FLOAT(edgeRight, right);
+  panToGains(1.0f, edgeLeft, edgeRight);
+  panToGains(3.0f, left, right);
+  TEST_ASSERT_EQUAL_FLOAT(edgeLeft, left);
+  TEST_ASSERT_EQUAL_FLOAT(edgeRight, right);
+}
+
+void test_moving_right_only_shifts_gain_right() {
+  float lastLeft, lastRight;
+  panToGains(-1.0f, lastLeft, lastRight);
+  for (int i = -999; i <= 1000; i++) {
+    float left, right;
+    panToGains((float)i * 0.001f, left, right);
+    TEST_ASSERT_TRUE(left <= lastLeft);
+    TEST_ASSERT_TRUE(right >= lastRight);
+    lastLeft = left;
+    lastRight = right;
+  }
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_gains_follow_the_sine_cosine_law);
+  RUN_TEST(test_center_is_unity_and_hard_pans_silence_the_far_side);
+  RUN_TEST(test_positions_outside_the_range_clamp);
+  RUN_TEST(test_moving_right_only_shifts_gain_right);
+  return UNITY_END();
+}
@@ -0,0 +1,252 @@
+/**
+ * PresetStore: payload encodings, torn and newer-format records skipped,
+ * and a long run of saves wrapping the log with even wear and every kind's
+ * newest record surviving re-scans
+ */
+
+#include <algorithm>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#include "PresetStore.h"
+
+const PresetRecordKind PRESET_3 = (PresetRecordKind)(RECORD_PRESET_FIRST + 2);
+
+/**
+ * NOR flash in RAM: erase sets 0xFF, program clears bits; counts erases
+ * per sector and can tear the Nth program (only half the record lands),
+ * keeping the image as a power cut at that moment would leave it
+ */
+class RamFlash : public FlashMemory {
+public:
+  static const uint32_t SECTOR = 4096;
+
+  RamFlash() : bytes(SECTOR * PRESET_FLASH_SECTORS, 0xFF), sectorErases(PRESET_FLASH_SECTORS, 0) {}
+
+  uint32_t SectorSize() const override { return SECTOR; }
+
+  bool Read(uint32_t address, uint8_t *dst, size_t n) override {
+    if (address + n > bytes.size()) {
+      return false;
+    }
+    memcpy(dst, &bytes[address], n);
+    return true;
+  }
+
+  bool EraseSector(uint32_t address) override {
+    if (address >= bytes.size()) {
+      return false;
+    }
+    address -= address % SECTOR;
+    memset(&bytes[address], 0xFF, SECTOR);
+    sectorErases[address / SECTOR]++;
+    return true;
+  }
+
+  bool Program(uint32_t address, const uint8_t *src, size_t n) override {
+    if (address + n > bytes.size()) {
+      return false;
+    }
+    bool tear = tearAt > 0 && --tearAt == 0;
+    for (size_t i = 0; i < (tear ? n / 2 : n); i++) {
+      bytes[address + i] &= src[i];
+    }
+    if (tear) {
+      atTear = bytes;
+    }
+    return true;
+  }
+
+  std::vector<uint8_t> bytes;
+  std::vector<uint32_t> sectorErases;
+  int tearAt = 0;                 // Program call (1-based) to tear, 0 for none
+  std::vector<uint8_t> atTear;    // Image right after the torn program
+};
+
+MusicalState testState(int i) {
+  MusicalState state = {(uint8_t)(i % 12), (uint8_t)(i % 3), (uint8_t)(1 + i % 8), (i & 1) != 0,
+                        (uint8_t)(i % 6), (int8_t)(i % 49 - 24)};
+  return state;
+}
+
+void assertSameState(const MusicalState &expected, const MusicalState &actual) {
+  TEST_ASSERT_EQUAL_UINT8(expected.key, actual.key);
+  TEST_ASSERT_EQUAL_UINT8(expected.scale, actual.scale);
+  TEST_ASSERT_EQUAL_UINT8(expected.octave, actual.octave);
+  TEST_ASSERT_EQUAL(expected.latch, actual.latch);
+  TEST_ASSERT_EQUAL_UINT8(expected.arpPattern, actual.arpPattern);
+  TEST_ASSERT_EQUAL_INT(expected.windowOffset, actual.windowOffset);
+}
+
+bool saveState(PresetStore &store, PresetRecordKind kind, const MusicalState &state) {
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  return store.Save(kind, payload, encodeMusicalState(state, payload));
+}
+
+MusicalState loadState(PresetStore &store, PresetRecordKind kind) {
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  size_t length = 0;
+  MusicalState state = {};
+  TEST_ASSERT_TRUE(store.Load(kind, payload, length));
+  decodeMusicalState(payload, length, state);
+  return state;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_payloads_round_trip() {
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  MusicalState state = testState(7);
+  MusicalState decoded = testState(0);
+  size_t length = encodeMusicalState(state, payload);
+  TEST_ASSERT_TRUE(length <= PRESET_PAYLOAD_MAX);
+  decodeMusicalState(payload, length, decoded);
+  assertSameState(state, decoded);
+
+  SensorCalibration calibration = {0.25f, -1.5f, 40, 320};
+  SensorCalibration calibrationOut = {0.0f, 0.0f, 0, 0};
+  decodeCalibration(payload, encodeCalibration(calibration, payload), calibrationOut);
+  TEST_ASSERT_EQUAL_FLOAT(0.25f, calibrationOut.accelCenterX);
+  TEST_ASSERT_EQUAL_FLOAT(-1.5f, calibrationOut.accelCenterY);
+  TEST_ASSERT_EQUAL_UINT16(40, calibrationOut.distanceMin);
+  TEST_ASSERT_EQUAL_UINT16(320, calibrationOut.distanceMax);
+
+  SensorConfig config = {true, false, 0x29, 0x26};
+  SensorConfig configOut = {false, true, 0, 0};
+  decodeSensorConfig(payload, encodeSensorConfig(config, payload), configOut);
+  TEST_ASSERT_TRUE(configOut.tof);
+  TEST_ASSERT_FALSE(configOut.accel);
+  TEST_ASSERT_EQUAL_HEX8(0x29, configOut.tofAddress);
+  TEST_ASSERT_EQUAL_HEX8(0x26, configOut.accelAddress);
+}
+
+/**
+ * A first-format payload had key, scale and octave only
+ */
+void test_older_payload_keeps_the_defaults() {
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  MusicalState state = testState(7);
+  MusicalState defaults = {0, 0, 4, true, 5, -3};
+  MusicalState older = defaults;
+  encodeMusicalState(state, payload);
+  decodeMusicalState(payload, 3, older);
+  TEST_ASSERT_EQUAL_UINT8(state.key, older.key);
+  TEST_ASSERT_EQUAL_UINT8(state.scale, older.scale);
+  TEST_ASSERT_EQUAL_UINT8(state.octave, older.octave);
+  TEST_ASSERT_EQUAL(defaults.latch, older.latch);
+  TEST_ASSERT_EQUAL_UINT8(defaults.arpPattern, older.arpPattern);
+  TEST_ASSERT_EQUAL_INT(defaults.windowOffset, older.windowOffset);
+}
+
+void test_empty_flash_has_nothing() {
+  static RamFlash flash;
+  PresetStore store;
+  TEST_ASSERT_TRUE(store.Init(&flash, 0));
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  size_t length = 0;
+  for (int kind = 0; kind < NUM_RECORD_KINDS; kind++) {
+    TEST_ASSERT_FALSE(store.Has((PresetRecordKind)kind));
+    TEST_ASSERT_FALSE(store.Load((PresetRecordKind)kind, payload, length));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, store.RecordsFound());
+}
+
+/**
+ * A power cut mid-record leaves the previous record in force, and the
+ * next save lands after the torn one
+ */
+void test_torn_record_keeps_the_previous_one() {
+  static RamFlash flash;
+  PresetStore store;
+  store.Init(&flash, 0);
+  TEST_ASSERT_TRUE(saveState(store, RECORD_PRESET_FIRST, testState(1)));
+  flash.tearAt = 1;
+  saveState(store, RECORD_PRESET_FIRST, testState(2));
+  flash.bytes = flash.atTear;  // Power back: what the cut left
+  store.Init(&flash, 0);
+  assertSameState(testState(1), loadState(store, RECORD_PRESET_FIRST));
+
+  TEST_ASSERT_TRUE(saveState(store, RECORD_PRESET_FIRST, testState(3)));
+  store.Init(&flash, 0);
+  assertSameState(testState(3), loadState(store, RECORD_PRESET_FIRST));
+}
+
+/**
+ * A record from a newer major format, CRC intact, is ignored
+ */
+void test_newer_format_record_is_ignored() {
+  static RamFlash flash;
+  PresetStore store;
+  store.Init(&flash, 0);
+  saveState(store, RECORD_LAST_STATE, testState(4));
+  saveState(store, RECORD_LAST_STATE, testState(5));
+  uint8_t *record = &flash.bytes[PRESET_RECORD_SIZE];
+  auto resign = [&](uint8_t version) {
+    record[1] = version;
+    uint16_t crc = presetCrc16(record, PRESET_RECORD_SIZE - 2);
+    record[PRESET_RECORD_SIZE - 2] = (uint8_t)crc;
+    record[PRESET_RECORD_SIZE - 1] = (uint8_t)(crc >> 8);
+  };
+  resign(PRESET_FORMAT_VERSION);  // Re-signed as it was: still valid
+  store.Init(&flash, 0);
+  assertSameState(testState(5), loadState(store, RECORD_LAST_STATE));
+
+  resign(PRESET_FORMAT_VERSION + 1);
+  store.Init(&flash, 0);
+  assertSameState(testState(4), loadState(store, RECORD_LAST_STATE));
+}
+
+/**
+ * One preset and the calibration saved once, then the last state over and
+ * over (the autosave) around the log several times, re-scanning now and
+ * then: the once-saved kinds are carried forward and every sector is
+ * erased equally often
+ */
+void test_log_wraps_with_even_wear_and_keeps_every_kind() {
+  const int SAVES = 10000;  // Almost five times round the log
+  static RamFlash flash;
+  PresetStore store;
+  store.Init(&flash, 0);
+  uint8_t payload[PRESET_PAYLOAD_MAX];
+  SensorCalibration calibration = {0.25f, -1.5f, 40, 320};
+  TEST_ASSERT_TRUE(saveState(store, PRESET_3, testState(42)));
+  TEST_ASSERT_TRUE(store.Save(RECORD_CALIBRATION, payload, encodeCalibration(calibration, payload)));
+  for (int i = 0; i < SAVES; i++) {
+    TEST_ASSERT_TRUE(saveState(store, RECORD_LAST_STATE, testState(i)));
+    if (i % 1000 == 999) {
+      store.Init(&flash, 0);
+      assertSameState(testState(i), loadState(store, RECORD_LAST_STATE));
+    }
+  }
+
+  store.Init(&flash, 0);
+  assertSameState(testState(42), loadState(store, PRESET_3));
+  assertSameState(testState(SAVES - 1), loadState(store, RECORD_LAST_STATE));
+  size_t length = 0;
+  SensorCalibration kept = {0.0f, 0.0f, 0, 0};
+  TEST_ASSERT_TRUE(store.Load(RECORD_CALIBRATION, payload, length));
+  decodeCalibration(payload, length, kept);
+  TEST_ASSERT_EQUAL_UINT16(320, kept.distanceMax);
+  TEST_ASSERT_FALSE(store.Has(RECORD_PRESET_FIRST));
+
+  uint32_t fewest = *std::min_element(flash.sectorErases.begin(), flash.sectorErases.end());
+  uint32_t most = *std::max_element(flash.sectorErases.begin(), flash.sectorErases.end());
+  TEST_ASSERT_TRUE(fewest >= 4);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(1, most - fewest);
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_payloads_round_trip);
+  RUN_TEST(test_older_payload_keeps_the_defaults);
+  RUN_TEST(test_empty_flash_has_nothing);
+  RUN_TEST(test_torn_record_keeps_the_previous_one);
+  RUN_TEST(test_newer_format_record_is_ignored);
+  RUN_TEST(test_log_wraps_with_even_wear_and_keeps_every_kind);
+  return UNITY_END();
+}
@@ -0,0 +1,157 @@
+/**
+ * SpscQueue: FIFO order, full/empty and drop counting, and a producer and
+ * consumer on two threads losing nothing but the drops they count
+ */
+
+#include <atomic>
+#include <thread>
+#include <unity.h>
+
+#include "SpscQueue.h"
+
+// Enough events to wrap a small ring many thousands of times
+const uint32_t STRESS_EVENTS = 200000;
+
+struct Event {
+  uint32_t sequence;
+  uint32_t check;  // Derived from sequence: a torn or stale slot shows up here
+};
+
+Event makeEvent(uint32_t sequence) { return {sequence, sequence * 2654435761u}; }
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_pops_in_push_order() {
+  SpscQueue<uint32_t, 8> queue;
+  for (uint32_t round = 0; round < 5; round++) {  // Past the end of the ring
+    for (uint32_t i = 0; i < 6; i++) {
+      TEST_ASSERT_TRUE(queue.Push(round * 10 + i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(6, queue.Size());
+    for (uint32_t i = 0; i < 6; i++) {
+      uint32_t item = 0;
+      TEST_ASSERT_TRUE(queue.Pop(item));
+      TEST_ASSERT_EQUAL_UINT32(round * 10 + i, item);
+    }
+    TEST_ASSERT_TRUE(queue.Empty());
+  }
+}
+
+void test_full_ring_drops_and_counts() {
+  SpscQueue<uint32_t, 4> queue;
+  uint32_t item = 0;
+  TEST_ASSERT_FALSE(queue.Pop(item));
+  for (uint32_t i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(queue.Push(i));
+  }
+  TEST_ASSERT_FALSE(queue.Push(4));
+  TEST_ASSERT_FALSE(queue.Push(5));
+  TEST_ASSERT_EQUAL_UINT32(2, queue.Dropped());
+  TEST_ASSERT_EQUAL_UINT32(4, queue.Size());
+
+  // The ring keeps the oldest items; the dropped ones never appear
+  for (uint32_t i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(queue.Pop(item));
+    TEST_ASSERT_EQUAL_UINT32(i, item);
+  }
+  TEST_ASSERT_FALSE(queue.Pop(item));
+  TEST_ASSERT_TRUE(queue.Push(6));
+  TEST_ASSERT_EQUAL_UINT32(2, queue.Dropped());
+}
+
+/**
+ * The producer pushes each event once and moves on, as loop() does; the
+ * consumer must see a strictly increasing sequence, and what it missed
+ * must be exactly what the producer counted as dropped
+ */
+void test_two_threads_lose_only_counted_drops() {
+  static SpscQueue<Event, 64> queue;
+  std::atomic<bool> done{false};
+  uint32_t received = 0;
+  uint32_t outOfOrder = 0;
+  uint32_t corrupt = 0;
+
+  std::thread consumer([&]() {
+    uint32_t next = 0;  // Lowest sequence still possible
+    Event event;
+    for (;;) {
+      bool finished = done.load(std::memory_order_acquire);  // Before the last Pop, so nothing is missed
+      if (!queue.Pop(event)) {
+        if (finished) {
+          break;
+        }
+        std::this_thread::yield();  // Lets the producer run on a single core
+        continue;
+      }
+      received++;
+      if (event.check != makeEvent(event.sequence).check) {
+        corrupt++;
+      }
+      if (event.sequence < next) {
+        outOfOrder++;
+      }
+      next = event.sequence + 1;
+    }
+  });
+
+  for (uint32_t sequence = 0; sequence < STRESS_EVENTS; sequence++) {
+    queue.Push(makeEvent(sequence));
+  }
+  done.store(true, std::memory_order_release);
+  consumer.join();
+
+  TEST_ASSERT_EQUAL_UINT32(0, corrupt);
+  TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+  TEST_ASSERT_EQUAL_UINT32(STRESS_EVENTS, received + queue.Dropped());
+  TEST_ASSERT_TRUE(queue.Empty());
+}
+
+/**
+ * A producer that retries until the push lands loses nothing: every
+ * sequence number arrives, once, in order
+ */
+void test_two_threads_deliver_every_event_in_order() {
+  static SpscQueue<Event, 16> queue;
+  uint32_t mismatches = 0;
+  uint32_t received = 0;
+
+  std::thread consumer([&]() {
+    Event event;
+    while (received < STRESS_EVENTS) {
+      if (!queue.Pop(event)) {
+        std::this_thread::yield();
+      } else {
+        if (event.sequence != received || event.check != makeEvent(received).check) {
+          mismatches++;
+        }
+        received++;
+      }
+    }
+  });
+
+  uint32_t retries = 0;
+  for (uint32_t sequence = 0; sequence < STRESS_EVENTS; sequence++) {
+    while (!queue.Push(makeEvent(sequence))) {
+      retries++;
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+
+  TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+  TEST_ASSERT_EQUAL_UINT32(STRESS_EVENTS, received);
+  TEST_ASSERT_EQUAL_UINT32(retries, queue.Dropped());  // Every failed push was counted
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_pops_in_push_order);
+  RUN_TEST(test_full_ring_drops_and_counts);
+  RUN_TEST(test_two_threads_lose_only_counted_drops);
+  RUN_TEST(test_two_threads_deliver_every_event_in_order);
+  return UNITY_END();
+}
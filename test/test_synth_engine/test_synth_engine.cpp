@@ -0,0 +1,363 @@
+/**
+ * SynthEngine: voice allocation and stealing, voice pan, and when queued
+ * events apply, rendered block by block on the sample clock the way
+ * AudioCallback() drives it
+ */
+
+#include <math.h>
+#include <unity.h>
+
+#include "SynthEngine.h"
+
+const float SAMPLE_RATE = 48000.0f;
+const size_t BLOCK = 64;
+
+static SynthEngine synth;
+static float left[BLOCK];
+static float right[BLOCK];
+static float *out[2] = {left, right};
+static uint32_t blocks = 0;
+
+uint32_t blockMicros(uint32_t block) { return (uint32_t)((double)block * BLOCK * 1.0e6 / SAMPLE_RATE); }
+
+/**
+ * Render the next block; returns its start time
+ */
+uint32_t render() {
+  uint32_t start = blockMicros(blocks++);
+  synth.Process(out, BLOCK, start);
+  return start;
+}
+
+bool sounding(int note) {
+  for (int i = 0; i < NUM_VOICES; i++) {
+    if (synth.Voice(i).note == note) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void setUp() {
+  synth.Init(SAMPLE_RATE);
+  synth.SetEnvelope(0.005f, 0.0f, 1.0f, 0.05f, ENV_CURVE_LINEAR);
+  synth.SetParam(PARAM_MORPH_RAMP, 0.0f);  // Morph lands in one block
+  blocks = 0;
+  render();
+}
+
+void tearDown() {}
+
+int voicesInStage(EnvelopeStage stage) {
+  int count = 0;
+  for (int i = 0; i < NUM_VOICES; i++) {
+    count += synth.Voice(i).stage == stage ? 1 : 0;
+  }
+  return count;
+}
+
+/////////////////////
+// Voice pool
+/////////////////////
+
+void test_notes_take_free_voices_until_the_pool_is_full() {
+  for (int note = 0; note < NUM_VOICES; note++) {
+    synth.NoteOn(note, 48.0f + note);
+  }
+  render();
+  for (int note = 0; note < NUM_VOICES; note++) {
+    TEST_ASSERT_TRUE(sounding(note));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, synth.StolenVoices());
+}
+
+/**
+ * A full pool with every note held gives up its oldest note
+ */
+void test_full_pool_steals_the_oldest_held_note() {
+  for (int note = 0; note < NUM_VOICES; note++) {
+    synth.NoteOn(note, 48.0f + note);
+  }
+  render();
+  synth.NoteOn(NUM_VOICES, 60.0f);
+  render();
+  TEST_ASSERT_FALSE(sounding(0));
+  for (int note = 1; note <= NUM_VOICES; note++) {
+    TEST_ASSERT_TRUE(sounding(note));
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, synth.StolenVoices());
+}
+
+/**
+ * A releasing voice is taken before any held note
+ */
+void test_full_pool_steals_a_releasing_voice_first() {
+  for (int note = 0; note < NUM_VOICES; note++) {
+    synth.NoteOn(note, 48.0f + note);
+  }
+  render();
+  synth.NoteOff(5);
+  render();
+  TEST_ASSERT_EQUAL_INT(1, voicesInStage(ENV_RELEASE));
+  synth.NoteOn(NUM_VOICES, 60.0f);
+  render();
+  TEST_ASSERT_EQUAL_INT(0, voicesInStage(ENV_RELEASE));
+  for (int note = 0; note <= NUM_VOICES; note++) {
+    TEST_ASSERT_EQUAL(note != 5, sounding(note));
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, synth.StolenVoices());
+}
+
+/**
+ * The same id again starts a fresh voice; the old one rings out
+ */
+void test_retrigger_releases_the_old_voice() {
+  synth.NoteOn(7, 60.0f);
+  render();
+  synth.NoteOn(7, 62.0f);
+  render();
+  int holding = 0;
+  for (int i = 0; i < NUM_VOICES; i++) {
+    holding += synth.Voice(i).note == 7 ? 1 : 0;
+  }
+  TEST_ASSERT_EQUAL_INT(1, holding);
+  TEST_ASSERT_EQUAL_INT(1, voicesInStage(ENV_RELEASE));
+  TEST_ASSERT_EQUAL_UINT32(0, synth.StolenVoices());
+}
+
+/**
+ * Released voices go back to the pool once their release ends
+ */
+void test_released_voices_return_to_the_pool() {
+  for (int note = 0; note < NUM_VOICES; note++) {
+    synth.NoteOn(note, 48.0f + note);
+  }
+  render();
+  for (int note = 0; note < NUM_VOICES; note++) {
+    synth.NoteOff(note);
+  }
+  for (int i = 0; i < 60; i++) {  // 50 ms release
+    render();
+  }
+  TEST_ASSERT_EQUAL_INT(NUM_VOICES, voicesInStage(ENV_IDLE));
+  for (int note = 0; note < NUM_VOICES; note++) {
+    synth.NoteOn(NUM_VOICES + note, 60.0f);
+  }
+  render();
+  TEST_ASSERT_EQUAL_UINT32(0, synth.StolenVoices());
+}
+
+/**
+ * A note timed late in a long callback does not lower the polyphony gain
+ * of the blocks before its start: those render exactly as without it
+ */
+void test_waiting_voice_does_not_lower_the_mix() {
+  static SynthEngine reference;
+  reference.Init(SAMPLE_RATE);
+  reference.SetEnvelope(0.005f, 0.0f, 1.0f, 0.05f, ENV_CURVE_LINEAR);
+  reference.SetParam(PARAM_MORPH_RAMP, 0.0f);
+  synth.NoteOn(1, 60.0f);
+  reference.NoteOn(1, 60.0f);
+  float refLeft[BLOCK], refRight[BLOCK];
+  float *refOut[2] = {refLeft, refRight};
+  for (int i = 0; i < 10; i++) {  // Past the attack
+    reference.Process(refOut, BLOCK, blockMicros(blocks));
+    render();
+  }
+
+  // Four blocks in one callback; the second note starts 240 samples in
+  const size_t CALLBACK = 4 * BLOCK;
+  float longLeft[2][CALLBACK], longRight[2][CALLBACK];
+  float *withNote[2] = {longLeft[0], longRight[0]};
+  float *without[2] = {longLeft[1], longRight[1]};
+  uint32_t start = blockMicros(blocks);
+  synth.NoteOn(2, 67.0f, start + 5000);
+  synth.Process(withNote, CALLBACK, start);
+  reference.Process(without, CALLBACK, start);
+  TEST_ASSERT_EQUAL_MEMORY(longLeft[1], longLeft[0], sizeof(float) * 3 * BLOCK);
+  TEST_ASSERT_EQUAL_MEMORY(longRight[1], longRight[0], sizeof(float) * 3 * BLOCK);
+}
+
+/////////////////////
+// Stereo pan
+/////////////////////
+
+/**
+ * A note panned hard left before it starts never reaches the right side;
+ * a centered one is the same on both
+ */
+void test_note_pan_places_the_voice() {
+  synth.SetNotePan(1, -1.0f);
+  synth.NoteOn(1, 60.0f);
+  float peak = 0.0f;
+  for (int i = 0; i < 10; i++) {
+    render();
+    for (size_t k = 0; k < BLOCK; k++) {
+      TEST_ASSERT_EQUAL_FLOAT(0.0f, right[k]);
+      peak = fmaxf(peak, fabsf(left[k]));
+    }
+  }
+  TEST_ASSERT_TRUE(peak > 0.1f);
+
+  synth.NoteOff(1);
+  synth.NoteOn(2, 60.0f);
+  for (int i = 0; i < 60; i++) {  // Past the first note's release
+    render();
+  }
+  for (size_t k = 0; k < BLOCK; k++) {
+    TEST_ASSERT_FLOAT_WITHIN(1.0e-6f, left[k], right[k]);
+  }
+}
+
+/**
+ * Moving a sounding note glides its gains over blocks instead of jumping
+ */
+void test_pan_change_glides() {
+  synth.SetNotePan(1, -1.0f);
+  synth.NoteOn(1, 60.0f);
+  for (int i = 0; i < 10; i++) {
+    render();
+  }
+  synth.SetNotePan(1, 1.0f);
+  render();
+  float firstBlock = 0.0f;
+  for (size_t k = 0; k < BLOCK; k++) {
+    firstBlock = fmaxf(firstBlock, fabsf(right[k]));
+  }
+  float settled = 0.0f;
+  for (int i = 0; i < 100; i++) {
+    render();
+  }
+  for (size_t k = 0; k < BLOCK; k++) {
+    settled = fmaxf(settled, fabsf(right[k]));
+    TEST_ASSERT_FLOAT_WITHIN(1.0e-6f, 0.0f, left[k]);
+  }
+  TEST_ASSERT_TRUE(firstBlock > 0.0f);
+  TEST_ASSERT_TRUE(firstBlock < 0.5f * settled);
+}
+
+/////////////////////
+// Event timing
+/////////////////////
+
+/**
+ * Parameters and untimed notes queued behind a note timed for a later
+ * block apply in the block they arrive in
+ */
+void test_untimed_events_pass_a_held_timed_note() {
+  uint32_t noteTime = blockMicros(blocks) + 10000;
+  synth.NoteOn(1, 60.0f, noteTime);
+  synth.SetParam(PARAM_MORPH, 1.0f);
+  synth.NoteOn(2, 64.0f);
+  render();
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, synth.Morph());
+  TEST_ASSERT_TRUE(sounding(2));
+  TEST_ASSERT_FALSE(sounding(1));
+  TEST_ASSERT_EQUAL_UINT32(0, synth.LateEvents());
+
+  // The timed note still starts in the block its time falls in
+  while (blockMicros(blocks + 1) <= noteTime) {
+    render();
+    TEST_ASSERT_FALSE(sounding(1));
+  }
+  render();
+  TEST_ASSERT_TRUE(sounding(1));
+}
+
+/**
+ * Timed events keep their queue order: one queued behind a held note
+ * waits for it even if its own time comes first
+ */
+void test_timed_events_stay_in_order() {
+  uint32_t now = blockMicros(blocks);
+  synth.NoteOn(1, 60.0f, now + 8500);
+  synth.NoteOn(2, 64.0f, now + 2000);
+  while (blockMicros(blocks + 1) <= now + 8500) {
+    render();
+    TEST_ASSERT_FALSE(sounding(1));
+    TEST_ASSERT_FALSE(sounding(2));
+  }
+  render();
+  TEST_ASSERT_TRUE(sounding(1));
+  TEST_ASSERT_TRUE(sounding(2));
+  TEST_ASSERT_EQUAL_UINT32(1, synth.LateEvents());  // Note 2, past due when reached
+}
+
+/**
+ * Init() starts the steal and late counts over
+ */
+void test_init_clears_the_counters() {
+  uint32_t now = blockMicros(blocks);
+  synth.NoteOn(1, 60.0f, now + 8500);
+  synth.NoteOn(2, 64.0f, now + 2000);
+  for (int note = 3; note < NUM_VOICES + 4; note++) {
+    synth.NoteOn(note, 48.0f + note);
+  }
+  while (blockMicros(blocks) <= now + 8500) {
+    render();
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, synth.LateEvents());
+  TEST_ASSERT_TRUE(synth.StolenVoices() > 0);
+  synth.Init(SAMPLE_RATE);
+  TEST_ASSERT_EQUAL_UINT32(0, synth.LateEvents());
+  TEST_ASSERT_EQUAL_UINT32(0, synth.StolenVoices());
+}
+
+/**
+ * A note off timed inside the block it arrives in releases that block
+ */
+void test_timed_note_off_in_block() {
+  synth.NoteOn(3, 67.0f);
+  render();
+  TEST_ASSERT_TRUE(sounding(3));
+  synth.NoteOff(3, blockMicros(blocks) + 500);
+  render();
+  TEST_ASSERT_FALSE(sounding(3));  // A releasing voice no longer holds its note id
+  int releasing = 0;
+  for (int i = 0; i < NUM_VOICES; i++) {
+    releasing += synth.Voice(i).stage == ENV_RELEASE ? 1 : 0;
+  }
+  TEST_ASSERT_EQUAL_INT(1, releasing);
+}
+
+/**
+ * With the hold full, later events stay queued in order rather than being
+ * dropped, and all of them apply once the hold drains
+ */
+void test_full_hold_keeps_the_rest_queued() {
+  uint32_t noteTime = blockMicros(blocks) + 5000;
+  for (int note = 0; note < MAX_HELD_EVENTS + 4; note++) {
+    synth.NoteOn(note, 60.0f, noteTime);
+  }
+  synth.SetParam(PARAM_MORPH, 0.5f);
+  while (blockMicros(blocks + 1) <= noteTime) {
+    render();
+  }
+  render();
+  render();  // The queued tail, now past due
+  for (int note = MAX_HELD_EVENTS + 4 - NUM_VOICES; note < MAX_HELD_EVENTS + 4; note++) {
+    TEST_ASSERT_TRUE(sounding(note));
+  }
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, synth.Morph());
+  TEST_ASSERT_EQUAL_UINT32(0, synth.DroppedEvents());
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_notes_take_free_voices_until_the_pool_is_full);
+  RUN_TEST(test_full_pool_steals_the_oldest_held_note);
+  RUN_TEST(test_full_pool_steals_a_releasing_voice_first);
+  RUN_TEST(test_retrigger_releases_the_old_voice);
+  RUN_TEST(test_released_voices_return_to_the_pool);
+  RUN_TEST(test_waiting_voice_does_not_lower_the_mix);
+  RUN_TEST(test_note_pan_places_the_voice);
+  RUN_TEST(test_pan_change_glides);
+  RUN_TEST(test_untimed_events_pass_a_held_timed_note);
+  RUN_TEST(test_timed_events_stay_in_order);
+  RUN_TEST(test_init_clears_the_counters);
+  RUN_TEST(test_timed_note_off_in_block);
+  RUN_TEST(test_full_hold_keeps_the_rest_queued);
+  return UNITY_END();
+}
@@ -0,0 +1,167 @@
+/**
+ * TaskScheduler on a simulated clock: most urgent first, deadlines on a
+ * fixed grid across a clock wrap, missed deadlines counted as overruns,
+ * and the wait it reports until the next one
+ */
+
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#include "TaskScheduler.h"
+
+struct Run {
+  const char *name;
+  uint32_t at;  // Since the test's start
+};
+
+static TaskScheduler scheduler;
+static uint32_t clockNow = 0;
+static uint32_t start = 0;
+static std::vector<Run> runs;
+static uint32_t stallOnce = 0;  // Next log run takes this long
+
+static uint32_t testClock() { return clockNow; }
+
+static void buttonTask(uint32_t now) {
+  runs.push_back({"buttons", now - start});
+  clockNow += 5;
+}
+
+static void midiTask(uint32_t now) {
+  runs.push_back({"midi", now - start});
+  clockNow += 50;
+}
+
+static void logTask(uint32_t now) {
+  runs.push_back({"log", now - start});
+  clockNow += stallOnce ? stallOnce : 30;
+  stallOnce = 0;
+}
+
+/**
+ * Run the loop for a while, idling exactly as long as RunDue() says,
+ * including whatever falls due at the end
+ */
+void runFor(uint32_t micros) {
+  uint32_t until = clockNow + micros;
+  while ((int32_t)(clockNow - until) < 0) {
+    clockNow += scheduler.RunDue();
+  }
+  scheduler.RunDue();
+}
+
+void setUp() {
+  start = clockNow = 0xFFFFFFFFu - 300000;  // Wraps 0.3 s in
+  runs.clear();
+  stallOnce = 0;
+  scheduler.Init(testClock);
+}
+
+void tearDown() {}
+
+void test_add_returns_ids_until_the_table_is_full() {
+  for (int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+    TEST_ASSERT_EQUAL_INT(i, scheduler.Add("t", 1000, 0, logTask));
+  }
+  TEST_ASSERT_EQUAL_INT(-1, scheduler.Add("t", 1000, 0, logTask));
+  TEST_ASSERT_EQUAL_INT(SCHEDULER_MAX_TASKS, scheduler.Count());
+
+  scheduler.Init(testClock);
+  TEST_ASSERT_EQUAL_INT(-1, scheduler.Add("t", 0, 0, logTask));
+  TEST_ASSERT_EQUAL_INT(-1, scheduler.Add("t", 1000, 0, nullptr));
+}
+
+void test_first_run_is_one_period_after_add() {
+  scheduler.Add("midi", 1000, 0, midiTask);
+  TEST_ASSERT_EQUAL_UINT32(1000, scheduler.RunDue());
+  TEST_ASSERT_EQUAL_UINT32(0, runs.size());
+  clockNow += 999;
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.RunDue());
+  clockNow += 1;
+  TEST_ASSERT_EQUAL_UINT32(950, scheduler.RunDue());  // Ran, took 50 us
+  TEST_ASSERT_EQUAL_UINT32(1, runs.size());
+}
+
+/**
+ * Added least urgent first: when all three fall due together the order
+ * comes from the priorities
+ */
+void test_most_urgent_runs_first_when_due_together() {
+  scheduler.Add("log", 2000, 5, logTask);
+  scheduler.Add("midi", 1000, 2, midiTask);
+  scheduler.Add("buttons", 250, 0, buttonTask);
+  runFor(2100);
+  size_t i = 0;
+  while (i < runs.size() && runs[i].at < 2000) {
+    i++;
+  }
+  TEST_ASSERT_TRUE(i + 2 < runs.size());
+  TEST_ASSERT_EQUAL_STRING("buttons", runs[i].name);
+  TEST_ASSERT_EQUAL_UINT32(2000, runs[i].at);
+  TEST_ASSERT_EQUAL_STRING("midi", runs[i + 1].name);
+  TEST_ASSERT_EQUAL_STRING("log", runs[i + 2].name);
+}
+
+/**
+ * A run delayed by other tasks does not push the next one back: every
+ * midi run over a second (across the clock wrap) starts less than a
+ * period after its grid point
+ */
+void test_deadlines_stay_on_the_grid_across_the_wrap() {
+  int logId = scheduler.Add("log", 2000, 5, logTask);
+  int midiId = scheduler.Add("midi", 1000, 2, midiTask);
+  int buttonId = scheduler.Add("buttons", 250, 0, buttonTask);
+  runFor(1000000);
+  uint32_t k = 1;
+  for (const Run &run : runs) {
+    if (strcmp(run.name, "midi") == 0) {
+      TEST_ASSERT_TRUE(run.at >= k * 1000 && run.at < k * 1000 + 100);
+      k++;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(1000, scheduler.Stats(midiId).runs);
+  TEST_ASSERT_EQUAL_UINT32(4000, scheduler.Stats(buttonId).runs);
+  TEST_ASSERT_EQUAL_UINT32(500, scheduler.Stats(logId).runs);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.Stats(buttonId).overruns);
+}
+
+/**
+ * A log write blocking 1.2 ms makes the 250 us button task miss deadlines:
+ * they are counted, it runs once and returns to its grid, and every
+ * deadline is either run or counted
+ */
+void test_missed_deadlines_count_as_overruns() {
+  int logId = scheduler.Add("log", 2000, 5, logTask);
+  int buttonId = scheduler.Add("buttons", 250, 0, buttonTask);
+  runFor(10000);
+  stallOnce = 1200;
+  runFor(10000);
+  uint32_t elapsed = clockNow - start;
+  const TaskStats &buttons = scheduler.Stats(buttonId);
+  TEST_ASSERT_EQUAL_UINT32(3, buttons.overruns);  // Ran 955 us late: three whole periods
+  TEST_ASSERT_TRUE(buttons.maxLateMicros >= 1200 - 250);
+  TEST_ASSERT_EQUAL_UINT32(elapsed / 250, buttons.runs + buttons.overruns);
+  TEST_ASSERT_EQUAL_UINT32(elapsed / 2000, scheduler.Stats(logId).runs);
+  TEST_ASSERT_EQUAL_UINT32(1200, scheduler.Stats(logId).maxMicros);
+
+  // Back on the grid after the stall
+  const Run &last = runs.back();
+  TEST_ASSERT_EQUAL_UINT32(0, last.at % 250);
+
+  scheduler.ResetStats();
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.Stats(buttonId).runs);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.Stats(buttonId).overruns);
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_add_returns_ids_until_the_table_is_full);
+  RUN_TEST(test_first_run_is_one_period_after_add);
+  RUN_TEST(test_most_urgent_runs_first_when_due_together);
+  RUN_TEST(test_deadlines_stay_on_the_grid_across_the_wrap);
+  RUN_TEST(test_missed_deadlines_count_as_overruns);
+  return UNITY_END();
+}
@@ -0,0 +1,352 @@
+/**
+ * TelemetryLink: COBS at the block edges, little-endian payload fields,
+ * frames surviving log text, corruption, cut-offs and noise before their
+ * delimiter, whole-frame drops when the port is full, and random payloads
+ * looped through both ways, in memory and through a pseudo-terminal
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <unity.h>
+#include <vector>
+
+#include "TelemetryLink.h"
+
+static std::vector<uint8_t> wire;
+static uint32_t seed = 1;
+static int ptyMaster = -1;
+static int ptySlave = -1;
+
+void capture(const uint8_t *data, size_t length) {
+  wire.insert(wire.end(), data, data + length);
+}
+
+uint8_t nextRandom() {
+  seed = seed * 1664525u + 1013904223u;
+  return (uint8_t)(seed >> 24);
+}
+
+/**
+ * Feed the wire to link; every payload it completes, in order
+ */
+std::vector<std::vector<uint8_t>> receiveAll(TelemetryLink &link) {
+  std::vector<std::vector<uint8_t>> frames;
+  for (uint8_t byte : wire) {
+    if (link.Receive(byte)) {
+      frames.push_back(std::vector<uint8_t>(link.Payload(), link.Payload() + link.PayloadLength()));
+    }
+  }
+  wire.clear();
+  return frames;
+}
+
+void setUp() {
+  wire.clear();
+  seed = 1;
+}
+
+void tearDown() {
+  if (ptySlave >= 0) {
+    close(ptySlave);
+  }
+  if (ptyMaster >= 0) {
+    close(ptyMaster);
+  }
+  ptyMaster = ptySlave = -1;
+}
+
+void test_cobs_known_encodings() {
+  const uint8_t ZERO[] = {0x00};
+  const uint8_t MIXED[] = {0x11, 0x22, 0x00, 0x33};
+  const uint8_t ZERO_CODED[] = {0x01, 0x01};
+  const uint8_t MIXED_CODED[] = {0x03, 0x11, 0x22, 0x02, 0x33};
+  uint8_t encoded[8];
+  TEST_ASSERT_EQUAL(sizeof(ZERO_CODED), cobsEncode(ZERO, sizeof(ZERO), encoded));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(ZERO_CODED, encoded, sizeof(ZERO_CODED));
+  TEST_ASSERT_EQUAL(sizeof(MIXED_CODED), cobsEncode(MIXED, sizeof(MIXED), encoded));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(MIXED_CODED, encoded, sizeof(MIXED_CODED));
+}
+
+/**
+ * Around the 254-byte block edges: no zeros out, at most one byte of
+ * overhead per 254, exact round trip
+ */
+void test_cobs_round_trips_at_the_block_edges() {
+  const size_t LENGTHS[] = {0, 1, 2, 253, 254, 255, 256, 508, 509, 600};
+  uint8_t raw[600], encoded[604], decoded[600];
+  for (size_t length : LENGTHS) {
+    for (int pattern = 0; pattern < 3; pattern++) {
+      for (size_t i = 0; i < length; i++) {
+        raw[i] = pattern == 0 ? (uint8_t)(1 + i % 255) : (pattern == 1 ? 0 : nextRandom() % 4);
+      }
+      size_t encodedLength = cobsEncode(raw, length, encoded);
+      TEST_ASSERT_TRUE(encodedLength <= length + length / 254 + 1);
+      TEST_ASSERT_NULL(memchr(encoded, 0, encodedLength));
+      size_t decodedLength = 0;
+      TEST_ASSERT_TRUE(cobsDecode(encoded, encodedLength, decoded, sizeof(decoded), decodedLength));
+      TEST_ASSERT_EQUAL(length, decodedLength);
+      if (length > 0) {
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(raw, decoded, length);
+      }
+    }
+  }
+}
+
+void test_cobs_rejects_malformed_and_too_long() {
+  const uint8_t OVERRUN[] = {0x05, 0x11, 0x22};  // Code points past the end
+  const uint8_t INNER_ZERO[] = {0x03, 0x11, 0x00};
+  const uint8_t FOUR[] = {0x05, 0x11, 0x22, 0x33, 0x44};
+  uint8_t decoded[8];
+  size_t length = 99;
+  TEST_ASSERT_FALSE(cobsDecode(OVERRUN, sizeof(OVERRUN), decoded, sizeof(decoded), length));
+  TEST_ASSERT_FALSE(cobsDecode(INNER_ZERO, sizeof(INNER_ZERO), decoded, sizeof(decoded), length));
+  TEST_ASSERT_FALSE(cobsDecode(FOUR, sizeof(FOUR), decoded, 3, length));
+  TEST_ASSERT_EQUAL(99, length);
+  TEST_ASSERT_TRUE(cobsDecode(FOUR, sizeof(FOUR), decoded, 4, length));
+  TEST_ASSERT_EQUAL(4, length);
+}
+
+void test_fields_are_little_endian_and_bounded() {
+  TelemetryPacket packet(TM_PARAM_INFO);
+  packet.PutU8(7);
+  packet.PutU16(0x1234);
+  packet.PutU32(0xA1B2C3D4u);
+  packet.PutFloat(1.0f);
+  packet.PutString("gain");
+  const uint8_t EXPECTED[] = {TM_PARAM_INFO, 7, 0x34, 0x12, 0xD4, 0xC3, 0xB2, 0xA1, 0, 0, 0x80, 0x3F,
+                              'g', 'a', 'i', 'n'};
+  TEST_ASSERT_EQUAL(sizeof(EXPECTED), packet.Length());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(EXPECTED, packet.Data(), sizeof(EXPECTED));
+  TEST_ASSERT_FALSE(packet.Overflowed());
+
+  TelemetryReader reader(packet.Data() + 1, packet.Length() - 1);
+  uint8_t u8 = 0;
+  uint16_t u16 = 0;
+  uint32_t u32 = 0;
+  float f = 0.0f;
+  TEST_ASSERT_TRUE(reader.GetU8(u8) && reader.GetU16(u16) && reader.GetU32(u32) && reader.GetFloat(f));
+  TEST_ASSERT_EQUAL_UINT8(7, u8);
+  TEST_ASSERT_EQUAL_UINT16(0x1234, u16);
+  TEST_ASSERT_EQUAL_UINT32(0xA1B2C3D4u, u32);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, f);
+  TEST_ASSERT_EQUAL(4, reader.Remaining());  // The name
+  TEST_ASSERT_TRUE(reader.GetU16(u16));
+  TEST_ASSERT_FALSE(reader.GetU32(u32));
+  TEST_ASSERT_EQUAL_UINT32(0xA1B2C3D4u, u32);
+
+  // A payload that does not fit is flagged, and Send() refuses it
+  TelemetryPacket big(TM_TELEMETRY);
+  for (size_t i = 0; i < TELEMETRY_MAX_PAYLOAD; i++) {
+    big.PutU8(1);
+  }
+  TEST_ASSERT_TRUE(big.Overflowed());
+  TEST_ASSERT_EQUAL(TELEMETRY_MAX_PAYLOAD, big.Length());
+  TelemetryLink link;
+  link.Init({capture, nullptr});
+  TEST_ASSERT_FALSE(link.Send(big));
+  TEST_ASSERT_TRUE(wire.empty());
+}
+
+/**
+ * Whatever comes before a delimiter costs at most that one frame; the
+ * good frames after it all arrive
+ */
+void test_good_frames_survive_what_comes_before_their_delimiter() {
+  TelemetryLink sender, receiver;
+  sender.Init({capture, nullptr});
+  receiver.Init({nullptr, nullptr});
+  const std::vector<uint8_t> PING = {TM_PING};
+  const std::vector<uint8_t> SET = {TM_SET_PARAM, 3, 0, 0, 0x80, 0x3F};
+  const std::vector<uint8_t> GET = {TM_GET_PARAM, 0};
+
+  sender.Send(PING.data(), PING.size());
+  const char *text = "Note on: C4\r\n";  // Log text, then the switch's delimiter
+  wire.insert(wire.end(), text, text + strlen(text));
+  sender.SendDelimiter();
+  sender.Send(SET.data(), SET.size());
+  size_t corrupt = wire.size() + 2;
+  sender.Send(SET.data(), SET.size());   // One bit flipped below
+  size_t cut = wire.size();
+  sender.Send(SET.data(), SET.size());
+  wire.resize(cut + 4);                  // Cut off, then a reconnect's delimiter
+  wire.push_back(0);
+  for (int i = 0; i < 200; i++) {        // Line noise
+    wire.push_back((uint8_t)(1 + nextRandom() % 255));
+  }
+  wire.push_back(0);
+  wire.insert(wire.end(), 400, 'x');     // Longer than any frame
+  wire.push_back(0);
+  sender.Send(GET.data(), GET.size());
+  wire[corrupt] ^= 0x10;
+
+  std::vector<std::vector<uint8_t>> frames = receiveAll(receiver);
+  TEST_ASSERT_EQUAL(3, frames.size());
+  TEST_ASSERT_TRUE(frames[0] == PING);
+  TEST_ASSERT_TRUE(frames[1] == SET);
+  TEST_ASSERT_TRUE(frames[2] == GET);
+  TEST_ASSERT_EQUAL_UINT32(5, receiver.BadFrames());
+}
+
+void test_frame_without_room_is_dropped_whole() {
+  TelemetryLink link;
+  link.Init({capture, []() -> size_t { return 8; }});
+  const uint8_t LONG[40] = {TM_TELEMETRY};
+  const uint8_t PING[] = {TM_PING};
+  TEST_ASSERT_FALSE(link.Send(LONG, sizeof(LONG)));
+  TEST_ASSERT_TRUE(wire.empty());
+  TEST_ASSERT_EQUAL_UINT32(1, link.DroppedFrames());
+  TEST_ASSERT_TRUE(link.Send(PING, sizeof(PING)));
+  TEST_ASSERT_FALSE(wire.empty());
+}
+
+/**
+ * Random payloads of every length, many zeros, down and echoed back
+ */
+void test_random_payloads_loop_both_ways() {
+  TelemetryLink host, device;
+  host.Init({capture, nullptr});
+  device.Init({capture, nullptr});
+  uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+  for (int trip = 0; trip < 500; trip++) {
+    size_t length = 1 + (size_t)trip % TELEMETRY_MAX_PAYLOAD;
+    for (size_t i = 0; i < length; i++) {
+      payload[i] = nextRandom() % 3 == 0 ? 0 : nextRandom();
+    }
+    TEST_ASSERT_TRUE(host.Send(payload, length));
+    std::vector<std::vector<uint8_t>> down = receiveAll(device);
+    TEST_ASSERT_EQUAL(1, down.size());
+    TEST_ASSERT_EQUAL(length, down[0].size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, down[0].data(), length);
+
+    TEST_ASSERT_TRUE(device.Send(down[0].data(), down[0].size()));
+    std::vector<std::vector<uint8_t>> up = receiveAll(host);
+    TEST_ASSERT_EQUAL(1, up.size());
+    TEST_ASSERT_TRUE(up[0] == down[0]);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, host.BadFrames());
+  TEST_ASSERT_EQUAL_UINT32(0, device.BadFrames());
+}
+
+/////////////////////
+// Pseudo-terminal
+/////////////////////
+
+void writeFd(int fd, const uint8_t *data, size_t length) {
+  while (length > 0) {
+    ssize_t n = write(fd, data, length);
+    if (n <= 0) {
+      return;
+    }
+    data += n;
+    length -= (size_t)n;
+  }
+}
+
+void writeMaster(const uint8_t *data, size_t length) {
+  writeFd(ptyMaster, data, length);
+}
+
+void writeSlave(const uint8_t *data, size_t length) {
+  writeFd(ptySlave, data, length);
+}
+
+/**
+ * Feed what arrives on fd to the link until it completes a frame (false
+ * after a second without one)
+ */
+bool receiveFrom(int fd, TelemetryLink &link) {
+  uint8_t buffer[256];
+  pollfd ready = {fd, POLLIN, 0};
+  while (poll(&ready, 1, 1000) > 0) {
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    if (n <= 0) {
+      return false;
+    }
+    for (ssize_t i = 0; i < n; i++) {
+      if (link.Receive(buffer[i])) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * As between tools/telemetry.py on the master side and `program --pty` on
+ * the slave: a parameter write goes down and a telemetry frame comes back,
+ * both decoded field by field
+ */
+void test_frames_cross_a_pseudo_terminal() {
+  ptyMaster = posix_openpt(O_RDWR | O_NOCTTY);
+  TEST_ASSERT_TRUE(ptyMaster >= 0);
+  TEST_ASSERT_TRUE(grantpt(ptyMaster) == 0 && unlockpt(ptyMaster) == 0);
+  ptySlave = open(ptsname(ptyMaster), O_RDWR | O_NOCTTY);
+  TEST_ASSERT_TRUE(ptySlave >= 0);
+  termios settings;
+  tcgetattr(ptySlave, &settings);
+  cfmakeraw(&settings);
+  tcsetattr(ptySlave, TCSANOW, &settings);
+
+  TelemetryLink host, device;
+  host.Init({writeMaster, nullptr});
+  device.Init({writeSlave, nullptr});
+
+  TelemetryPacket setParam(TM_SET_PARAM);
+  setParam.PutU8(3);
+  setParam.PutFloat(0.05f);
+  TEST_ASSERT_TRUE(host.Send(setParam));
+  TEST_ASSERT_TRUE(receiveFrom(ptySlave, device));
+  TelemetryReader request(device.Payload(), device.PayloadLength());
+  uint8_t type = 0, id = 0;
+  float value = 0.0f;
+  TEST_ASSERT_TRUE(request.GetU8(type) && request.GetU8(id) && request.GetFloat(value));
+  TEST_ASSERT_EQUAL_UINT8(TM_SET_PARAM, type);
+  TEST_ASSERT_EQUAL_UINT8(3, id);
+  TEST_ASSERT_EQUAL_FLOAT(0.05f, value);
+
+  TelemetryPacket frame(TM_TELEMETRY);
+  frame.PutU32(123456789u);
+  frame.PutU16(125);  // CPU 12.5%, peak 40.0%
+  frame.PutU16(400);
+  frame.PutU8(2);
+  frame.PutFloat(-1.0f);  // No hand
+  frame.PutFloat(0.0f);   // Zero bytes to stuff
+  TEST_ASSERT_TRUE(device.Send(frame));
+  TEST_ASSERT_TRUE(receiveFrom(ptyMaster, host));
+  TEST_ASSERT_EQUAL(frame.Length(), host.PayloadLength());
+  TelemetryReader reply(host.Payload(), host.PayloadLength());
+  uint32_t micros = 0;
+  uint16_t cpu = 0, peak = 0;
+  uint8_t active = 0;
+  float distance = 0.0f, morph = 1.0f;
+  TEST_ASSERT_TRUE(reply.GetU8(type) && reply.GetU32(micros) && reply.GetU16(cpu) && reply.GetU16(peak) &&
+                   reply.GetU8(active) && reply.GetFloat(distance) && reply.GetFloat(morph));
+  TEST_ASSERT_EQUAL_UINT8(TM_TELEMETRY, type);
+  TEST_ASSERT_EQUAL_UINT32(123456789u, micros);
+  TEST_ASSERT_EQUAL_UINT16(125, cpu);
+  TEST_ASSERT_EQUAL_UINT16(400, peak);
+  TEST_ASSERT_EQUAL_UINT8(2, active);
+  TEST_ASSERT_EQUAL_FLOAT(-1.0f, distance);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, morph);
+  TEST_ASSERT_EQUAL_UINT32(0, host.BadFrames());
+  TEST_ASSERT_EQUAL_UINT32(0, device.BadFrames());
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_cobs_known_encodings);
+  RUN_TEST(test_cobs_round_trips_at_the_block_edges);
+  RUN_TEST(test_cobs_rejects_malformed_and_too_long);
+  RUN_TEST(test_fields_are_little_endian_and_bounded);
+  RUN_TEST(test_good_frames_survive_what_comes_before_their_delimiter);
+  RUN_TEST(test_frame_without_room_is_dropped_whole);
+  RUN_TEST(test_random_payloads_loop_both_ways);
+  RUN_TEST(test_frames_cross_a_pseudo_terminal);
+  return UNITY_END();
+}
@@ -0,0 +1,150 @@
+"""
+Memory placement report for the Daisy Seed firmware
+
+Lists how full each STM32H750 memory region is and which symbols landed
+in ITCM, DTCM and SDRAM (see include/MemoryPlacement.h), largest first.
+Hot code that slipped back into flash, or a DMA buffer in DTCM, shows up
+here before it shows up in the CPU report.
+
+Region totals come from the section headers: a section loaded from flash
+and run elsewhere (ITCM code, DTCM_DATA, .data) counts in both places,
+since its image takes space in the 128 KB of flash too.
+
+Runs after every firmware build as a PlatformIO extra script
+(platformio.ini: extra_scripts = post:tools/memory_report.py), or by hand:
+    python3 tools/memory_report.py .pio/build/electrosmith_daisy/firmware.elf
+"""
+
+import os
+import subprocess
+import sys
+
+# name, start, length (bytes), whether to list its symbols
+REGIONS = [
+    ("ITCM", 0x00000000, 64 * 1024, True),
+    ("FLASH", 0x08000000, 128 * 1024, False),
+    ("DTCM", 0x20000000, 128 * 1024, True),
+    ("AXI SRAM", 0x24000000, 512 * 1024, False),
+    ("SRAM D2", 0x30000000, 288 * 1024, False),
+    ("SRAM D3", 0x38000000, 64 * 1024, False),
+    ("QSPI", 0x90000000, 8 * 1024 * 1024, False),
+    ("SDRAM", 0xC0000000, 64 * 1024 * 1024, True),
+]
+
+# Symbols the placement exists for, and where they must be
+EXPECTED = [
+    ("AudioCallback", "ITCM"),
+    ("SynthEngine::renderBlock", "ITCM"),
+    ("synth", "DTCM"),
+]
+
+SYMBOLS_PER_REGION = 20
+
+
+def region_of(address):
+    for name, start, length, _ in REGIONS:
+        if start <= address < start + length:
+            return name
+    return None
+
+
+def read_sections(elf, objdump):
+    """(name, size, run address, load address, loaded) of every allocated section"""
+    lines = subprocess.check_output([objdump, "-h", elf], universal_newlines=True).splitlines()
+    sections = []
+    for line, flags in zip(lines, lines[1:]):
+        fields = line.split()
+        if len(fields) != 7 or not fields[0].isdigit() or "ALLOC" not in flags:
+            continue
+        sections.append((fields[1], int(fields[2], 16), int(fields[3], 16), int(fields[4], 16), "LOAD" in flags))
+    return sections
+
+
+def read_symbols(elf, nm):
+    """(address, size, type, name) of every sized symbol"""
+    output = subprocess.check_output([nm, "-S", "-C", "--defined-only", elf], universal_newlines=True)
+    symbols = []
+    for line in output.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) < 4:
+            continue  # No size: labels and linker symbols
+        address, size, kind, name = fields
+        symbols.append((int(address, 16), int(size, 16), kind, name))
+    return symbols
+
+
+def short_name(name):
+    """Demangled name without the argument list"""
+    return name.split("(")[0]
+
+
+def report(elf, nm, objdump):
+    used = dict((name, 0) for name, _, _, _ in REGIONS)
+    images = []
+    for section, size, run, load, loaded in read_sections(elf, objdump):
+        region = region_of(run)
+        if region is not None:
+            used[region] += size
+        if loaded and load != run and region_of(load) is not None:
+            used[region_of(load)] += size
+            images.append("%s %d" % (section, size))
+
+    listed = dict((name, []) for name, _, _, _ in REGIONS)
+    placed = {}
+    for address, size, kind, name in read_symbols(elf, nm):
+        region = region_of(address)
+        if region is None:
+            continue
+        listed[region].append((size, kind, name))
+        placed[short_name(name)] = region
+
+    print("Memory placement (%s)" % os.path.basename(elf))
+    for name, _, length, _ in REGIONS:
+        print("  %-8s %9d / %9d bytes (%5.1f%%)" % (name, used[name], length, 100.0 * used[name] / length))
+    if images:
+        print("  load images (in the totals at both addresses): %s" % ", ".join(images))
+
+    for name, _, _, list_symbols in REGIONS:
+        if not list_symbols:
+            continue
+        entries = sorted(listed[name], reverse=True)
+        print("  %s: %d symbols" % (name, len(entries)))
+        for size, kind, symbol in entries[:SYMBOLS_PER_REGION]:
+            print("    %8d %s %s" % (size, kind, short_name(symbol)))
+        if len(entries) > SYMBOLS_PER_REGION:
+            print("    ... %d more" % (len(entries) - SYMBOLS_PER_REGION))
+
+    misplaced = 0
+    for symbol, region in EXPECTED:
+        actual = placed.get(symbol)
+        if actual != region:
+            print("  warning: %s is in %s, expected %s" % (symbol, actual or "no region", region))
+            misplaced += 1
+    return misplaced
+
+
+def tool_for(size_tool, tool):
+    """arm-none-eabi-<tool> next to the toolchain's arm-none-eabi-size"""
+    if size_tool.endswith("size"):
+        return size_tool[:-len("size")] + tool
+    return "arm-none-eabi-" + tool
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("usage: memory_report.py firmware.elf [arm-none-eabi-size]")
+        sys.exit(2)
+    size_tool = sys.argv[2] if len(sys.argv) > 2 else "arm-none-eabi-size"
+    misplaced = report(sys.argv[1], tool_for(size_tool, "nm"), tool_for(size_tool, "objdump"))
+    sys.exit(1 if misplaced else 0)
+
+# PlatformIO extra script: report after the firmware links
+Import("env")  # noqa: F821
+
+
+def after_build(source, target, env):
+    size_tool = env.subst("$SIZETOOL")
+    report(str(source[0]), tool_for(size_tool, "nm"), tool_for(size_tool, "objdump"))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", after_build)  # noqa: F821
@@ -0,0 +1,289 @@
+"""
+Telemetry client for the instrument's serial port
+
+Switches the firmware's serial port to binary frames (the 'b' command) and
+speaks the protocol in include/TelemetryLink.h: COBS-framed payloads with a
+CRC-16/CCITT-FALSE, fields little-endian. Standard library only.
+
+    python3 tools/telemetry.py PORT ping
+    python3 tools/telemetry.py PORT list
+    python3 tools/telemetry.py PORT get attack
+    python3 tools/telemetry.py PORT set attack 0.05
+    python3 tools/telemetry.py PORT watch [rate]     (Ctrl-C stops)
+    python3 tools/telemetry.py PORT shell            (commands from stdin)
+    python3 tools/telemetry.py PORT exit             (back to log text)
+
+PORT is the Seed's USB serial device (/dev/ttyACM0, /dev/cu.usbmodem...),
+or the pseudo-terminal `program --pty` prints. Settings written here last
+until the next reboot.
+"""
+
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+VERSION = 1
+
+TM_PING = 0x01
+TM_GET_PARAM = 0x02
+TM_SET_PARAM = 0x03
+TM_GET_INFO = 0x04
+TM_SET_RATE = 0x05
+TM_EXIT = 0x06
+TM_PONG = 0x81
+TM_PARAM = 0x82
+TM_PARAM_INFO = 0x83
+TM_RATE = 0x84
+TM_TELEMETRY = 0x85
+TM_ERROR = 0xFF
+
+ERRORS = {1: "unknown message", 2: "bad length", 3: "unknown parameter", 4: "rejected"}
+STAGES = ["idle", "attack", "decay", "sustain", "release"]
+
+REPLY_TIMEOUT = 1.0
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as presetCrc16()"""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code = 0
+    for byte in data:
+        if byte == 0:
+            out[code] = len(out) - code
+            code = len(out)
+            out.append(0)
+            continue
+        out.append(byte)
+        if len(out) - code == 0xFF:
+            out[code] = 0xFF
+            code = len(out)
+            out.append(0)
+    out[code] = len(out) - code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    """Decoded bytes, or None if the frame is malformed"""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            return None
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frame(payload):
+    return cobs_encode(payload + struct.pack("<H", crc16(payload))) + b"\0"
+
+
+class Link(object):
+    def __init__(self, path):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        settings = termios.tcgetattr(self.fd)
+        settings[4] = settings[5] = termios.B115200  # Ignored by USB CDC, but set anyway
+        termios.tcsetattr(self.fd, termios.TCSANOW, settings)
+        self.rx = bytearray()
+        self.bad_frames = 0
+        self.params = []
+
+    def close(self):
+        os.close(self.fd)
+
+    def send(self, payload):
+        os.write(self.fd, frame(payload))
+
+    def receive(self, timeout):
+        """Next valid payload, or None after timeout seconds"""
+        deadline = time.time() + timeout
+        while True:
+            end = self.rx.find(b"\0")
+            if end >= 0:
+                raw = bytes(self.rx[:end])
+                del self.rx[:end + 1]
+                if not raw:
+                    continue
+                decoded = cobs_decode(raw)
+                if decoded is None or len(decoded) < 3 or \
+                        struct.unpack("<H", decoded[-2:])[0] != crc16(decoded[:-2]):
+                    self.bad_frames += 1  # Log text before the switch lands here too
+                    continue
+                return decoded[:-2]
+            remaining = deadline - time.time()
+            if remaining <= 0 or not select.select([self.fd], [], [], remaining)[0]:
+                return None
+            self.rx += os.read(self.fd, 4096)
+
+    def request(self, payload, reply_types):
+        """Send a request and return its reply (telemetry frames in between are skipped)"""
+        self.send(payload)
+        deadline = time.time() + REPLY_TIMEOUT
+        while time.time() < deadline:
+            reply = self.receive(deadline - time.time())
+            if reply is None:
+                break
+            if reply[0] == TM_ERROR:
+                raise RuntimeError("device: %s" % ERRORS.get(reply[1], "error %d" % reply[1]))
+            if reply[0] in reply_types:
+                return reply
+        raise RuntimeError("no reply")
+
+    def connect(self):
+        """Switch the port to frames and read the parameter table"""
+        os.write(self.fd, b"\0b")  # A lone delimiter is ignored as a command key
+        pong = None
+        deadline = time.time() + REPLY_TIMEOUT
+        while pong is None and time.time() < deadline:
+            reply = self.receive(deadline - time.time())
+            if reply is not None and reply[0] == TM_PONG:
+                pong = reply
+        if pong is None:
+            # Already in binary mode: end the frame the 'b' started and ask again
+            os.write(self.fd, b"\0")
+            pong = self.request(bytes([TM_PING]), [TM_PONG])
+        version, count = pong[1], pong[2]
+        if version != VERSION:
+            raise RuntimeError("device speaks protocol %d, this client %d" % (version, VERSION))
+        self.params = []
+        for param in range(count):
+            info = self.request(bytes([TM_GET_INFO, param]), [TM_PARAM_INFO])
+            _, value, low, high = struct.unpack("<Bfff", info[1:14])
+            self.params.append((info[14:].decode("ascii"), value, low, high))
+
+    def param_id(self, name):
+        for param, info in enumerate(self.params):
+            if info[0] == name:
+                return param
+        raise RuntimeError("no parameter %s (try list)" % name)
+
+    def get(self, name):
+        reply = self.request(bytes([TM_GET_PARAM, self.param_id(name)]), [TM_PARAM])
+        return struct.unpack("<f", reply[2:6])[0]
+
+    def set(self, name, value):
+        reply = self.request(struct.pack("<BBf", TM_SET_PARAM, self.param_id(name), value), [TM_PARAM])
+        return struct.unpack("<f", reply[2:6])[0]
+
+    def set_rate(self, rate):
+        reply = self.request(struct.pack("<BH", TM_SET_RATE, rate), [TM_RATE])
+        return struct.unpack("<H", reply[1:3])[0]
+
+    def exit(self):
+        self.send(bytes([TM_EXIT]))
+
+
+def parse_telemetry(payload):
+    fields = struct.unpack("<IHHBfffffB", payload[1:31])
+    voices = []
+    for voice in range(fields[9]):
+        note, stage, level = struct.unpack("<BBH", payload[31 + 4 * voice:35 + 4 * voice])
+        voices.append((None if note == 0xFF else note, stage, level / 65535.0))
+    return {
+        "micros": fields[0], "cpu": fields[1] / 10.0, "cpu_peak": fields[2] / 10.0, "active": fields[3],
+        "distance": fields[4], "morph": fields[5], "tilt": fields[6], "bend": fields[7], "volume": fields[8],
+        "voices": voices,
+    }
+
+
+def print_telemetry(t):
+    distance = "  -  " if t["distance"] < 0 else "%5.0f" % t["distance"]
+    voices = " ".join("%d:%s:%.2f" % (v[0], STAGES[v[1]] if v[1] < len(STAGES) else v[1], v[2])
+                      for v in t["voices"] if v[0] is not None)
+    print("%10.3f s  cpu %5.1f%% (peak %5.1f%%)  dist %s mm  morph %.2f  tilt %5.2f  bend %5.2f  vol %.2f  "
+          "voices %d %s" % (t["micros"] / 1e6, t["cpu"], t["cpu_peak"], distance, t["morph"], t["tilt"],
+                            t["bend"], t["volume"], t["active"], voices))
+    sys.stdout.flush()
+
+
+def watch(link, rate):
+    print("Streaming at %d Hz (Ctrl-C stops)" % link.set_rate(rate))
+    try:
+        while True:
+            payload = link.receive(REPLY_TIMEOUT)
+            if payload is not None and payload[0] == TM_TELEMETRY:
+                print_telemetry(parse_telemetry(payload))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        link.set_rate(0)
+
+
+def run(link, words):
+    command = words[0]
+    if command == "ping":
+        link.request(bytes([TM_PING]), [TM_PONG])
+        print("pong (protocol %d, %d parameters)" % (VERSION, len(link.params)))
+    elif command == "list":
+        for name, value, low, high in link.params:
+            print("%-20s %10.4f   [%g .. %g]" % (name, value, low, high))
+    elif command == "get" and len(words) == 2:
+        print("%s = %g" % (words[1], link.get(words[1])))
+    elif command == "set" and len(words) == 3:
+        print("%s = %g" % (words[1], link.set(words[1], float(words[2]))))
+    elif command == "watch":
+        watch(link, int(words[1]) if len(words) > 1 else 20)
+    elif command == "exit":
+        link.exit()
+    else:
+        raise RuntimeError("unknown command: %s" % " ".join(words))
+
+
+def shell(link):
+    print("Commands: list, get NAME, set NAME VALUE, watch [RATE], ping, quit")
+    while True:
+        try:
+            line = input("> ")
+        except EOFError:
+            break
+        words = line.split()
+        if not words:
+            continue
+        if words[0] in ("quit", "exit"):
+            break
+        try:
+            run(link, words)
+        except (RuntimeError, ValueError) as error:
+            print(error)
+
+
+def main(argv):
+    if len(argv) < 3:
+        print(__doc__.strip())
+        return 2
+    link = Link(argv[1])
+    try:
+        link.connect()
+        if argv[2] == "shell":
+            shell(link)
+        else:
+            run(link, argv[2:])
+    except (RuntimeError, ValueError) as error:
+        print(error)
+        return 1
+    finally:
+        link.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))